@@ -3,81 +3,150 @@
 #ifdef _CAPTURE_USE_LNFQ_
 
 static capture_handle_t capture_handle;
+/* the event loop serving the queues, NULL if there is a thread per queue: */
+static struct event_loop* capture_event_loop = NULL;
+/* orders capture_stop_all() with the start of the capture in capture_up_all(): */
+static pthread_mutex_t capture_stop_lock = PTHREAD_MUTEX_INITIALIZER;
+/* set once the capture threads or the event loop run: */
+static int capture_started = 0;
+/* set once the capture is to stop: */
+static int capture_stopping = 0;
 
-/** Initializes packet capturing.
-    Opens a netfilter library handle and a queue handle for queue-num CAPTURE_LNFQ_QUEUE_NUM.
-*/
-void capture_up_all() {
-    capture_handle_t new_handle;
-    struct nfq_handle *library_handle;
-    struct nfq_q_handle *queue_handle;
-    struct nlif_handle *interface_resolving_handle;
+/* Makes the capture threads (or the event loop threads) finish, called
+ * with the stop lock held once the capture is started. */
+static void capture_stop_threads() {
+    int i;
 
-    capture_handle = NULL;
-    library_handle = nfq_open();
-    if (!library_handle) {
-        fprintf(stderr, "[capture_lnfq] Error during nfq_open()\n");
-        exit(1);
+    if (capture_event_loop!=NULL) {
+        /* the handlers finish their batch, no thread is cancelled: */
+        event_loop_stop(capture_event_loop);
+        return;
     }
-    if (nfq_unbind_pf(library_handle, PF_INET6) < 0) {
-        fprintf(stderr, "[capture_lnfq] WARNING: could not nfq_unbind_pf()\n");
+    for (i=0; i<capture_handle->queue_count; i++) {
+        pthread_cancel(capture_handle->queues[i].capture_thread);
     }
-    if (nfq_bind_pf(library_handle, PF_INET6) < 0) {
-        fprintf(stderr, "[capture_lnfq] ERROR: during nfq_bind_pf()\n");
-        exit(1);
+}
+
+/* Marks the capture as started, stops it at once if it was asked to stop meanwhile. */
+static void capture_started_set() {
+    pthread_mutex_lock(&capture_stop_lock);
+    capture_started = 1;
+    if (capture_stopping) {
+        capture_stop_threads();
     }
-    queue_handle = nfq_create_queue(library_handle,  CAPTURE_LNFQ_QUEUE_NUM, &capture_lnfq_callback, NULL);
-    if (!queue_handle) {
-        fprintf(stderr, "[capture_lnfq] ERROR: during nfq_create_queue()\n");
-        exit(1);
+    pthread_mutex_unlock(&capture_stop_lock);
+}
+
+static void capture_lnfq_settings_defaults(struct capture_lnfq_settings* settings) {
+    memset(settings, 0, sizeof(struct capture_lnfq_settings));
+    settings->queue_first  = CAPTURE_LNFQ_QUEUE_NUM;
+    settings->queue_count  = 1;
+    settings->queue_maxlen = 4096;
+    settings->rcvbuf       = 8*1024*1024;
+    settings->batch        = 32;
+    settings->fail_open    = 1;
+}
+
+/* Copies the configured settings, the defaults if there is no nfqueue element. */
+static void capture_lnfq_settings_get(struct capture_lnfq_settings* settings) {
+    struct extinfo_list** extinfo;
+    struct capture_lnfq_settings* configured;
+
+    extinfo = settings_extinfo_lock();
+    configured = extinfo_list_get_data(*extinfo, "nfqueue");
+    if (configured!=NULL) {
+        memcpy(settings, configured, sizeof(struct capture_lnfq_settings));
+    } else {
+        capture_lnfq_settings_defaults(settings);
     }
-    if (nfq_set_queue_maxlen(queue_handle, 4096) < 0) {
+    settings_extinfo_unlock();
+}
+
+/* Releases the handles of a queue (the thread must be stopped). */
+static void capture_lnfq_queue_close(struct capture_lnfq_queue* queue) {
+    if (DEBUG) {
+        fprintf(stderr, "    unbinding from queue %u\n", queue->queue_num);
+    }
+    if (queue->queue_handle!=NULL) {
+        nfq_destroy_queue(queue->queue_handle);
+    }
+    /* closing interface resolving library (nlif):
+     * (must be released AFTER destroying the queue!)
+     * */
+    if (queue->interface_resolving_handle!=NULL) {
+        nlif_close(queue->interface_resolving_handle);
+    }
+    if (queue->library_handle!=NULL) {
+        nfq_close(queue->library_handle);
+    }
+    free(queue->buffer);
+    free(queue->frame);
+}
+
+/* Opens a library handle and binds it to a queue. */
+static int capture_lnfq_queue_open(struct capture_lnfq_queue* queue, const struct capture_lnfq_settings* settings, int bind_pf) {
+    queue->library_handle = nfq_open();
+    if (!queue->library_handle) {
+        fprintf(stderr, "[capture_lnfq] Error during nfq_open()\n");
+        return -1;
+    }
+    if (bind_pf) {
+        if (nfq_unbind_pf(queue->library_handle, PF_INET6) < 0) {
+            fprintf(stderr, "[capture_lnfq] WARNING: could not nfq_unbind_pf()\n");
+        }
+        if (nfq_bind_pf(queue->library_handle, PF_INET6) < 0) {
+            fprintf(stderr, "[capture_lnfq] ERROR: during nfq_bind_pf()\n");
+            return -1;
+        }
+    }
+    queue->queue_handle = nfq_create_queue(queue->library_handle, queue->queue_num, &capture_lnfq_callback, queue);
+    if (!queue->queue_handle) {
+        fprintf(stderr, "[capture_lnfq] ERROR: during nfq_create_queue() for queue %u\n", queue->queue_num);
+        return -1;
+    }
+    if (nfq_set_queue_maxlen(queue->queue_handle, settings->queue_maxlen) < 0) {
         fprintf(stderr, "[capture_lnfq] ERROR: can't set maxlength\n");
-        exit(1);
+        return -1;
     }
-    if (nfq_set_mode(queue_handle, NFQNL_COPY_PACKET, 0xffff) < 0) {
+    if (nfq_set_mode(queue->queue_handle, NFQNL_COPY_PACKET, 0xffff) < 0) {
         fprintf(stderr, "[capture_lnfq] ERROR: can't set packet_copy mode\n");
-        exit(1);
+        return -1;
+    }
+#ifdef NFQA_CFG_F_FAIL_OPEN
+    /* let packets pass instead of dropping them when the queue is full: */
+    if (settings->fail_open
+            && nfq_set_queue_flags(queue->queue_handle, NFQA_CFG_F_FAIL_OPEN, NFQA_CFG_F_FAIL_OPEN) < 0) {
+        fprintf(stderr, "[capture_lnfq] WARNING: can't set fail-open mode, not supported by the kernel?\n");
+    }
+#else
+    if (settings->fail_open) {
+        fprintf(stderr, "[capture_lnfq] WARNING: fail-open mode not supported by libnetfilter_queue.\n");
     }
+#endif
+    /* a larger socket buffer absorbs bursts: */
+    nfnl_rcvbufsiz(nfq_nfnlh(queue->library_handle), settings->rcvbuf);
     /* prepare the resolving of interface IDs to names: */
-    interface_resolving_handle = nlif_open();
-    if (interface_resolving_handle == NULL) {
+    queue->interface_resolving_handle = nlif_open();
+    if (queue->interface_resolving_handle == NULL) {
         fprintf(stderr, "[capture_lnfq] ERROR: can't init interface name resolving (nlif).\n");
-        exit(1);
+        return -1;
     }
-    nlif_query(interface_resolving_handle);
+    nlif_query(queue->interface_resolving_handle);
 
-    /* creating the capture handle containing all information */
-    if ((new_handle=malloc(sizeof(struct capture_descriptor)))==NULL) {
+    if ((queue->buffer=malloc(CAPTURE_LNFQ_BUFFER_SIZE))==NULL
+            || (queue->frame=malloc(sizeof(struct ether_header)+CAPTURE_LNFQ_BUFFER_SIZE))==NULL) {
         perror("[capture_lnfq] malloc failed.");
-        exit(1);
+        return -1;
     }
-    new_handle->library_handle = library_handle;
-    new_handle->queue_handle = queue_handle;
-    new_handle->interface_resolving_handle = interface_resolving_handle;
-    new_handle->file_descriptor = 0;
-    capture_handle = new_handle;
-    pthread_create(&new_handle->capture_thread, NULL, capture_loop, NULL);
-    /* join the capturing thread to prevent the main program from exiting. */
-    pthread_join(new_handle->capture_thread, NULL);
-
+    queue->batch = settings->batch;
+    return 0;
 }
 
-/** Starts the packet capturing loop.
-    @param unused This thread does not recieve any params.
-*/
-void* capture_loop(void* unused) {
-    int file_descriptor;
-    int recieved;
-    char buffer[4096] __attribute__ ((aligned));
+/* Sends the up events of the probes, once for all queues. */
+static void capture_lnfq_announce() {
     struct probe_list** locked_probes;
     struct probe_list*  tmp_probes;
 
-    pthread_setcanceltype(capture_handle->capture_thread, PTHREAD_CANCEL_DEFERRED);
-    if (capture_handle==NULL) {
-        fprintf(stderr, "[capture_lnfq] Error: capture_handle not initialized.\n");
-        return NULL;
-    }
     /* critical section: */
     locked_probes = probe_list_lock();
     tmp_probes = *locked_probes;
@@ -89,55 +158,202 @@ void* capture_loop(void* unused) {
     tmp_probes = NULL;
     probe_list_unlock();
     /* end critical section: */
-    file_descriptor = nfq_fd(capture_handle->library_handle);
-    fprintf(stderr, "[capture_lnfq] netfilter_queue up and listening on queue %u...\n", CAPTURE_LNFQ_QUEUE_NUM);
+}
+
+/* Prints that a queue is listening. */
+static void capture_lnfq_listening(struct capture_lnfq_queue* queue) {
+    fprintf(stderr, "[capture_lnfq] netfilter_queue up and listening on queue %u...\n", queue->queue_num);
     if (DEBUG) {
-        fprintf(stderr, "    file descriptor is %i.\n", file_descriptor);
+        fprintf(stderr, "    file descriptor is %i.\n", nfq_fd(queue->library_handle));
+    }
+    fprintf(stderr, "    if nothing is captured, use ip6tables to configure NFQUEUE %u.\n", queue->queue_num);
+}
+
+/* Serves all queues by the threads of an event loop. */
+static void capture_lnfq_up_loop(const struct event_loop_settings* loop_settings) {
+    int i;
+
+    if ((capture_event_loop=event_loop_create())==NULL) {
+        exit(1);
     }
-    fprintf(stderr, "    if nothing is captured, use ip6tables to configure NFQUEUE 0.\n");
-    while ((recieved = recv(file_descriptor, buffer, sizeof(buffer), 0)) && recieved >= 0) {
-        nfq_handle_packet(capture_handle->library_handle, buffer, recieved);
+    for (i=0; i<capture_handle->queue_count; i++) {
+        if (event_loop_add(capture_event_loop, nfq_fd(capture_handle->queues[i].library_handle),
+                capture_lnfq_dispatch, &capture_handle->queues[i])==-1) {
+            exit(1);
+        }
+    }
+    capture_lnfq_announce();
+    for (i=0; i<capture_handle->queue_count; i++) {
+        capture_lnfq_listening(&capture_handle->queues[i]);
+    }
+    if (event_loop_start(capture_event_loop, loop_settings->threads)==-1) {
+        exit(1);
+    }
+    capture_started_set();
+    /* keep the main program running until capture_stop_all(): */
+    event_loop_wait(capture_event_loop);
+}
+
+/** Initializes packet capturing.
+    Opens a netfilter library handle and a queue handle for each configured queue.
+*/
+void capture_up_all() {
+    capture_handle_t new_handle;
+    struct capture_lnfq_settings settings;
+    struct event_loop_settings loop_settings;
+    int i;
+
+    capture_handle = NULL;
+    capture_lnfq_settings_get(&settings);
+    event_loop_settings_get(&loop_settings);
+
+    /* creating the capture handle containing all information */
+    if ((new_handle=malloc(sizeof(struct capture_descriptor)))==NULL) {
+        perror("[capture_lnfq] malloc failed.");
+        exit(1);
+    }
+    memset(new_handle, 0, sizeof(struct capture_descriptor));
+    for (i=0; i<settings.queue_count; i++) {
+        new_handle->queues[i].queue_num = settings.queue_first + i;
+        if (capture_lnfq_queue_open(&new_handle->queues[i], &settings, i==0)==-1) {
+            exit(1);
+        }
+        new_handle->queue_count++;
+    }
+    capture_handle = new_handle;
+    if (loop_settings.enabled) {
+        capture_lnfq_up_loop(&loop_settings);
+        return;
+    }
+    for (i=0; i<new_handle->queue_count; i++) {
+        pthread_create(&new_handle->queues[i].capture_thread, NULL, capture_loop, &new_handle->queues[i]);
+    }
+    capture_started_set();
+    /* join the capturing threads to prevent the main program from exiting
+     * until capture_stop_all(). */
+    for (i=0; i<new_handle->queue_count; i++) {
+        pthread_join(new_handle->queues[i].capture_thread, NULL);
+    }
+
+}
+
+/* Issues the verdict for the accepted packets without one. */
+static void capture_lnfq_flush(struct capture_lnfq_queue* queue) {
+    if (queue->pending==0) {
+        return;
+    }
+    /* accepts all packets up to pending_id: */
+    nfq_set_verdict_batch(queue->queue_handle, queue->pending_id, NF_ACCEPT, 0);
+    queue->pending = 0;
+}
+
+/* Receives the packets waiting on a queue, up to a verdict window, and
+ * issues the verdict. Without MSG_DONTWAIT in flags it first waits for a
+ * packet. Returns -1 if the socket failed. */
+static int capture_lnfq_receive(struct capture_lnfq_queue* queue, int flags) {
+    int file_descriptor = nfq_fd(queue->library_handle);
+    int recieved;
+
+    while ((recieved = recv(file_descriptor, queue->buffer, CAPTURE_LNFQ_BUFFER_SIZE, flags)) >= 0
+            || errno==ENOBUFS) {
+        if (recieved < 0) {
+            /* the socket buffer overflowed, the kernel dropped messages: */
+            queue->overruns++;
+            if (DEBUG) {
+                fprintf(stderr, "[capture_lnfq] queue %u: receive buffer overrun.\n", queue->queue_num);
+            }
+            continue;
+        }
+        nfq_handle_packet(queue->library_handle, queue->buffer, recieved);
+        if (queue->pending >= queue->batch) {
+            break;
+        }
+        flags |= MSG_DONTWAIT;
+    }
+    capture_lnfq_flush(queue);
+    if (recieved < 0 && errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR) {
+        perror("[capture_lnfq] recv failed");
+        return -1;
+    }
+    return 0;
+}
+
+/** Starts the packet capturing loop.
+    @param args The queue to receive from.
+*/
+void* capture_loop(void* args) {
+    struct capture_lnfq_queue* queue = (struct capture_lnfq_queue*) args;
+
+    pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
+    if (capture_handle==NULL) {
+        fprintf(stderr, "[capture_lnfq] Error: capture_handle not initialized.\n");
+        return NULL;
+    }
+    if (queue==&capture_handle->queues[0]) {
+        capture_lnfq_announce();
+    }
+    capture_lnfq_listening(queue);
+    /* wait for a packet, then take what is already there (up to a
+     * verdict window) before the accepted packets are released: */
+    while (capture_lnfq_receive(queue, 0)==0) {
         pthread_testcancel();
     }
     return NULL;
 }
 
+int capture_lnfq_dispatch(void* args) {
+    struct capture_lnfq_queue* queue = (struct capture_lnfq_queue*) args;
+
+    return capture_lnfq_receive(queue, MSG_DONTWAIT);
+}
+
+void capture_stop_all() {
+    pthread_mutex_lock(&capture_stop_lock);
+    if (!capture_stopping) {
+        capture_stopping = 1;
+        if (capture_started) {
+            capture_stop_threads();
+        }
+    }
+    pthread_mutex_unlock(&capture_stop_lock);
+}
+
 void capture_down_all(void) {
+    int i;
 
+    /* the threads were joined by capture_up_all(), a late stop has nothing to do: */
+    pthread_mutex_lock(&capture_stop_lock);
+    capture_started = 0;
+    capture_stopping = 1;
+    pthread_mutex_unlock(&capture_stop_lock);
     if (capture_handle==NULL) {
         return;
     }
     if (DEBUG) {
         fprintf(stderr, "[capture_lnfq] Stop listening on netfilter_queue... \n");
     }
-    pthread_cancel(capture_handle->capture_thread);
-    pthread_join(capture_handle->capture_thread, NULL);
+    event_loop_free(capture_event_loop);
+    capture_event_loop = NULL;
     /* lnfq cleanup: */
-    if (DEBUG) {
-        fprintf(stderr, "    unbinding from queue %u\n", CAPTURE_LNFQ_QUEUE_NUM);
-    }
-    nfq_destroy_queue(capture_handle->queue_handle);
-    /* closing interface resolving library (nlif):
-     * (must be released AFTER destroying the queue!)
-     * */
-    if (DEBUG) {
-        fprintf(stderr, "    closing interface resolving handle\n");
-    }
-    nlif_close(capture_handle->interface_resolving_handle);
-    if (DEBUG) {
-        fprintf(stderr, "    closing library handle\n");
+    for (i=0; i<capture_handle->queue_count; i++) {
+        if (capture_handle->queues[i].overruns>0) {
+            fprintf(stderr, "[capture_lnfq] queue %u: %lu receive buffer overruns.\n",
+                    capture_handle->queues[i].queue_num, capture_handle->queues[i].overruns);
+        }
+        capture_lnfq_queue_close(&capture_handle->queues[i]);
     }
-    nfq_close(capture_handle->library_handle);
     /* free handle: */
     if (DEBUG) {
         fprintf(stderr, "    handle cleanup.\n");
     }
     free(capture_handle);
+    capture_handle = NULL;
     if (DEBUG) {
         fprintf(stderr, "    Stopped netfilter_queue.\n");
     }
 }
 
+
 #if 0
 /** Prints packet information for debug mode.
 */
@@ -171,9 +387,17 @@ static u_int32_t print_pkt (struct nfq_data *tb) {
 }
 #endif
 
+/* Accepts a packet, the verdict is issued for a window of packets. */
+static int capture_lnfq_accept(struct capture_lnfq_queue* queue, uint32_t packet_id) {
+    queue->pending_id = packet_id;
+    queue->pending++;
+    return 0;
+}
+
 /** Function called each time that a packet pass the filter and is captured.
 */
 int capture_lnfq_callback(struct nfq_q_handle *queue_handle, struct nfgenmsg *nfmsg, struct nfq_data *nfa, void *data) {
+    struct capture_lnfq_queue* queue = (struct capture_lnfq_queue*) data;
     const time_t* time;
 
     /* packet information: */
@@ -182,7 +406,7 @@ int capture_lnfq_callback(struct nfq_q_handle *queue_handle, struct nfgenmsg *nf
     int                          packet_length;
     unsigned char*               packet_data;
     char                         packet_interface[PROBE_NAME_SIZE];
-    uint8_t*                     packet_with_pseudo;
+    uint8_t*                     packet_with_pseudo = queue->frame;
     struct timeval               timestamp;
     struct ether_header*         pseudo_ether_header;
     struct nfqnl_msg_packet_hw*  packet_hw;
@@ -203,19 +427,18 @@ int capture_lnfq_callback(struct nfq_q_handle *queue_handle, struct nfgenmsg *nf
     
     /* get the packet's data and length: */
     packet_length = nfq_get_payload(nfa, &packet_data);
+    if (packet_length < 0 || packet_length > CAPTURE_LNFQ_BUFFER_SIZE) {
+        return capture_lnfq_accept(queue, packet_id);
+    }
 
     /* get the packet's source hardware address */
     packet_hw = nfq_get_packet_hw(nfa);
     if (packet_hw==NULL) {
         fprintf(stderr, "[capture_lnfq] error retrieving packet source hardware address.");
-        return nfq_set_verdict(queue_handle, packet_id, NF_ACCEPT, 0, NULL);
+        return capture_lnfq_accept(queue, packet_id);
     }
     
     /* build a pseudo ethernet header: */
-    if ((packet_with_pseudo=malloc(sizeof(struct ether_header)+packet_length))==NULL) {
-        perror("malloc");
-        exit(1);
-    }
     pseudo_ether_header = (struct ether_header*) packet_with_pseudo;
     /* initialise pseudo ethernet header: */
     memset(pseudo_ether_header, 0, sizeof(struct ether_header));
@@ -227,9 +450,9 @@ int capture_lnfq_callback(struct nfq_q_handle *queue_handle, struct nfgenmsg *nf
     packet_length = packet_length + sizeof(struct ether_header);
 
     /* get the packet's indev name: */
-    if (nfq_get_indev_name(capture_handle->interface_resolving_handle, nfa, packet_interface)<0) {
+    if (nfq_get_indev_name(queue->interface_resolving_handle, nfa, packet_interface)<0) {
         fprintf(stderr, "[capture_lnfq] error resolving interface name, packet ignored");
-        return nfq_set_verdict(queue_handle, packet_id, NF_ACCEPT, 0, NULL);
+        return capture_lnfq_accept(queue, packet_id);
     }
     /* get the packet's timestamp: */
     /* cannot use nfq_get_timestamp(nfa, &timestamp), keeps on failing. seems to be an lnfq issue according to internet research.
@@ -261,12 +484,11 @@ int capture_lnfq_callback(struct nfq_q_handle *queue_handle, struct nfgenmsg *nf
                 packet_result = capture_process_packet(&tmp_probes->entry,
                         &timestamp, packet_with_pseudo,
                         packet_length);
-                free(packet_with_pseudo);
                 if (packet_result==0) {
                     if (DEBUG) {
                         fprintf(stderr, "[capture_lnfq] result==0 => NF_ACCEPT\n\n");
                     }
-                    return nfq_set_verdict(queue_handle, packet_id, NF_ACCEPT, 0, NULL);
+                    return capture_lnfq_accept(queue, packet_id);
                 } else {
                     if (DEBUG) {
                         fprintf(stderr, "[capture_lnfq] result!=0 => NF_DROP\n\n");
@@ -282,7 +504,112 @@ int capture_lnfq_callback(struct nfq_q_handle *queue_handle, struct nfgenmsg *nf
         fprintf(stderr,
                 "[capture_lnfq] interface is not configured, ignoring packet.\n");
     }
-    return nfq_set_verdict(queue_handle, packet_id, NF_ACCEPT, 0, NULL);
+    return capture_lnfq_accept(queue, packet_id);
+}
+
+/* Adds the kernel counters of the queues of the handle, read from
+ * /proc/net/netfilter/nfnetlink_queue (one line per queue: number, peer
+ * port id, queued, copy mode, copy range, queue dropped, user dropped,
+ * last packet id, 1). */
+static int capture_lnfq_read_proc(struct capture_stats* stats) {
+    FILE* proc;
+    char line[256];
+    unsigned int queue_num;
+    unsigned int peer_portid;
+    unsigned int queue_total;
+    unsigned int copy_mode;
+    unsigned int copy_range;
+    unsigned int queue_dropped;
+    unsigned int user_dropped;
+    unsigned int id_sequence;
+    int i;
+
+    if ((proc=fopen(CAPTURE_LNFQ_PROC_PATH, "r"))==NULL) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), proc)!=NULL) {
+        if (sscanf(line, "%u %u %u %u %u %u %u %u", &queue_num, &peer_portid, &queue_total,
+                &copy_mode, &copy_range, &queue_dropped, &user_dropped, &id_sequence)!=8) {
+            continue;
+        }
+        for (i=0; i<capture_handle->queue_count; i++) {
+            if (capture_handle->queues[i].queue_num==queue_num) {
+                /* packet ids are assigned before the queue length is checked: */
+                stats->received           += id_sequence;
+                stats->queue_dropped      += queue_dropped;
+                stats->queue_user_dropped += user_dropped;
+                break;
+            }
+        }
+    }
+    fclose(proc);
+    return 0;
+}
+
+int capture_get_stats(struct probe* probe, struct capture_stats* stats) {
+    int i;
+
+    if (capture_handle==NULL) {
+        return -1;
+    }
+    /* the queues are shared, all probes report the same counters: */
+    memset(stats, 0, sizeof(struct capture_stats));
+    for (i=0; i<capture_handle->queue_count; i++) {
+        stats->overruns += capture_handle->queues[i].overruns;
+    }
+    if (capture_lnfq_read_proc(stats)==-1 && DEBUG) {
+        perror("[capture_lnfq] reading " CAPTURE_LNFQ_PROC_PATH " failed");
+    }
+    return 0;
+}
+
+int capture_lnfq_settings_load(xmlNodePtr element, void** data) {
+    struct capture_lnfq_settings* settings;
+
+    if ((settings=malloc(sizeof(struct capture_lnfq_settings)))==NULL) {
+        perror("[capture_lnfq] malloc failed.\n");
+        exit(1);
+    }
+    capture_lnfq_settings_defaults(settings);
+    if (settings_get_int(element, "first",     &settings->queue_first,  0, 65535)==-1
+            || settings_get_int(element, "count",     &settings->queue_count,  1, CAPTURE_LNFQ_QUEUES_MAX)==-1
+            || settings_get_int(element, "maxlen",    &settings->queue_maxlen, 1, 1<<20)==-1
+            || settings_get_int(element, "rcvbuf",    &settings->rcvbuf,       65536, 1<<30)==-1
+            || settings_get_int(element, "batch",     &settings->batch,        1, CAPTURE_LNFQ_BATCH_MAX)==-1
+            || settings_get_int(element, "fail_open", &settings->fail_open,    0, 1)==-1) {
+        free(settings);
+        return -1;
+    }
+    if (settings->queue_first+settings->queue_count>65536) {
+        fprintf(stderr, "[capture_lnfq] ERROR: settings: queue range exceeds 65535.\n");
+        free(settings);
+        return -1;
+    }
+    *data = settings;
+    return 0;
+}
+
+void capture_lnfq_settings_print(void* data) {
+    struct capture_lnfq_settings* settings = (struct capture_lnfq_settings*) data;
+
+    fprintf(stderr, "[capture_lnfq] configuration {\n");
+    fprintf(stderr, "    queues %i to %i (max length %i)\n", settings->queue_first,
+            settings->queue_first+settings->queue_count-1, settings->queue_maxlen);
+    fprintf(stderr, "    receive buffer %i bytes, verdict batch %i\n", settings->rcvbuf, settings->batch);
+    fprintf(stderr, "    fail open %s\n", settings->fail_open ? "yes" : "no");
+    fprintf(stderr, "}\n");
+}
+
+int capture_lnfq_settings_save(xmlNodePtr element, void* data) {
+    struct capture_lnfq_settings* settings = (struct capture_lnfq_settings*) data;
+
+    settings_set_int(element, "first", settings->queue_first);
+    settings_set_int(element, "count", settings->queue_count);
+    settings_set_int(element, "maxlen", settings->queue_maxlen);
+    settings_set_int(element, "rcvbuf", settings->rcvbuf);
+    settings_set_int(element, "batch", settings->batch);
+    settings_set_int(element, "fail_open", settings->fail_open);
+    return 0;
 }
 
 #else
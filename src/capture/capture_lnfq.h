@@ -6,31 +6,114 @@
 
 #ifdef _CAPTURE_USE_LNFQ_
 
+#include <errno.h>
 #include <linux/netfilter.h> /* for NF_ACCEPT */
 #include <libnetfilter_queue/libnetfilter_queue.h> /* libnetfilter_queue*/
 #include <sys/time.h> /* gettimeofday - timestamp substitute */
 #include <pthread.h>
 
-/** Which queue is to be used (option --queue-num in ip6tables). */
+#include <libxml/tree.h>
+
+#include "../core/settings.h"
+#include "../core/event_loop.h"
+
+/** Default queue to be used (option --queue-num in ip6tables). */
 #define CAPTURE_LNFQ_QUEUE_NUM 1
+/** Maximum number of queues (option --queue-balance in ip6tables). */
+#define CAPTURE_LNFQ_QUEUES_MAX 64
+/** Size of the receive buffer of a queue thread (a netlink message with a full packet). */
+#define CAPTURE_LNFQ_BUFFER_SIZE (0xffff + 4096)
+/** Maximum number of accepted packets per verdict. */
+#define CAPTURE_LNFQ_BATCH_MAX 1024
+/** Kernel counters of the netfilter queues. */
+#define CAPTURE_LNFQ_PROC_PATH "/proc/net/netfilter/nfnetlink_queue"
 
-struct capture_descriptor {
-    struct probe* interface_probe;
+/** Settings for netfilter queue capturing, loaded from the nfqueue element
+ *  of the settings (extinfo type "nfqueue"), for instance
+ *  \verbatim <nfqueue first="1" count="4" batch="32" fail_open="1"/> \endverbatim
+ */
+struct capture_lnfq_settings {
+    /** First queue number. */
+    int queue_first;
+    /** Number of queues (one capture thread each). */
+    int queue_count;
+    /** Maximum number of packets the kernel queues for a queue. */
+    int queue_maxlen;
+    /** Netlink socket receive buffer size in bytes. */
+    int rcvbuf;
+    /** Maximum number of accepted packets per verdict. */
+    int batch;
+    /** Accept packets instead of dropping them if a queue is full. */
+    int fail_open;
+};
+
+/** A netfilter queue with its own library handle (netlink socket) and thread. */
+struct capture_lnfq_queue {
+    /** Queue number. */
+    uint16_t queue_num;
     struct nfq_handle *library_handle;
     struct nfq_q_handle *queue_handle;
     struct nlif_handle *interface_resolving_handle;
-    int file_descriptor;
     pthread_t capture_thread;
+    /** Receive buffer. */
+    char* buffer;
+    /** Buffer for the packet with its pseudo ethernet header. */
+    uint8_t* frame;
+    /** Id of the last accepted packet without verdict. */
+    uint32_t pending_id;
+    /** Number of accepted packets without verdict. */
+    int pending;
+    /** Maximum number of accepted packets per verdict. */
+    int batch;
+    /** Number of times the socket receive buffer overflowed. */
+    unsigned long overruns;
+};
+
+struct capture_descriptor {
+    struct probe* interface_probe;
+    int queue_count;
+    struct capture_lnfq_queue queues[CAPTURE_LNFQ_QUEUES_MAX];
 };
 
 void capture_up_all();
 
-void* capture_loop(void* unused);
+/** Starts the packet capturing loop of a queue.
+ *  @param args The queue (struct capture_lnfq_queue).
+ */
+void* capture_loop(void* args);
+
+/** Receives the packets of a queue from the event loop.
+ *  @param args The queue (struct capture_lnfq_queue).
+ *  @return     0 to wait for more packets, -1 if the queue failed.
+ */
+int capture_lnfq_dispatch(void* args);
+
+/** Makes capture_up_all() return, see capture.h. */
+void capture_stop_all();
 
 void capture_down_all();
 
 int capture_lnfq_callback(struct nfq_q_handle *queue_handle, struct nfgenmsg *nfmsg, struct nfq_data *nfa, void *data);
 
+/** Loads the netfilter queue settings from a XML element.
+ *  @param element The nfqueue element.
+ *  @param data    Will hold the settings (call by reference).
+ *  @return        0 on success, -1 on error.
+ */
+int capture_lnfq_settings_load(xmlNodePtr element, void** data);
+
+/** Prints the netfilter queue settings.
+ *  @param data The settings.
+ */
+void capture_lnfq_settings_print(void* data);
+
+/** Saves the netfilter queue settings to a XML element.
+ *  @param element The element to add the attributes to.
+ *  @param data    The settings.
+ *  @return        Always 0.
+ */
+int capture_lnfq_settings_save(xmlNodePtr element, void* data);
+
 #else
 #define _CAPTURE_LNFQ_NOT_USED_
 #endif
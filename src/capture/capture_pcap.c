@@ -3,11 +3,119 @@
 
 #ifdef _CAPTURE_USE_PCAP_
 
+/* the event loop serving the capture sockets, NULL if there is a thread per socket: */
+static struct event_loop* capture_event_loop = NULL;
+/* orders capture_stop_all() with the start of the capture in capture_up_all(): */
+static pthread_mutex_t capture_stop_lock = PTHREAD_MUTEX_INITIALIZER;
+/* set once the capture threads or the event loop run: */
+static int capture_started = 0;
+/* set once the capture is to stop: */
+static int capture_stopping = 0;
+
+/* Makes the capture threads (or the event loop threads) finish, called
+ * with the stop lock held once the capture is started. */
+static void capture_stop_threads() {
+    struct probe_list** locked_probes;
+    struct probe_list* tmp_probes;
+    int i;
+
+#ifdef _LINUX_
+    if (capture_event_loop!=NULL) {
+        /* the handlers finish their batch, no thread is cancelled: */
+        event_loop_stop(capture_event_loop);
+        return;
+    }
+#endif
+    /* critical section: */
+    locked_probes = probe_list_lock();
+    for (tmp_probes=*locked_probes; tmp_probes!=NULL; tmp_probes=tmp_probes->next) {
+        if (tmp_probes->entry.type==PROBE_TYPE_INTERFACE && tmp_probes->entry.capture_handle!=NULL) {
+            for (i=0; i<tmp_probes->entry.capture_handle->socket_count; i++) {
+                pthread_cancel(tmp_probes->entry.capture_handle->sockets[i].capture_thread);
+            }
+        }
+    }
+    probe_list_unlock();
+    /* end critical section. */
+}
+
+/* Marks the capture as started, stops it at once if it was asked to stop meanwhile. */
+static void capture_started_set() {
+    pthread_mutex_lock(&capture_stop_lock);
+    capture_started = 1;
+    if (capture_stopping) {
+        capture_stop_threads();
+    }
+    pthread_mutex_unlock(&capture_stop_lock);
+}
+
+#ifdef _LINUX_
+/* maximum number of frames read per wakeup of a socket: */
+static int capture_event_budget = EVENT_LOOP_BUDGET_DEFAULT;
+
+/* Captures on all interface probes with the sockets in an event loop. */
+static void capture_up_loop(struct probe_list* probes, const struct event_loop_settings* loop_settings) {
+    char errbuf[PCAP_ERRBUF_SIZE];
+    int i;
+
+    if ((capture_event_loop=event_loop_create())==NULL) {
+        exit(1);
+    }
+    capture_event_budget = loop_settings->budget;
+    while (probes!=NULL) {
+        if (probes->entry.type==PROBE_TYPE_INTERFACE) {
+            probes->entry.capture_handle = capture_init(&probes->entry);
+            if (probes->entry.capture_handle!=NULL) {
+                for (i=0; i<probes->entry.capture_handle->socket_count; i++) {
+                    struct capture_socket* capture_socket = &probes->entry.capture_handle->sockets[i];
+                    int fd;
+
+                    memset(errbuf,0,PCAP_ERRBUF_SIZE);
+                    if (pcap_setnonblock(capture_socket->descr,1,errbuf)==-1) {
+                        fprintf(stderr,"[capture_pcap] pcap_setnonblock(): %s\n",errbuf);
+                        continue;
+                    }
+                    if ((fd=pcap_get_selectable_fd(capture_socket->descr))==-1) {
+                        fprintf(stderr,"[capture_pcap] %s: no selectable descriptor.\n", probes->entry.name);
+                        continue;
+                    }
+                    event_loop_add(capture_event_loop, fd, capture_pcap_dispatch, capture_socket);
+                }
+                probe_updown(PROBE_UPDOWN_STATE_UP, &probes->entry);
+                fprintf(stderr, "[capture_pcap] Listening on interface %s (%i sockets in the event loop).\n",
+                        probes->entry.name, probes->entry.capture_handle->socket_count);
+            }
+        }
+        probes = probes->next;
+    }
+    if (event_loop_start(capture_event_loop, loop_settings->threads)==-1) {
+        exit(1);
+    }
+    capture_started_set();
+    /* keep the main program running until capture_stop_all(): */
+    event_loop_wait(capture_event_loop);
+}
+
+int capture_pcap_dispatch(void* args) {
+    struct capture_socket* capture_socket = (struct capture_socket*) args;
+
+    if (pcap_dispatch(capture_socket->descr,capture_event_budget,capture_pcap_callback,(u_char*)capture_socket)<0) {
+        fprintf(stderr,"[capture_pcap] %s: pcap_dispatch(): %s\n",
+                capture_socket->capture_handle->interface_probe->name, pcap_geterr(capture_socket->descr));
+        return -1;
+    }
+    return 0;
+}
+#endif
+
 void capture_up_all() {
     struct probe_list** locked_probes;
     struct probe_list* tmp_probes1;
     struct probe_list* tmp_probes2;
+    struct event_loop_settings loop_settings;
+    int i;
 
+    event_loop_settings_get(&loop_settings);
     /* critical section: */
     locked_probes = probe_list_lock();
     /* copy the probe list (don't bother if it changes later) */
@@ -16,35 +124,63 @@ void capture_up_all() {
     probe_list_unlock();
     /* end critical section. */
 
-    /* create probe threads */
+#ifdef _LINUX_
+    if (loop_settings.enabled) {
+        capture_up_loop(tmp_probes1, &loop_settings);
+        return;
+    }
+#endif
+    /* create probe threads (one per capture socket) */
     while (tmp_probes1!=NULL) {
         if (tmp_probes1->entry.type==PROBE_TYPE_INTERFACE) {
             tmp_probes1->entry.capture_handle = capture_init(&tmp_probes1->entry);
             if (tmp_probes1->entry.capture_handle!=NULL) {
-                pthread_create(&tmp_probes1->entry.capture_handle->capture_thread, NULL, capture_loop, tmp_probes1->entry.capture_handle);
+                for (i=0; i<tmp_probes1->entry.capture_handle->socket_count; i++) {
+                    struct capture_socket* capture_socket = &tmp_probes1->entry.capture_handle->sockets[i];
+                    pthread_create(&capture_socket->capture_thread, NULL, capture_loop, capture_socket);
+                }
             }
         }
         tmp_probes1 = tmp_probes1->next;
     }
-    /* join all threads to keep main program running:  */
+    capture_started_set();
+    /* join all threads to keep main program running until capture_stop_all(): */
     while (tmp_probes2 != NULL) {
         if (tmp_probes2->entry.type == PROBE_TYPE_INTERFACE) {
             if (tmp_probes2->entry.capture_handle != NULL) {
                 if (DEBUG) {
                     fprintf(stderr, "[capture_pcap] joining capturing thread..\n");
                 }
-                pthread_join(tmp_probes2->entry.capture_handle->capture_thread,
-                        NULL);
+                for (i=0; i<tmp_probes2->entry.capture_handle->socket_count; i++) {
+                    pthread_join(tmp_probes2->entry.capture_handle->sockets[i].capture_thread,
+                            NULL);
+                }
             }
         }
         tmp_probes2 = tmp_probes2->next;
     }
 }
 
+void capture_stop_all() {
+    pthread_mutex_lock(&capture_stop_lock);
+    if (!capture_stopping) {
+        capture_stopping = 1;
+        if (capture_started) {
+            capture_stop_threads();
+        }
+    }
+    pthread_mutex_unlock(&capture_stop_lock);
+}
+
 void capture_down_all() {
     struct probe_list** locked_probes;
     struct probe_list* tmp_probes;
 
+    /* the threads were joined by capture_up_all(), a late stop has nothing to do: */
+    pthread_mutex_lock(&capture_stop_lock);
+    capture_started = 0;
+    capture_stopping = 1;
+    pthread_mutex_unlock(&capture_stop_lock);
     /* critical section: */
     locked_probes = probe_list_lock();
     /* copy the probe list (don't bother if it changes later) */
@@ -54,14 +190,14 @@ void capture_down_all() {
 
     while (tmp_probes!=NULL) {
         if (tmp_probes->entry.capture_handle != NULL) {
+            capture_handle_t capture_handle = tmp_probes->entry.capture_handle;
+
             if (DEBUG) {
                 fprintf(stderr,
                         "[capture_pcap] Stop listening on interface %s...\n",
                         tmp_probes->entry.name);
             }
-            pthread_cancel(tmp_probes->entry.capture_handle->capture_thread);
-            pthread_join(tmp_probes->entry.capture_handle->capture_thread, NULL);
-            capture_release(tmp_probes->entry.capture_handle);
+            capture_release(capture_handle);
             if (DEBUG) {
                 fprintf(stderr, "    Stopped interface %s.\n",
                         tmp_probes->entry.name);
@@ -69,52 +205,161 @@ void capture_down_all() {
         }
         tmp_probes = tmp_probes->next;
     }
+#ifdef _LINUX_
+    event_loop_free(capture_event_loop);
+#endif
+    capture_event_loop = NULL;
 }
 
-capture_handle_t capture_init(struct probe* interface_probe) {
-    char* filter = "icmp6"; /* filter to select the packets to grab */
-    char* interface = interface_probe->name;
+/* Creates and activates a pcap handle with the capture settings of the probe. */
+static pcap_t* capture_pcap_open(char* interface, const struct capture_settings* settings, int* nanoseconds) {
     char errbuf[PCAP_ERRBUF_SIZE];
-    struct bpf_program* filter_program;/* string which contains the filter expression */
-    pcap_t* descr = NULL;
-    capture_handle_t new_handle;
-    bpf_u_int32 maskp; /* mask  */
-    bpf_u_int32 netp; /* ip */
+    pcap_t* descr;
+    int immediate = settings->immediate;
+    int status;
 
     memset(errbuf,0,PCAP_ERRBUF_SIZE);
-    /* if the device isn't specified */
-    if ( (interface == NULL) && ((interface = pcap_lookupdev(errbuf)) == NULL)) {
-        fprintf(stderr,"%s\n",errbuf);
-        return NULL; 
+    if ((descr=pcap_create(interface,errbuf))==NULL) {
+        fprintf(stderr,"pcap_create(): %s\n",errbuf);
+        return NULL;
     }
-    
-    /* pcap get information on the interface */
-    pcap_lookupnet(interface,&netp,&maskp,errbuf);
-    if (capture_pcap_interface_spec(interface,netp,maskp)<0) {
+    pcap_set_snaplen(descr,settings->snaplen);
+    pcap_set_promisc(descr,1);
+    pcap_set_timeout(descr,settings->timeout);
+    if (settings->buffer_size>0 && pcap_set_buffer_size(descr,settings->buffer_size)!=0) {
+        fprintf(stderr,"[capture_pcap] WARNING: could not set buffer size on %s.\n", interface);
+    }
+    /* libpcap selects TPACKET_V3 (block based, delivered on timeout or when
+     * a block is full) and falls back to TPACKET_V2 (frame based) in
+     * immediate mode, so the version is chosen through the delivery mode: */
+    if (settings->tpacket_version==2) {
+        immediate = 1;
+    } else if (settings->tpacket_version==3 && immediate) {
+        fprintf(stderr,"[capture_pcap] WARNING: %s: immediate mode uses TPACKET_V2.\n", interface);
+    }
+    if (immediate && pcap_set_immediate_mode(descr,1)!=0) {
+        fprintf(stderr,"[capture_pcap] WARNING: could not set immediate mode on %s.\n", interface);
+    }
+    *nanoseconds = 0;
+#ifdef PCAP_TSTAMP_PRECISION_NANO
+    if (settings->nanoseconds) {
+        if (pcap_set_tstamp_precision(descr,PCAP_TSTAMP_PRECISION_NANO)==0) {
+            *nanoseconds = 1;
+        } else {
+            fprintf(stderr,"[capture_pcap] WARNING: %s: nanosecond timestamps not supported.\n", interface);
+        }
+    }
+#endif
+    status = pcap_activate(descr);
+    if (status<0) {
+        fprintf(stderr,"pcap_activate(): %s: %s\n", pcap_statustostr(status), pcap_geterr(descr));
+        pcap_close(descr);
         return NULL;
     }
-    
+    if (status>0) {
+        fprintf(stderr,"[capture_pcap] WARNING: %s: %s\n", pcap_statustostr(status), pcap_geterr(descr));
+    }
+#ifdef PCAP_TSTAMP_PRECISION_NANO
+    *nanoseconds = (pcap_get_tstamp_precision(descr)==PCAP_TSTAMP_PRECISION_NANO);
+#endif
+    return descr;
+}
+
+/* Opens a capture socket and starts its analysis thread. */
+static int capture_socket_open(struct capture_socket* capture_socket, char* interface,
+        bpf_u_int32 netp, const struct capture_settings* settings, uint16_t fanout_group) {
+    /* filter to select the packets to grab: */
+    char* filter = settings->trunk ? CAPTURE_PCAP_FILTER_TRUNK : CAPTURE_PCAP_FILTER;
+    struct bpf_program* filter_program;/* string which contains the filter expression */
+    pcap_t* descr = NULL;
+
     /* open device for reading */
-    descr = pcap_open_live(interface,BUFSIZ,1,1000,errbuf);
-    if(descr == NULL) {
-        fprintf(stderr,"pcap_open_live(): %s\n",errbuf);
-        return NULL;
+    if ((descr=capture_pcap_open(interface, settings, &capture_socket->nanoseconds))==NULL) {
+        return -1;
     }
     
     /* using the filter */
     if ((filter_program=malloc(sizeof(struct bpf_program)))==NULL) {
         perror("malloc");
         pcap_close(descr);
-        return NULL;
+        return -1;
     }
     if(pcap_compile(descr,filter_program,filter,0,netp) <0) { 
         fprintf(stderr,"Error calling pcap_compile %s.\n", pcap_geterr(descr));
+        free(filter_program);
         pcap_close(descr);
-        return NULL; 
+        return -1; 
     }
     if (pcap_setfilter(descr,filter_program) == -1) {
         fprintf(stderr,"Error setting pcap filter.\n");
+        pcap_freecode(filter_program);
+        free(filter_program);
         pcap_close(descr);
+        return -1;
+    }
+    if (settings->fanout>1
+            && capture_pcap_fanout_join(descr, fanout_group, settings->fanout_mode, settings->fanout)==-1) {
+        pcap_freecode(filter_program);
+        free(filter_program);
+        pcap_close(descr);
+        return -1;
+    }
+    if ((capture_socket->analysis=analysis_worker_create(capture_socket->capture_handle->interface_probe,
+            settings->snaplen))==NULL) {
+        pcap_freecode(filter_program);
+        free(filter_program);
+        pcap_close(descr);
+        return -1;
+    }
+    capture_socket->descr = descr;
+    capture_socket->filter_program = filter_program;
+    return 0;
+}
+
+/* Stops the analysis thread of a capture socket and closes it. */
+static void capture_socket_close(struct capture_socket* capture_socket, struct packet_ring_stats* stats) {
+    struct packet_ring_stats socket_stats;
+
+    /* the analysis thread finishes the frames already captured: */
+    analysis_worker_stop(capture_socket->analysis);
+    analysis_worker_get_stats(capture_socket->analysis, &socket_stats);
+    stats->capacity   += socket_stats.capacity;
+    if (socket_stats.high_water>stats->high_water) {
+        stats->high_water = socket_stats.high_water;
+    }
+    stats->received   += socket_stats.received;
+    stats->dropped    += socket_stats.dropped;
+    stats->truncated  += socket_stats.truncated;
+    stats->processed  += socket_stats.processed;
+    stats->batches    += socket_stats.batches;
+    analysis_worker_free(capture_socket->analysis);
+    /* pcap cleanup */
+    pcap_freecode(capture_socket->filter_program);
+    free(capture_socket->filter_program);
+    pcap_close(capture_socket->descr);
+}
+
+capture_handle_t capture_init(struct probe* interface_probe) {
+    char* interface = interface_probe->name;
+    char errbuf[PCAP_ERRBUF_SIZE];
+    capture_handle_t new_handle;
+    struct capture_settings settings;
+    struct packet_ring_stats unused_stats;
+    uint16_t fanout_group;
+    bpf_u_int32 maskp; /* mask  */
+    bpf_u_int32 netp; /* ip */
+    int i;
+
+    memset(errbuf,0,PCAP_ERRBUF_SIZE);
+    /* if the device isn't specified */
+    if ( (interface == NULL) && ((interface = pcap_lookupdev(errbuf)) == NULL)) {
+        fprintf(stderr,"%s\n",errbuf);
+        return NULL; 
+    }
+    
+    /* pcap get information on the interface */
+    pcap_lookupnet(interface,&netp,&maskp,errbuf);
+    if (capture_pcap_interface_spec(interface,netp,maskp)<0) {
         return NULL;
     }
 
@@ -123,47 +368,117 @@ capture_handle_t capture_init(struct probe* interface_probe) {
         perror("malloc");
         return NULL;
     }
+    memset(new_handle, 0, sizeof(struct capture_descriptor));
     new_handle->interface_probe = interface_probe;
-    new_handle->descr = descr;
-    new_handle->filter_program = filter_program;
+    capture_settings_get(interface_probe, &settings);
+    /* the fanout group id must be unique for the interface, the sockets
+     * of other processes are not to be joined: */
+    fanout_group = (uint16_t)((getpid()<<4) ^ if_nametoindex(interface));
+
+    for (i=0; i<settings.fanout; i++) {
+        new_handle->sockets[i].capture_handle = new_handle;
+        new_handle->sockets[i].index = i;
+        if (capture_socket_open(&new_handle->sockets[i], interface, netp, &settings, fanout_group)==-1) {
+            memset(&unused_stats, 0, sizeof(struct packet_ring_stats));
+            while (--i>=0) {
+                capture_socket_close(&new_handle->sockets[i], &unused_stats);
+            }
+            free(new_handle);
+            return NULL;
+        }
+        new_handle->socket_count++;
+    }
     return new_handle;
 }
 
 void* capture_loop(void* args) {
-    capture_handle_t capture_handle = (capture_handle_t) args;
+    struct capture_socket* capture_socket = (struct capture_socket*) args;
+    struct probe* interface_probe;
     int nb_packet = 0;
     pcap_t* descr = NULL;
 
     pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
-    if (capture_handle==NULL) {
+    if (capture_socket==NULL) {
         fprintf(stderr, "Error: capture_handle not initialized.\n");
         return NULL;
     }
-    descr = capture_handle->descr;
+    descr = capture_socket->descr;
+    interface_probe = capture_socket->capture_handle->interface_probe;
     /* all packets are captured until kill */
     nb_packet=0;
     /* then we can capture the packets */
-    probe_updown(PROBE_UPDOWN_STATE_UP, capture_handle->interface_probe);
-    fprintf(stderr, "[capture_pcap] Listening on interface %s.\n", capture_handle->interface_probe->name);
-    pcap_loop(descr,nb_packet,capture_pcap_callback,(u_char*)capture_handle->interface_probe);
+    if (capture_socket->index==0) {
+        probe_updown(PROBE_UPDOWN_STATE_UP, interface_probe);
+    }
+    if (capture_socket->capture_handle->socket_count>1) {
+        fprintf(stderr, "[capture_pcap] Listening on interface %s (socket %i of %i).\n",
+                interface_probe->name, capture_socket->index+1, capture_socket->capture_handle->socket_count);
+    } else {
+        fprintf(stderr, "[capture_pcap] Listening on interface %s.\n", interface_probe->name);
+    }
+    pcap_loop(descr,nb_packet,capture_pcap_callback,(u_char*)capture_socket);
     return NULL;
 }
 
+int capture_get_stats(struct probe* probe, struct capture_stats* stats) {
+    struct packet_ring_stats socket_stats;
+    struct pcap_stat socket_pcap_stats;
+    int i;
+
+    if (probe->capture_handle==NULL) {
+        return -1;
+    }
+    memset(stats, 0, sizeof(struct capture_stats));
+    for (i=0; i<probe->capture_handle->socket_count; i++) {
+        struct capture_socket* capture_socket = &probe->capture_handle->sockets[i];
+
+        /* on Linux ps_recv includes the frames dropped for a full buffer,
+         * libpcap sums up the counters the kernel resets on each read: */
+        if (pcap_stats(capture_socket->descr, &socket_pcap_stats)==0) {
+            stats->received       += socket_pcap_stats.ps_recv;
+            stats->kernel_dropped += socket_pcap_stats.ps_drop;
+            /* the interface counter is the same for all sockets of the probe: */
+            if (i==0) {
+                stats->interface_dropped = socket_pcap_stats.ps_ifdrop;
+            }
+        } else if (DEBUG) {
+            fprintf(stderr, "[capture_pcap] pcap_stats() on %s: %s\n", probe->name, pcap_geterr(capture_socket->descr));
+        }
+        analysis_worker_get_stats(capture_socket->analysis, &socket_stats);
+        stats->ring.capacity   += socket_stats.capacity;
+        stats->ring.occupancy  += socket_stats.occupancy;
+        if (socket_stats.high_water>stats->ring.high_water) {
+            stats->ring.high_water = socket_stats.high_water;
+        }
+        stats->ring.received   += socket_stats.received;
+        stats->ring.dropped    += socket_stats.dropped;
+        stats->ring.truncated  += socket_stats.truncated;
+        stats->ring.processed  += socket_stats.processed;
+        stats->ring.batches    += socket_stats.batches;
+    }
+    return 0;
+}
+
 void capture_release(capture_handle_t capture_handle) {
-    pcap_t* descr;
-    struct bpf_program* fp;
+    struct packet_ring_stats stats;
+    int i;
 
     if (capture_handle==NULL) {
         return;
     }
-    descr = capture_handle->descr;
-    fp = capture_handle->filter_program;
     if (DEBUG) {
         fprintf(stderr, "    pcap cleanup.\n");
     }
-    /* pcap cleanup */
-    pcap_freecode(fp);
-    pcap_close(descr);
+    memset(&stats, 0, sizeof(struct packet_ring_stats));
+    for (i=0; i<capture_handle->socket_count; i++) {
+        capture_socket_close(&capture_handle->sockets[i], &stats);
+    }
+    fprintf(stderr, "[capture_pcap] %s: %llu frames received, %llu dropped (ring full), "
+            "%llu truncated, %llu analyzed in %llu batches, ring high water %u/%u.\n",
+            capture_handle->interface_probe->name,
+            (unsigned long long)stats.received, (unsigned long long)stats.dropped,
+            (unsigned long long)stats.truncated, (unsigned long long)stats.processed,
+            (unsigned long long)stats.batches, stats.high_water, stats.capacity);
     /* free handle */
     if (DEBUG) {
         fprintf(stderr, "    handle cleanup.\n");
@@ -174,7 +489,8 @@ void capture_release(capture_handle_t capture_handle) {
 /*Function called each time that a packet pass the filter and is captured*/
 void capture_pcap_callback(u_char *args,const struct pcap_pkthdr* hdr,const u_char* packet) {
     const time_t* time = (const time_t*) &(hdr->ts).tv_sec;
-    struct probe* interface_probe = (struct probe*) args;
+    struct capture_socket* capture_socket = (struct capture_socket*) args;
+    struct timespec timestamp;
 
     if(DEBUG) {
         /* General info on the paquet */
@@ -182,11 +498,85 @@ void capture_pcap_callback(u_char *args,const struct pcap_pkthdr* hdr,const u_ch
         fprintf(stderr,"[capture_pcap] recieved at: %s", (char*)ctime(time));
     }
     
-    capture_process_packet(interface_probe, &hdr->ts, (uint8_t*)packet, hdr->len);
+    /* in nanosecond precision tv_usec holds nanoseconds: */
+    timestamp.tv_sec  = hdr->ts.tv_sec;
+    timestamp.tv_nsec = capture_socket->nanoseconds ? hdr->ts.tv_usec : hdr->ts.tv_usec*1000;
+    /* the frame is analyzed by the analysis thread, a full ring drops it: */
+    if (analysis_worker_dispatch(capture_socket->analysis, &timestamp, packet, hdr->caplen)<0 && DEBUG) {
+        fprintf(stderr,"[capture_pcap] analysis ring of %s full, frame dropped.\n",
+                capture_socket->capture_handle->interface_probe->name);
+    }
     pthread_testcancel();
     
 }
 
+int capture_pcap_fanout_join(pcap_t* descr, uint16_t group, enum capture_fanout_mode mode, int socket_count) {
+#ifdef PACKET_FANOUT
+    int socket_fd = pcap_fileno(descr);
+    int fanout_arg = group | (PACKET_FANOUT_CBPF << 16);
+    /* The watchers of a probe compare the ND messages of different hosts
+     * (a DAD solicitation and the advertisement answering it), so all ND
+     * messages go to the first socket and are analyzed in capture order.
+     * Only ICMPv6 messages without extension header that are not ND are
+     * spread over the other sockets, everything else goes to the first: */
+    struct sock_filter code[16] = {
+        /* IPv6 (an accelerated VLAN tag is already removed): */
+        { BPF_LD  | BPF_H   | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_PROTOCOL },
+        { BPF_JMP | BPF_JEQ | BPF_K,   0, 5, ETHERTYPE_IPV6 },
+        /* ICMPv6 right after the IPv6 header: */
+        { BPF_LD  | BPF_B   | BPF_ABS, 0, 0, SKF_NET_OFF + 6 },
+        { BPF_JMP | BPF_JEQ | BPF_K,   0, 3, IPPROTO_ICMPV6 },
+        /* not a Router Solicitation ... Redirect: */
+        { BPF_LD  | BPF_B   | BPF_ABS, 0, 0, SKF_NET_OFF + 40 },
+        { BPF_JMP | BPF_JGE | BPF_K,   0, 2, ND_ROUTER_SOLICIT },
+        { BPF_JMP | BPF_JGT | BPF_K,   1, 0, ND_REDIRECT },
+        { BPF_RET | BPF_K,             0, 0, 0 }
+    };
+    int length = 8;
+    struct sock_fprog program;
+
+    /* the key of the frame: */
+    switch (mode) {
+        case CAPTURE_FANOUT_CPU:
+            code[length++] = (struct sock_filter) { BPF_LD  | BPF_W   | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_CPU };
+            break;
+        case CAPTURE_FANOUT_HASH:
+            /* low words of the source and destination address: */
+            code[length++] = (struct sock_filter) { BPF_LD  | BPF_W   | BPF_ABS, 0, 0, SKF_NET_OFF + 20 };
+            code[length++] = (struct sock_filter) { BPF_MISC| BPF_TAX,           0, 0, 0 };
+            code[length++] = (struct sock_filter) { BPF_LD  | BPF_W   | BPF_ABS, 0, 0, SKF_NET_OFF + 36 };
+            code[length++] = (struct sock_filter) { BPF_ALU | BPF_XOR | BPF_X,   0, 0, 0 };
+            break;
+        default:
+            /* source MAC bytes 0-3 ^ bytes 4-5, relative to the link layer header: */
+            code[length++] = (struct sock_filter) { BPF_LD  | BPF_W   | BPF_ABS, 0, 0, SKF_LL_OFF + 6 };
+            code[length++] = (struct sock_filter) { BPF_MISC| BPF_TAX,           0, 0, 0 };
+            code[length++] = (struct sock_filter) { BPF_LD  | BPF_H   | BPF_ABS, 0, 0, SKF_LL_OFF + 10 };
+            code[length++] = (struct sock_filter) { BPF_ALU | BPF_XOR | BPF_X,   0, 0, 0 };
+            break;
+    }
+    /* socket = key % (socket_count-1) + 1: */
+    code[length++] = (struct sock_filter) { BPF_ALU | BPF_MOD | BPF_K,   0, 0, (uint32_t)(socket_count-1) };
+    code[length++] = (struct sock_filter) { BPF_ALU | BPF_ADD | BPF_K,   0, 0, 1 };
+    code[length++] = (struct sock_filter) { BPF_RET | BPF_A,             0, 0, 0 };
+
+    if (setsockopt(socket_fd, SOL_PACKET, PACKET_FANOUT, &fanout_arg, sizeof(fanout_arg))==-1) {
+        perror("[capture_pcap] joining the fanout group failed");
+        return -1;
+    }
+    program.len    = length;
+    program.filter = code;
+    if (setsockopt(socket_fd, SOL_PACKET, PACKET_FANOUT_DATA, &program, sizeof(program))==-1) {
+        perror("[capture_pcap] setting the fanout program failed");
+        return -1;
+    }
+    return 0;
+#else
+    fprintf(stderr, "[capture_pcap] PACKET_FANOUT is not supported on this system.\n");
+    return -1;
+#endif
+}
+
 /*To display properly the network address and device's mask */
 int capture_pcap_interface_spec(char* interface, bpf_u_int32 netp, bpf_u_int32 maskp) {
     struct in_addr addr;
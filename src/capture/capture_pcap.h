@@ -8,6 +8,15 @@
 #include <pthread.h>
 #include <pcap.h>              /*lib pcap*/
 
+#include "../core/analysis.h"
+#include "../core/event_loop.h"
+
+#ifdef _LINUX_
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/filter.h>
+#endif
+
 #ifdef _COUNTERMEASURES_
 #include "../plugins/countermeasures/countermeasures.h"
 #endif
@@ -15,11 +24,35 @@
 #include "../plugins/webinterface/webinterface.h"
 #endif
 
-struct capture_descriptor {
-    struct probe* interface_probe;
+/** Filter to select the frames to grab. */
+#define CAPTURE_PCAP_FILTER "icmp6"
+/** Filter of a trunk: untagged, 802.1Q and QinQ frames (each vlan keyword
+ *  moves the following matches behind one more tag). */
+#define CAPTURE_PCAP_FILTER_TRUNK "icmp6 or (vlan and (icmp6 or (vlan and icmp6)))"
+
+/** A capture socket of a probe. The capture thread only copies frames into
+ *  the ring of the socket's analysis thread, which runs the watchers on them.
+ */
+struct capture_socket {
+    /** The probe's capture state. */
+    struct capture_descriptor* capture_handle;
+    /** Index of the socket in the fanout group. */
+    int index;
     pthread_t capture_thread;
     pcap_t* descr;
+    /** Set if the timestamps of the frames are in nanoseconds. */
+    int nanoseconds;
     struct bpf_program* filter_program;
+    struct analysis_worker* analysis;
+};
+
+/** Capture state of a probe: one socket, or several sockets joined in a
+ *  PACKET_FANOUT group that the kernel spreads the frames over.
+ */
+struct capture_descriptor {
+    struct probe* interface_probe;
+    int socket_count;
+    struct capture_socket sockets[CAPTURE_FANOUT_MAX];
 };
 
 
@@ -29,6 +62,17 @@ void capture_release(capture_handle_t capture_handle);
 
 void* capture_loop(void* args);
 
+#ifdef _LINUX_
+/** Reads a batch of frames from a capture socket of the event loop.
+ *  @param args The capture socket (struct capture_socket).
+ *  @return     0 to wait for more frames, -1 if the socket failed.
+ */
+int capture_pcap_dispatch(void* args);
+#endif
+
+/** Makes capture_up_all() return, see capture.h. */
+void capture_stop_all();
+
 void capture_down_all();
 
 void capture_up_all();
@@ -37,6 +81,17 @@ void capture_pcap_callback(u_char *args,const struct pcap_pkthdr* hdr,const u_ch
 
 int capture_pcap_interface_spec(char* interface, bpf_u_int32 netp, bpf_u_int32 maskp);
 
+/** Joins a capture socket to the PACKET_FANOUT group of its probe. The
+ *  sockets must join in order, the first one receives all Neighbor
+ *  Discovery messages.
+ *  @param descr        The activated pcap handle.
+ *  @param group        The group id, the same for all sockets of a probe.
+ *  @param mode         How the other ICMPv6 messages are spread.
+ *  @param socket_count Number of sockets in the group.
+ *  @return             0 on success, -1 otherwise.
+ */
+int capture_pcap_fanout_join(pcap_t* descr, uint16_t group, enum capture_fanout_mode mode, int socket_count);
+
 #else
 #define _CAPTURE_PCAP_NOT_USED
 #endif
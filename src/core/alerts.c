@@ -35,6 +35,9 @@ Olivier Festor, Scientific Leader of the MADYNEs Project, 20 August 2006
 
 static int watch;
 
+/* alerts raised by the calling thread, learning mode included: */
+static __thread unsigned long alert_raised = 0;
+
 int alert_already_sent(const char* const message)
 {
 	static char old_messages[HISTORY_LENGTH][NOTIFY_BUFFER_SIZE];
@@ -157,34 +160,14 @@ void alert_free(union event_data** alert)
 
 int alert_gethostfromipv6(const struct in6_addr* const ipv6_address, char* hostname) 
 {
-	/*struct in6_addr addrbuf;*/
-	struct hostent *h;
-
-	/*if (0 == inet_pton(AF_INET6, ipv6adr, &addrbuf)) {
-	  snprintf(hostname, HOST_NAME_SIZE, "<%s>",hstrerror(h_errno));
-	  if (DEBUG) fprintf(stderr,"Problem (inet_pton) looking up \"%." HOST_NAME_LEN_FSTR "s\": %." HOST_NAME_LEN_FSTR "s\n", ipv6adr, hstrerror(h_errno));
-	  return;
-	  }*/
-	h = gethostbyaddr(ipv6_address, sizeof(struct in6_addr), AF_INET6);
-	if (h) 
+	/* The lookup is done by the resolver workers, so a slow DNS server
+	 * does not stall the event queue. If the answer does not arrive in
+	 * time, hostname is set to "pending". */
+	if (resolver_lookup(ipv6_address, hostname)==0)
 	{
-		snprintf(hostname, HOST_NAME_SIZE, "%s", h->h_name);
 		return 0;
-	} else 
-	{
-		char ipv6_address_str[INET6_ADDRSTRLEN];
-		inet_ntop(AF_INET6, ipv6_address, ipv6_address_str, INET6_ADDRSTRLEN);
-		snprintf(hostname, HOST_NAME_SIZE, "<%s>", hstrerror(h_errno));
-		if (DEBUG) 
-		{
-			fprintf(
-					stderr,
-					"Problem (gethostbyaddr) looking up \"%." HOST_NAME_LEN_FSTR "s\": %." HOST_NAME_LEN_FSTR "s\n",
-					ipv6_address_str, hstrerror(h_errno));
-		}
-		return -1;
 	}
-	return 0;
+	return -1;
 }
 
 
@@ -252,6 +235,13 @@ void alert_handler_std_syslog(const struct event_info* event)
 		default:
 			break;
 	}
+#ifdef _SYSLOG_NATIVE_
+	/* the native syslog plugin sends the alert with structured data: */
+	if (syslog_native_active())
+	{
+		return;
+	}
+#endif
 	syslog(LOG_INFO, " %s ", alert->message);
 }
 
@@ -302,6 +292,11 @@ void alert_handler_std_xml_append(const struct event_info* event)
 	parser_alerts_append(alert);
 }
 
+unsigned long alert_raised_count()
+{
+	return alert_raised;
+}
+
 void alert_raise(int priority, const struct probe* probe, char* reason,
         char* message, const struct ether_addr* const ethernet_address1,
         const struct ether_addr* ethernet_address2,
@@ -310,6 +305,7 @@ void alert_raise(int priority, const struct probe* probe, char* reason,
 	union event_data* new = event_data_create();
 	time_t current = time(NULL);
 
+	alert_raised++;
 	if (!watch)
 	{
 		if (DEBUG)
@@ -322,6 +318,8 @@ void alert_raise(int priority, const struct probe* probe, char* reason,
 
 	/* Print information: */
 	fprintf(stderr, "[alerts] Alert \"%s\" raised on probe \"%s\".\n", reason, probe->name);
+	stats_alert(probe, reason);
+	evidence_alert(probe, reason, message);
 
 	/* fill event_data structure: */
 	new->alert.priority = priority;
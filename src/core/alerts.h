@@ -48,8 +48,15 @@ Olivier Festor, Scientific Leader of the MADYNEs Project, 20 August 2006
 #include "../ndpmon_netheaders.h"
 
 #include "events.h"
+#include "evidence.h"
 #include "extinfo.h"
 #include "probes.h"
+#include "resolver.h"
+#include "stats.h"
+
+#ifdef _SYSLOG_NATIVE_
+#include "../plugins/syslog_native/syslog_native.h"
+#endif
 
 /** @file
  *  Raises alerts and provides functions to post alerts to the syslog, mail or XML.
@@ -84,7 +91,8 @@ char* alert_create_mailmessage(const struct alert_info* const alert_info);
 void alert_free(union event_data** alert);
 
 /** Resolves an IPv6 address to a hostname to have additional information
- *  for the alert message.
+ *  for the alert message. Waits at most for the resolver deadline,
+ *  "pending" is written to hostname if the lookup takes longer.
  *  @param ipv6_address The address to be resolved.
  *  @param hostname     Buffer to hold the hostname, must be of
  *                      HOST_NAME_SIZE.
@@ -125,6 +133,13 @@ void alert_handler_std_xml_append(const struct event_info* event);
  */
 void alert_raise(int priority, const struct probe* probe, char* reason, char* message, const struct ether_addr* const ethernet_address1, const struct ether_addr* ethernet_address2, const struct in6_addr* const ipv6_address, struct extinfo_list* extinfo);
 
+/** Counts the alerts raised by the calling thread, including those
+ *  ignored in learning mode. Tells whether the analysis of a frame raised
+ *  an alert.
+ *  @return The number of alerts raised by the calling thread.
+ */
+unsigned long alert_raised_count();
+
 /** Saves an alert to a given XML element.
  *  @param element The element to add the information to.
  *  @param alert   The alert information.
@@ -0,0 +1,75 @@
+#include "analysis.h"
+
+static void* analysis_worker_run(void* args) {
+    struct analysis_worker* worker = (struct analysis_worker*) args;
+    struct packet_ring* ring = worker->ring;
+    uint32_t available;
+    uint32_t i;
+
+    /* returns 0 once the ring is closed and drained: */
+    while ((available=packet_ring_wait(ring, ANALYSIS_RING_BATCH))>0) {
+        for (i=0; i<available; i++) {
+            struct packet_ring_slot* slot = packet_ring_peek(ring, i);
+            struct timeval timestamp;
+
+            timestamp.tv_sec  = slot->timestamp.tv_sec;
+            timestamp.tv_usec = slot->timestamp.tv_nsec / 1000;
+            capture_process_packet(worker->probe, &timestamp,
+                    slot->data, slot->length);
+        }
+        packet_ring_release(ring, available);
+    }
+    return NULL;
+}
+
+struct analysis_worker* analysis_worker_create(struct probe* probe, uint32_t slot_size) {
+    struct analysis_worker* worker;
+
+    if ((worker=malloc(sizeof(struct analysis_worker)))==NULL) {
+        perror("[analysis] malloc failed");
+        return NULL;
+    }
+    memset(worker, 0, sizeof(struct analysis_worker));
+    worker->probe = probe;
+    if ((worker->ring=packet_ring_create(ANALYSIS_RING_SLOTS, slot_size))==NULL) {
+        free(worker);
+        return NULL;
+    }
+    if (pthread_create(&worker->thread, NULL, analysis_worker_run, worker)!=0) {
+        perror("[analysis] pthread_create failed");
+        packet_ring_free(worker->ring);
+        free(worker);
+        return NULL;
+    }
+    if (DEBUG) {
+        fprintf(stderr, "[analysis] analysis thread started for %s.\n", probe->name);
+    }
+    return worker;
+}
+
+int analysis_worker_dispatch(struct analysis_worker* worker, const struct timespec* timestamp,
+        const uint8_t* data, uint32_t length) {
+    return packet_ring_push(worker->ring, timestamp, data, length);
+}
+
+void analysis_worker_stop(struct analysis_worker* worker) {
+    if (worker->stopped) {
+        return;
+    }
+    packet_ring_close(worker->ring);
+    pthread_join(worker->thread, NULL);
+    worker->stopped = 1;
+}
+
+void analysis_worker_free(struct analysis_worker* worker) {
+    if (worker==NULL) {
+        return;
+    }
+    analysis_worker_stop(worker);
+    packet_ring_free(worker->ring);
+    free(worker);
+}
+
+void analysis_worker_get_stats(struct analysis_worker* worker, struct packet_ring_stats* stats) {
+    packet_ring_get_stats(worker->ring, stats);
+}
@@ -0,0 +1,79 @@
+#ifndef _ANALYSIS_H_
+#define _ANALYSIS_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "capture.h"
+#include "packet_ring.h"
+
+/** @file
+ *  Analysis thread of a capture socket.
+ *
+ *  The capture thread of a socket only copies each frame into the ring of
+ *  the socket's analysis thread, which runs the watch functions. A burst
+ *  of frames is buffered in the ring while the watchers are busy instead
+ *  of filling the kernel buffer.
+ *
+ *  All frames of a socket are analyzed by the same thread, in capture
+ *  order: a DAD solicitation and the advertisement of another host
+ *  answering it, or the advertisements of two hosts claiming an address,
+ *  are seen in the order they were sent. The neighbor and router state is
+ *  protected by the probe lock.
+ */
+
+/** Number of frames buffered for the analysis thread. */
+#define ANALYSIS_RING_SLOTS 2048
+/** Maximum number of frames analyzed per ring wakeup. */
+#define ANALYSIS_RING_BATCH 64
+
+/** The analysis thread of a capture socket. */
+struct analysis_worker {
+    /** The probe the frames were captured on. */
+    struct probe* probe;
+    /** Frames waiting for analysis. */
+    struct packet_ring* ring;
+    /** The analysis thread. */
+    pthread_t thread;
+    /** Set once the thread is stopped. */
+    int stopped;
+};
+
+/** Creates the ring and starts the analysis thread.
+ *  @param probe     The probe the frames are captured on.
+ *  @param slot_size Bytes kept of each frame (the capture snaplen).
+ *  @return          The analysis thread or NULL on error.
+ */
+struct analysis_worker* analysis_worker_create(struct probe* probe, uint32_t slot_size);
+
+/** Hands a frame to the analysis thread (called by the capture thread only).
+ *  @param worker    The analysis thread.
+ *  @param timestamp Capture time.
+ *  @param data      The frame.
+ *  @param length    Length of the frame.
+ *  @return          0 on success, -1 if the frame was dropped.
+ */
+int analysis_worker_dispatch(struct analysis_worker* worker, const struct timespec* timestamp,
+        const uint8_t* data, uint32_t length);
+
+/** Stops the analysis thread once the frames already queued are analyzed.
+ *  The capture thread must be stopped.
+ *  @param worker The analysis thread.
+ */
+void analysis_worker_stop(struct analysis_worker* worker);
+
+/** Stops the analysis thread (if still running) and releases it.
+ *  @param worker The analysis thread.
+ */
+void analysis_worker_free(struct analysis_worker* worker);
+
+/** Reads the statistics of the ring of the analysis thread.
+ *  @param worker The analysis thread.
+ *  @param stats  Will hold the statistics.
+ */
+void analysis_worker_get_stats(struct analysis_worker* worker, struct packet_ring_stats* stats);
+
+#endif
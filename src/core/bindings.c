@@ -0,0 +1,173 @@
+#include "bindings.h"
+
+/* Gets the binding cache of a probe, creates it on first use. */
+static struct binding_cache* bindings_get(struct probe* probe) {
+    struct binding_cache* cache = __atomic_load_n(&probe->bindings, __ATOMIC_ACQUIRE);
+    struct binding_cache* expected = NULL;
+
+    if (cache!=NULL) {
+        return cache;
+    }
+    if ((cache=calloc(1, sizeof(struct binding_cache)))==NULL) {
+        perror("[bindings] calloc failed");
+        return NULL;
+    }
+    /* another analysis thread of the probe may have been faster: */
+    if (!__atomic_compare_exchange_n(&probe->bindings, &expected, cache, 0,
+            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        free(cache);
+        cache = expected;
+    }
+    return cache;
+}
+
+/* Fills the key of a binding from a frame, returns -1 if it is not cached. */
+static int bindings_key(const struct capture_info* capture_info, struct binding* key) {
+    const uint8_t* message = (const uint8_t*) capture_info->icmp6_header;
+    long length;
+
+    switch (capture_info->icmp6_type) {
+        case ND_ROUTER_SOLICIT:
+        case ND_NEIGHBOR_SOLICIT:
+        case ND_NEIGHBOR_ADVERT:
+            break;
+        default:
+            return -1;
+    }
+    if (!watchers_flags_isset(capture_info->watch_flags, WATCH_FLAG_IP6_SRC_SPECIFIED)) {
+        return -1;
+    }
+    /* the message following the checksum: */
+    length = (long)((capture_info->packet_data + capture_info->packet_length) - (message+4));
+    if (length<0 || length>BINDINGS_MESSAGE_SIZE) {
+        return -1;
+    }
+    memset(key, 0, sizeof(struct binding));
+    memcpy(&key->ethernet_address, capture_info->ethernet_header->ether_shost, sizeof(struct ether_addr));
+    memcpy(&key->ipv6_address, &capture_info->ip6_header->ip6_src, sizeof(struct in6_addr));
+    key->icmp6_type = capture_info->icmp6_header->icmp6_type;
+    key->icmp6_code = capture_info->icmp6_header->icmp6_code;
+    key->length = (uint16_t)length;
+    memcpy(key->message, message+4, length);
+    return 0;
+}
+
+/* FNV-1a of the key, only used to pick the slot. */
+static unsigned int bindings_slot(const struct binding* key) {
+    const uint8_t* parts[3] = {
+        (const uint8_t*)&key->ethernet_address, (const uint8_t*)&key->ipv6_address, key->message
+    };
+    size_t sizes[3] = { sizeof(struct ether_addr), sizeof(struct in6_addr), key->length };
+    uint64_t hash = 14695981039346656037ULL ^ key->icmp6_type;
+    size_t i, j;
+
+    for (i=0; i<3; i++) {
+        for (j=0; j<sizes[i]; j++) {
+            hash ^= parts[i][j];
+            hash *= 1099511628211ULL;
+        }
+    }
+    return (unsigned int)(hash ^ (hash>>32)) & (BINDINGS_SLOTS-1);
+}
+
+/* Tells if a binding has the key of another. */
+static int bindings_equal(const struct binding* binding, const struct binding* key) {
+    return binding->icmp6_type==key->icmp6_type && binding->icmp6_code==key->icmp6_code
+            && binding->length==key->length
+            && memcmp(&binding->ethernet_address, &key->ethernet_address, sizeof(struct ether_addr))==0
+            && memcmp(&binding->ipv6_address, &key->ipv6_address, sizeof(struct in6_addr))==0
+            && memcmp(binding->message, key->message, key->length)==0;
+}
+
+/* Marks the neighbor of a binding as seen, as new_station() does for a known binding. */
+static void bindings_seen(struct probe* probe, const struct binding* binding) {
+    lastseen_mark(probe, binding->neighbor,
+            IN6_IS_ADDR_LINKLOCAL(&binding->ipv6_address) ? NULL : &binding->ipv6_address);
+}
+
+int watch_known_binding(struct capture_info* const capture_info) {
+    struct binding_cache* cache;
+    struct binding* slot;
+    struct binding key;
+    struct binding binding;
+    uint64_t sequence;
+
+    if (bindings_key(capture_info, &key)==-1 || (cache=bindings_get(capture_info->probe))==NULL) {
+        return 0;
+    }
+    /* remembered for bindings_verified(): */
+    capture_info->binding_generation = __atomic_load_n(&capture_info->probe->bindings_generation, __ATOMIC_ACQUIRE);
+    capture_info->binding_alerts = alert_raised_count();
+    capture_info->binding_candidate = 1;
+
+    slot = &cache->slots[bindings_slot(&key)];
+    sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+    if (sequence&1) {
+        return 0;
+    }
+    memcpy(&binding, slot, sizeof(struct binding));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED)!=sequence) {
+        return 0;
+    }
+    if (sequence==0 || binding.generation!=capture_info->binding_generation
+            || difftime(time(NULL), binding.verified)>=BINDINGS_TTL || !bindings_equal(&binding, &key)) {
+        return 0;
+    }
+    bindings_seen(capture_info->probe, &binding);
+    watchers_flags_set(&capture_info->watch_flags, WATCH_FLAG_KNOWN_BINDING);
+    capture_info->binding_candidate = 0;
+    return 0;
+}
+
+void bindings_verified(const struct capture_info* capture_info, int packet_result) {
+    struct binding_cache* cache = __atomic_load_n(&capture_info->probe->bindings, __ATOMIC_ACQUIRE);
+    struct binding* slot;
+    struct binding key;
+    uint64_t sequence;
+
+    if (!capture_info->binding_candidate || packet_result!=0 || cache==NULL
+            || alert_raised_count()!=capture_info->binding_alerts
+            || __atomic_load_n(&capture_info->probe->bindings_generation, __ATOMIC_ACQUIRE)!=capture_info->binding_generation
+            || bindings_key(capture_info, &key)==-1) {
+        return;
+    }
+    /* critical section: */
+    key.neighbor = get_neighbor_by_mac(probe_handle_rdlock(capture_info->probe)->neighbors, &key.ethernet_address);
+    probe_handle_unlock(capture_info->probe);
+    /* end critical section. */
+    if (key.neighbor==NULL) {
+        return;
+    }
+    key.generation = capture_info->binding_generation;
+    key.verified = time(NULL);
+    slot = &cache->slots[bindings_slot(&key)];
+    sequence = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+    /* leave the slot to a thread writing it already: */
+    if ((sequence&1) || !__atomic_compare_exchange_n(&slot->sequence, &sequence, sequence+1, 0,
+            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+    }
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy((uint8_t*)slot+sizeof(uint64_t), (const uint8_t*)&key+sizeof(uint64_t),
+            sizeof(struct binding)-sizeof(uint64_t));
+    __atomic_store_n(&slot->sequence, sequence+2, __ATOMIC_RELEASE);
+}
+
+void bindings_invalidate(struct probe* probe) {
+    __atomic_add_fetch(&probe->bindings_generation, 1, __ATOMIC_RELEASE);
+}
+
+void bindings_free() {
+    struct probe_list** locked_probes;
+    struct probe_list* tmp_probes;
+
+    /* critical section: */
+    locked_probes = probe_list_lock();
+    for (tmp_probes=*locked_probes; tmp_probes!=NULL; tmp_probes=tmp_probes->next) {
+        free(tmp_probes->entry.bindings);
+        tmp_probes->entry.bindings = NULL;
+    }
+    probe_list_unlock();
+    /* end critical section. */
+}
@@ -0,0 +1,99 @@
+#ifndef _BINDINGS_H_
+#define _BINDINGS_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "ndpmon_defs.h"
+#include "../ndpmon_netheaders.h"
+
+#include "alerts.h"
+#include "cache_types.h"
+#include "lastseen.h"
+#include "neighbors.h"
+#include "probes.h"
+#include "watchers.h"
+
+/** @file
+ *  Known-host fast path: a cache of the verified bindings of each probe.
+ *
+ *  A binding is the source MAC and IPv6 address of a Router Solicitation,
+ *  Neighbor Solicitation or Neighbor Advertisement together with the
+ *  message itself (ICMPv6 type, code and body, options included). It is
+ *  verified once a frame carrying it went through all watch functions
+ *  without raising an alert and without changing the neighbor cache or
+ *  router list of its probe.
+ *
+ *  watch_known_binding() looks the frames up right after they are decoded.
+ *  For a verified binding it only marks the neighbor as seen (see
+ *  lastseen.h), without locking the probe, and sets WATCH_FLAG_KNOWN_BINDING, so that only the watch functions
+ *  registered with WATCH_FLAG_STATELESS are called. Those check the parts
+ *  of the frame outside the binding (e.g. the hop limit) or follow state
+ *  the cache does not cover (e.g. Duplicate Address Detection).
+ *
+ *  Every change of the neighbor cache or router list of a probe must call
+ *  bindings_invalidate(), which drops all bindings of the probe by
+ *  increasing its generation. Bindings are also verified again after
+ *  BINDINGS_TTL seconds, so that the neighbor updates keep being reported.
+ */
+
+/** Number of bindings cached per probe (a power of two). */
+#define BINDINGS_SLOTS 1024
+/** Largest ICMPv6 message cached, in bytes following the checksum. */
+#define BINDINGS_MESSAGE_SIZE 64
+/** Seconds a binding is used before it is verified again. */
+#define BINDINGS_TTL 60
+
+/** A verified binding. */
+struct binding {
+    /** Odd while the binding is written. */
+    uint64_t sequence;
+    /** Generation of the probe's bindings it was verified in. */
+    uint64_t generation;
+    /** Time it was verified. */
+    time_t verified;
+    /** The neighbor of the source MAC address, the handle of its lastseen marks. */
+    const neighbor_list_t* neighbor;
+    struct ether_addr ethernet_address;
+    uint8_t icmp6_type;
+    uint8_t icmp6_code;
+    /** Length of the message following the checksum. */
+    uint16_t length;
+    struct in6_addr ipv6_address;
+    /** The message following the checksum. */
+    uint8_t message[BINDINGS_MESSAGE_SIZE];
+};
+
+/** The verified bindings of a probe, indexed by a hash of their key. */
+struct binding_cache {
+    struct binding slots[BINDINGS_SLOTS];
+};
+
+/** Drops all verified bindings of a probe. Called with the probe locked
+ *  for writing, whenever its neighbor cache or router list is changed.
+ *  @param probe The probe.
+ */
+void bindings_invalidate(struct probe* probe);
+
+/** Stores the binding of an analyzed frame if it was verified, i.e. if
+ *  watch_known_binding() looked it up and no watch function raised an
+ *  alert or changed the probe since.
+ *  @param capture_info  The analyzed frame.
+ *  @param packet_result The result of watchers_call().
+ */
+void bindings_verified(const struct capture_info* capture_info, int packet_result);
+
+/** Releases the binding caches of all probes. The capture must be stopped. */
+void bindings_free();
+
+/** Watch function looking up the binding of a NDP message, sets
+ *  WATCH_FLAG_KNOWN_BINDING if it is verified.
+ *  @param capture_info The frame.
+ *  @return             Always 0.
+ */
+int watch_known_binding(struct capture_info* const capture_info);
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "ndpmon_defs.h"
 #include "../ndpmon_netheaders.h"
+#include "packet_ring.h"
 
 /** Maximum size of a probe name. */
 #define PROBE_NAME_SIZE 100
@@ -110,6 +111,24 @@ typedef struct route_info
 
 
 
+/** Open addressing hash index of the entries of a router list or of the
+    sub-lists of a router, maintained by the functions of routers.c.
+    An index that is not allocated (slots==NULL) is not used, the list is
+    scanned instead.
+*/
+struct router_index
+{
+	/** Hashes of the entries, in the slots of the entries. */
+	uint64_t *hashes;
+	/** The entries indexed, NULL for an empty slot. */
+	void **slots;
+	/** Number of slots (a power of two). */
+	uint32_t capacity;
+	/** Number of entries indexed. */
+	uint32_t count;
+};
+
+
 /** Stores entries for the legitimate routers in the network.
     The members starting with "param_" are used to determine whether
     the RA params are wellformed and to send faked RA in the counter measures plugin.
@@ -147,6 +166,27 @@ typedef struct router_list
 	dnssl_t *domains;
 	/** Pointer to the list of routes advertised */
 	route_info_t *routes;
+	/** Index of the prefixes by prefix and mask. */
+	struct router_index prefix_index;
+	/** Index of the routes by prefix and mask. */
+	struct router_index route_index;
+	/** Index of the nameservers by address and lifetime. */
+	struct router_index nameserver_index;
+	/** Index of the domains by domain and lifetime. */
+	struct router_index domain_index;
+	/** Index of the routers of the list by link local and ETHERNET address,
+	    held by the first entry of a list built by router_add(). */
+	struct router_index router_index;
+	/** Index of the first router of the list with a given ETHERNET address,
+	    held by the first entry of a list built by router_add(). */
+	struct router_index mac_index;
+	/** Canonical form of the last RA of this router that passed all checks of watch_ra(),
+	    NULL if none. Not copied by router_copy(). */
+	uint8_t *ra_verified;
+	/** Length of the canonical form of the last RA verified. */
+	size_t ra_verified_length;
+	/** Fingerprint of the canonical form of the last RA verified. */
+	uint64_t ra_verified_fingerprint;
 	/** Pointer to the next router list entry.*/
 	struct router_list *next;
 } router_list_t;
@@ -156,9 +196,64 @@ enum probe_type
     /** Locally connected interface. */
     PROBE_TYPE_INTERFACE,
     /** Remote interface that is reporting to this NDPMon instance. */
-    PROBE_TYPE_REMOTE
+    PROBE_TYPE_REMOTE,
+    /** Virtual probe for a VLAN captured on a trunk interface. */
+    PROBE_TYPE_VLAN
 };
 
+/** Capture statistics of a probe, cumulative since the capture was started.
+ *  Counters a capture library does not provide stay 0.
+ */
+struct capture_stats {
+    /** Time of the collection. */
+    time_t time;
+    /** Frames that reached the capture, the lost ones included. */
+    uint64_t received;
+    /** Frames the kernel dropped since the capture buffer was full (pcap ps_drop). */
+    uint64_t kernel_dropped;
+    /** Frames dropped by the interface or its driver (pcap ps_ifdrop). */
+    uint64_t interface_dropped;
+    /** Packets dropped since the netfilter queue was full. */
+    uint64_t queue_dropped;
+    /** Packets the kernel failed to send to the netfilter queue socket. */
+    uint64_t queue_user_dropped;
+    /** Overruns of the netfilter queue socket buffer seen by the capture threads. */
+    uint64_t overruns;
+    /** Statistics of the analysis rings (ring.dropped is counted as loss). */
+    struct packet_ring_stats ring;
+};
+
+/** Maximum number of alert reasons counted separately, the alerts of
+ *  further reasons are counted with the last one. */
+#define PROBE_STATS_REASONS_MAX 64
+
+/** Runtime counters of a probe. They are updated and read with atomic
+ *  operations, without holding the probe lock (see stats.h).
+ */
+struct probe_stats {
+    /** Frames analyzed, by ICMPv6 type (0 for frames of other protocols). */
+    uint64_t packets[256];
+    /** Bytes of the frames analyzed. */
+    uint64_t bytes;
+    /** Alerts raised, by the index of their reason (see stats_reason_name()). */
+    uint64_t alerts[PROBE_STATS_REASONS_MAX];
+    /** Entries of the neighbor cache (refreshed periodically). */
+    uint64_t neighbors;
+    /** IPv6 addresses of all neighbors (refreshed periodically). */
+    uint64_t addresses;
+    /** Entries of the router list (refreshed periodically). */
+    uint64_t routers;
+    /** Time of the last refresh of the cache sizes. */
+    time_t refreshed;
+};
+
+/* see evidence.h */
+struct evidence_ring;
+/* see bindings.h */
+struct binding_cache;
+/* see dad.h */
+struct dad_table;
+
 /** Holds all state information of a probe. */
 struct probe 
 {
@@ -182,6 +277,16 @@ struct probe
     neighbor_list_t* neighbors;
     /** The router list of this probe. */
     router_list_t* routers;
+    /** Runtime counters, not copied by probe_copy(). */
+    struct probe_stats stats;
+    /** Recent frames for the evidence of alerts, not copied by probe_copy(). */
+    struct evidence_ring* evidence;
+    /** Verified bindings of the known-host fast path, not copied by probe_copy(). */
+    struct binding_cache* bindings;
+    /** Increased by every change of the neighbor cache or router list. */
+    uint64_t bindings_generation;
+    /** Duplicate Address Detections in progress, not copied by probe_copy(). */
+    struct dad_table* dad;
 };
 
 #endif
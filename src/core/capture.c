@@ -62,10 +62,8 @@ int capture_nd_option_list_add(struct nd_option_list** option_list, const struct
 
 
 		default:
-			if (DEBUG) 
-			{
-				fprintf(stderr, "[capture] unknown option type %u, ignoring option.\n",	opt->nd_opt_type);
-			}
+			LOGGING_RATELIMITED(LOGGING_CAPTURE, LOGGING_LEVEL_DEBUG,
+					"[capture] unknown option type %u, ignoring option.\n", opt->nd_opt_type);
 	}
 
 	if (*option_list == NULL) 
@@ -113,6 +111,31 @@ int capture_process_packet(struct probe* probe, const struct timeval* timestamp,
 	struct capture_info  capture_info;
 	/* pre-initialize a buffer for storing alerts: */
 	char message[NOTIFY_BUFFER_SIZE];
+	/* VLAN IDs of a tagged frame: */
+	uint16_t vids[VLAN_TAGS_MAX];
+	int tags;
+
+	/* tagged frames are analyzed untagged, on the virtual probe of their
+	 * VLAN if the probe is a trunk: */
+	if ((tags=vlan_parse(packet_data, packet_length, vids))!=0)
+	{
+		if (tags<0)
+		{
+			LOGGING_RATELIMITED(LOGGING_CAPTURE, LOGGING_LEVEL_DEBUG,
+					"[capture] frame with unsupported VLAN tags ignored.\n");
+			return 0;
+		}
+		if ((probe=vlan_probe_get(probe, vids, tags))==NULL)
+		{
+			/* a VLAN beyond the limit of virtual probes: */
+			return 0;
+		}
+		packet_data = vlan_strip(packet_data, tags);
+		packet_length -= tags*VLAN_TAG_SIZE;
+	}
+
+	/* keep the frame for the evidence of the alerts it may raise: */
+	evidence_record(probe, timestamp, packet_data, packet_length);
 
 	memset(&capture_info, 0, sizeof(struct capture_info));
 	memset(&message, 0, NOTIFY_BUFFER_SIZE);
@@ -120,24 +143,465 @@ int capture_process_packet(struct probe* probe, const struct timeval* timestamp,
 	capture_info.message = message;
 	capture_info.packet_data = packet_data;
 	capture_info.packet_length = packet_length;
+	capture_info.timestamp = timestamp;
 
 #ifdef _COUNTERMEASURES_
 	/* if (cm_on_link_remove(packet, hdr->len)!=0) { */
 	if (cm_on_link_remove(capture_info.packet_data, capture_info.packet_length)!=0) 
 	{
-		fprintf(stderr,"---- ICMP packet ----\n");
-		fprintf(stderr, "[countermeasures]: Packet dropped as it is a NDPMon counter measure.\n");
-		fprintf(stderr,"------------------\n\n");
+		LOGGING(LOGGING_PLUGINS, LOGGING_LEVEL_DEBUG,
+				"[countermeasures]: Packet dropped as it is a NDPMon counter measure.\n");
 		return 0;
 	}
 #endif
 	/* Call watch functions: */
 	packet_result = watchers_call(&capture_info);
+	/* a known host's next identical message takes the fast path: */
+	bindings_verified(&capture_info, packet_result);
+	/* the watchers set the ICMPv6 type: */
+	stats_packet(probe, capture_info.icmp6_type, packet_length);
 	/* Free neighbor discovery option list: */
 	capture_nd_option_list_free((struct nd_option_list**)&capture_info.option_list);
 
-	fprintf(stderr,"------------------\n\n");
+	LOGGING(LOGGING_CAPTURE, LOGGING_LEVEL_TRACE, "------------------\n\n");
 
 	sched_yield();
 	return packet_result;
 }
+
+static const char* capture_fanout_mode_names[] = { "mac", "cpu", "hash" };
+
+static void capture_settings_defaults(struct capture_settings* settings)
+{
+	memset(settings, 0, sizeof(struct capture_settings));
+	settings->fanout = 1;
+	settings->fanout_mode = CAPTURE_FANOUT_MAC;
+	settings->snaplen = CAPTURE_SNAPLEN_DEFAULT;
+	settings->timeout = 1000;
+	settings->stats_interval = 60;
+	settings->loss_alert = 1;
+	settings->vlan_probes_max = VLAN_PROBES_MAX_DEFAULT;
+}
+
+void capture_settings_get(const struct probe* probe, struct capture_settings* settings)
+{
+	const struct capture_settings* probe_settings = extinfo_list_get_data(probe->extinfo, "capture");
+
+	if (probe_settings==NULL)
+	{
+		capture_settings_defaults(settings);
+		return;
+	}
+	memcpy(settings, probe_settings, sizeof(struct capture_settings));
+}
+
+int capture_settings_load(xmlNodePtr element, void** data)
+{
+	struct capture_settings* settings;
+	xmlChar* mode_prop;
+	xmlChar* precision_prop;
+
+	if ((settings=malloc(sizeof(struct capture_settings)))==NULL)
+	{
+		perror("[capture] malloc failed");
+		return -1;
+	}
+	capture_settings_defaults(settings);
+	if (settings_get_int(element, "fanout", &settings->fanout, 1, CAPTURE_FANOUT_MAX)==-1
+			|| settings_get_int(element, "snaplen", &settings->snaplen, 128, CAPTURE_SNAPLEN_MAX)==-1
+			|| settings_get_int(element, "buffer_size", &settings->buffer_size, 0, 1<<30)==-1
+			|| settings_get_int(element, "timeout", &settings->timeout, 1, 60000)==-1
+			|| settings_get_int(element, "immediate", &settings->immediate, 0, 1)==-1
+			|| settings_get_int(element, "tpacket_version", &settings->tpacket_version, 2, 3)==-1
+			|| settings_get_int(element, "stats_interval", &settings->stats_interval, 0, 86400)==-1
+			|| settings_get_int(element, "loss_alert", &settings->loss_alert, 0, 100)==-1
+			|| settings_get_int(element, "trunk", &settings->trunk, 0, 1)==-1
+			|| settings_get_int(element, "vlan_probes_max", &settings->vlan_probes_max, 1, VLAN_ID_COUNT*VLAN_ID_COUNT)==-1)
+	{
+		free(settings);
+		return -1;
+	}
+	if ((mode_prop=xmlGetProp(element, BAD_CAST "fanout_mode"))!=NULL)
+	{
+		if (STRCMP(mode_prop, "mac")==0)
+		{
+			settings->fanout_mode = CAPTURE_FANOUT_MAC;
+		}
+		else if (STRCMP(mode_prop, "cpu")==0)
+		{
+			settings->fanout_mode = CAPTURE_FANOUT_CPU;
+		}
+		else if (STRCMP(mode_prop, "hash")==0)
+		{
+			settings->fanout_mode = CAPTURE_FANOUT_HASH;
+		}
+		else
+		{
+			fprintf(stderr, "[capture] ERROR: unknown fanout mode %s.\n", (char*)mode_prop);
+			xmlFree(mode_prop);
+			free(settings);
+			return -1;
+		}
+		xmlFree(mode_prop);
+	}
+	if ((precision_prop=xmlGetProp(element, BAD_CAST "tstamp_precision"))!=NULL)
+	{
+		if (STRCMP(precision_prop, "nano")==0)
+		{
+			settings->nanoseconds = 1;
+		}
+		else if (STRCMP(precision_prop, "micro")!=0)
+		{
+			fprintf(stderr, "[capture] ERROR: unknown timestamp precision %s.\n", (char*)precision_prop);
+			xmlFree(precision_prop);
+			free(settings);
+			return -1;
+		}
+		xmlFree(precision_prop);
+	}
+	*data = settings;
+	return 0;
+}
+
+void capture_settings_print(void* data)
+{
+	struct capture_settings* settings = (struct capture_settings*) data;
+
+	if (settings->fanout>1)
+	{
+		fprintf(stderr, "    capture: %i sockets (fanout by %s)\n",
+				settings->fanout, capture_fanout_mode_names[settings->fanout_mode]);
+	}
+	fprintf(stderr, "    capture: snaplen %i, buffer size %i, %s, %s timestamps",
+			settings->snaplen, settings->buffer_size,
+			settings->immediate ? "immediate mode" : "batched delivery",
+			settings->nanoseconds ? "nanosecond" : "microsecond");
+	if (settings->tpacket_version!=0)
+	{
+		fprintf(stderr, ", TPACKET_V%i", settings->tpacket_version);
+	}
+	fprintf(stderr, "\n");
+	if (settings->trunk)
+	{
+		fprintf(stderr, "    capture: VLAN trunk, up to %i virtual probes\n", settings->vlan_probes_max);
+	}
+	if (settings->stats_interval>0)
+	{
+		fprintf(stderr, "    capture: statistics every %i s", settings->stats_interval);
+		if (settings->loss_alert>0)
+		{
+			fprintf(stderr, ", alert above %i%% loss", settings->loss_alert);
+		}
+		fprintf(stderr, "\n");
+	}
+}
+
+int capture_settings_save(xmlNodePtr element, void* data)
+{
+	struct capture_settings* settings = (struct capture_settings*) data;
+
+	settings_set_int(element, "fanout", settings->fanout);
+	xmlNewProp(element, BAD_CAST "fanout_mode", BAD_CAST capture_fanout_mode_names[settings->fanout_mode]);
+	settings_set_int(element, "snaplen", settings->snaplen);
+	settings_set_int(element, "buffer_size", settings->buffer_size);
+	settings_set_int(element, "timeout", settings->timeout);
+	settings_set_int(element, "immediate", settings->immediate);
+	xmlNewProp(element, BAD_CAST "tstamp_precision", BAD_CAST (settings->nanoseconds ? "nano" : "micro"));
+	if (settings->tpacket_version!=0)
+	{
+		settings_set_int(element, "tpacket_version", settings->tpacket_version);
+	}
+	settings_set_int(element, "stats_interval", settings->stats_interval);
+	settings_set_int(element, "loss_alert", settings->loss_alert);
+	if (settings->trunk)
+	{
+		xmlNewProp(element, BAD_CAST "trunk", BAD_CAST "1");
+		settings_set_int(element, "vlan_probes_max", settings->vlan_probes_max);
+	}
+	return 0;
+}
+
+/* Statistics collected for a probe by the monitor thread. */
+struct capture_monitor_entry
+{
+	const struct probe* probe;
+	/* the last collection: */
+	struct capture_stats last;
+	int collected;
+	/* time of the next collection: */
+	time_t next_collection;
+	/* set while the loss is above the threshold, to alert only once: */
+	int alerted;
+	struct capture_monitor_entry* next;
+};
+
+static struct capture_monitor_entry* capture_monitor_entries = NULL;
+static pthread_mutex_t capture_monitor_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t capture_monitor_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t capture_monitor_thread;
+static int capture_monitor_running = 0;
+static int capture_monitor_started = 0;
+
+uint64_t capture_stats_lost(const struct capture_stats* stats)
+{
+	/* overruns are not added, the messages lost are in queue_user_dropped: */
+	return stats->kernel_dropped + stats->interface_dropped + stats->queue_dropped
+		+ stats->queue_user_dropped + stats->ring.dropped;
+}
+
+/* Returns the entry of a probe, creates it if there is none. Must be called with the monitor lock held. */
+static struct capture_monitor_entry* capture_monitor_entry_get(const struct probe* probe, int create)
+{
+	struct capture_monitor_entry* entry = capture_monitor_entries;
+
+	while (entry!=NULL)
+	{
+		if (entry->probe==probe)
+		{
+			return entry;
+		}
+		entry = entry->next;
+	}
+	if (!create)
+	{
+		return NULL;
+	}
+	if ((entry=malloc(sizeof(struct capture_monitor_entry)))==NULL)
+	{
+		perror("[capture] malloc failed");
+		return NULL;
+	}
+	memset(entry, 0, sizeof(struct capture_monitor_entry));
+	entry->probe = probe;
+	entry->next = capture_monitor_entries;
+	capture_monitor_entries = entry;
+	return entry;
+}
+
+int capture_stats_last(const struct probe* probe, struct capture_stats* stats)
+{
+	struct capture_monitor_entry* entry;
+	int ret = -1;
+
+	pthread_mutex_lock(&capture_monitor_lock);
+	entry = capture_monitor_entry_get(probe, 0);
+	if (entry!=NULL && entry->collected)
+	{
+		memcpy(stats, &entry->last, sizeof(struct capture_stats));
+		ret = 0;
+	}
+	pthread_mutex_unlock(&capture_monitor_lock);
+	return ret;
+}
+
+int capture_stats_save(xmlNodePtr element, const struct capture_stats* stats)
+{
+	char number[24];
+
+	snprintf(number, sizeof(number), "%lld", (long long)stats->time);
+	xmlNewProp(element, BAD_CAST "time", BAD_CAST number);
+	snprintf(number, sizeof(number), "%llu", (unsigned long long)stats->received);
+	xmlNewProp(element, BAD_CAST "received", BAD_CAST number);
+	snprintf(number, sizeof(number), "%llu", (unsigned long long)stats->kernel_dropped);
+	xmlNewProp(element, BAD_CAST "kernel_dropped", BAD_CAST number);
+	snprintf(number, sizeof(number), "%llu", (unsigned long long)stats->interface_dropped);
+	xmlNewProp(element, BAD_CAST "interface_dropped", BAD_CAST number);
+	snprintf(number, sizeof(number), "%llu", (unsigned long long)stats->queue_dropped);
+	xmlNewProp(element, BAD_CAST "queue_dropped", BAD_CAST number);
+	snprintf(number, sizeof(number), "%llu", (unsigned long long)stats->queue_user_dropped);
+	xmlNewProp(element, BAD_CAST "queue_user_dropped", BAD_CAST number);
+	snprintf(number, sizeof(number), "%llu", (unsigned long long)stats->overruns);
+	xmlNewProp(element, BAD_CAST "overruns", BAD_CAST number);
+	snprintf(number, sizeof(number), "%llu", (unsigned long long)stats->ring.dropped);
+	xmlNewProp(element, BAD_CAST "ring_dropped", BAD_CAST number);
+	snprintf(number, sizeof(number), "%llu", (unsigned long long)stats->ring.truncated);
+	xmlNewProp(element, BAD_CAST "ring_truncated", BAD_CAST number);
+	snprintf(number, sizeof(number), "%u", stats->ring.high_water);
+	xmlNewProp(element, BAD_CAST "ring_high_water", BAD_CAST number);
+	return 0;
+}
+
+/* Checks if the share of frames lost since the previous collection exceeds
+ * the threshold. Returns 1 if an alert is to be raised (once while the loss
+ * stays above the threshold), 0 otherwise. */
+static int capture_monitor_check_loss(struct capture_monitor_entry* entry, const struct capture_settings* settings,
+		uint64_t lost, uint64_t total)
+{
+	if (settings->loss_alert==0 || lost==0 || lost*100 <= (uint64_t)settings->loss_alert*total)
+	{
+		entry->alerted = 0;
+		return 0;
+	}
+	if (entry->alerted)
+	{
+		return 0;
+	}
+	entry->alerted = 1;
+	return 1;
+}
+
+/* Collects the statistics of a probe if they are due (always if final is set). */
+static void capture_monitor_collect(struct probe* probe, time_t now, int final)
+{
+	struct capture_settings settings;
+	struct capture_stats stats;
+	struct capture_stats previous;
+	struct capture_monitor_entry* entry;
+	char message[NOTIFY_BUFFER_SIZE];
+	uint64_t lost;
+	uint64_t total;
+	int raise;
+
+	capture_settings_get(probe, &settings);
+	if (settings.stats_interval==0)
+	{
+		return;
+	}
+	pthread_mutex_lock(&capture_monitor_lock);
+	entry = capture_monitor_entry_get(probe, 1);
+	if (entry==NULL || (!final && entry->next_collection>now))
+	{
+		pthread_mutex_unlock(&capture_monitor_lock);
+		return;
+	}
+	entry->next_collection = now + settings.stats_interval;
+	pthread_mutex_unlock(&capture_monitor_lock);
+
+	/* the capture library is queried unlocked: */
+	memset(&stats, 0, sizeof(struct capture_stats));
+	if (capture_get_stats(probe, &stats)==-1)
+	{
+		return;
+	}
+	stats.time = now;
+
+	pthread_mutex_lock(&capture_monitor_lock);
+	if (entry->collected)
+	{
+		memcpy(&previous, &entry->last, sizeof(struct capture_stats));
+	}
+	else
+	{
+		memset(&previous, 0, sizeof(struct capture_stats));
+	}
+	memcpy(&entry->last, &stats, sizeof(struct capture_stats));
+	entry->collected = 1;
+	/* frames dropped by the interface never reach the capture: */
+	lost  = capture_stats_lost(&stats) - capture_stats_lost(&previous);
+	total = (stats.received - previous.received) + (stats.interface_dropped - previous.interface_dropped);
+	raise = capture_monitor_check_loss(entry, &settings, lost, total);
+	pthread_mutex_unlock(&capture_monitor_lock);
+
+	fprintf(stderr, "[capture] stats %s: received=%llu kernel_dropped=%llu interface_dropped=%llu "
+			"queue_dropped=%llu queue_user_dropped=%llu overruns=%llu ring_dropped=%llu "
+			"ring_high_water=%u/%u interval_lost=%llu/%llu\n",
+			probe->name, (unsigned long long)stats.received,
+			(unsigned long long)stats.kernel_dropped, (unsigned long long)stats.interface_dropped,
+			(unsigned long long)stats.queue_dropped, (unsigned long long)stats.queue_user_dropped,
+			(unsigned long long)stats.overruns, (unsigned long long)stats.ring.dropped,
+			stats.ring.high_water, stats.ring.capacity,
+			(unsigned long long)lost, (unsigned long long)total);
+
+	if (raise)
+	{
+		snprintf(message, NOTIFY_BUFFER_SIZE,
+				"capture on %s lost %llu of %llu frames (more than %i%%) in %lld s: "
+				"%llu kernel buffer, %llu interface, %llu queue, %llu queue socket, %llu analysis ring",
+				probe->name, (unsigned long long)lost, (unsigned long long)total, settings.loss_alert,
+				(long long)(previous.time!=0 ? stats.time-previous.time : settings.stats_interval),
+				(unsigned long long)(stats.kernel_dropped - previous.kernel_dropped),
+				(unsigned long long)(stats.interface_dropped - previous.interface_dropped),
+				(unsigned long long)(stats.queue_dropped - previous.queue_dropped),
+				(unsigned long long)(stats.queue_user_dropped - previous.queue_user_dropped),
+				(unsigned long long)(stats.ring.dropped - previous.ring.dropped));
+		alert_raise(ALERT_PRIORITY_LOW, probe, "capture loss", message,
+				&probe->ethernet_address, NULL, NULL, NULL);
+	}
+}
+
+/* Collects the statistics of all local probes. */
+static void capture_monitor_collect_all(int final)
+{
+	struct probe_list** locked_probes;
+	struct probe_list* tmp_probes;
+	time_t now = time(NULL);
+
+	/* critical section: */
+	locked_probes = probe_list_lock();
+	/* copy the probe list (don't bother if it changes later) */
+	tmp_probes = *locked_probes;
+	probe_list_unlock();
+	/* end critical section. */
+
+	while (tmp_probes!=NULL)
+	{
+		if (tmp_probes->entry.type==PROBE_TYPE_INTERFACE)
+		{
+			capture_monitor_collect(&tmp_probes->entry, now, final);
+		}
+		tmp_probes = tmp_probes->next;
+	}
+}
+
+static void* capture_monitor_run(void* unused)
+{
+	struct timespec wakeup;
+
+	pthread_mutex_lock(&capture_monitor_lock);
+	while (capture_monitor_running)
+	{
+		clock_gettime(CLOCK_REALTIME, &wakeup);
+		wakeup.tv_sec++;
+		pthread_cond_timedwait(&capture_monitor_cond, &capture_monitor_lock, &wakeup);
+		if (!capture_monitor_running)
+		{
+			break;
+		}
+		pthread_mutex_unlock(&capture_monitor_lock);
+		capture_monitor_collect_all(0);
+		pthread_mutex_lock(&capture_monitor_lock);
+	}
+	pthread_mutex_unlock(&capture_monitor_lock);
+	return NULL;
+}
+
+int capture_monitor_start()
+{
+	capture_monitor_running = 1;
+	if (pthread_create(&capture_monitor_thread, NULL, capture_monitor_run, NULL)!=0)
+	{
+		perror("[capture] pthread_create failed");
+		capture_monitor_running = 0;
+		return -1;
+	}
+	capture_monitor_started = 1;
+	return 0;
+}
+
+void capture_monitor_stop()
+{
+	if (!capture_monitor_started)
+	{
+		return;
+	}
+	pthread_mutex_lock(&capture_monitor_lock);
+	capture_monitor_running = 0;
+	pthread_cond_signal(&capture_monitor_cond);
+	pthread_mutex_unlock(&capture_monitor_lock);
+	pthread_join(capture_monitor_thread, NULL);
+	capture_monitor_started = 0;
+	/* the probe down events carry the final statistics: */
+	capture_monitor_collect_all(1);
+}
+
+void capture_monitor_free()
+{
+	pthread_mutex_lock(&capture_monitor_lock);
+	while (capture_monitor_entries!=NULL)
+	{
+		struct capture_monitor_entry* entry = capture_monitor_entries;
+		capture_monitor_entries = entry->next;
+		free(entry);
+	}
+	pthread_mutex_unlock(&capture_monitor_lock);
+}
@@ -5,11 +5,75 @@
 
 #include "ndpmon_defs.h"
 #include "../ndpmon_netheaders.h"
+#include "bindings.h"
+#include "evidence.h"
+#include "logging.h"
 #include "parser.h"
 #include "probes.h"
+#include "settings.h"
 #include "watchers.h"
 
 #include "print_packet_info.h"
+#include "packet_ring.h"
+#include "stats.h"
+#include "vlan.h"
+
+/** Maximum number of capture sockets of a probe. */
+#define CAPTURE_FANOUT_MAX 16
+/** Default number of bytes captured of each frame (ND messages on standard links fit). */
+#define CAPTURE_SNAPLEN_DEFAULT 2048
+/** Maximum number of bytes captured of each frame. */
+#define CAPTURE_SNAPLEN_MAX 65535
+
+/** How the kernel spreads the frames over the capture sockets of a probe.
+ *  All Neighbor Discovery messages (and the frames with an extension
+ *  header) go to the first socket in every mode, the watchers compare the
+ *  messages of different hosts and need them in capture order. The other
+ *  ICMPv6 messages are spread over the remaining sockets (classic BPF
+ *  fanout program).
+ */
+enum capture_fanout_mode {
+    /** By source MAC address. */
+    CAPTURE_FANOUT_MAC,
+    /** By the CPU that received the frame. */
+    CAPTURE_FANOUT_CPU,
+    /** By a hash of the source and destination address. */
+    CAPTURE_FANOUT_HASH
+};
+
+/** Per probe capture settings, loaded from the capture element of a probe
+ *  (extinfo type "capture"), for instance
+ *  \verbatim <capture fanout="4" fanout_mode="mac"/> \endverbatim
+ *  or \verbatim <capture buffer_size="67108864" immediate="1" tstamp_precision="nano"/> \endverbatim
+ *  or \verbatim <capture stats_interval="60" loss_alert="1"/> \endverbatim
+ *  or \verbatim <capture trunk="1" vlan_probes_max="256"/> \endverbatim
+ */
+struct capture_settings {
+    /** Number of capture sockets (PACKET_FANOUT group members, 1 for no fanout). */
+    int fanout;
+    /** How the frames are spread over the capture sockets. */
+    enum capture_fanout_mode fanout_mode;
+    /** Bytes captured of each frame. */
+    int snaplen;
+    /** Kernel buffer size in bytes of each capture socket, 0 for the library default. */
+    int buffer_size;
+    /** Milliseconds the kernel may wait to deliver frames in batches. */
+    int timeout;
+    /** Deliver each frame as soon as it arrives (overrides the timeout). */
+    int immediate;
+    /** Request nanosecond timestamps. */
+    int nanoseconds;
+    /** TPACKET version of the capture ring (0 for the library default, 2 or 3). */
+    int tpacket_version;
+    /** Seconds between two collections of the capture statistics, 0 to disable. */
+    int stats_interval;
+    /** Percentage of frames lost in an interval that raises an alert, 0 to disable. */
+    int loss_alert;
+    /** Capture tagged frames and analyze each VLAN on a virtual probe. */
+    int trunk;
+    /** Maximum number of virtual probes of a trunk. */
+    int vlan_probes_max;
+};
 
 /* Forward declaration of library specific structure.*/
 struct capture_descriptor;
@@ -30,16 +94,96 @@ int capture_nd_option_list_add(struct nd_option_list** option_list,
 
 int capture_process_packet(struct probe* probe, const struct timeval* timestamp, uint8_t* packet_data, int packet_length);
 
+/** Gets the capture settings of a probe, the defaults if the probe has no
+ *  capture element.
+ *  @param probe    The probe.
+ *  @param settings Will hold the settings.
+ */
+void capture_settings_get(const struct probe* probe, struct capture_settings* settings);
+
+/** Loads the capture settings of a probe from a XML element.
+ *  @param element The capture element.
+ *  @param data    Will hold the settings (call by reference).
+ *  @return        0 on success, -1 on error.
+ */
+int capture_settings_load(xmlNodePtr element, void** data);
+
+/** Prints the capture settings of a probe.
+ *  @param data The settings.
+ */
+void capture_settings_print(void* data);
+
+/** Saves the capture settings of a probe to a XML element.
+ *  @param element The element to add the attributes to.
+ *  @param data    The settings.
+ *  @return        Always 0.
+ */
+int capture_settings_save(xmlNodePtr element, void* data);
+
+/** Sums up the frames lost by the kernel, the interface, the netfilter
+ *  queue and the analysis rings.
+ *  @param stats The capture statistics.
+ *  @return      The number of lost frames.
+ */
+uint64_t capture_stats_lost(const struct capture_stats* stats);
+
+/** Gets the capture statistics of a probe as of the last collection.
+ *  @param probe The probe.
+ *  @param stats Will hold the statistics.
+ *  @return      0 on success, -1 if no statistics were collected for the probe.
+ */
+int capture_stats_last(const struct probe* probe, struct capture_stats* stats);
+
+/** Saves capture statistics to a XML element.
+ *  @param element The element to add the attributes to.
+ *  @param stats   The capture statistics.
+ *  @return        Always 0.
+ */
+int capture_stats_save(xmlNodePtr element, const struct capture_stats* stats);
+
+/** Starts the thread collecting the capture statistics of the probes in
+ *  their stats_interval. Each collection is printed, and an alert is
+ *  raised if the share of frames lost since the previous one exceeds the
+ *  loss_alert percentage of the probe.
+ *  @return 0 on success, -1 otherwise.
+ */
+int capture_monitor_start();
+
+/** Stops the statistics thread after a last collection. Must be called
+ *  before capture_down_all() releases the capture handles.
+ */
+void capture_monitor_stop();
+
+/** Releases the statistics collected by the monitor thread. */
+void capture_monitor_free();
+
 /* Interface to library specific funtions. */
 
 /** Stops packet capturing on all interfaces of PROBE_TYPE_INTERFACE.
- *
+ *  Releases the capture handles, the capture threads must have been
+ *  stopped by capture_stop_all() and joined by capture_up_all().
  */
 extern void capture_down_all();
 
 /** Initializes packet capturing on all interfaces of PROBE_TYPE_INTERFACE
- *
+ *  and waits for the capture threads until capture_stop_all() is called.
+ *  This is the only place the capture threads are joined.
  */
 extern void capture_up_all();
 
+/** Makes the capture threads finish so that capture_up_all() returns.
+ *  Does not wait for them, may be called before they are started (they
+ *  are then stopped once started) and more than once. Not to be called
+ *  from a signal handler.
+ */
+extern void capture_stop_all();
+
+/** Reads the current capture statistics of a probe from the capture
+ *  library and the kernel.
+ *  @param probe The probe.
+ *  @param stats Will hold the statistics (time is not set).
+ *  @return      0 on success, -1 if the probe is not captured.
+ */
+extern int capture_get_stats(struct probe* probe, struct capture_stats* stats);
+
 #endif
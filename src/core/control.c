@@ -0,0 +1,462 @@
+#include "control.h"
+
+static int control_fd = -1;
+/* written to by control_stop() to wake up the thread: */
+static int control_wakeup[2] = { -1, -1 };
+static char control_path[PATH_SIZE];
+static pthread_t control_thread;
+static int control_started = 0;
+
+static void control_mac_ntoa(const struct ether_addr* mac, char* buffer) {
+    const uint8_t* octets = (const uint8_t*) mac;
+
+    snprintf(buffer, ETH_ADDRSTRLEN, "%x:%x:%x:%x:%x:%x",
+            octets[0], octets[1], octets[2], octets[3], octets[4], octets[5]);
+}
+
+static const char* control_probe_type(enum probe_type type) {
+    switch (type) {
+        case PROBE_TYPE_INTERFACE:
+            return "interface";
+        case PROBE_TYPE_VLAN:
+            return "vlan";
+        default:
+            return "remote";
+    }
+}
+
+/* Prints a comma separated address list as key=value (- if empty). */
+static void control_print_addresses(struct text_buffer* buffer, const char* key, const address_t* addresses) {
+    char address[INET6_ADDRSTRLEN];
+    const char* separator = "";
+
+    text_buffer_printf(buffer, " %s=", key);
+    if (addresses==NULL) {
+        text_buffer_printf(buffer, "-");
+    }
+    while (addresses!=NULL) {
+        inet_ntop(AF_INET6, &addresses->address, address, INET6_ADDRSTRLEN);
+        text_buffer_printf(buffer, "%s%s", separator, address);
+        separator = ",";
+        addresses = addresses->next;
+    }
+}
+
+static void control_stats_probe(struct text_buffer* buffer, const struct probe* probe) {
+    struct probe_stats stats;
+    struct capture_stats capture;
+    uint64_t packets = 0;
+    int reasons = stats_reason_count();
+    int i;
+
+    stats_probe_get(probe, &stats);
+    for (i=0; i<256; i++) {
+        packets += stats.packets[i];
+    }
+    text_buffer_printf(buffer, "probe name=%s type=%s packets=%llu bytes=%llu neighbors=%llu addresses=%llu routers=%llu refreshed=%lld\n",
+            probe->name, control_probe_type(probe->type), (unsigned long long)packets,
+            (unsigned long long)stats.bytes, (unsigned long long)stats.neighbors,
+            (unsigned long long)stats.addresses, (unsigned long long)stats.routers,
+            (long long)stats.refreshed);
+    for (i=0; i<256; i++) {
+        if (stats.packets[i]!=0) {
+            text_buffer_printf(buffer, "icmp6 probe=%s type=%i packets=%llu\n",
+                    probe->name, i, (unsigned long long)stats.packets[i]);
+        }
+    }
+    for (i=0; i<reasons; i++) {
+        if (stats.alerts[i]!=0) {
+            text_buffer_printf(buffer, "alerts probe=%s reason=\"%s\" count=%llu\n",
+                    probe->name, stats_reason_name(i), (unsigned long long)stats.alerts[i]);
+        }
+    }
+    if (capture_stats_last(probe, &capture)==0) {
+        text_buffer_printf(buffer, "capture probe=%s time=%lld received=%llu lost=%llu kernel_dropped=%llu "
+                "interface_dropped=%llu queue_dropped=%llu queue_user_dropped=%llu overruns=%llu ring_dropped=%llu\n",
+                probe->name, (long long)capture.time, (unsigned long long)capture.received,
+                (unsigned long long)capture_stats_lost(&capture), (unsigned long long)capture.kernel_dropped,
+                (unsigned long long)capture.interface_dropped, (unsigned long long)capture.queue_dropped,
+                (unsigned long long)capture.queue_user_dropped, (unsigned long long)capture.overruns,
+                (unsigned long long)capture.ring.dropped);
+    }
+}
+
+static void control_neighbors(struct text_buffer* buffer, const struct probe* probe) {
+    const neighbor_list_t* neighbor = probe->neighbors;
+
+    while (neighbor!=NULL) {
+        char mac[ETH_ADDRSTRLEN], first_mac[ETH_ADDRSTRLEN], lla[INET6_ADDRSTRLEN];
+        const ethernet_t* old_mac = neighbor->old_mac;
+        const char* separator = "";
+
+        control_mac_ntoa(&neighbor->mac, mac);
+        control_mac_ntoa(&neighbor->first_mac_seen, first_mac);
+        inet_ntop(AF_INET6, &neighbor->lla, lla, INET6_ADDRSTRLEN);
+        text_buffer_printf(buffer, "neighbor probe=%s mac=%s first_mac=%s lla=%s timer=%lld trouble=%i",
+                probe->name, mac, first_mac, lla, (long long)neighbor->timer, neighbor->trouble);
+        control_print_addresses(buffer, "addresses", neighbor->addresses);
+        text_buffer_printf(buffer, " old_macs=");
+        if (old_mac==NULL) {
+            text_buffer_printf(buffer, "-");
+        }
+        while (old_mac!=NULL) {
+            control_mac_ntoa(&old_mac->mac, mac);
+            text_buffer_printf(buffer, "%s%s", separator, mac);
+            separator = ",";
+            old_mac = old_mac->next;
+        }
+        text_buffer_printf(buffer, "\n");
+        neighbor = neighbor->next;
+    }
+}
+
+static void control_routers(struct text_buffer* buffer, const struct probe* probe) {
+    const router_list_t* router = probe->routers;
+
+    while (router!=NULL) {
+        char mac[ETH_ADDRSTRLEN], address[INET6_ADDRSTRLEN];
+        const prefix_t* prefix = router->prefixes;
+        const route_info_t* route = router->routes;
+        const rdnss_t* nameserver = router->nameservers;
+        const dnssl_t* domain = router->domains;
+        const char* separator;
+
+        control_mac_ntoa(&router->mac, mac);
+        inet_ntop(AF_INET6, &router->lla, address, INET6_ADDRSTRLEN);
+        text_buffer_printf(buffer, "router probe=%s mac=%s lla=%s hop_limit=%u flags=0x%02x lifetime=%u "
+                "reachable=%u retrans=%u mtu=%u volatile=%i",
+                probe->name, mac, address, router->param_curhoplimit, router->param_flags_reserved,
+                router->param_router_lifetime, router->param_reachable_timer,
+                router->param_retrans_timer, router->param_mtu, router->params_volatile);
+        control_print_addresses(buffer, "addresses", router->addresses);
+        text_buffer_printf(buffer, " prefixes=%s", (prefix==NULL) ? "-" : "");
+        for (separator=""; prefix!=NULL; prefix=prefix->next, separator=",") {
+            inet_ntop(AF_INET6, &prefix->prefix, address, INET6_ADDRSTRLEN);
+            text_buffer_printf(buffer, "%s%s/%u", separator, address, prefix->mask);
+        }
+        text_buffer_printf(buffer, " routes=%s", (route==NULL) ? "-" : "");
+        for (separator=""; route!=NULL; route=route->next, separator=",") {
+            inet_ntop(AF_INET6, &route->prefix, address, INET6_ADDRSTRLEN);
+            text_buffer_printf(buffer, "%s%s/%u", separator, address, route->mask);
+        }
+        text_buffer_printf(buffer, " nameservers=%s", (nameserver==NULL) ? "-" : "");
+        for (separator=""; nameserver!=NULL; nameserver=nameserver->next, separator=",") {
+            inet_ntop(AF_INET6, &nameserver->address, address, INET6_ADDRSTRLEN);
+            text_buffer_printf(buffer, "%s%s", separator, address);
+        }
+        text_buffer_printf(buffer, " domains=%s", (domain==NULL) ? "-" : "");
+        for (separator=""; domain!=NULL; domain=domain->next, separator=",") {
+            text_buffer_printf(buffer, "%s%s", separator, domain->domain);
+        }
+        text_buffer_printf(buffer, "\n");
+        router = router->next;
+    }
+}
+
+/* Returns the list of probes (entries are never removed while running). */
+static struct probe_list* control_probes() {
+    struct probe_list** locked_probes;
+    struct probe_list* tmp_probes;
+
+    /* critical section: */
+    locked_probes = probe_list_lock();
+    tmp_probes = *locked_probes;
+    probe_list_unlock();
+    /* end critical section. */
+    return tmp_probes;
+}
+
+/* Builds the response to a request, returns -1 with the error in the buffer. */
+static int control_handle(struct text_buffer* buffer, const char* command, const char* probe_name) {
+    struct probe_list* tmp_probes = control_probes();
+    const struct probe* probe;
+    int found = 0;
+
+    if (strcmp(command, "probes")==0) {
+        while (tmp_probes!=NULL) {
+            text_buffer_printf(buffer, "probe name=%s type=%s\n", tmp_probes->entry.name,
+                    control_probe_type(tmp_probes->entry.type));
+            tmp_probes = tmp_probes->next;
+        }
+        return 0;
+    }
+    if (strcmp(command, "stats")==0) {
+        uint64_t queued;
+        unsigned int depth = event_queue_depth(&queued);
+
+        while (tmp_probes!=NULL) {
+            if (probe_name[0]=='\0' || strncmp(probe_name, tmp_probes->entry.name, PROBE_NAME_SIZE)==0) {
+                control_stats_probe(buffer, &tmp_probes->entry);
+                found = 1;
+            }
+            tmp_probes = tmp_probes->next;
+        }
+        if (!found && probe_name[0]!='\0') {
+            text_buffer_printf(buffer, "unknown probe %s", probe_name);
+            return -1;
+        }
+        text_buffer_printf(buffer, "events depth=%u queued=%llu\n", depth, (unsigned long long)queued);
+        return 0;
+    }
+    if (strcmp(command, "neighbors")!=0 && strcmp(command, "routers")!=0) {
+        text_buffer_printf(buffer, "unknown command %s", command);
+        return -1;
+    }
+    if (probe_name[0]=='\0') {
+        text_buffer_printf(buffer, "%s needs a probe", command);
+        return -1;
+    }
+    if (command[0]=='n') {
+        /* the timers of the neighbors seen since the last merge: */
+        lastseen_merge();
+    }
+    while (tmp_probes!=NULL && strncmp(probe_name, tmp_probes->entry.name, PROBE_NAME_SIZE)!=0) {
+        tmp_probes = tmp_probes->next;
+    }
+    if (tmp_probes==NULL) {
+        text_buffer_printf(buffer, "unknown probe %s", probe_name);
+        return -1;
+    }
+    probe = probe_handle_rdlock(&tmp_probes->entry);
+    if (command[0]=='n') {
+        control_neighbors(buffer, probe);
+    } else {
+        control_routers(buffer, probe);
+    }
+    probe_handle_unlock(&tmp_probes->entry);
+    return 0;
+}
+
+/* Reads the request line, returns -1 if the client did not send one in time. */
+static int control_read_request(int client, char* request) {
+    size_t length = 0;
+    ssize_t received;
+
+    while (length<CONTROL_REQUEST_SIZE-1) {
+        if ((received=recv(client, request+length, CONTROL_REQUEST_SIZE-1-length, 0))<=0) {
+            break;
+        }
+        length += received;
+        if (memchr(request, '\n', length)!=NULL) {
+            break;
+        }
+    }
+    request[length] = '\0';
+    request[strcspn(request, "\r\n")] = '\0';
+    return (length>0) ? 0 : -1;
+}
+
+static void control_write(int client, const char* data, size_t length) {
+    ssize_t sent;
+
+    while (length>0) {
+        if ((sent=send(client, data, length, MSG_NOSIGNAL))<=0) {
+            if (DEBUG) {
+                perror("[control] send failed");
+            }
+            return;
+        }
+        data += sent;
+        length -= sent;
+    }
+}
+
+static void control_serve(int client) {
+    struct timeval timeout;
+    struct text_buffer buffer;
+    char request[CONTROL_REQUEST_SIZE];
+    char command[32];
+    char probe_name[PROBE_NAME_SIZE];
+    const char* status;
+    int result;
+
+    timeout.tv_sec  = CONTROL_CLIENT_TIMEOUT;
+    timeout.tv_usec = 0;
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+    result = 1;
+    setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &result, sizeof(result));
+#endif
+    if (control_read_request(client, request)==-1) {
+        return;
+    }
+    command[0] = '\0';
+    probe_name[0] = '\0';
+    sscanf(request, "%31s %99s", command, probe_name);
+
+    if (text_buffer_init(&buffer, 4096)==-1) {
+        return;
+    }
+    result = control_handle(&buffer, command, probe_name);
+    if (buffer.failed) {
+        status = CONTROL_RESPONSE_ERROR " out of memory\n";
+        buffer.length = 0;
+    } else if (result==-1) {
+        status = CONTROL_RESPONSE_ERROR " ";
+        text_buffer_printf(&buffer, "\n");
+    } else {
+        status = CONTROL_RESPONSE_OK "\n";
+    }
+    control_write(client, status, strlen(status));
+    control_write(client, buffer.data, buffer.length);
+    text_buffer_free(&buffer);
+}
+
+static void* control_run(void* unused) {
+    struct pollfd fds[2];
+    sigset_t signals;
+    int client;
+
+    /* signals are handled by the main thread: */
+    sigfillset(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    fds[0].fd     = control_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd     = control_wakeup[0];
+    fds[1].events = POLLIN;
+    while (1) {
+        if (poll(fds, 2, -1)==-1) {
+            if (errno==EINTR) {
+                continue;
+            }
+            perror("[control] poll failed");
+            break;
+        }
+        if (fds[1].revents!=0) {
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            if ((client=accept(control_fd, NULL, NULL))==-1) {
+                if (DEBUG) {
+                    perror("[control] accept failed");
+                }
+                continue;
+            }
+            control_serve(client);
+            close(client);
+        }
+    }
+    return NULL;
+}
+
+int control_start() {
+    struct extinfo_list** extinfo;
+    struct control_settings* configured;
+    struct control_settings settings;
+    struct sockaddr_un address;
+    mode_t old_mask;
+    int result;
+
+    extinfo = settings_extinfo_lock();
+    configured = extinfo_list_get_data(*extinfo, "control");
+    if (configured!=NULL) {
+        memcpy(&settings, configured, sizeof(struct control_settings));
+    }
+    settings_extinfo_unlock();
+    if (configured==NULL) {
+        return 0;
+    }
+    memset(&address, 0, sizeof(struct sockaddr_un));
+    address.sun_family = AF_UNIX;
+    if (strlcpy(address.sun_path, settings.path, sizeof(address.sun_path))>=sizeof(address.sun_path)) {
+        fprintf(stderr, "[control] ERROR: socket path %s is too long.\n", settings.path);
+        return -1;
+    }
+    if ((control_fd=socket(AF_UNIX, SOCK_STREAM, 0))==-1) {
+        perror("[control] socket failed");
+        return -1;
+    }
+    /* a socket left by a previous run: */
+    unlink(settings.path);
+    /* create the socket with its final mode, a chmod() after bind() would
+     * leave it open to anyone in between: */
+    old_mask = umask(0777 & ~settings.mode);
+    result = bind(control_fd, (struct sockaddr*)&address, sizeof(struct sockaddr_un));
+    umask(old_mask);
+    if (result==-1 || listen(control_fd, 8)==-1) {
+        perror("[control] opening the socket failed");
+        close(control_fd);
+        control_fd = -1;
+        return -1;
+    }
+    if (pipe(control_wakeup)==-1) {
+        perror("[control] pipe failed");
+        close(control_fd);
+        control_fd = -1;
+        return -1;
+    }
+    strlcpy(control_path, settings.path, PATH_SIZE);
+    if (pthread_create(&control_thread, NULL, control_run, NULL)!=0) {
+        perror("[control] pthread_create failed");
+        control_stop();
+        return -1;
+    }
+    control_started = 1;
+    fprintf(stderr, "[control] listening on %s.\n", control_path);
+    return 0;
+}
+
+void control_stop() {
+    if (control_fd==-1) {
+        return;
+    }
+    if (control_started) {
+        if (write(control_wakeup[1], "x", 1)!=1) {
+            perror("[control] waking the thread failed");
+        }
+        pthread_join(control_thread, NULL);
+        control_started = 0;
+    }
+    close(control_wakeup[0]);
+    close(control_wakeup[1]);
+    close(control_fd);
+    control_fd = -1;
+    unlink(control_path);
+}
+
+int control_settings_load(xmlNodePtr element, void** data) {
+    struct control_settings* settings;
+    xmlChar* path = xmlGetProp(element, BAD_CAST "path");
+    xmlChar* mode = xmlGetProp(element, BAD_CAST "mode");
+
+    if ((settings=malloc(sizeof(struct control_settings)))==NULL) {
+        perror("[control] malloc failed.\n");
+        exit(1);
+    }
+    memset(settings, 0, sizeof(struct control_settings));
+    strlcpy(settings->path, (path!=NULL) ? (char*)path : CONTROL_PATH, PATH_SIZE);
+    settings->mode = 0600;
+    if (mode!=NULL) {
+        char* end;
+
+        settings->mode = (int)strtol((char*)mode, &end, 8);
+        if (*end!='\0' || settings->mode<0 || settings->mode>0777) {
+            fprintf(stderr, "[control] ERROR: settings: mode must be an octal permission like 0660.\n");
+            xmlFree(path);
+            xmlFree(mode);
+            free(settings);
+            return -1;
+        }
+    }
+    xmlFree(path);
+    xmlFree(mode);
+    *data = settings;
+    return 0;
+}
+
+void control_settings_print(void* data) {
+    struct control_settings* settings = (struct control_settings*) data;
+
+    fprintf(stderr, "[control] socket %s (mode %04o)\n", settings->path, settings->mode);
+}
+
+int control_settings_save(xmlNodePtr element, void* data) {
+    struct control_settings* settings = (struct control_settings*) data;
+    char mode[8];
+
+    xmlNewProp(element, BAD_CAST "path", BAD_CAST settings->path);
+    snprintf(mode, sizeof(mode), "%04o", settings->mode);
+    xmlNewProp(element, BAD_CAST "mode", BAD_CAST mode);
+    return 0;
+}
@@ -0,0 +1,93 @@
+#ifndef _CONTROL_H_
+#define _CONTROL_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/time.h>
+
+#include <libxml/tree.h>
+
+#include "../membounds.h"
+#include "ndpmon_defs.h"
+#include "../ndpmon_netheaders.h"
+
+#include "cache_types.h"
+#include "capture.h"
+#include "events.h"
+#include "extinfo.h"
+#include "lastseen.h"
+#include "probes.h"
+#include "settings.h"
+#include "stats.h"
+#include "text_buffer.h"
+#include "control_protocol.h"
+
+/** @file
+ *  Control socket: serves the runtime counters of the probes and dumps of
+ *  their neighbor caches and router lists over a unix stream socket, see
+ *  control_protocol.h for the protocol and ndpmon-ctl for the client.
+ *
+ *  Requests are served one at a time by a thread of their own. The
+ *  counters are read without locks, a dump holds the lock of its probe
+ *  only while it is formatted, the response is written afterwards.
+ *
+ *  Enabled by the control element of the settings, for instance
+ *  \verbatim <control path="/var/lib/ndpmon/ndpmon.ctl" mode="0660"/> \endverbatim
+ */
+
+/** Seconds a client may take to send its request or to read the response. */
+#define CONTROL_CLIENT_TIMEOUT 2
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/** Settings of the control socket (extinfo type "control"). */
+struct control_settings {
+    /** Path of the socket. */
+    char path[PATH_SIZE];
+    /** Permissions of the socket. */
+    int mode;
+};
+
+/** Opens the control socket and starts its thread, if the settings have a
+ *  control element.
+ *  @return 0 on success or if the socket is not configured, -1 otherwise.
+ */
+int control_start();
+
+/** Stops the thread and removes the socket. */
+void control_stop();
+
+/** Loads the control socket settings from a XML element.
+ *  @param element The control element.
+ *  @param data    Will hold the settings (call by reference).
+ *  @return        0 on success, -1 on error.
+ */
+int control_settings_load(xmlNodePtr element, void** data);
+
+/** Prints the control socket settings.
+ *  @param data The settings.
+ */
+void control_settings_print(void* data);
+
+/** Saves the control socket settings to a XML element.
+ *  @param element The element to add the attributes to.
+ *  @param data    The settings.
+ *  @return        Always 0.
+ */
+int control_settings_save(xmlNodePtr element, void* data);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef _CONTROL_PROTOCOL_H_
+#define _CONTROL_PROTOCOL_H_
+
+#include "ndpmon_defs.h"
+
+/** @file
+ *  Protocol of the control socket, shared by NDPMon and ndpmon-ctl.
+ *
+ *  A client connects to the unix stream socket and sends one request line:
+ *  \verbatim
+    probes                 list the probes
+    stats [probe]          counters of all probes or of one probe
+    neighbors <probe>      neighbor cache of a probe
+    routers <probe>        router list of a probe
+    \endverbatim
+ *  The first line of the response is "ok" or "error <text>", followed by
+ *  one record per line of the form "<record> key=value ...", values with
+ *  spaces are quoted. NDPMon closes the connection after the response.
+ */
+
+/** Default path of the control socket. */
+#define CONTROL_PATH _CONTROL_PATH_
+/** Maximum length of a request line, the newline included. */
+#define CONTROL_REQUEST_SIZE 256
+/** First line of a successful response. */
+#define CONTROL_RESPONSE_OK "ok"
+/** Start of the first line of a failed response. */
+#define CONTROL_RESPONSE_ERROR "error"
+
+#endif
@@ -0,0 +1,148 @@
+#include "dad.h"
+
+/* Gets the DAD table of a probe, creates it on first use. */
+static struct dad_table* dad_get(struct probe* probe) {
+    struct dad_table* table = __atomic_load_n(&probe->dad, __ATOMIC_ACQUIRE);
+    struct dad_table* expected = NULL;
+
+    if (table!=NULL) {
+        return table;
+    }
+    if ((table=calloc(1, sizeof(struct dad_table)))==NULL) {
+        perror("[dad] calloc failed");
+        return NULL;
+    }
+    pthread_mutex_init(&table->lock, NULL);
+    table->retrans_timer = DAD_RETRANS_TIMER;
+    /* another analysis thread of the probe may have been faster: */
+    if (!__atomic_compare_exchange_n(&probe->dad, &expected, table, 0,
+            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_destroy(&table->lock);
+        free(table);
+        table = expected;
+    }
+    return table;
+}
+
+/* FNV-1a of the target, only used to pick the first slot of its window. */
+static unsigned int dad_slot(const struct in6_addr* target) {
+    const uint8_t* bytes = (const uint8_t*)target;
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i;
+
+    for (i=0; i<sizeof(struct in6_addr); i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return (unsigned int)(hash ^ (hash>>32)) & (DAD_SLOTS-1);
+}
+
+/* Milliseconds from a DAD's first solicitation to a frame. */
+static int64_t dad_elapsed(const struct dad_entry* entry, const struct timeval* timestamp) {
+    return ((int64_t)timestamp->tv_sec - entry->started.tv_sec)*1000
+            + ((int64_t)timestamp->tv_usec - entry->started.tv_usec)/1000;
+}
+
+/* Tells if a slot holds a DAD in progress at the time of a frame. */
+static int dad_live(const struct dad_entry* entry, const struct timeval* timestamp) {
+    return (entry->started.tv_sec!=0 || entry->started.tv_usec!=0)
+            && dad_elapsed(entry, timestamp) <= (int64_t)entry->retrans_timer*DAD_TRANSMITS;
+}
+
+int dad_started(struct probe* probe, const struct in6_addr* target, const struct timeval* timestamp) {
+    struct dad_table* table = dad_get(probe);
+    struct dad_entry* free_slot = NULL;
+    struct dad_entry* oldest = NULL;
+    struct dad_entry* entry;
+    unsigned int first, i;
+
+    if (table==NULL) {
+        return -1;
+    }
+    first = dad_slot(target);
+    /* critical section: */
+    pthread_mutex_lock(&table->lock);
+    for (i=0; i<DAD_WINDOW; i++) {
+        entry = &table->slots[(first+i) & (DAD_SLOTS-1)];
+        if (!dad_live(entry, timestamp)) {
+            if (free_slot==NULL) {
+                free_slot = entry;
+            }
+            continue;
+        }
+        if (IN6_ARE_ADDR_EQUAL(&entry->target, target)) {
+            /* a further solicitation of the same DAD: */
+            pthread_mutex_unlock(&table->lock);
+            return 0;
+        }
+        if (oldest==NULL || dad_elapsed(entry, timestamp) > dad_elapsed(oldest, timestamp)) {
+            oldest = entry;
+        }
+    }
+    entry = (free_slot!=NULL) ? free_slot : oldest;
+    memcpy(&entry->target, target, sizeof(struct in6_addr));
+    entry->started = *timestamp;
+    entry->retrans_timer = table->retrans_timer;
+    pthread_mutex_unlock(&table->lock);
+    /* end critical section. */
+    return 0;
+}
+
+int dad_in_progress(struct probe* probe, const struct in6_addr* target, const struct timeval* timestamp) {
+    struct dad_table* table = __atomic_load_n(&probe->dad, __ATOMIC_ACQUIRE);
+    const struct dad_entry* entry;
+    unsigned int first, i;
+    int found = 0;
+
+    if (table==NULL) {
+        return 0;
+    }
+    first = dad_slot(target);
+    /* critical section: */
+    pthread_mutex_lock(&table->lock);
+    for (i=0; i<DAD_WINDOW && !found; i++) {
+        entry = &table->slots[(first+i) & (DAD_SLOTS-1)];
+        found = dad_live(entry, timestamp) && IN6_ARE_ADDR_EQUAL(&entry->target, target);
+    }
+    pthread_mutex_unlock(&table->lock);
+    /* end critical section. */
+    return found;
+}
+
+void dad_retrans_timer_set(struct probe* probe, uint32_t retrans_timer) {
+    struct dad_table* table;
+
+    if (retrans_timer==0) {
+        return;
+    }
+    if ((table=dad_get(probe))==NULL) {
+        return;
+    }
+    if (retrans_timer<DAD_RETRANS_TIMER) {
+        retrans_timer = DAD_RETRANS_TIMER;
+    } else if (retrans_timer>DAD_RETRANS_TIMER_MAX) {
+        retrans_timer = DAD_RETRANS_TIMER_MAX;
+    }
+    /* critical section: */
+    pthread_mutex_lock(&table->lock);
+    table->retrans_timer = retrans_timer;
+    pthread_mutex_unlock(&table->lock);
+    /* end critical section. */
+}
+
+void dad_free() {
+    struct probe_list** locked_probes;
+    struct probe_list* tmp_probes;
+
+    /* critical section: */
+    locked_probes = probe_list_lock();
+    for (tmp_probes=*locked_probes; tmp_probes!=NULL; tmp_probes=tmp_probes->next) {
+        if (tmp_probes->entry.dad!=NULL) {
+            pthread_mutex_destroy(&tmp_probes->entry.dad->lock);
+            free(tmp_probes->entry.dad);
+            tmp_probes->entry.dad = NULL;
+        }
+    }
+    probe_list_unlock();
+    /* end critical section. */
+}
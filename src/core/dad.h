@@ -0,0 +1,93 @@
+#ifndef _DAD_H_
+#define _DAD_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "ndpmon_defs.h"
+#include "../ndpmon_netheaders.h"
+
+#include "cache_types.h"
+#include "probes.h"
+
+/** @file
+ *  Duplicate Address Detection in progress on each probe.
+ *
+ *  watch_dad() records the target of every DAD Neighbor Solicitation (one
+ *  with the unspecified source address) with dad_started(), and
+ *  watch_dad_dos() asks with dad_in_progress() whether the target of a
+ *  Neighbor Advertisement is being detected, so that concurrent DADs of
+ *  many hosts are all followed.
+ *
+ *  A DAD ends RetransTimer x DupAddrDetectTransmits (RFC 4861, RFC 4862)
+ *  after its first solicitation, measured with the capture timestamps of
+ *  the frames. RetransTimer is the one last advertised by a router of the
+ *  probe in a RA that passed the checks when the DAD started, see
+ *  dad_retrans_timer_set(), held between DAD_RETRANS_TIMER and
+ *  DAD_RETRANS_TIMER_MAX. The targets are kept in an open addressing table per probe,
+ *  looked up in a window of DAD_WINDOW slots after their hash. When all
+ *  slots of the window are taken by DADs in progress, the oldest one is
+ *  forgotten.
+ */
+
+/** Number of DAD targets tracked per probe (a power of two). */
+#define DAD_SLOTS 1024
+/** Slots after the hash of a target it may be stored in. */
+#define DAD_WINDOW 16
+/** RetransTimer of the hosts in milliseconds (RFC 4861 RETRANS_TIMER),
+ *  used until a router advertises one and as the least one. */
+#define DAD_RETRANS_TIMER 1000
+/** Greatest advertised RetransTimer taken in milliseconds. */
+#define DAD_RETRANS_TIMER_MAX 60000
+/** DupAddrDetectTransmits of the hosts (RFC 4862 default). */
+#define DAD_TRANSMITS 1
+
+/** A DAD in progress. */
+struct dad_entry {
+    struct in6_addr target;
+    /** Capture time of its first solicitation, 0 for a free slot. */
+    struct timeval started;
+    /** RetransTimer in milliseconds when it started. */
+    unsigned int retrans_timer;
+};
+
+/** The DADs in progress on a probe. */
+struct dad_table {
+    pthread_mutex_t lock;
+    /** RetransTimer of the hosts in milliseconds. */
+    unsigned int retrans_timer;
+    struct dad_entry slots[DAD_SLOTS];
+};
+
+/** Records a DAD solicitation.
+ *  @param probe     The probe the solicitation was captured on.
+ *  @param target    The tentative address.
+ *  @param timestamp Capture time of the solicitation.
+ *  @return          0 on success, -1 if the table could not be allocated.
+ */
+int dad_started(struct probe* probe, const struct in6_addr* target, const struct timeval* timestamp);
+
+/** Tells if the DAD of an address is in progress.
+ *  @param probe     The probe.
+ *  @param target    The address.
+ *  @param timestamp Capture time of the frame asking.
+ *  @return          1 if it is, 0 otherwise.
+ */
+int dad_in_progress(struct probe* probe, const struct in6_addr* target, const struct timeval* timestamp);
+
+/** Takes the RetransTimer advertised by a router of a probe for the DADs
+ *  started from now on. Only called for a RA that passed the checks.
+ *  @param probe         The probe the advertisement was captured on.
+ *  @param retrans_timer The advertised RetransTimer in milliseconds, 0 if
+ *                       the router does not specify one.
+ */
+void dad_retrans_timer_set(struct probe* probe, uint32_t retrans_timer);
+
+/** Releases the DAD tables of all probes. The capture must be stopped. */
+void dad_free();
+
+#endif
@@ -0,0 +1,231 @@
+#include "event_loop.h"
+
+#ifdef _LINUX_
+
+static void* event_loop_run(void* args) {
+    struct event_loop* loop = (struct event_loop*) args;
+    struct epoll_event events[EVENT_LOOP_EVENTS_MAX];
+    sigset_t signals;
+    int count;
+    int i;
+
+    /* signals are handled by the signal thread, which stops the loop: */
+    sigfillset(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    while (1) {
+        count = epoll_wait(loop->epoll_fd, events, EVENT_LOOP_EVENTS_MAX, -1);
+        if (count<0) {
+            if (errno==EINTR) {
+                continue;
+            }
+            perror("[event_loop] epoll_wait failed");
+            return NULL;
+        }
+        for (i=0; i<count; i++) {
+            struct event_loop_source* source = (struct event_loop_source*) events[i].data.ptr;
+            struct epoll_event event;
+
+            if (source==NULL) {
+                /* the stop descriptor stays readable and wakes every thread: */
+                return NULL;
+            }
+            memset(&event, 0, sizeof(struct epoll_event));
+            if (source->handler(source->arg)==0) {
+                /* re-arm, reported again at once if there is more to read: */
+                event.events   = EPOLLIN | EPOLLONESHOT;
+                event.data.ptr = source;
+                if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, source->fd, &event)==-1) {
+                    perror("[event_loop] re-arming a descriptor failed");
+                }
+            } else {
+                epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, source->fd, &event);
+            }
+        }
+    }
+    return NULL;
+}
+
+struct event_loop* event_loop_create() {
+    struct event_loop* loop;
+    struct epoll_event event;
+
+    if ((loop=malloc(sizeof(struct event_loop)))==NULL) {
+        perror("[event_loop] malloc failed");
+        return NULL;
+    }
+    memset(loop, 0, sizeof(struct event_loop));
+    if ((loop->epoll_fd=epoll_create1(EPOLL_CLOEXEC))==-1) {
+        perror("[event_loop] epoll_create1 failed");
+        free(loop);
+        return NULL;
+    }
+    if ((loop->stop_fd=eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))==-1) {
+        perror("[event_loop] eventfd failed");
+        close(loop->epoll_fd);
+        free(loop);
+        return NULL;
+    }
+    memset(&event, 0, sizeof(struct epoll_event));
+    event.events   = EPOLLIN;
+    event.data.ptr = NULL;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->stop_fd, &event)==-1) {
+        perror("[event_loop] adding the stop descriptor failed");
+        close(loop->stop_fd);
+        close(loop->epoll_fd);
+        free(loop);
+        return NULL;
+    }
+    return loop;
+}
+
+int event_loop_add(struct event_loop* loop, int fd, event_loop_handler_t handler, void* arg) {
+    struct event_loop_source* source;
+    struct epoll_event event;
+
+    if ((source=malloc(sizeof(struct event_loop_source)))==NULL) {
+        perror("[event_loop] malloc failed");
+        return -1;
+    }
+    source->fd      = fd;
+    source->handler = handler;
+    source->arg     = arg;
+    memset(&event, 0, sizeof(struct epoll_event));
+    event.events   = EPOLLIN | EPOLLONESHOT;
+    event.data.ptr = source;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &event)==-1) {
+        perror("[event_loop] adding a descriptor failed");
+        free(source);
+        return -1;
+    }
+    source->next  = loop->sources;
+    loop->sources = source;
+    return 0;
+}
+
+int event_loop_start(struct event_loop* loop, int threads) {
+    if (threads<1) {
+        threads = 1;
+    } else if (threads>EVENT_LOOP_THREADS_MAX) {
+        threads = EVENT_LOOP_THREADS_MAX;
+    }
+    for (loop->thread_count=0; loop->thread_count<threads; loop->thread_count++) {
+        if (pthread_create(&loop->threads[loop->thread_count], NULL, event_loop_run, loop)!=0) {
+            perror("[event_loop] pthread_create failed");
+            event_loop_stop(loop);
+            event_loop_wait(loop);
+            return -1;
+        }
+    }
+    if (DEBUG) {
+        fprintf(stderr, "[event_loop] %i threads started.\n", loop->thread_count);
+    }
+    return 0;
+}
+
+void event_loop_wait(struct event_loop* loop) {
+    int i;
+
+    for (i=0; i<loop->thread_count; i++) {
+        pthread_join(loop->threads[i], NULL);
+    }
+    loop->thread_count = 0;
+}
+
+void event_loop_stop(struct event_loop* loop) {
+    uint64_t value = 1;
+
+    /* only a write, the threads are joined by event_loop_wait(): */
+    if (write(loop->stop_fd, &value, sizeof(value))!=sizeof(value)) {
+        perror("[event_loop] waking the threads failed");
+    }
+}
+
+void event_loop_free(struct event_loop* loop) {
+    if (loop==NULL) {
+        return;
+    }
+    while (loop->sources!=NULL) {
+        struct event_loop_source* source = loop->sources;
+        loop->sources = source->next;
+        free(source);
+    }
+    close(loop->stop_fd);
+    close(loop->epoll_fd);
+    free(loop);
+}
+
+#endif
+
+static void event_loop_settings_defaults(struct event_loop_settings* settings) {
+    memset(settings, 0, sizeof(struct event_loop_settings));
+    settings->enabled = 0;
+    settings->threads = 2;
+    settings->budget  = EVENT_LOOP_BUDGET_DEFAULT;
+}
+
+void event_loop_settings_get(struct event_loop_settings* settings) {
+    struct extinfo_list** extinfo;
+    struct event_loop_settings* configured;
+
+    extinfo = settings_extinfo_lock();
+    configured = extinfo_list_get_data(*extinfo, "capture_loop");
+    if (configured!=NULL) {
+        memcpy(settings, configured, sizeof(struct event_loop_settings));
+    } else {
+        event_loop_settings_defaults(settings);
+    }
+    settings_extinfo_unlock();
+}
+
+int event_loop_settings_load(xmlNodePtr element, void** data) {
+    struct event_loop_settings* settings;
+    xmlChar* mode = xmlGetProp(element, BAD_CAST "mode");
+
+    if ((settings=malloc(sizeof(struct event_loop_settings)))==NULL) {
+        perror("[event_loop] malloc failed.\n");
+        exit(1);
+    }
+    event_loop_settings_defaults(settings);
+    if (mode!=NULL) {
+        if (STRCMP(mode, "epoll")==0) {
+#ifdef _LINUX_
+            settings->enabled = 1;
+#else
+            fprintf(stderr, "[event_loop] WARNING: settings: mode epoll is only supported on Linux.\n");
+#endif
+        } else if (STRCMP(mode, "thread")!=0) {
+            fprintf(stderr, "[event_loop] ERROR: settings: unknown mode %s.\n", (char*)mode);
+            xmlFree(mode);
+            free(settings);
+            return -1;
+        }
+        xmlFree(mode);
+    }
+    if (settings_get_int(element, "threads", &settings->threads, 1, EVENT_LOOP_THREADS_MAX)==-1
+            || settings_get_int(element, "budget", &settings->budget, 1, 65536)==-1) {
+        free(settings);
+        return -1;
+    }
+    *data = settings;
+    return 0;
+}
+
+void event_loop_settings_print(void* data) {
+    struct event_loop_settings* settings = (struct event_loop_settings*) data;
+
+    if (settings->enabled) {
+        fprintf(stderr, "[event_loop] capture by %i threads, %i frames per wakeup\n",
+                settings->threads, settings->budget);
+    } else {
+        fprintf(stderr, "[event_loop] capture by a thread per socket\n");
+    }
+}
+
+int event_loop_settings_save(xmlNodePtr element, void* data) {
+    struct event_loop_settings* settings = (struct event_loop_settings*) data;
+
+    xmlNewProp(element, BAD_CAST "mode", BAD_CAST (settings->enabled ? "epoll" : "thread"));
+    settings_set_int(element, "threads", settings->threads);
+    settings_set_int(element, "budget", settings->budget);
+    return 0;
+}
@@ -0,0 +1,153 @@
+#ifndef _EVENT_LOOP_H_
+#define _EVENT_LOOP_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#ifdef _LINUX_
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+#include <libxml/tree.h>
+
+#include "ndpmon_defs.h"
+#include "extinfo.h"
+#include "settings.h"
+
+/** @file
+ *  Event loop capture mode.
+ *
+ *  Instead of a blocking capture thread per capture socket (or netfilter
+ *  queue), the descriptors of all probes are put into one epoll set that
+ *  is served by a small, fixed pool of threads. Each descriptor is armed
+ *  with EPOLLONESHOT, so a capture handle is served by only one thread at
+ *  a time, and re-armed after its handler read a batch. The loop is
+ *  stopped through an eventfd that wakes all threads, no thread is
+ *  cancelled.
+ *
+ *  Enabled by the capture_loop element of the settings, for instance
+ *  \verbatim <capture_loop mode="epoll" threads="2" budget="256"/> \endverbatim
+ *  The loop is only available on Linux, elsewhere the element is accepted
+ *  but the capture keeps a thread per socket.
+ */
+
+/** Maximum number of event loop threads. */
+#define EVENT_LOOP_THREADS_MAX 64
+/** Maximum number of events taken by a thread per wakeup. */
+#define EVENT_LOOP_EVENTS_MAX 8
+/** Default maximum number of frames read per descriptor wakeup. */
+#define EVENT_LOOP_BUDGET_DEFAULT 256
+
+/** Settings of the capture mode, loaded from the capture_loop element of
+ *  the settings (extinfo type "capture_loop").
+ */
+struct event_loop_settings {
+    /** Set if the capture is served by the event loop (mode="epoll"). */
+    int enabled;
+    /** Number of threads. */
+    int threads;
+    /** Maximum number of frames read per descriptor wakeup. */
+    int budget;
+};
+
+#ifdef _LINUX_
+
+/** Handles a readable descriptor.
+ *  @param arg The argument given to event_loop_add().
+ *  @return    0 to wait for the descriptor again, -1 to remove it.
+ */
+typedef int (*event_loop_handler_t)(void* arg);
+
+/** A descriptor served by the loop. */
+struct event_loop_source {
+    int fd;
+    event_loop_handler_t handler;
+    void* arg;
+    struct event_loop_source* next;
+};
+
+/** An epoll set with its threads. */
+struct event_loop {
+    int epoll_fd;
+    /** Readable once the loop is to be stopped. */
+    int stop_fd;
+    int thread_count;
+    pthread_t threads[EVENT_LOOP_THREADS_MAX];
+    struct event_loop_source* sources;
+};
+
+/** Creates an event loop without threads.
+ *  @return The loop or NULL on error.
+ */
+struct event_loop* event_loop_create();
+
+/** Adds a descriptor to the loop.
+ *  @param loop    The loop.
+ *  @param fd      The descriptor, should be non-blocking.
+ *  @param handler Called when the descriptor is readable.
+ *  @param arg     Passed to the handler.
+ *  @return        0 on success, -1 on error.
+ */
+int event_loop_add(struct event_loop* loop, int fd, event_loop_handler_t handler, void* arg);
+
+/** Starts the threads of the loop.
+ *  @param loop    The loop.
+ *  @param threads Number of threads.
+ *  @return        0 on success, -1 on error.
+ */
+int event_loop_start(struct event_loop* loop, int threads);
+
+/** Waits for the threads of the loop to finish, once they are stopped by
+ *  event_loop_stop(). Only one thread may wait for a loop, the threads are
+ *  joined once.
+ *  @param loop The loop.
+ */
+void event_loop_wait(struct event_loop* loop);
+
+/** Wakes the threads of the loop to make them finish, does not wait for
+ *  them (see event_loop_wait()). The handlers that are running complete
+ *  their batch first.
+ *  @param loop The loop.
+ */
+void event_loop_stop(struct event_loop* loop);
+
+/** Closes the descriptors of the loop (not the ones of the sources) and
+ *  frees it. The threads must be joined.
+ *  @param loop The loop.
+ */
+void event_loop_free(struct event_loop* loop);
+
+#endif
+
+/** Gets the capture mode settings, the defaults (no event loop) if the
+ *  settings have no capture_loop element.
+ *  @param settings Will hold the settings.
+ */
+void event_loop_settings_get(struct event_loop_settings* settings);
+
+/** Loads the capture mode settings from a XML element.
+ *  @param element The capture_loop element.
+ *  @param data    Will hold the settings (call by reference).
+ *  @return        0 on success, -1 on error.
+ */
+int event_loop_settings_load(xmlNodePtr element, void** data);
+
+/** Prints the capture mode settings.
+ *  @param data The settings.
+ */
+void event_loop_settings_print(void* data);
+
+/** Saves the capture mode settings to a XML element.
+ *  @param element The element to add the attributes to.
+ *  @param data    The settings.
+ *  @return        Always 0.
+ */
+int event_loop_settings_save(xmlNodePtr element, void* data);
+
+#endif
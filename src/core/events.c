@@ -2,6 +2,9 @@
 #include "events.h"
 
 static struct event_list* events=NULL;
+/* number of queued events, changed with events_lock held but read without: */
+static unsigned int events_depth = 0;
+static uint64_t events_queued = 0;
 
 static struct event_handler_list* event_handlers;
 
@@ -93,6 +96,8 @@ void event_queue(enum event_type type, union event_data* const data) {
          }
          tmp_events->next = new;
      }
+     __atomic_store_n(&events_depth, events_depth+1, __ATOMIC_RELAXED);
+     __atomic_store_n(&events_queued, events_queued+1, __ATOMIC_RELAXED);
      pthread_mutex_unlock(&events_lock);
      pthread_cond_signal(&events_cond);
      sched_yield();
@@ -110,6 +115,13 @@ void event_queue_cleanup() {
     pthread_cond_destroy(&events_cond);
 }
 
+unsigned int event_queue_depth(uint64_t* queued) {
+    if (queued!=NULL) {
+        *queued = __atomic_load_n(&events_queued, __ATOMIC_RELAXED);
+    }
+    return __atomic_load_n(&events_depth, __ATOMIC_RELAXED);
+}
+
 struct event_info* event_queue_pop() {
     struct event_info* next_event;
     struct event_list* tmp_event_list;
@@ -136,6 +148,7 @@ struct event_info* event_queue_pop() {
     tmp_event_list = events;
     events = events->next;
     free(tmp_event_list);
+    __atomic_store_n(&events_depth, events_depth-1, __ATOMIC_RELAXED);
     pthread_mutex_unlock(&events_lock);
     return next_event;
 }
@@ -76,6 +76,10 @@ struct probe_updown_info {
     } state;
     /** The configuration and state information of the probe. */
     struct probe probe;
+    /** Set if capture statistics were collected for the probe. */
+    int has_capture_stats;
+    /** The capture statistics as of the last collection. */
+    struct capture_stats capture_stats;
 };
 
 /** Possible event types. */
@@ -171,6 +175,12 @@ void event_queue(enum event_type type, union event_data* const data);
 /** Frees the queue of events (should be empty on teardown). */
 void event_queue_free();
 
+/** Returns the number of events waiting in the queue, without locking it.
+ *  @param queued Will hold the number of events queued since the start, may be NULL.
+ *  @return       The number of waiting events.
+ */
+unsigned int event_queue_depth(uint64_t* queued);
+
 /** This thread consumes everything that is added to the queue.
  *  @param unused The thread parameter is not used.
  *  @return       Always NULL.
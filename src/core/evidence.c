@@ -0,0 +1,520 @@
+#include "evidence.h"
+
+/* pcapng block types and options: */
+#define EVIDENCE_PCAPNG_SHB 0x0A0D0D0A
+#define EVIDENCE_PCAPNG_IDB 0x00000001
+#define EVIDENCE_PCAPNG_EPB 0x00000006
+#define EVIDENCE_PCAPNG_BYTE_ORDER 0x1A2B3C4D
+#define EVIDENCE_PCAPNG_OPT_END 0
+#define EVIDENCE_PCAPNG_OPT_COMMENT 1
+#define EVIDENCE_PCAPNG_IF_NAME 2
+#define EVIDENCE_PCAPNG_SHB_USERAPPL 4
+#define EVIDENCE_PCAPNG_LINKTYPE_ETHERNET 1
+
+/* directory, probe name, date and extension: */
+#define EVIDENCE_FILE_NAME_SIZE (PATH_SIZE+PROBE_NAME_SIZE+64)
+
+/** An alert waiting for its evidence to be written. */
+struct evidence_request {
+    /** The frames of the probe. */
+    struct evidence_ring* ring;
+    char probe_name[PROBE_NAME_SIZE];
+    char reason[ALERT_REASON_SIZE];
+    /** Comment of the section and of the frame that raised the alert. */
+    char comment[EVIDENCE_COMMENT_SIZE];
+    /** Capture time of the frame that raised the alert (or the time it was raised). */
+    struct timeval time;
+    /** Position of the frame that raised the alert, if has_trigger is set. */
+    uint64_t trigger;
+    int has_trigger;
+    /** The evidence is written once the frames after the alert are captured. */
+    time_t due;
+    struct evidence_request* next;
+};
+
+static struct evidence_settings evidence_settings;
+/* set by evidence_start() before the capture starts: */
+static int evidence_enabled = 0;
+
+static struct evidence_request* evidence_queue = NULL;
+static int evidence_queued = 0;
+static int evidence_running = 0;
+static pthread_mutex_t evidence_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t evidence_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t evidence_thread;
+
+/* the frame being analyzed by the current thread, for the alerts it raises: */
+static __thread struct evidence_ring* evidence_current_ring = NULL;
+static __thread uint64_t evidence_current_position;
+static __thread struct timeval evidence_current_time;
+
+static struct evidence_ring* evidence_ring_create(uint32_t frames, uint32_t snaplen) {
+    struct evidence_ring* ring;
+    uint32_t capacity = 1;
+    uint32_t i;
+
+    while (capacity<frames) {
+        capacity <<= 1;
+    }
+    if ((ring=malloc(sizeof(struct evidence_ring)))==NULL) {
+        perror("[evidence] malloc failed");
+        return NULL;
+    }
+    memset(ring, 0, sizeof(struct evidence_ring));
+    ring->capacity = capacity;
+    ring->mask     = capacity-1;
+    ring->snaplen  = snaplen;
+    /* keep the slots 8 byte aligned: */
+    ring->stride   = (sizeof(struct evidence_slot)+snaplen+7) & ~((size_t)7);
+    if ((ring->slots=malloc(ring->stride*capacity))==NULL) {
+        perror("[evidence] malloc failed");
+        free(ring);
+        return NULL;
+    }
+    for (i=0; i<capacity; i++) {
+        ((struct evidence_slot*)(ring->slots + i*ring->stride))->sequence = 0;
+    }
+    return ring;
+}
+
+static void evidence_ring_free(struct evidence_ring* ring) {
+    if (ring==NULL) {
+        return;
+    }
+    free(ring->slots);
+    free(ring);
+}
+
+/* Returns the ring of a probe, virtual probes get theirs with their first frame. */
+static struct evidence_ring* evidence_ring_get(struct probe* probe) {
+    struct evidence_ring* ring = __atomic_load_n(&probe->evidence, __ATOMIC_ACQUIRE);
+    struct evidence_ring* expected = NULL;
+
+    if (ring!=NULL) {
+        return ring;
+    }
+    if ((ring=evidence_ring_create(evidence_settings.frames, evidence_settings.snaplen))==NULL) {
+        return NULL;
+    }
+    /* another analysis thread of the probe may have been faster: */
+    if (!__atomic_compare_exchange_n(&probe->evidence, &expected, ring, 0,
+            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        evidence_ring_free(ring);
+        ring = expected;
+    }
+    return ring;
+}
+
+void evidence_record(struct probe* probe, const struct timeval* timestamp, const uint8_t* data, int length) {
+    struct evidence_ring* ring;
+    struct evidence_slot* slot;
+    uint64_t position;
+    uint32_t caplen;
+
+    if (!evidence_enabled || (ring=evidence_ring_get(probe))==NULL) {
+        return;
+    }
+    position = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED);
+    slot = (struct evidence_slot*)(ring->slots + (position & ring->mask)*ring->stride);
+    caplen = ((uint32_t)length>ring->snaplen) ? ring->snaplen : (uint32_t)length;
+    __atomic_store_n(&slot->sequence, 2*position+1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->timestamp = *timestamp;
+    slot->length    = (uint32_t)length;
+    slot->caplen    = caplen;
+    memcpy(slot->data, data, caplen);
+    __atomic_store_n(&slot->sequence, 2*position+2, __ATOMIC_RELEASE);
+
+    evidence_current_ring     = ring;
+    evidence_current_position = position;
+    evidence_current_time     = *timestamp;
+}
+
+/* Tells if a reason is in the comma separated list of the settings. */
+static int evidence_reason_match(const char* reason) {
+    const char* list = evidence_settings.reasons;
+    size_t reason_length = strlen(reason);
+
+    if (list[0]=='\0') {
+        return 1;
+    }
+    while (*list!='\0') {
+        size_t length;
+
+        list += strspn(list, " ,");
+        length = strcspn(list, ",");
+        /* ignore trailing blanks: */
+        while (length>0 && list[length-1]==' ') {
+            length--;
+        }
+        if (length>0 && length==reason_length && strncmp(list, reason, length)==0) {
+            return 1;
+        }
+        list += strcspn(list, ",");
+    }
+    return 0;
+}
+
+void evidence_alert(const struct probe* probe, const char* reason, const char* message) {
+    struct evidence_request* request;
+    struct evidence_request** last;
+    struct evidence_ring* ring;
+
+    if (!evidence_enabled || !evidence_reason_match(reason)) {
+        return;
+    }
+    if ((ring=__atomic_load_n(&probe->evidence, __ATOMIC_ACQUIRE))==NULL) {
+        /* no frame analyzed on the probe yet: */
+        return;
+    }
+    if ((request=malloc(sizeof(struct evidence_request)))==NULL) {
+        perror("[evidence] malloc failed");
+        return;
+    }
+    memset(request, 0, sizeof(struct evidence_request));
+    request->ring = ring;
+    strlcpy(request->probe_name, probe->name, PROBE_NAME_SIZE);
+    strlcpy(request->reason, reason, ALERT_REASON_SIZE);
+    snprintf(request->comment, EVIDENCE_COMMENT_SIZE, "NDPMon alert \"%s\" on probe %s: %s",
+            reason, probe->name, message);
+    if (evidence_current_ring==ring) {
+        /* raised by the frame this thread is analyzing: */
+        request->time        = evidence_current_time;
+        request->trigger     = evidence_current_position;
+        request->has_trigger = 1;
+    } else {
+        gettimeofday(&request->time, NULL);
+    }
+    request->due = time(NULL) + evidence_settings.after;
+
+    pthread_mutex_lock(&evidence_lock);
+    if (!evidence_running || evidence_queued>=EVIDENCE_QUEUE_MAX) {
+        pthread_mutex_unlock(&evidence_lock);
+        LOGGING_RATELIMITED(LOGGING_CORE, LOGGING_LEVEL_WARNING,
+                "[evidence] too many alerts, no evidence written for \"%s\" on %s.\n", reason, probe->name);
+        free(request);
+        return;
+    }
+    for (last=&evidence_queue; *last!=NULL; last=&(*last)->next) {
+    }
+    *last = request;
+    evidence_queued++;
+    pthread_cond_signal(&evidence_cond);
+    pthread_mutex_unlock(&evidence_lock);
+}
+
+/* Appends an option to a block body, returns the new length of the body. */
+static size_t evidence_option(uint8_t* body, size_t length, uint16_t code, const void* value, uint16_t value_length) {
+    size_t padded = ((size_t)value_length+3) & ~((size_t)3);
+
+    memcpy(body+length, &code, 2);
+    memcpy(body+length+2, &value_length, 2);
+    memcpy(body+length+4, value, value_length);
+    memset(body+length+4+value_length, 0, padded-value_length);
+    return length+4+padded;
+}
+
+/* Terminates the options of a block body, returns the new length of the body. */
+static size_t evidence_option_end(uint8_t* body, size_t length) {
+    memset(body+length, 0, 4);
+    return length+4;
+}
+
+/* Writes a block, its body padded to 32 bits. */
+static int evidence_block_write(FILE* file, uint32_t type, const uint8_t* body, size_t length) {
+    uint32_t total = (uint32_t)(12+length);
+
+    if (fwrite(&type, 4, 1, file)!=1 || fwrite(&total, 4, 1, file)!=1
+            || fwrite(body, 1, length, file)!=length || fwrite(&total, 4, 1, file)!=1) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Writes the section header and the interface description. */
+static int evidence_header_write(FILE* file, const struct evidence_request* request, uint8_t* body) {
+    uint32_t byte_order = EVIDENCE_PCAPNG_BYTE_ORDER;
+    uint16_t version[2] = { 1, 0 };
+    int64_t section_length = -1;
+    uint16_t linktype = EVIDENCE_PCAPNG_LINKTYPE_ETHERNET;
+    uint16_t reserved = 0;
+    uint32_t snaplen = request->ring->snaplen;
+    size_t length = 0;
+
+    memcpy(body, &byte_order, 4);
+    memcpy(body+4, version, 4);
+    memcpy(body+8, &section_length, 8);
+    length = evidence_option(body, 16, EVIDENCE_PCAPNG_OPT_COMMENT, request->comment, strlen(request->comment));
+    length = evidence_option(body, length, EVIDENCE_PCAPNG_SHB_USERAPPL, "NDPMon", 6);
+    length = evidence_option_end(body, length);
+    if (evidence_block_write(file, EVIDENCE_PCAPNG_SHB, body, length)==-1) {
+        return -1;
+    }
+    memcpy(body, &linktype, 2);
+    memcpy(body+2, &reserved, 2);
+    memcpy(body+4, &snaplen, 4);
+    length = evidence_option(body, 8, EVIDENCE_PCAPNG_IF_NAME, request->probe_name, strlen(request->probe_name));
+    length = evidence_option_end(body, length);
+    return evidence_block_write(file, EVIDENCE_PCAPNG_IDB, body, length);
+}
+
+/* Writes a frame as enhanced packet block (microsecond timestamps). */
+static int evidence_frame_write(FILE* file, const struct evidence_slot* frame, const char* comment, uint8_t* body) {
+    uint64_t timestamp = (uint64_t)frame->timestamp.tv_sec*1000000 + frame->timestamp.tv_usec;
+    uint32_t words[5];
+    size_t length;
+
+    words[0] = 0;
+    words[1] = (uint32_t)(timestamp>>32);
+    words[2] = (uint32_t)timestamp;
+    words[3] = frame->caplen;
+    words[4] = frame->length;
+    memcpy(body, words, 20);
+    memcpy(body+20, frame->data, frame->caplen);
+    length = 20 + ((frame->caplen+3) & ~3U);
+    memset(body+20+frame->caplen, 0, length-20-frame->caplen);
+    if (comment!=NULL) {
+        length = evidence_option(body, length, EVIDENCE_PCAPNG_OPT_COMMENT, comment, strlen(comment));
+        length = evidence_option_end(body, length);
+    }
+    return evidence_block_write(file, EVIDENCE_PCAPNG_EPB, body, length);
+}
+
+/* Copies the frame of a position, returns -1 if it was overwritten. */
+static int evidence_frame_copy(const struct evidence_ring* ring, uint64_t position, struct evidence_slot* frame) {
+    struct evidence_slot* slot = (struct evidence_slot*)(ring->slots + (position & ring->mask)*ring->stride);
+    uint64_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+
+    if (sequence!=2*position+2) {
+        return -1;
+    }
+    memcpy(frame, slot, ring->stride);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED)==sequence) ? 0 : -1;
+}
+
+/* Builds the file name from the probe name and the alert time. */
+static void evidence_file_name(const struct evidence_request* request, char* path) {
+    char probe_name[PROBE_NAME_SIZE];
+    char date[32];
+    struct tm time_fields;
+    size_t i;
+
+    strlcpy(probe_name, request->probe_name, PROBE_NAME_SIZE);
+    /* remote probes are named host/interface: */
+    for (i=0; probe_name[i]!='\0'; i++) {
+        if (probe_name[i]=='/' || probe_name[i]==' ') {
+            probe_name[i] = '_';
+        }
+    }
+    localtime_r(&request->time.tv_sec, &time_fields);
+    strftime(date, sizeof(date), "%Y%m%d-%H%M%S", &time_fields);
+    snprintf(path, EVIDENCE_FILE_NAME_SIZE, "%s/%s-%s-%06ld.pcapng", evidence_settings.directory,
+            probe_name, date, (long)request->time.tv_usec);
+}
+
+static void evidence_write(const struct evidence_request* request) {
+    const struct evidence_ring* ring = request->ring;
+    struct evidence_slot* frame;
+    uint8_t* body;
+    char path[EVIDENCE_FILE_NAME_SIZE];
+    FILE* file;
+    int64_t alert = (int64_t)request->time.tv_sec*1000000 + request->time.tv_usec;
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t position = (head>ring->capacity) ? head-ring->capacity : 0;
+    int frames = 0;
+
+    frame = malloc(ring->stride);
+    body = malloc(ring->snaplen + 2*EVIDENCE_COMMENT_SIZE + 64);
+    if (frame==NULL || body==NULL) {
+        perror("[evidence] malloc failed");
+        free(frame);
+        free(body);
+        return;
+    }
+    evidence_file_name(request, path);
+    if ((file=fopen(path, "wb"))==NULL) {
+        LOGGING(LOGGING_CORE, LOGGING_LEVEL_ERROR, "[evidence] ERROR: opening %s: %s\n", path, strerror(errno));
+        free(frame);
+        free(body);
+        return;
+    }
+    if (evidence_header_write(file, request, body)==-1) {
+        position = head;
+    }
+    for (; position<head; position++) {
+        int64_t captured;
+
+        if (evidence_frame_copy(ring, position, frame)==-1) {
+            continue;
+        }
+        captured = (int64_t)frame->timestamp.tv_sec*1000000 + frame->timestamp.tv_usec;
+        if (captured<alert-(int64_t)evidence_settings.before*1000000
+                || captured>alert+(int64_t)evidence_settings.after*1000000) {
+            continue;
+        }
+        if (evidence_frame_write(file, frame,
+                (request->has_trigger && position==request->trigger) ? request->comment : NULL, body)==-1) {
+            break;
+        }
+        frames++;
+    }
+    if (ferror(file) || fclose(file)!=0) {
+        LOGGING(LOGGING_CORE, LOGGING_LEVEL_ERROR, "[evidence] ERROR: writing %s failed.\n", path);
+    } else {
+        LOGGING(LOGGING_CORE, LOGGING_LEVEL_NOTICE, "[evidence] %i frames of alert \"%s\" written to %s.\n",
+                frames, request->reason, path);
+    }
+    free(frame);
+    free(body);
+}
+
+static void* evidence_run(void* unused) {
+    sigset_t signals;
+
+    /* signals are handled by the main thread: */
+    sigfillset(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    pthread_mutex_lock(&evidence_lock);
+    while (evidence_running || evidence_queue!=NULL) {
+        struct evidence_request* request = evidence_queue;
+
+        if (request==NULL) {
+            pthread_cond_wait(&evidence_cond, &evidence_lock);
+            continue;
+        }
+        /* on stop the pending alerts are written at once: */
+        if (evidence_running && time(NULL)<request->due) {
+            struct timespec due;
+
+            due.tv_sec  = request->due;
+            due.tv_nsec = 0;
+            pthread_cond_timedwait(&evidence_cond, &evidence_lock, &due);
+            continue;
+        }
+        evidence_queue = request->next;
+        evidence_queued--;
+        pthread_mutex_unlock(&evidence_lock);
+        evidence_write(request);
+        free(request);
+        pthread_mutex_lock(&evidence_lock);
+    }
+    pthread_mutex_unlock(&evidence_lock);
+    return NULL;
+}
+
+int evidence_start() {
+    struct extinfo_list** extinfo;
+    struct evidence_settings* configured;
+    struct probe_list** locked_probes;
+    struct probe_list* tmp_probes;
+
+    extinfo = settings_extinfo_lock();
+    configured = extinfo_list_get_data(*extinfo, "evidence");
+    if (configured!=NULL) {
+        memcpy(&evidence_settings, configured, sizeof(struct evidence_settings));
+    }
+    settings_extinfo_unlock();
+    if (configured==NULL) {
+        return 0;
+    }
+    if (mkdir(evidence_settings.directory, 0750)==-1 && errno!=EEXIST) {
+        fprintf(stderr, "[evidence] ERROR: creating %s: %s\n", evidence_settings.directory, strerror(errno));
+        return -1;
+    }
+    /* critical section: */
+    locked_probes = probe_list_lock();
+    for (tmp_probes=*locked_probes; tmp_probes!=NULL; tmp_probes=tmp_probes->next) {
+        if (tmp_probes->entry.evidence==NULL) {
+            tmp_probes->entry.evidence = evidence_ring_create(evidence_settings.frames, evidence_settings.snaplen);
+        }
+    }
+    probe_list_unlock();
+    /* end critical section. */
+    evidence_running = 1;
+    if (pthread_create(&evidence_thread, NULL, evidence_run, NULL)!=0) {
+        perror("[evidence] pthread_create failed");
+        evidence_running = 0;
+        return -1;
+    }
+    evidence_enabled = 1;
+    fprintf(stderr, "[evidence] keeping %i frames per probe for the alerts.\n", evidence_settings.frames);
+    return 0;
+}
+
+void evidence_stop() {
+    struct probe_list** locked_probes;
+    struct probe_list* tmp_probes;
+
+    if (!evidence_enabled) {
+        return;
+    }
+    pthread_mutex_lock(&evidence_lock);
+    evidence_running = 0;
+    pthread_cond_signal(&evidence_cond);
+    pthread_mutex_unlock(&evidence_lock);
+    pthread_join(evidence_thread, NULL);
+    evidence_enabled = 0;
+
+    /* critical section: */
+    locked_probes = probe_list_lock();
+    for (tmp_probes=*locked_probes; tmp_probes!=NULL; tmp_probes=tmp_probes->next) {
+        evidence_ring_free(tmp_probes->entry.evidence);
+        tmp_probes->entry.evidence = NULL;
+    }
+    probe_list_unlock();
+    /* end critical section. */
+}
+
+int evidence_settings_load(xmlNodePtr element, void** data) {
+    struct evidence_settings* settings;
+    xmlChar* directory = xmlGetProp(element, BAD_CAST "directory");
+    xmlChar* reasons = xmlGetProp(element, BAD_CAST "reasons");
+
+    if ((settings=malloc(sizeof(struct evidence_settings)))==NULL) {
+        perror("[evidence] malloc failed.\n");
+        exit(1);
+    }
+    memset(settings, 0, sizeof(struct evidence_settings));
+    strlcpy(settings->directory, (directory!=NULL) ? (char*)directory : _EVIDENCE_PATH_, PATH_SIZE);
+    if (reasons!=NULL) {
+        strlcpy(settings->reasons, (char*)reasons, EVIDENCE_REASONS_SIZE);
+    }
+    xmlFree(directory);
+    xmlFree(reasons);
+    settings->frames  = EVIDENCE_FRAMES;
+    settings->snaplen = EVIDENCE_SNAPLEN;
+    settings->before  = EVIDENCE_BEFORE;
+    settings->after   = EVIDENCE_AFTER;
+    if (settings_get_int(element, "frames", &settings->frames, 16, 1048576)==-1
+            || settings_get_int(element, "snaplen", &settings->snaplen, 64, 65535)==-1
+            || settings_get_int(element, "before", &settings->before, 0, 3600)==-1
+            || settings_get_int(element, "after", &settings->after, 0, 3600)==-1) {
+        free(settings);
+        return -1;
+    }
+    *data = settings;
+    return 0;
+}
+
+void evidence_settings_print(void* data) {
+    struct evidence_settings* settings = (struct evidence_settings*) data;
+
+    fprintf(stderr, "[evidence] %i frames of %i bytes per probe, %i s before and %i s after an alert, to %s\n",
+            settings->frames, settings->snaplen, settings->before, settings->after, settings->directory);
+    fprintf(stderr, "[evidence] alert reasons: %s\n", (settings->reasons[0]=='\0') ? "all" : settings->reasons);
+}
+
+int evidence_settings_save(xmlNodePtr element, void* data) {
+    struct evidence_settings* settings = (struct evidence_settings*) data;
+
+    xmlNewProp(element, BAD_CAST "directory", BAD_CAST settings->directory);
+    settings_set_int(element, "frames", settings->frames);
+    settings_set_int(element, "snaplen", settings->snaplen);
+    settings_set_int(element, "before", settings->before);
+    settings_set_int(element, "after", settings->after);
+    if (settings->reasons[0]!='\0') {
+        xmlNewProp(element, BAD_CAST "reasons", BAD_CAST settings->reasons);
+    }
+    return 0;
+}
@@ -0,0 +1,148 @@
+#ifndef _EVIDENCE_H_
+#define _EVIDENCE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+
+#include <libxml/tree.h>
+
+#include "../membounds.h"
+#include "ndpmon_defs.h"
+
+#include "cache_types.h"
+#include "events.h"
+#include "extinfo.h"
+#include "logging.h"
+#include "probes.h"
+#include "settings.h"
+
+/** @file
+ *  Evidence capture: the frames around an alert, written to a pcapng file.
+ *
+ *  Each probe keeps the last frames it analyzed in a preallocated ring
+ *  (struct evidence_ring). The analysis threads claim a slot with an atomic
+ *  increment and copy the frame, a sequence number per slot tells readers
+ *  whether the slot was overwritten while they copied it.
+ *
+ *  When an alert of one of the configured reasons is raised, a request is
+ *  queued for the writer thread of this module. The writer waits until the
+ *  frames following the alert are captured, then writes the frames within
+ *  the window around the alert to
+ *  \verbatim <directory>/<probe>-<date>-<time>-<usec>.pcapng \endverbatim
+ *  with the alert as comment of the section and of the frame that raised it.
+ *
+ *  Enabled by the evidence element of the settings, for instance
+ *  \verbatim <evidence frames="1024" before="5" after="2" reasons="wrong router mac,wrong prefix"/> \endverbatim
+ */
+
+/** Default number of frames kept per probe. */
+#define EVIDENCE_FRAMES 1024
+/** Default number of bytes kept of a frame. */
+#define EVIDENCE_SNAPLEN 1518
+/** Default seconds of traffic written from before an alert. */
+#define EVIDENCE_BEFORE 5
+/** Default seconds of traffic written from after an alert. */
+#define EVIDENCE_AFTER 2
+/** Size of the comma separated list of reasons. */
+#define EVIDENCE_REASONS_SIZE 1024
+/** Maximum number of alerts waiting to be written, further alerts are not written. */
+#define EVIDENCE_QUEUE_MAX 32
+/** Size of the comment describing an alert. */
+#define EVIDENCE_COMMENT_SIZE (ALERT_REASON_SIZE+ALERT_MESSAGE_SIZE+PROBE_NAME_SIZE+64)
+
+/** Settings of the evidence capture (extinfo type "evidence"). */
+struct evidence_settings {
+    /** Directory of the pcapng files. */
+    char directory[PATH_SIZE];
+    /** Frames kept per probe (rounded up to a power of two). */
+    int frames;
+    /** Bytes kept of a frame. */
+    int snaplen;
+    /** Seconds of traffic written from before the alert. */
+    int before;
+    /** Seconds of traffic written from after the alert. */
+    int after;
+    /** Comma separated alert reasons to write evidence for, all if empty. */
+    char reasons[EVIDENCE_REASONS_SIZE];
+};
+
+/** A slot of the frame ring. */
+struct evidence_slot {
+    /** 2*position+1 while the frame of a position is copied, 2*position+2 once it is. */
+    uint64_t sequence;
+    /** Capture time. */
+    struct timeval timestamp;
+    /** Length of the frame. */
+    uint32_t length;
+    /** Bytes kept of the frame. */
+    uint32_t caplen;
+    /** The frame (snaplen bytes available). */
+    uint8_t data[];
+};
+
+/** The recent frames of a probe. */
+struct evidence_ring {
+    uint32_t capacity;
+    uint32_t mask;
+    uint32_t snaplen;
+    size_t   stride;
+    uint8_t* slots;
+    /** Next position, claimed with an atomic increment. */
+    uint64_t head __attribute__ ((aligned (64)));
+};
+
+/** Allocates the frame rings of the probes and starts the writer thread,
+ *  if the settings have an evidence element.
+ *  @return 0 on success or if evidence capture is not configured, -1 otherwise.
+ */
+int evidence_start();
+
+/** Writes the evidence of pending alerts, stops the writer thread and
+ *  releases the frame rings. The capture must be stopped.
+ */
+void evidence_stop();
+
+/** Copies an analyzed frame into the ring of its probe.
+ *  @param probe     The probe the frame is analyzed on.
+ *  @param timestamp Capture time.
+ *  @param data      The frame.
+ *  @param length    Length of the frame.
+ */
+void evidence_record(struct probe* probe, const struct timeval* timestamp, const uint8_t* data, int length);
+
+/** Queues the evidence of an alert if its reason is configured.
+ *  @param probe   The probe the alert is raised on.
+ *  @param reason  The reason of the alert.
+ *  @param message The alert message.
+ */
+void evidence_alert(const struct probe* probe, const char* reason, const char* message);
+
+/** Loads the evidence settings from a XML element.
+ *  @param element The evidence element.
+ *  @param data    Will hold the settings (call by reference).
+ *  @return        0 on success, -1 on error.
+ */
+int evidence_settings_load(xmlNodePtr element, void** data);
+
+/** Prints the evidence settings.
+ *  @param data The settings.
+ */
+void evidence_settings_print(void* data);
+
+/** Saves the evidence settings to a XML element.
+ *  @param element The element to add the attributes to.
+ *  @param data    The settings.
+ *  @return        Always 0.
+ */
+int evidence_settings_save(xmlNodePtr element, void* data);
+
+#endif
@@ -1,85 +1,76 @@
 #include "extinfo.h"
 
-static struct extinfo_type_list* extinfo_types=NULL;
+/* the registered types, indexed by their slot: */
+static struct extinfo_type extinfo_types[EXTINFO_TYPES_MAX];
+static int extinfo_types_count=0;
 
 int extinfo_type_list_add(const char* const name, handler_free_t handler_free,
         handler_print_t handler_print,
         handler_xml_load_t handler_xml_load,
         handler_xml_save_t handler_xml_save) {
-    struct extinfo_type_list* tmp_types=extinfo_types;
-    struct extinfo_type_list* new;
+    struct extinfo_type* new;
 
-    while (tmp_types!=NULL) {
-        if (strncmp((tmp_types->entry.name), name, EXTINFO_NAME_SIZE)==0) {
-            fprintf(stderr, "[extinfo] ERROR: extinfo type with given name already exists.");
-            return -1;
-        }
-        tmp_types = tmp_types->next;
-    }
-    if ((new=malloc(sizeof(struct extinfo_type_list)))==NULL) {
-        perror("malloc");
+    if (extinfo_type_list_get(name)!=NULL) {
+        fprintf(stderr, "[extinfo] ERROR: extinfo type with given name already exists.");
         return -1;
     }
-    /* set values: */
-    new->entry.handler_free = handler_free;
-    new->entry.handler_print = handler_print;
-    new->entry.handler_xml_load = handler_xml_load;
-    new->entry.handler_xml_save = handler_xml_save;
-    strlcpy(new->entry.name, name, EXTINFO_NAME_SIZE);
-    new->next = NULL;
-    if (extinfo_types==NULL) {
-        /* if the list is empty the new entry is the list: */
-        extinfo_types = new;
-    } else {
-        /* else walk to the end of the list to keep the FIFO ordering: */
-        tmp_types = extinfo_types;
-        while (tmp_types->next != NULL) {
-            tmp_types = tmp_types->next;
-        }
-        tmp_types->next = new;
+    if (extinfo_types_count==EXTINFO_TYPES_MAX) {
+        fprintf(stderr, "[extinfo] ERROR: more than %d extinfo types.", EXTINFO_TYPES_MAX);
+        return -1;
     }
-    return 0;
+    /* set values, slots are given in the order of registration: */
+    new = &extinfo_types[extinfo_types_count];
+    new->handler_free = handler_free;
+    new->handler_print = handler_print;
+    new->handler_xml_load = handler_xml_load;
+    new->handler_xml_save = handler_xml_save;
+    strlcpy(new->name, name, EXTINFO_NAME_SIZE);
+    new->slot = extinfo_types_count;
+    extinfo_types_count++;
+    return new->slot;
 }
 
 void extinfo_type_list_free() {
-    while (extinfo_types!=NULL) {
-        struct extinfo_type_list* current = extinfo_types;
-        extinfo_types = extinfo_types->next;
-        free(current);
-    }
+    memset(extinfo_types, 0, sizeof(extinfo_types));
+    extinfo_types_count = 0;
 }
 
 const struct extinfo_type* extinfo_type_list_get(const char* const name) {
-    struct extinfo_type_list* tmp_types=extinfo_types;
+    int slot;
 
-    while (tmp_types!=NULL) {
-        if (strncmp(tmp_types->entry.name, name, EXTINFO_NAME_SIZE)==0) {
-            return &tmp_types->entry;
+    for (slot=0; slot<extinfo_types_count; slot++) {
+        if (strncmp(extinfo_types[slot].name, name, EXTINFO_NAME_SIZE)==0) {
+            return &extinfo_types[slot];
         }
-        tmp_types = tmp_types->next;
     }
     return NULL;
 }
 
+int extinfo_type_slot(const char* const name) {
+    const struct extinfo_type* type = extinfo_type_list_get(name);
+
+    return type!=NULL ? type->slot : -1;
+}
+
 void extinfo_list_free(struct extinfo_list** list) {
+    unsigned int i;
 
-    while ((*list)!=NULL) {
-        struct extinfo_list* current = *list;
-        *list = (*list)->next;
-        (current->type->handler_free)(&current->data);
-        free(current);
+    if ((*list)==NULL) {
+        return;
     }
+    for (i=0; i<(*list)->count; i++) {
+        const int slot = (*list)->order[i];
+
+        (extinfo_types[slot].handler_free)(&(*list)->data[slot]);
+    }
+    free(*list);
+    *list = NULL;
 }
 
 void* extinfo_list_get_data(const struct extinfo_list* list, const char* const type_name) {
+    const int slot = extinfo_type_slot(type_name);
 
-    while (list!=NULL) {
-        if (strncmp(list->type->name, type_name, EXTINFO_NAME_SIZE)==0) {
-            return list->data;
-        }
-        list = list->next;
-    }
-    return NULL;
+    return slot!=-1 ? extinfo_list_get(list, slot) : NULL;
 }
 
 int extinfo_list_load(xmlNodePtr element, struct extinfo_list** extinfo) {
@@ -101,7 +92,7 @@ int extinfo_list_load(xmlNodePtr element, struct extinfo_list** extinfo) {
                 fprintf(stderr, "[probes] ERROR: While loading extinfo tag %s\n", (char*) extinfo_element->name);
                 return -1;
             }
-            if (extinfo_list_set(extinfo, (char*) extinfo_element->name, extinfo_data)==-1) {
+            if (extinfo_list_set_slot(extinfo, extinfo_type->slot, extinfo_data)==-1) {
                 fprintf(stderr, "[probes] ERROR: While set extinfo for tag %s\n", (char*) extinfo_element->name);
                 return -1;
             }
@@ -112,70 +103,67 @@ int extinfo_list_load(xmlNodePtr element, struct extinfo_list** extinfo) {
 }
 
 void extinfo_list_print(const struct extinfo_list* list) {
+    unsigned int i;
+
+    if (list==NULL) {
+        return;
+    }
+    for (i=0; i<list->count; i++) {
+        const int slot = list->order[i];
 
-    while (list!=NULL) {
-        if (list->type->handler_print!=NULL) {
-            (list->type->handler_print)(list->data);
+        if (extinfo_types[slot].handler_print!=NULL) {
+            (extinfo_types[slot].handler_print)(list->data[slot]);
         }
-        list = list->next;
     }
 }
 
 int extinfo_list_set(struct extinfo_list** list,
         const char* const type_name, void* data) {
-    struct extinfo_list* tmp_list = *list;
-    struct extinfo_list* new;
-    const struct extinfo_type* tmp_type;
-
-    while (tmp_list!=NULL) {
-        if (strncmp(tmp_list->type->name, type_name, EXTINFO_NAME_SIZE)==0) {
-            tmp_list->data = data;
-            return 0;
-        }
-        tmp_list = tmp_list->next;
+    const int slot = extinfo_type_slot(type_name);
+
+    if (slot==-1) {
+        fprintf(stderr, "[extinfo] ERROR: Tried setting a not registered extinfo type.");
+        return -1;
     }
-    /* entry must be created: */
-    tmp_type = extinfo_type_list_get(type_name);
-    if (tmp_type==NULL) {
+    return extinfo_list_set_slot(list, slot, data);
+}
+
+int extinfo_list_set_slot(struct extinfo_list** list, int slot, void* data) {
+
+    if (slot<0 || slot>=extinfo_types_count) {
         fprintf(stderr, "[extinfo] ERROR: Tried setting a not registered extinfo type.");
         return -1;
     }
-    /* type exists: */
-    if ((new=malloc(sizeof(struct extinfo_list)))==NULL) {
-        perror("malloc");
+    if ((*list)==NULL && ((*list)=calloc(1, sizeof(struct extinfo_list)))==NULL) {
+        perror("calloc");
         return -1;
     }
-    new->data = data;
-    new->type = tmp_type;
-    new->next = NULL;
-    if ((*list)==NULL) {
-        /* empty list: entry is the new list: */
-        *list = new;
-    } else {
-        /* else walk to the end of the list and append: */
-        tmp_list = *list;
-        while (tmp_list->next != NULL) {
-            tmp_list = tmp_list->next;
-        }
-        tmp_list->next = new;
+    if (((*list)->set & (UINT32_C(1)<<slot))==0) {
+        /* new entry, remember the order for saving and printing: */
+        (*list)->set |= UINT32_C(1)<<slot;
+        (*list)->order[(*list)->count++] = (uint8_t)slot;
     }
+    (*list)->data[slot] = data;
     return 0;
 }
 
 
 int extinfo_list_save(xmlNodePtr element, const struct extinfo_list* extinfo) {
+    unsigned int i;
 
-    while (extinfo!=NULL) {
-        const struct extinfo_type* const extinfo_type = extinfo->type;
+    if (extinfo==NULL) {
+        return 0;
+    }
+    for (i=0; i<extinfo->count; i++) {
+        const struct extinfo_type* const extinfo_type = &extinfo_types[extinfo->order[i]];
         xmlNodePtr extinfo_element = xmlNewChild(element, NULL, BAD_CAST extinfo_type->name, NULL);
 
-        if (extinfo_type->handler_xml_save!=NULL && ((extinfo_type->handler_xml_save)(extinfo_element, extinfo->data)==-1)) {
+        if (extinfo_type->handler_xml_save!=NULL && ((extinfo_type->handler_xml_save)(extinfo_element, extinfo->data[extinfo_type->slot])==-1)) {
             fprintf(stderr,
                     "[probes] ERROR: Could not save extinfo information %s.\n",
                     extinfo_type->name);
             return -1;
         }
-        extinfo = extinfo->next;
     }
     return 0;
 }
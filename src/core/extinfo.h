@@ -6,14 +6,17 @@
  *  Extension information is used by plugins to store values in the
  *  core data structures (for instance the neighbor list).
  *
- *  Extinfo types are only identified by a string which must match the name
+ *  Extinfo types are identified by a string which must match the name
  *  of XML elements in the configuration (or in the neighbor cache) that carry
- *  such information.
+ *  such information. At registration a type is given a slot, the index of its
+ *  value in every extinfo list, so that code looking values up per packet
+ *  can use extinfo_list_get() instead of the lookups by name.
  *
  *  Plugins using extinfo values must take care to cast the void* <B>data</B>
  *  pointer value according to the type they deal with.
  */
 
+#include <stdint.h>
 #include <string.h>
 #include <libxml/tree.h>
 
@@ -21,6 +24,10 @@
  */
 #define EXTINFO_NAME_SIZE 100
 
+/** Maximum number of extinfo types (the slots of an extinfo list).
+ */
+#define EXTINFO_TYPES_MAX 32
+
 /** Type for a handler that frees the data of an extinfo value.
  *  <B>data</B> points to the data of the extension
  *  information value and should be set to NULL if the data was freed.
@@ -59,41 +66,34 @@ struct extinfo_type {
     handler_xml_load_t handler_xml_load;
     /** See @ref handler_xml_save_t.*/
     handler_xml_save_t handler_xml_save;
-
+    /** Slot of the values of this type in the extinfo lists. */
+    int slot;
 };
 
-/** A list holding possible extinfo types.
- *  This list type has a nested entry field only to prevent publishing
- *  the <B>next</B> field to plugins dealing with their extinfo types.
+/** The extinfo values of a probe, a neighbor or the settings. Allocated
+ *  when the first value is set, an empty list is NULL.
  */
-struct extinfo_type_list {
-    /** This list entry. */
-    struct extinfo_type entry;
-    /** Pointer to the next list entry.*/
-    struct extinfo_type_list* next;
-};
-
-/** A list holding extinfo values.*/
 struct extinfo_list {
-    /** The type of this extinfo value. */
-    const struct extinfo_type* type;
-    /** (Pointer to) the data of this extinfo value. */
-    void* data;
-    /** The next list entry.*/
-    struct extinfo_list* next;
+    /** (Pointers to) the data of the values, by the slot of their type. */
+    void* data[EXTINFO_TYPES_MAX];
+    /** Bit i is set if the value of slot i is set (its data may be NULL). */
+    uint32_t set;
+    /** Slots of the values set, in the order they were set. */
+    uint8_t order[EXTINFO_TYPES_MAX];
+    /** Number of values set. */
+    unsigned int count;
 };
 
 /** Adds an extinfo type to the list of possible types.
  *  The name must not already exist in the list, else adding the type fails.
- *  @param type The type.
- *  @return     0 on success, -1 otherwise.
+ *  @return     The slot of the type on success, -1 otherwise.
  */
 int extinfo_type_list_add(const char* const name, handler_free_t handler_free,
         handler_print_t handler_print,
         handler_xml_load_t handler_xml_load,
         handler_xml_save_t handler_xml_save);
 
-/** Frees an extinfo type list, does not free the list entries.*/
+/** Frees an extinfo type list, does not free the extinfo lists.*/
 void extinfo_type_list_free();
 
 /** Retrieves a extinfo type structure for a given name. Is internally needed
@@ -109,6 +109,21 @@ const struct extinfo_type* extinfo_type_list_get(const char* const name);
  */
 void extinfo_list_free(struct extinfo_list** list);
 
+/** Gets the slot of an extinfo type.
+ *  @param name The name of the type.
+ *  @return     The slot or -1 if the type is not registered.
+ */
+int extinfo_type_slot(const char* const name);
+
+/** Gets the value of the given slot in a list.
+ *  @param list The list to be used.
+ *  @param slot The slot of the type, as returned by extinfo_type_list_add().
+ *  @return Pointer to the data or NULL if not set.
+ */
+static inline void* extinfo_list_get(const struct extinfo_list* list, int slot) {
+    return list!=NULL ? list->data[slot] : NULL;
+}
+
 /** Gets the entry in the given list that is of the specified type.
  *  @param list      The list to be used.
  *  @param type_name The type to be searched.
@@ -141,6 +156,14 @@ void extinfo_list_print(const struct extinfo_list* list);
 int extinfo_list_set(struct extinfo_list** list,
         const char* const type_name, void* data);
 
+/** Sets the value of the given slot in a list, see extinfo_list_set().
+ *  @param list Pointer to the list holding this extinfo (call by reference).
+ *  @param slot The slot of the type, as returned by extinfo_type_list_add().
+ *  @param data The data to be added.
+ *  @return     0 on success, -1 otherwise.
+ */
+int extinfo_list_set_slot(struct extinfo_list** list, int slot, void* data);
+
 /** Saves all entries of the given extinfo value list as children of a XML
  *  element.
  *  @param element The XML element to add the information to.
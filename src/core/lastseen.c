@@ -0,0 +1,328 @@
+#include "lastseen.h"
+
+/* A mark taken over by the merge. */
+struct lastseen_entry {
+    struct lastseen_mark mark;
+    /* set by neighbor_seen(), the alert is raised once the probe is unlocked: */
+    int inactive;
+    struct ether_addr mac;
+    struct in6_addr lla;
+};
+
+static struct lastseen_buffer* lastseen_buffers = NULL;
+static pthread_key_t lastseen_key;
+static pthread_once_t lastseen_key_once = PTHREAD_ONCE_INIT;
+static __thread struct lastseen_buffer* lastseen_current = NULL;
+/* increased by every merge, a thread records a mark once per merge (0 for unused filter entries): */
+static uint64_t lastseen_epoch = 1;
+
+static pthread_mutex_t lastseen_merge_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct lastseen_entry* lastseen_entries = NULL;
+static size_t lastseen_entries_size = 0;
+
+static int lastseen_interval = LASTSEEN_INTERVAL;
+static int lastseen_running = 0;
+static int lastseen_started = 0;
+static pthread_mutex_t lastseen_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t lastseen_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t lastseen_thread;
+
+/* Leaves the buffer of an exiting thread to the next new thread. */
+static void lastseen_buffer_release(void* buffer) {
+    __atomic_store_n(&((struct lastseen_buffer*)buffer)->owned, 0, __ATOMIC_RELEASE);
+}
+
+static void lastseen_key_create() {
+    pthread_key_create(&lastseen_key, lastseen_buffer_release);
+}
+
+/* Gets the buffer of the current thread, takes one over or creates it on first use. */
+static struct lastseen_buffer* lastseen_buffer_get() {
+    struct lastseen_buffer* buffer = lastseen_current;
+    int expected;
+
+    if (buffer!=NULL) {
+        return buffer;
+    }
+    pthread_once(&lastseen_key_once, lastseen_key_create);
+    for (buffer=__atomic_load_n(&lastseen_buffers, __ATOMIC_ACQUIRE); buffer!=NULL; buffer=buffer->next) {
+        expected = 0;
+        if (__atomic_compare_exchange_n(&buffer->owned, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    if (buffer==NULL) {
+        if ((buffer=calloc(1, sizeof(struct lastseen_buffer)))==NULL) {
+            perror("[lastseen] calloc failed");
+            return NULL;
+        }
+        buffer->owned = 1;
+        buffer->next = __atomic_load_n(&lastseen_buffers, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&lastseen_buffers, &buffer->next, buffer, 0,
+                __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+    pthread_setspecific(lastseen_key, buffer);
+    lastseen_current = buffer;
+    return buffer;
+}
+
+static unsigned int lastseen_filter_index(const neighbor_list_t* neighbor, const struct in6_addr* address) {
+    uint64_t hash = (uint64_t)(uintptr_t)neighbor;
+    uint64_t interface_id;
+
+    if (address!=NULL) {
+        memcpy(&interface_id, &address->s6_addr[8], sizeof(uint64_t));
+        hash ^= interface_id;
+    }
+    hash *= 0x9E3779B97F4A7C15ULL;
+    /* the first entry of the set: */
+    return (unsigned int)(hash>>32) & (LASTSEEN_FILTER_SIZE-2);
+}
+
+/* Tells if an entry of the filter holds a mark. */
+static int lastseen_filter_match(const struct lastseen_buffer* buffer, unsigned int index,
+        const neighbor_list_t* neighbor, const struct in6_addr* address, uint64_t epoch) {
+    return buffer->filter[index].neighbor==neighbor && buffer->filter[index].epoch==epoch
+            && ((address==NULL) ? IN6_IS_ADDR_UNSPECIFIED(&buffer->filter[index].address)
+                    : IN6_ARE_ADDR_EQUAL(address, &buffer->filter[index].address));
+}
+
+void lastseen_mark(struct probe* probe, const neighbor_list_t* neighbor, const struct in6_addr* address) {
+    uint64_t epoch = __atomic_load_n(&lastseen_epoch, __ATOMIC_RELAXED);
+    struct lastseen_buffer* buffer;
+    struct lastseen_mark* mark;
+    unsigned int index;
+    uint32_t head;
+
+    if (neighbor==NULL || (buffer=lastseen_buffer_get())==NULL) {
+        return;
+    }
+    index = lastseen_filter_index(neighbor, address);
+    if (lastseen_filter_match(buffer, index, neighbor, address, epoch)
+            || lastseen_filter_match(buffer, index+1, neighbor, address, epoch)) {
+        /* recorded since the last merge already: */
+        return;
+    }
+    head = buffer->head;
+    if (head-__atomic_load_n(&buffer->tail, __ATOMIC_ACQUIRE)>=LASTSEEN_BUFFER_SIZE) {
+        /* full until the next merge, the next frame of the neighbor records it: */
+        return;
+    }
+    mark = &buffer->marks[head & (LASTSEEN_BUFFER_SIZE-1)];
+    mark->probe = probe;
+    mark->neighbor = (neighbor_list_t*) neighbor;
+    mark->has_address = (address!=NULL);
+    if (address!=NULL) {
+        memcpy(&mark->address, address, sizeof(struct in6_addr));
+    }
+    mark->seen = time(NULL);
+    __atomic_store_n(&buffer->head, head+1, __ATOMIC_RELEASE);
+
+    /* replace the entry of the set recorded in an older merge: */
+    if (buffer->filter[index].epoch==epoch && buffer->filter[index+1].epoch!=epoch) {
+        index++;
+    }
+    buffer->filter[index].neighbor = neighbor;
+    buffer->filter[index].epoch = epoch;
+    if (address!=NULL) {
+        memcpy(&buffer->filter[index].address, address, sizeof(struct in6_addr));
+    } else {
+        memset(&buffer->filter[index].address, 0, sizeof(struct in6_addr));
+    }
+}
+
+/* Takes the marks of all threads over, returns their number. */
+static size_t lastseen_drain() {
+    struct lastseen_buffer* buffer;
+    struct lastseen_entry* entries;
+    size_t count = 0;
+    uint32_t head;
+    uint32_t tail;
+
+    for (buffer=__atomic_load_n(&lastseen_buffers, __ATOMIC_ACQUIRE); buffer!=NULL; buffer=buffer->next) {
+        tail = buffer->tail;
+        head = __atomic_load_n(&buffer->head, __ATOMIC_ACQUIRE);
+        while (tail!=head) {
+            if (count==lastseen_entries_size) {
+                size_t size = (lastseen_entries_size==0) ? LASTSEEN_BUFFER_SIZE : 2*lastseen_entries_size;
+
+                if ((entries=realloc(lastseen_entries, size*sizeof(struct lastseen_entry)))==NULL) {
+                    /* the remaining marks are left to the next merge: */
+                    perror("[lastseen] realloc failed");
+                    break;
+                }
+                lastseen_entries = entries;
+                lastseen_entries_size = size;
+            }
+            memcpy(&lastseen_entries[count].mark, &buffer->marks[tail & (LASTSEEN_BUFFER_SIZE-1)],
+                    sizeof(struct lastseen_mark));
+            lastseen_entries[count].inactive = 0;
+            count++;
+            tail++;
+        }
+        __atomic_store_n(&buffer->tail, tail, __ATOMIC_RELEASE);
+    }
+    return count;
+}
+
+/* Merges the marks of a probe, locks it if there are any. */
+static void lastseen_merge_probe(struct probe* probe, size_t count) {
+    struct probe* locked_probe = NULL;
+    struct lastseen_entry* entry;
+    size_t i;
+
+    for (i=0; i<count; i++) {
+        entry = &lastseen_entries[i];
+        if (entry->mark.probe!=probe) {
+            continue;
+        }
+        if (locked_probe==NULL) {
+            /* critical section: */
+            locked_probe = probe_handle_lock(probe);
+        }
+        entry->inactive = neighbor_seen(entry->mark.neighbor,
+                entry->mark.has_address ? &entry->mark.address : NULL, entry->mark.seen);
+        if (entry->inactive) {
+            memcpy(&entry->mac, &entry->mark.neighbor->mac, sizeof(struct ether_addr));
+            memcpy(&entry->lla, &entry->mark.neighbor->lla, sizeof(struct in6_addr));
+        }
+    }
+    if (locked_probe!=NULL) {
+        probe_handle_unlock(probe);
+        /* end critical section. */
+    }
+}
+
+void lastseen_merge() {
+    struct probe_list** locked_probes;
+    struct probe_list* tmp_probes;
+    struct lastseen_entry* entry;
+    char buffer[NOTIFY_BUFFER_SIZE];
+    char str_ip[INET6_ADDRSTRLEN];
+    size_t count;
+    size_t i;
+
+    pthread_mutex_lock(&lastseen_merge_lock);
+    __atomic_add_fetch(&lastseen_epoch, 1, __ATOMIC_RELAXED);
+    if ((count=lastseen_drain())==0) {
+        pthread_mutex_unlock(&lastseen_merge_lock);
+        return;
+    }
+
+    /* critical section: */
+    locked_probes = probe_list_lock();
+    /* copy the probe list (entries are never removed while running) */
+    tmp_probes = *locked_probes;
+    probe_list_unlock();
+    /* end critical section. */
+
+    while (tmp_probes!=NULL) {
+        lastseen_merge_probe(&tmp_probes->entry, count);
+        tmp_probes = tmp_probes->next;
+    }
+
+    for (i=0; i<count; i++) {
+        entry = &lastseen_entries[i];
+        if (!entry->inactive) {
+            continue;
+        }
+        inet_ntop(AF_INET6, &entry->lla, str_ip, INET6_ADDRSTRLEN);
+        snprintf(buffer, NOTIFY_BUFFER_SIZE, "new activity from: %s %s", ether_ntoa(&entry->mac), str_ip);
+        alert_raise(1, entry->mark.probe, "new activity", buffer, &entry->mac, NULL, &entry->lla, NULL);
+    }
+    pthread_mutex_unlock(&lastseen_merge_lock);
+}
+
+static void* lastseen_run(void* unused) {
+    struct timespec wakeup;
+
+    pthread_mutex_lock(&lastseen_lock);
+    while (lastseen_running) {
+        clock_gettime(CLOCK_REALTIME, &wakeup);
+        wakeup.tv_sec += lastseen_interval;
+        /* wait out the interval unless stopped: */
+        while (lastseen_running
+                && pthread_cond_timedwait(&lastseen_cond, &lastseen_lock, &wakeup)!=ETIMEDOUT) {
+        }
+        pthread_mutex_unlock(&lastseen_lock);
+        lastseen_merge();
+        pthread_mutex_lock(&lastseen_lock);
+    }
+    pthread_mutex_unlock(&lastseen_lock);
+    return NULL;
+}
+
+int lastseen_start() {
+    struct extinfo_list** extinfo;
+    struct lastseen_settings* configured;
+
+    extinfo = settings_extinfo_lock();
+    configured = extinfo_list_get_data(*extinfo, "lastseen");
+    if (configured!=NULL) {
+        lastseen_interval = configured->interval;
+    }
+    settings_extinfo_unlock();
+
+    lastseen_running = 1;
+    if (pthread_create(&lastseen_thread, NULL, lastseen_run, NULL)!=0) {
+        perror("[lastseen] pthread_create failed");
+        lastseen_running = 0;
+        return -1;
+    }
+    lastseen_started = 1;
+    return 0;
+}
+
+void lastseen_stop() {
+    struct lastseen_buffer* buffer;
+
+    if (lastseen_started) {
+        pthread_mutex_lock(&lastseen_lock);
+        lastseen_running = 0;
+        pthread_cond_signal(&lastseen_cond);
+        pthread_mutex_unlock(&lastseen_lock);
+        pthread_join(lastseen_thread, NULL);
+        lastseen_started = 0;
+    }
+    lastseen_merge();
+
+    pthread_mutex_lock(&lastseen_merge_lock);
+    while ((buffer=lastseen_buffers)!=NULL) {
+        lastseen_buffers = buffer->next;
+        free(buffer);
+    }
+    free(lastseen_entries);
+    lastseen_entries = NULL;
+    lastseen_entries_size = 0;
+    pthread_mutex_unlock(&lastseen_merge_lock);
+}
+
+int lastseen_settings_load(xmlNodePtr element, void** data) {
+    struct lastseen_settings* settings;
+
+    if ((settings=malloc(sizeof(struct lastseen_settings)))==NULL) {
+        perror("[lastseen] malloc failed.\n");
+        exit(1);
+    }
+    settings->interval = LASTSEEN_INTERVAL;
+    if (settings_get_int(element, "interval", &settings->interval, 1, 3600)==-1) {
+        free(settings);
+        return -1;
+    }
+    *data = settings;
+    return 0;
+}
+
+void lastseen_settings_print(void* data) {
+    struct lastseen_settings* settings = (struct lastseen_settings*) data;
+
+    fprintf(stderr, "[lastseen] timers merged every %i s\n", settings->interval);
+}
+
+int lastseen_settings_save(xmlNodePtr element, void* data) {
+    struct lastseen_settings* settings = (struct lastseen_settings*) data;
+
+    settings_set_int(element, "interval", settings->interval);
+    return 0;
+}
@@ -0,0 +1,130 @@
+#ifndef _LASTSEEN_H_
+#define _LASTSEEN_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <libxml/tree.h>
+
+#include "../membounds.h"
+#include "ndpmon_defs.h"
+
+#include "alerts.h"
+#include "cache_types.h"
+#include "extinfo.h"
+#include "neighbors.h"
+#include "probes.h"
+#include "settings.h"
+
+/** @file
+ *  Batched updates of the lastseen timers of the neighbors.
+ *
+ *  The analysis threads do not write the timers of the neighbors they see
+ *  a frame from. They record a mark (the neighbor and, for a global address,
+ *  the address) with lastseen_mark() in a ring of their own, which takes no
+ *  lock: only the thread writes its head, only the merging thread its tail.
+ *  A thread records the same mark once per merge interval.
+ *
+ *  The marks are merged into the neighbor caches every interval by a thread
+ *  of this module, which locks each probe once per merge, and by
+ *  lastseen_merge() before the caches are saved or exported. The merge
+ *  raises the "new activity" alert of neighbors that have been inactive for
+ *  long (see neighbor_seen()). The timers are thus up to an interval late.
+ *
+ *  Marks refer to the neighbors by their cache entry, as neighbors are never
+ *  removed from the cache of a probe while running.
+ *
+ *  The interval is given by the lastseen element of the settings, for
+ *  instance
+ *  \verbatim <lastseen interval="5"/> \endverbatim
+ */
+
+/** Default seconds between two merges. */
+#define LASTSEEN_INTERVAL 5
+/** Marks a thread can hold between two merges (a power of two), further marks are left to the next frames. */
+#define LASTSEEN_BUFFER_SIZE 1024
+/** Marks a thread remembers to record each mark once per interval (a power of two, in sets of two). */
+#define LASTSEEN_FILTER_SIZE 1024
+
+/** Settings of the lastseen merge (extinfo type "lastseen"). */
+struct lastseen_settings {
+    /** Seconds between two merges. */
+    int interval;
+};
+
+/** A neighbor seen by an analysis thread. */
+struct lastseen_mark {
+    struct probe* probe;
+    neighbor_list_t* neighbor;
+    /** 1 if the global address below was seen too. */
+    int has_address;
+    struct in6_addr address;
+    /** When it was seen. */
+    time_t seen;
+};
+
+/** Marks recorded by an analysis thread. */
+struct lastseen_buffer {
+    struct lastseen_mark marks[LASTSEEN_BUFFER_SIZE];
+    /** Next mark written, by the owning thread. */
+    uint32_t head __attribute__ ((aligned (64)));
+    /** Next mark merged, by the merging thread. */
+    uint32_t tail __attribute__ ((aligned (64)));
+    /** 1 while a thread records into the buffer, a new thread may take it over otherwise. */
+    int owned;
+    /** Merge a mark of the filter was last recorded in, private to the owning thread. */
+    struct {
+        const neighbor_list_t* neighbor;
+        struct in6_addr address;
+        uint64_t epoch;
+    } filter[LASTSEEN_FILTER_SIZE];
+    struct lastseen_buffer* next;
+};
+
+/** Starts the thread merging the marks.
+ *  @return 0 on success, -1 otherwise.
+ */
+int lastseen_start();
+
+/** Merges the remaining marks, stops the merging thread and releases the
+ *  buffers of the threads. The capture must be stopped.
+ */
+void lastseen_stop();
+
+/** Records that a neighbor was seen now. Takes no lock.
+ *  @param probe    The probe the neighbor was seen on.
+ *  @param neighbor The neighbor, nothing is recorded if NULL.
+ *  @param address  A global address of the neighbor that was seen, or NULL.
+ */
+void lastseen_mark(struct probe* probe, const neighbor_list_t* neighbor, const struct in6_addr* address);
+
+/** Merges the marks of all threads into the neighbor caches. Locks the
+ *  probes one after the other, the caller must not hold a probe lock.
+ */
+void lastseen_merge();
+
+/** Loads the lastseen settings from a XML element.
+ *  @param element The XML element.
+ *  @param data    Will hold the settings (call by reference).
+ *  @return        0 on success, -1 otherwise.
+ */
+int lastseen_settings_load(xmlNodePtr element, void** data);
+
+/** Prints the lastseen settings.
+ *  @param data The settings.
+ */
+void lastseen_settings_print(void* data);
+
+/** Saves the lastseen settings to a XML element.
+ *  @param element The XML element.
+ *  @param data    The settings.
+ *  @return        0 on success, -1 otherwise.
+ */
+int lastseen_settings_save(xmlNodePtr element, void* data);
+
+#endif
@@ -0,0 +1,300 @@
+#include "logging.h"
+
+/** Bytes the logger thread collects before writing them to stderr. */
+#define LOGGING_BATCH_SIZE 16384
+
+/** A message slot of the ring. */
+struct logging_slot {
+    /* the position the slot is free for, or that position+1 once written: */
+    uint64_t sequence;
+    char text[LOGGING_MESSAGE_SIZE];
+};
+
+int logging_levels[LOGGING_SUBSYSTEMS] = {
+    LOGGING_DEFAULT_LEVEL, LOGGING_DEFAULT_LEVEL, LOGGING_DEFAULT_LEVEL,
+    LOGGING_DEFAULT_LEVEL, LOGGING_DEFAULT_LEVEL
+};
+
+static const char* logging_level_names[] = {
+    "error", "warning", "notice", "info", "debug", "trace"
+};
+
+static const char* logging_subsystem_names[LOGGING_SUBSYSTEMS] = {
+    "core", "capture", "watch", "cache", "plugins"
+};
+
+static struct logging_slot logging_ring[LOGGING_RING_SLOTS];
+/* next position to write, shared by the producers: */
+static uint64_t logging_head __attribute__ ((aligned (64))) = 0;
+/* next position to read, owned by the logger thread: */
+static uint64_t logging_tail __attribute__ ((aligned (64))) = 0;
+static uint64_t logging_dropped = 0;
+static uint64_t logging_dropped_reported = 0;
+/* set while messages go through the ring: */
+static int logging_running = 0;
+/* number of threads between the check of logging_running and their push: */
+static int logging_writers = 0;
+/* set while the logger thread is about to sleep: */
+static int logging_waiting = 0;
+static pthread_mutex_t logging_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t logging_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t logging_thread;
+
+extern int DEBUG;
+
+/* Copies a message into the ring, returns -1 if the ring is full. */
+static int logging_push(const char* text) {
+    uint64_t position = __atomic_load_n(&logging_head, __ATOMIC_RELAXED);
+    struct logging_slot* slot;
+
+    while (1) {
+        int64_t difference;
+
+        slot = &logging_ring[position & (LOGGING_RING_SLOTS-1)];
+        difference = (int64_t)(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - position);
+        if (difference==0) {
+            /* the slot is free, claim it (position is reloaded on failure): */
+            if (__atomic_compare_exchange_n(&logging_head, &position, position+1, 1,
+                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (difference<0) {
+            /* the slot still holds a message one round behind: */
+            return -1;
+        } else {
+            position = __atomic_load_n(&logging_head, __ATOMIC_RELAXED);
+        }
+    }
+    strlcpy(slot->text, text, LOGGING_MESSAGE_SIZE);
+    /* publish the slot: */
+    __atomic_store_n(&slot->sequence, position+1, __ATOMIC_SEQ_CST);
+    /* the logger thread announces that it is going to sleep: */
+    if (__atomic_load_n(&logging_waiting, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&logging_lock);
+        pthread_cond_signal(&logging_cond);
+        pthread_mutex_unlock(&logging_lock);
+    }
+    return 0;
+}
+
+/* Tells if the next slot to read is written. */
+static int logging_available() {
+    struct logging_slot* slot = &logging_ring[logging_tail & (LOGGING_RING_SLOTS-1)];
+
+    return __atomic_load_n(&slot->sequence, __ATOMIC_SEQ_CST)==logging_tail+1;
+}
+
+/* Writes the messages waiting in the ring, returns their number. */
+static int logging_drain() {
+    static char batch[LOGGING_BATCH_SIZE];
+    size_t length = 0;
+    uint64_t dropped;
+    int count = 0;
+
+    while (logging_available()) {
+        struct logging_slot* slot = &logging_ring[logging_tail & (LOGGING_RING_SLOTS-1)];
+        size_t text_length = strlen(slot->text);
+
+        if (length+text_length>LOGGING_BATCH_SIZE) {
+            fwrite(batch, 1, length, stderr);
+            length = 0;
+        }
+        memcpy(batch+length, slot->text, text_length);
+        length += text_length;
+        /* give the slot back for the next round: */
+        __atomic_store_n(&slot->sequence, logging_tail+LOGGING_RING_SLOTS, __ATOMIC_RELEASE);
+        logging_tail++;
+        count++;
+    }
+    if (length>0) {
+        fwrite(batch, 1, length, stderr);
+    }
+    dropped = __atomic_load_n(&logging_dropped, __ATOMIC_RELAXED);
+    if (dropped!=logging_dropped_reported) {
+        fprintf(stderr, "[logging] %llu messages dropped, the ring was full.\n",
+                (unsigned long long)(dropped-logging_dropped_reported));
+        logging_dropped_reported = dropped;
+    }
+    return count;
+}
+
+static void* logging_run(void* unused) {
+    sigset_t signals;
+    int running = 1;
+
+    /* signals are handled by the main thread: */
+    sigfillset(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    while (running) {
+        if (logging_drain()>0) {
+            continue;
+        }
+        pthread_mutex_lock(&logging_lock);
+        __atomic_store_n(&logging_waiting, 1, __ATOMIC_SEQ_CST);
+        if (!logging_available() && logging_running) {
+            pthread_cond_wait(&logging_cond, &logging_lock);
+        }
+        __atomic_store_n(&logging_waiting, 0, __ATOMIC_SEQ_CST);
+        running = logging_running;
+        pthread_mutex_unlock(&logging_lock);
+    }
+    logging_drain();
+    return NULL;
+}
+
+void logging_write(enum logging_subsystem subsystem, enum logging_level level, const char* format, ...) {
+    char text[LOGGING_MESSAGE_SIZE];
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(text, LOGGING_MESSAGE_SIZE, format, args);
+    va_end(args);
+    /* announced before the check, logging_stop() waits for the push: */
+    __atomic_fetch_add(&logging_writers, 1, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&logging_running, __ATOMIC_SEQ_CST)) {
+        fputs(text, stderr);
+    } else if (logging_push(text)==-1) {
+        __atomic_fetch_add(&logging_dropped, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_sub(&logging_writers, 1, __ATOMIC_RELEASE);
+}
+
+int logging_ratelimit(struct logging_ratelimit* limit) {
+    time_t now = time(NULL);
+
+    if (__atomic_load_n(&limit->second, __ATOMIC_RELAXED)!=now) {
+        /* a new second, racing call sites may both reset the count: */
+        __atomic_store_n(&limit->second, now, __ATOMIC_RELAXED);
+        __atomic_store_n(&limit->count, 0, __ATOMIC_RELAXED);
+    }
+    return __atomic_fetch_add(&limit->count, 1, __ATOMIC_RELAXED)<LOGGING_RATELIMIT_BURST;
+}
+
+void logging_set_level(enum logging_level level) {
+    int i;
+
+    for (i=0; i<LOGGING_SUBSYSTEMS; i++) {
+        __atomic_store_n(&logging_levels[i], (int)level, __ATOMIC_RELAXED);
+    }
+}
+
+int logging_level_parse(const char* name) {
+    int level;
+
+    for (level=LOGGING_LEVEL_ERROR; level<=LOGGING_LEVEL_TRACE; level++) {
+        if (strcmp(name, logging_level_names[level])==0) {
+            return level;
+        }
+    }
+    return -1;
+}
+
+int logging_start() {
+    struct extinfo_list** extinfo;
+    struct logging_settings* settings;
+    int i;
+
+    extinfo = settings_extinfo_lock();
+    settings = extinfo_list_get_data(*extinfo, "logging");
+    for (i=0; settings!=NULL && i<LOGGING_SUBSYSTEMS; i++) {
+        __atomic_store_n(&logging_levels[i], settings->levels[i], __ATOMIC_RELAXED);
+    }
+    settings_extinfo_unlock();
+    for (i=0; DEBUG && i<LOGGING_SUBSYSTEMS; i++) {
+        if (logging_levels[i]<LOGGING_LEVEL_DEBUG) {
+            __atomic_store_n(&logging_levels[i], LOGGING_LEVEL_DEBUG, __ATOMIC_RELAXED);
+        }
+    }
+    for (i=0; i<LOGGING_RING_SLOTS; i++) {
+        logging_ring[i].sequence = i;
+    }
+    logging_head = 0;
+    logging_tail = 0;
+    __atomic_store_n(&logging_running, 1, __ATOMIC_RELEASE);
+    if (pthread_create(&logging_thread, NULL, logging_run, NULL)!=0) {
+        perror("[logging] pthread_create failed");
+        __atomic_store_n(&logging_running, 0, __ATOMIC_RELEASE);
+        return -1;
+    }
+    return 0;
+}
+
+void logging_stop() {
+    if (!__atomic_load_n(&logging_running, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    pthread_mutex_lock(&logging_lock);
+    /* messages logged from now on are written directly: */
+    __atomic_store_n(&logging_running, 0, __ATOMIC_SEQ_CST);
+    pthread_cond_signal(&logging_cond);
+    pthread_mutex_unlock(&logging_lock);
+    pthread_join(logging_thread, NULL);
+    /* a producer that saw the ring running may still push after the last
+     * drain of the logger thread, wait for it and drain once more: */
+    while (__atomic_load_n(&logging_writers, __ATOMIC_ACQUIRE)!=0) {
+        sched_yield();
+    }
+    logging_drain();
+}
+
+int logging_settings_load(xmlNodePtr element, void** data) {
+    struct logging_settings* settings;
+    xmlChar* value;
+    int level = LOGGING_DEFAULT_LEVEL;
+    int i;
+
+    if ((settings=malloc(sizeof(struct logging_settings)))==NULL) {
+        perror("[logging] malloc failed.\n");
+        exit(1);
+    }
+    /* the level attribute applies to the subsystems without one: */
+    if ((value=xmlGetProp(element, BAD_CAST "level"))!=NULL) {
+        level = logging_level_parse((char*)value);
+        if (level==-1) {
+            fprintf(stderr, "[logging] ERROR: settings: unknown level %s.\n", (char*)value);
+            xmlFree(value);
+            free(settings);
+            return -1;
+        }
+        xmlFree(value);
+    }
+    for (i=0; i<LOGGING_SUBSYSTEMS; i++) {
+        settings->levels[i] = level;
+        if ((value=xmlGetProp(element, BAD_CAST logging_subsystem_names[i]))==NULL) {
+            continue;
+        }
+        settings->levels[i] = logging_level_parse((char*)value);
+        if (settings->levels[i]==-1) {
+            fprintf(stderr, "[logging] ERROR: settings: unknown level %s for %s.\n",
+                    (char*)value, logging_subsystem_names[i]);
+            xmlFree(value);
+            free(settings);
+            return -1;
+        }
+        xmlFree(value);
+    }
+    *data = settings;
+    return 0;
+}
+
+void logging_settings_print(void* data) {
+    struct logging_settings* settings = (struct logging_settings*) data;
+    int i;
+
+    fprintf(stderr, "[logging] levels:");
+    for (i=0; i<LOGGING_SUBSYSTEMS; i++) {
+        fprintf(stderr, " %s=%s", logging_subsystem_names[i], logging_level_names[settings->levels[i]]);
+    }
+    fprintf(stderr, "\n");
+}
+
+int logging_settings_save(xmlNodePtr element, void* data) {
+    struct logging_settings* settings = (struct logging_settings*) data;
+    int i;
+
+    for (i=0; i<LOGGING_SUBSYSTEMS; i++) {
+        xmlNewProp(element, BAD_CAST logging_subsystem_names[i],
+                BAD_CAST logging_level_names[settings->levels[i]]);
+    }
+    return 0;
+}
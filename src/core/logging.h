@@ -0,0 +1,184 @@
+#ifndef _LOGGING_H_
+#define _LOGGING_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+
+#include <libxml/tree.h>
+
+#include "../membounds.h"
+#include "ndpmon_defs.h"
+
+#include "extinfo.h"
+#include "settings.h"
+
+/** @file
+ *  Leveled diagnostic messages with a level per subsystem.
+ *
+ *  A message is formatted by the thread that logs it and copied into a
+ *  bounded multi producer ring, from which a logger thread writes the
+ *  messages to stderr in batches. The capture and analysis threads thus
+ *  never wait for stderr. If the ring is full, the message is dropped and
+ *  counted. Before logging_start() and after logging_stop() the messages
+ *  are written directly.
+ *
+ *  Messages above LOGGING_COMPILED_LEVEL are compiled out, the per packet
+ *  traces are only built with the meson option log_trace. Messages that
+ *  may repeat for every frame use LOGGING_RATELIMITED().
+ *
+ *  The levels are set by the logging element of the settings, e.g.
+ *  \verbatim <logging level="info" capture="debug"/> \endverbatim
+ *  NDPMon -v raises all of them to debug.
+ */
+
+/** Message levels, from the most to the least important. */
+enum logging_level {
+    LOGGING_LEVEL_ERROR,
+    LOGGING_LEVEL_WARNING,
+    LOGGING_LEVEL_NOTICE,
+    LOGGING_LEVEL_INFO,
+    LOGGING_LEVEL_DEBUG,
+    /** One message or more for every frame. */
+    LOGGING_LEVEL_TRACE
+};
+
+/** Subsystems with a level of their own. */
+enum logging_subsystem {
+    /** Startup, settings, events. */
+    LOGGING_CORE,
+    /** Capture and frame decoding. */
+    LOGGING_CAPTURE,
+    /** Watch functions. */
+    LOGGING_WATCH,
+    /** Neighbor cache and router list. */
+    LOGGING_CACHE,
+    /** Plugins. */
+    LOGGING_PLUGINS,
+    LOGGING_SUBSYSTEMS
+};
+
+/** Highest level compiled in. */
+#ifndef LOGGING_COMPILED_LEVEL
+#define LOGGING_COMPILED_LEVEL LOGGING_LEVEL_DEBUG
+#endif
+
+/** Level of the subsystems without a level in the settings. */
+#define LOGGING_DEFAULT_LEVEL LOGGING_LEVEL_INFO
+/** Maximum length of a message, longer messages are cut. */
+#define LOGGING_MESSAGE_SIZE 240
+/** Number of messages the ring holds (a power of two). */
+#define LOGGING_RING_SLOTS 1024
+/** Messages a rate limited call site may log per second. */
+#define LOGGING_RATELIMIT_BURST 10
+
+/** State of a rate limited call site. */
+struct logging_ratelimit {
+    /** The second being counted. */
+    time_t second;
+    /** Messages logged in that second. */
+    int count;
+};
+
+/** Settings of the logging (extinfo type "logging"). */
+struct logging_settings {
+    /** Level of each subsystem. */
+    int levels[LOGGING_SUBSYSTEMS];
+};
+
+/** Current level of each subsystem, read without locking. */
+extern int logging_levels[LOGGING_SUBSYSTEMS];
+
+/** Logs a message if its subsystem's level allows it.
+ *  @param subsystem The subsystem (enum logging_subsystem).
+ *  @param level     The level (enum logging_level).
+ *  @param ...       printf style format and arguments.
+ */
+#define LOGGING(subsystem, level, ...) \
+    do { \
+        if ((level)<=LOGGING_COMPILED_LEVEL && logging_enabled((subsystem), (level))) { \
+            logging_write((subsystem), (level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+/** Like LOGGING(), but at most LOGGING_RATELIMIT_BURST messages per second
+ *  of the call site.
+ */
+#define LOGGING_RATELIMITED(subsystem, level, ...) \
+    do { \
+        static struct logging_ratelimit logging_call_site; \
+        if ((level)<=LOGGING_COMPILED_LEVEL && logging_enabled((subsystem), (level)) \
+                && logging_ratelimit(&logging_call_site)) { \
+            logging_write((subsystem), (level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+/** Tells if a subsystem logs messages of a level.
+ *  @param subsystem The subsystem.
+ *  @param level     The level.
+ *  @return          1 if it does, 0 otherwise.
+ */
+static inline int logging_enabled(enum logging_subsystem subsystem, enum logging_level level) {
+    return (int)level<=__atomic_load_n(&logging_levels[subsystem], __ATOMIC_RELAXED);
+}
+
+/** Logs a message regardless of the levels (use LOGGING()).
+ *  @param subsystem The subsystem.
+ *  @param level     The level.
+ *  @param format    printf style format.
+ */
+void logging_write(enum logging_subsystem subsystem, enum logging_level level, const char* format, ...)
+        __attribute__ ((format (printf, 3, 4)));
+
+/** Counts a message of a rate limited call site.
+ *  @param limit The state of the call site.
+ *  @return      1 if the message may be logged, 0 if it is suppressed.
+ */
+int logging_ratelimit(struct logging_ratelimit* limit);
+
+/** Sets the level of all subsystems.
+ *  @param level The level.
+ */
+void logging_set_level(enum logging_level level);
+
+/** Parses the name of a level.
+ *  @param name The name, e.g. "debug".
+ *  @return     The level or -1 if the name is unknown.
+ */
+int logging_level_parse(const char* name);
+
+/** Applies the levels of the settings and starts the logger thread.
+ *  @return 0 on success, -1 otherwise.
+ */
+int logging_start();
+
+/** Writes the remaining messages and stops the logger thread. */
+void logging_stop();
+
+/** Loads the logging settings from a XML element.
+ *  @param element The logging element.
+ *  @param data    Will hold the settings (call by reference).
+ *  @return        0 on success, -1 on error.
+ */
+int logging_settings_load(xmlNodePtr element, void** data);
+
+/** Prints the logging settings.
+ *  @param data The settings.
+ */
+void logging_settings_print(void* data);
+
+/** Saves the logging settings to a XML element.
+ *  @param element The element to add the attributes to.
+ *  @param data    The settings.
+ *  @return        Always 0.
+ */
+int logging_settings_save(xmlNodePtr element, void* data);
+
+#endif
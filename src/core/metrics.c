@@ -0,0 +1,497 @@
+#include "metrics.h"
+
+/** The counters of a probe, taken once per scrape. */
+struct metrics_probe {
+    const struct probe* probe;
+    struct probe_stats stats;
+    struct capture_stats capture;
+    /* set if the capture monitor collected statistics for the probe: */
+    int has_capture;
+};
+
+static int metrics_fd = -1;
+/* written to by metrics_stop() to wake up the thread: */
+static int metrics_wakeup[2] = { -1, -1 };
+static pthread_t metrics_thread;
+static int metrics_started = 0;
+
+/* Prints the HELP and TYPE lines of a metric family. */
+static void metrics_family(struct text_buffer* buffer, const char* name, const char* type, const char* help) {
+    text_buffer_printf(buffer, "# TYPE %s %s\n# HELP %s %s\n", name, type, name, help);
+}
+
+/* Prints a label value, escaping backslashes, quotes and newlines. */
+static void metrics_label_value(struct text_buffer* buffer, const char* value) {
+    text_buffer_printf(buffer, "\"");
+    while (*value!='\0') {
+        size_t plain = strcspn(value, "\\\"\n");
+
+        text_buffer_printf(buffer, "%.*s", (int)plain, value);
+        value += plain;
+        if (*value=='\n') {
+            text_buffer_printf(buffer, "\\n");
+            value++;
+        } else if (*value!='\0') {
+            text_buffer_printf(buffer, "\\%c", *value);
+            value++;
+        }
+    }
+    text_buffer_printf(buffer, "\"");
+}
+
+/* Prints a sample of a family labelled with the probe only. */
+static void metrics_probe_sample(struct text_buffer* buffer, const char* name,
+        const struct probe* probe, unsigned long long value) {
+    text_buffer_printf(buffer, "%s{probe=", name);
+    metrics_label_value(buffer, probe->name);
+    text_buffer_printf(buffer, "} %llu\n", value);
+}
+
+static const char* metrics_icmp6_type(int type, char* number) {
+    switch (type) {
+        case 0:
+            return "none";
+        case ND_ROUTER_SOLICIT:
+            return "router_solicit";
+        case ND_ROUTER_ADVERT:
+            return "router_advert";
+        case ND_NEIGHBOR_SOLICIT:
+            return "neighbor_solicit";
+        case ND_NEIGHBOR_ADVERT:
+            return "neighbor_advert";
+        case ND_REDIRECT:
+            return "redirect";
+        default:
+            snprintf(number, 4, "%i", type);
+            return number;
+    }
+}
+
+static void metrics_render_packets(struct text_buffer* buffer, const struct metrics_probe* probes, int count) {
+    char number[4];
+    int p, type;
+
+    metrics_family(buffer, "ndpmon_packets", "counter",
+            "Frames analyzed by ICMPv6 type (none for frames of other protocols).");
+    for (p=0; p<count; p++) {
+        for (type=0; type<256; type++) {
+            /* the Neighbor Discovery types are always present: */
+            if (probes[p].stats.packets[type]==0 && (type<ND_ROUTER_SOLICIT || type>ND_REDIRECT)) {
+                continue;
+            }
+            text_buffer_printf(buffer, "ndpmon_packets_total{probe=");
+            metrics_label_value(buffer, probes[p].probe->name);
+            text_buffer_printf(buffer, ",type=\"%s\"} %llu\n", metrics_icmp6_type(type, number),
+                    (unsigned long long)probes[p].stats.packets[type]);
+        }
+    }
+    metrics_family(buffer, "ndpmon_bytes", "counter", "Bytes of the frames analyzed.");
+    for (p=0; p<count; p++) {
+        metrics_probe_sample(buffer, "ndpmon_bytes_total", probes[p].probe, probes[p].stats.bytes);
+    }
+}
+
+static void metrics_render_alerts(struct text_buffer* buffer, const struct metrics_probe* probes, int count) {
+    int reasons = stats_reason_count();
+    int p, i;
+
+    metrics_family(buffer, "ndpmon_alerts", "counter", "Alerts raised by reason.");
+    for (p=0; p<count; p++) {
+        for (i=0; i<reasons; i++) {
+            if (probes[p].stats.alerts[i]==0) {
+                continue;
+            }
+            text_buffer_printf(buffer, "ndpmon_alerts_total{probe=");
+            metrics_label_value(buffer, probes[p].probe->name);
+            text_buffer_printf(buffer, ",reason=");
+            metrics_label_value(buffer, stats_reason_name(i));
+            text_buffer_printf(buffer, "} %llu\n", (unsigned long long)probes[p].stats.alerts[i]);
+        }
+    }
+}
+
+static void metrics_render_caches(struct text_buffer* buffer, const struct metrics_probe* probes, int count) {
+    int p;
+
+    metrics_family(buffer, "ndpmon_neighbors", "gauge", "Entries of the neighbor cache.");
+    for (p=0; p<count; p++) {
+        metrics_probe_sample(buffer, "ndpmon_neighbors", probes[p].probe, probes[p].stats.neighbors);
+    }
+    metrics_family(buffer, "ndpmon_neighbor_addresses", "gauge", "Addresses of the neighbors in the cache.");
+    for (p=0; p<count; p++) {
+        metrics_probe_sample(buffer, "ndpmon_neighbor_addresses", probes[p].probe, probes[p].stats.addresses);
+    }
+    metrics_family(buffer, "ndpmon_routers", "gauge", "Entries of the router list.");
+    for (p=0; p<count; p++) {
+        metrics_probe_sample(buffer, "ndpmon_routers", probes[p].probe, probes[p].stats.routers);
+    }
+}
+
+/* Prints a dropped frames sample of a probe. */
+static void metrics_dropped_sample(struct text_buffer* buffer, const struct probe* probe,
+        const char* cause, uint64_t value) {
+    text_buffer_printf(buffer, "ndpmon_capture_dropped_total{probe=");
+    metrics_label_value(buffer, probe->name);
+    text_buffer_printf(buffer, ",cause=\"%s\"} %llu\n", cause, (unsigned long long)value);
+}
+
+static void metrics_render_capture(struct text_buffer* buffer, const struct metrics_probe* probes, int count) {
+    int p;
+
+    metrics_family(buffer, "ndpmon_capture_received", "counter",
+            "Frames that reached the capture, the dropped ones included.");
+    for (p=0; p<count; p++) {
+        if (probes[p].has_capture) {
+            metrics_probe_sample(buffer, "ndpmon_capture_received_total", probes[p].probe, probes[p].capture.received);
+        }
+    }
+    metrics_family(buffer, "ndpmon_capture_dropped", "counter", "Frames lost by the capture, by cause.");
+    for (p=0; p<count; p++) {
+        const struct capture_stats* capture = &probes[p].capture;
+
+        if (!probes[p].has_capture) {
+            continue;
+        }
+        metrics_dropped_sample(buffer, probes[p].probe, "kernel", capture->kernel_dropped);
+        metrics_dropped_sample(buffer, probes[p].probe, "interface", capture->interface_dropped);
+        metrics_dropped_sample(buffer, probes[p].probe, "queue", capture->queue_dropped);
+        metrics_dropped_sample(buffer, probes[p].probe, "queue_user", capture->queue_user_dropped);
+        metrics_dropped_sample(buffer, probes[p].probe, "overrun", capture->overruns);
+        metrics_dropped_sample(buffer, probes[p].probe, "ring", capture->ring.dropped);
+    }
+    /* the slots of the analysis rings are the frame memory of a probe: */
+    metrics_family(buffer, "ndpmon_ring_slots", "gauge", "Frame slots of the analysis rings.");
+    for (p=0; p<count; p++) {
+        if (probes[p].has_capture) {
+            metrics_probe_sample(buffer, "ndpmon_ring_slots", probes[p].probe, probes[p].capture.ring.capacity);
+        }
+    }
+    metrics_family(buffer, "ndpmon_ring_slots_used", "gauge", "Frame slots in use, as of the last collection.");
+    for (p=0; p<count; p++) {
+        if (probes[p].has_capture) {
+            metrics_probe_sample(buffer, "ndpmon_ring_slots_used", probes[p].probe, probes[p].capture.ring.occupancy);
+        }
+    }
+    metrics_family(buffer, "ndpmon_ring_slots_high_water", "gauge", "Highest number of frame slots in use of a ring.");
+    for (p=0; p<count; p++) {
+        if (probes[p].has_capture) {
+            metrics_probe_sample(buffer, "ndpmon_ring_slots_high_water", probes[p].probe, probes[p].capture.ring.high_water);
+        }
+    }
+}
+
+static void metrics_render_events(struct text_buffer* buffer) {
+    uint64_t queued;
+    unsigned int depth = event_queue_depth(&queued);
+
+    metrics_family(buffer, "ndpmon_event_queue_depth", "gauge", "Events waiting for their handlers.");
+    text_buffer_printf(buffer, "ndpmon_event_queue_depth %u\n", depth);
+    metrics_family(buffer, "ndpmon_events", "counter", "Events queued.");
+    text_buffer_printf(buffer, "ndpmon_events_total %llu\n", (unsigned long long)queued);
+}
+
+static void metrics_render_watchers(struct text_buffer* buffer) {
+    const struct watcher_list* watcher;
+
+    metrics_family(buffer, "ndpmon_watcher_duration_seconds", "histogram", "Duration of the watch function calls.");
+    for (watcher=watchers_get(); watcher!=NULL; watcher=watcher->next) {
+        uint64_t cumulative = 0;
+        char labels[WATCHER_NAME_SIZE+32];
+        char number[4];
+        int i;
+
+        snprintf(labels, sizeof(labels), "watcher=\"%s\",type=\"%s\"", watcher->name,
+                (watcher->icmp6_type_match==0) ? "any" : metrics_icmp6_type(watcher->icmp6_type_match, number));
+        for (i=0; i<WATCHERS_LATENCY_BUCKETS; i++) {
+            cumulative += __atomic_load_n(&watcher->latency[i], __ATOMIC_RELAXED);
+            if (i<WATCHERS_LATENCY_BUCKETS-1) {
+                text_buffer_printf(buffer, "ndpmon_watcher_duration_seconds_bucket{%s,le=\"%g\"} %llu\n",
+                        labels, watchers_latency_bounds[i]/1e6, (unsigned long long)cumulative);
+            } else {
+                text_buffer_printf(buffer, "ndpmon_watcher_duration_seconds_bucket{%s,le=\"+Inf\"} %llu\n",
+                        labels, (unsigned long long)cumulative);
+            }
+        }
+        text_buffer_printf(buffer, "ndpmon_watcher_duration_seconds_count{%s} %llu\n", labels, (unsigned long long)cumulative);
+        text_buffer_printf(buffer, "ndpmon_watcher_duration_seconds_sum{%s} %.9f\n", labels,
+                __atomic_load_n(&watcher->latency_sum, __ATOMIC_RELAXED)/1e9);
+    }
+}
+
+/* Renders all metric families. */
+static void metrics_render(struct text_buffer* buffer) {
+    struct probe_list** locked_probes;
+    struct probe_list* tmp_probes;
+    struct probe_list* first;
+    struct metrics_probe* probes;
+    int count = 0;
+    int p;
+
+    /* critical section: */
+    locked_probes = probe_list_lock();
+    /* copy the probe list (entries are never removed while running) */
+    first = *locked_probes;
+    probe_list_unlock();
+    /* end critical section. */
+
+    for (tmp_probes=first; tmp_probes!=NULL; tmp_probes=tmp_probes->next) {
+        count++;
+    }
+    if ((probes=calloc(count+1, sizeof(struct metrics_probe)))==NULL) {
+        buffer->failed = 1;
+        return;
+    }
+    for (p=0, tmp_probes=first; p<count; p++, tmp_probes=tmp_probes->next) {
+        probes[p].probe = &tmp_probes->entry;
+        stats_probe_get(probes[p].probe, &probes[p].stats);
+        probes[p].has_capture = (capture_stats_last(probes[p].probe, &probes[p].capture)==0);
+    }
+    metrics_render_packets(buffer, probes, count);
+    metrics_render_alerts(buffer, probes, count);
+    metrics_render_caches(buffer, probes, count);
+    metrics_render_capture(buffer, probes, count);
+    metrics_render_events(buffer);
+    metrics_render_watchers(buffer);
+    text_buffer_printf(buffer, "# EOF\n");
+    free(probes);
+}
+
+/* Reads the request head, returns -1 if the client did not send one in time. */
+static int metrics_read_request(int client, char* request) {
+    size_t length = 0;
+    ssize_t received;
+
+    while (length<METRICS_REQUEST_SIZE-1) {
+        if ((received=recv(client, request+length, METRICS_REQUEST_SIZE-1-length, 0))<=0) {
+            break;
+        }
+        length += received;
+        request[length] = '\0';
+        if (strstr(request, "\r\n\r\n")!=NULL || strstr(request, "\n\n")!=NULL) {
+            break;
+        }
+    }
+    request[length] = '\0';
+    return (length>0) ? 0 : -1;
+}
+
+static void metrics_write(int client, const char* data, size_t length) {
+    ssize_t sent;
+
+    while (length>0) {
+        if ((sent=send(client, data, length, MSG_NOSIGNAL))<=0) {
+            if (DEBUG) {
+                perror("[metrics] send failed");
+            }
+            return;
+        }
+        data += sent;
+        length -= sent;
+    }
+}
+
+static void metrics_serve(int client) {
+    struct timeval timeout;
+    struct text_buffer buffer;
+    char request[METRICS_REQUEST_SIZE];
+    char method[16];
+    char target[256];
+    char head[256];
+    const char* status = "200 OK";
+    const char* content_type = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+    int head_length;
+
+    timeout.tv_sec  = METRICS_CLIENT_TIMEOUT;
+    timeout.tv_usec = 0;
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+    head_length = 1;
+    setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &head_length, sizeof(head_length));
+#endif
+    if (metrics_read_request(client, request)==-1) {
+        return;
+    }
+    method[0] = '\0';
+    target[0] = '\0';
+    sscanf(request, "%15s %255s", method, target);
+    /* the query string is ignored: */
+    target[strcspn(target, "?")] = '\0';
+
+    if (text_buffer_init(&buffer, 16384)==-1) {
+        return;
+    }
+    if (strcmp(method, "GET")!=0 && strcmp(method, "HEAD")!=0) {
+        status = "405 Method Not Allowed";
+    } else if (strcmp(target, "/metrics")!=0) {
+        status = "404 Not Found";
+    } else {
+        metrics_render(&buffer);
+    }
+    if (buffer.failed) {
+        status = "500 Internal Server Error";
+        buffer.failed = 0;
+        buffer.length = 0;
+    }
+    if (strcmp(status, "200 OK")!=0) {
+        content_type = "text/plain; charset=utf-8";
+        text_buffer_printf(&buffer, "%s\n", status);
+    }
+    head_length = snprintf(head, sizeof(head),
+            "HTTP/1.0 %s\r\nContent-Type: %s\r\nContent-Length: %lu\r\nConnection: close\r\n\r\n",
+            status, content_type, (unsigned long)buffer.length);
+    metrics_write(client, head, head_length);
+    if (strcmp(method, "HEAD")!=0) {
+        metrics_write(client, buffer.data, buffer.length);
+    }
+    text_buffer_free(&buffer);
+}
+
+static void* metrics_run(void* unused) {
+    struct pollfd fds[2];
+    sigset_t signals;
+    int client;
+
+    /* signals are handled by the main thread: */
+    sigfillset(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    fds[0].fd     = metrics_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd     = metrics_wakeup[0];
+    fds[1].events = POLLIN;
+    while (1) {
+        if (poll(fds, 2, -1)==-1) {
+            if (errno==EINTR) {
+                continue;
+            }
+            perror("[metrics] poll failed");
+            break;
+        }
+        if (fds[1].revents!=0) {
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            if ((client=accept(metrics_fd, NULL, NULL))==-1) {
+                if (DEBUG) {
+                    perror("[metrics] accept failed");
+                }
+                continue;
+            }
+            metrics_serve(client);
+            close(client);
+        }
+    }
+    return NULL;
+}
+
+int metrics_start() {
+    struct extinfo_list** extinfo;
+    struct metrics_settings* configured;
+    struct metrics_settings settings;
+    struct addrinfo hints;
+    struct addrinfo* address;
+    char port[8];
+    int error;
+    int on = 1;
+
+    extinfo = settings_extinfo_lock();
+    configured = extinfo_list_get_data(*extinfo, "metrics");
+    if (configured!=NULL) {
+        memcpy(&settings, configured, sizeof(struct metrics_settings));
+    }
+    settings_extinfo_unlock();
+    if (configured==NULL) {
+        return 0;
+    }
+    memset(&hints, 0, sizeof(struct addrinfo));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags    = AI_PASSIVE|AI_NUMERICHOST|AI_NUMERICSERV;
+    snprintf(port, sizeof(port), "%i", settings.port);
+    if ((error=getaddrinfo(settings.address, port, &hints, &address))!=0) {
+        fprintf(stderr, "[metrics] ERROR: address %s: %s\n", settings.address, gai_strerror(error));
+        return -1;
+    }
+    if ((metrics_fd=socket(address->ai_family, address->ai_socktype, address->ai_protocol))==-1) {
+        perror("[metrics] socket failed");
+        freeaddrinfo(address);
+        return -1;
+    }
+    setsockopt(metrics_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (bind(metrics_fd, address->ai_addr, address->ai_addrlen)==-1
+            || listen(metrics_fd, 16)==-1) {
+        perror("[metrics] opening the socket failed");
+        freeaddrinfo(address);
+        close(metrics_fd);
+        metrics_fd = -1;
+        return -1;
+    }
+    freeaddrinfo(address);
+    if (pipe(metrics_wakeup)==-1) {
+        perror("[metrics] pipe failed");
+        close(metrics_fd);
+        metrics_fd = -1;
+        return -1;
+    }
+    if (pthread_create(&metrics_thread, NULL, metrics_run, NULL)!=0) {
+        perror("[metrics] pthread_create failed");
+        metrics_stop();
+        return -1;
+    }
+    metrics_started = 1;
+    watchers_timing(1);
+    fprintf(stderr, "[metrics] listening on %s port %i.\n", settings.address, settings.port);
+    return 0;
+}
+
+void metrics_stop() {
+    if (metrics_fd==-1) {
+        return;
+    }
+    watchers_timing(0);
+    if (metrics_started) {
+        if (write(metrics_wakeup[1], "x", 1)!=1) {
+            perror("[metrics] waking the thread failed");
+        }
+        pthread_join(metrics_thread, NULL);
+        metrics_started = 0;
+    }
+    close(metrics_wakeup[0]);
+    close(metrics_wakeup[1]);
+    close(metrics_fd);
+    metrics_fd = -1;
+}
+
+int metrics_settings_load(xmlNodePtr element, void** data) {
+    struct metrics_settings* settings;
+    xmlChar* address = xmlGetProp(element, BAD_CAST "address");
+
+    if ((settings=malloc(sizeof(struct metrics_settings)))==NULL) {
+        perror("[metrics] malloc failed.\n");
+        exit(1);
+    }
+    memset(settings, 0, sizeof(struct metrics_settings));
+    strlcpy(settings->address, (address!=NULL) ? (char*)address : METRICS_ADDRESS, INET6_ADDRSTRLEN);
+    settings->port = METRICS_PORT;
+    xmlFree(address);
+    if (settings_get_int(element, "port", &settings->port, 1, 65535)==-1) {
+        free(settings);
+        return -1;
+    }
+    *data = settings;
+    return 0;
+}
+
+void metrics_settings_print(void* data) {
+    struct metrics_settings* settings = (struct metrics_settings*) data;
+
+    fprintf(stderr, "[metrics] exporter on %s port %i\n", settings->address, settings->port);
+}
+
+int metrics_settings_save(xmlNodePtr element, void* data) {
+    struct metrics_settings* settings = (struct metrics_settings*) data;
+
+    xmlNewProp(element, BAD_CAST "address", BAD_CAST settings->address);
+    settings_set_int(element, "port", settings->port);
+    return 0;
+}
@@ -0,0 +1,101 @@
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <libxml/tree.h>
+
+#include "../membounds.h"
+#include "ndpmon_defs.h"
+#include "../ndpmon_netheaders.h"
+
+#include "cache_types.h"
+#include "capture.h"
+#include "events.h"
+#include "extinfo.h"
+#include "probes.h"
+#include "settings.h"
+#include "stats.h"
+#include "text_buffer.h"
+#include "watchers.h"
+
+/** @file
+ *  Metrics exporter: a minimal HTTP listener answering GET /metrics with
+ *  the runtime counters in the OpenMetrics text format, to be scraped by
+ *  Prometheus or a compatible collector.
+ *
+ *  The families exported are the frames by ICMPv6 type, the alerts by
+ *  reason, the cache sizes and the capture losses of each probe, the
+ *  occupancy of the analysis rings, the depth of the event queue and a
+ *  latency histogram of each watch function. Rendering reads the atomic
+ *  counters of stats.h and the snapshots of the capture monitor, it never
+ *  takes a probe lock. Rates are left to the collector.
+ *
+ *  Requests are served one at a time by a thread of their own. Enabled by
+ *  the metrics element of the settings, which listens on the loopback
+ *  address unless told otherwise, for instance
+ *  \verbatim <metrics address="127.0.0.1" port="9806"/> \endverbatim
+ */
+
+/** Default listening address. */
+#define METRICS_ADDRESS "127.0.0.1"
+/** Default listening port. */
+#define METRICS_PORT 9806
+/** Maximum size of the request head. */
+#define METRICS_REQUEST_SIZE 2048
+/** Seconds a client may take to send its request or to read the response. */
+#define METRICS_CLIENT_TIMEOUT 2
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/** Settings of the metrics exporter (extinfo type "metrics"). */
+struct metrics_settings {
+    /** Numeric listening address (IPv4 or IPv6). */
+    char address[INET6_ADDRSTRLEN];
+    /** Listening port. */
+    int port;
+};
+
+/** Opens the listening socket and starts the exporter thread, if the
+ *  settings have a metrics element. Enables the timing of the watchers.
+ *  @return 0 on success or if the exporter is not configured, -1 otherwise.
+ */
+int metrics_start();
+
+/** Stops the exporter thread and closes the socket. */
+void metrics_stop();
+
+/** Loads the metrics exporter settings from a XML element.
+ *  @param element The metrics element.
+ *  @param data    Will hold the settings (call by reference).
+ *  @return        0 on success, -1 on error.
+ */
+int metrics_settings_load(xmlNodePtr element, void** data);
+
+/** Prints the metrics exporter settings.
+ *  @param data The settings.
+ */
+void metrics_settings_print(void* data);
+
+/** Saves the metrics exporter settings to a XML element.
+ *  @param element The element to add the attributes to.
+ *  @param data    The settings.
+ *  @return        Always 0.
+ */
+int metrics_settings_save(xmlNodePtr element, void* data);
+
+#endif
@@ -433,16 +433,41 @@ int reset_neighbor_timer(neighbor_list_t *list, const struct ether_addr* eth, co
     }
 
     /* neighbor with the given ethernet address found, reset timer: */
-    if(difftime(current, tmp->timer) > 6*30*DAY_TIME) {
+    if (neighbor_seen(tmp, NULL, current)) {
         /* if the station has been inactive for a long time (6 months): */
         inet_ntop(AF_INET6, &tmp->lla, str_ip, INET6_ADDRSTRLEN);
         snprintf (buffer, NOTIFY_BUFFER_SIZE, "new activity from: %s %s", ether_ntoa((struct ether_addr*)(&(tmp->mac))),str_ip);
         alert_raise(1, probe, "new activity", buffer, eth, NULL, &tmp->lla,NULL);
     }
-    tmp->timer = current;
     return 1;
 }
 
+int neighbor_seen(neighbor_list_t *neighbor, const struct in6_addr* addr, time_t seen)
+{
+    address_t *atmp;
+    int inactive = 0;
+
+    /* a merged mark may be older than a timer set meanwhile: */
+    if (difftime(seen, neighbor->timer) > 0) {
+        inactive = (difftime(seen, neighbor->timer) > 6*30*DAY_TIME);
+        neighbor->timer = seen;
+    }
+    if (addr == NULL) {
+        return inactive;
+    }
+    atmp = neighbor->addresses;
+    while (atmp != NULL) {
+        if (IN6_ARE_ADDR_EQUAL(addr,&(atmp->address))) {
+            if (difftime(seen, atmp->lastseen) > 0) {
+                atmp->lastseen = seen;
+            }
+            break;
+        }
+        atmp = atmp->next;
+    }
+    return inactive;
+}
+
 int set_neighbor_timer(neighbor_list_t *list, const struct ether_addr* eth, time_t value)
 {
     neighbor_list_t *tmp = (neighbor_list_t*) get_neighbor_by_mac(list, eth);
@@ -472,7 +497,7 @@ int del_neighbor(neighbor_list_t **list, const struct ether_addr* eth)
 
 	if(!is_neighbor_by_mac(*list,eth))
 	{
-		fprintf(stderr,"neighbor not in list\n");
+		LOGGING(LOGGING_CACHE, LOGGING_LEVEL_DEBUG, "neighbor not in list\n");
 		return 0;
 	}
 
@@ -510,7 +535,7 @@ int add_neighbor(neighbor_list_t **list, const struct ether_addr* eth)
 
 	if(is_neighbor_by_mac(*list,eth))
 	{
-		fprintf(stderr,"Neighbor already in list %s\n", ether_ntoa(eth));
+		LOGGING(LOGGING_CACHE, LOGGING_LEVEL_DEBUG, "Neighbor already in list %s\n", ether_ntoa(eth));
 		return 0;
 	}
 
@@ -949,17 +974,11 @@ int neighbor_save(xmlNodePtr neighbor_element, const neighbor_list_t* list)
 		}
 		old_macs = old_macs->next;
 	}
-	while (extinfo!=NULL) {
-		const struct extinfo_type* const extinfo_type = extinfo->type;
-		xmlNodePtr extinfo_element = xmlNewChild(neighbor_element, NULL, BAD_CAST extinfo_type->name, NULL);
-
-		if ((extinfo_type->handler_xml_save)(extinfo_element, extinfo->data)==-1) {
-			fprintf(stderr,
-					"[neighbors] ERROR: Could not save extinfo information %s for neighbor %s.\n",
-					extinfo_type->name, ether_ntoa(&list->mac));
-			return -1;
-		}
-		extinfo = extinfo->next;
+	if (extinfo_list_save(neighbor_element, extinfo)==-1) {
+		fprintf(stderr,
+				"[neighbors] ERROR: Could not save extinfo information for neighbor %s.\n",
+				ether_ntoa(&list->mac));
+		return -1;
 	}
 	return 0;
 }
@@ -11,6 +11,7 @@
 #include "alerts.h"
 #include "cache_types.h"
 #include "extinfo.h"
+#include "logging.h"
 #include "probes.h"
 
 
@@ -209,6 +210,16 @@ const neighbor_list_t * get_neighbor_by_ip(const neighbor_list_t *list,
  */
 int reset_neighbor_timer(neighbor_list_t *list, const struct ether_addr* eth, const struct probe* probe);
 
+/** Moves the lastseen timers of a neighbor forward to the time it was seen,
+ *  for the merge of lastseen.h. Leaves the timers set to a later time.
+ *  @param neighbor The neighbor.
+ *  @param addr     A global IPv6 address of the neighbor that was seen, or NULL.
+ *  @param seen     When the neighbor was seen.
+ *  @return         1 if the neighbor has been inactive for more than six month
+ *                  (the caller raises the "new activity" alert), 0 otherwise.
+ */
+int neighbor_seen(neighbor_list_t *neighbor, const struct in6_addr* addr, time_t seen);
+
 /** Sets the lastseen timer for a given neighbor.
  *  @param list  The neighbor list to be used.
  *  @param eth   The ethernet address of the neighbor.
@@ -0,0 +1,129 @@
+#include "packet_ring.h"
+
+struct packet_ring* packet_ring_create(uint32_t capacity, uint32_t slot_size) {
+    struct packet_ring* ring;
+    uint32_t size = 1;
+
+    while (size<capacity) {
+        size <<= 1;
+    }
+    if ((ring=malloc(sizeof(struct packet_ring)))==NULL) {
+        perror("[packet_ring] malloc failed");
+        return NULL;
+    }
+    memset(ring, 0, sizeof(struct packet_ring));
+    ring->capacity  = size;
+    ring->mask      = size-1;
+    ring->slot_size = slot_size;
+    /* keep the timestamps of all slots aligned: */
+    ring->stride    = (sizeof(struct packet_ring_slot) + slot_size + 7) & ~((size_t)7);
+    if ((ring->slots=malloc(ring->stride*size))==NULL) {
+        perror("[packet_ring] malloc failed");
+        free(ring);
+        return NULL;
+    }
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->cond, NULL);
+    return ring;
+}
+
+void packet_ring_free(struct packet_ring* ring) {
+    if (ring==NULL) {
+        return;
+    }
+    pthread_mutex_destroy(&ring->lock);
+    pthread_cond_destroy(&ring->cond);
+    free(ring->slots);
+    free(ring);
+}
+
+int packet_ring_push(struct packet_ring* ring, const struct timespec* timestamp,
+        const uint8_t* data, uint32_t length) {
+    uint64_t head = ring->head;
+    uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    struct packet_ring_slot* slot;
+    uint32_t occupancy;
+
+    __atomic_store_n(&ring->received, ring->received+1, __ATOMIC_RELAXED);
+    if (head-tail>=ring->capacity) {
+        __atomic_store_n(&ring->dropped, ring->dropped+1, __ATOMIC_RELAXED);
+        return -1;
+    }
+    slot = (struct packet_ring_slot*)(ring->slots + (head & ring->mask)*ring->stride);
+    if (length>ring->slot_size) {
+        __atomic_store_n(&ring->truncated, ring->truncated+1, __ATOMIC_RELAXED);
+        length = ring->slot_size;
+    }
+    memcpy(&slot->timestamp, timestamp, sizeof(struct timespec));
+    slot->length = length;
+    memcpy(slot->data, data, length);
+    /* publish the slot, sequentially consistent so that it is not ordered
+     * after the load of waiting below (else both sides could miss the
+     * other and the consumer sleep with a packet in the ring): */
+    __atomic_store_n(&ring->head, head+1, __ATOMIC_SEQ_CST);
+
+    occupancy = (uint32_t)(head+1-tail);
+    if (occupancy>ring->high_water) {
+        __atomic_store_n(&ring->high_water, occupancy, __ATOMIC_RELAXED);
+    }
+    /* the consumer announces that it is going to sleep: */
+    if (__atomic_load_n(&ring->waiting, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&ring->lock);
+        pthread_cond_signal(&ring->cond);
+        pthread_mutex_unlock(&ring->lock);
+    }
+    return 0;
+}
+
+uint32_t packet_ring_wait(struct packet_ring* ring, uint32_t max) {
+    uint64_t available = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - ring->tail;
+
+    if (available==0) {
+        pthread_mutex_lock(&ring->lock);
+        __atomic_store_n(&ring->waiting, 1, __ATOMIC_SEQ_CST);
+        while ((available=__atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) - ring->tail)==0
+                && !ring->closed) {
+            pthread_cond_wait(&ring->cond, &ring->lock);
+        }
+        __atomic_store_n(&ring->waiting, 0, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&ring->lock);
+    }
+    if (available==0) {
+        return 0;
+    }
+    if (available>max) {
+        available = max;
+    }
+    __atomic_store_n(&ring->batches, ring->batches+1, __ATOMIC_RELAXED);
+    return (uint32_t)available;
+}
+
+struct packet_ring_slot* packet_ring_peek(struct packet_ring* ring, uint32_t n) {
+    return (struct packet_ring_slot*)(ring->slots + ((ring->tail+n) & ring->mask)*ring->stride);
+}
+
+void packet_ring_release(struct packet_ring* ring, uint32_t count) {
+    __atomic_store_n(&ring->processed, ring->processed+count, __ATOMIC_RELAXED);
+    __atomic_store_n(&ring->tail, ring->tail+count, __ATOMIC_RELEASE);
+}
+
+void packet_ring_close(struct packet_ring* ring) {
+    pthread_mutex_lock(&ring->lock);
+    ring->closed = 1;
+    pthread_cond_signal(&ring->cond);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+void packet_ring_get_stats(struct packet_ring* ring, struct packet_ring_stats* stats) {
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    stats->capacity   = ring->capacity;
+    stats->occupancy  = (head>tail) ? (uint32_t)(head-tail) : 0;
+    stats->high_water = __atomic_load_n(&ring->high_water, __ATOMIC_RELAXED);
+    stats->received   = __atomic_load_n(&ring->received, __ATOMIC_RELAXED);
+    stats->dropped    = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+    stats->truncated  = __atomic_load_n(&ring->truncated, __ATOMIC_RELAXED);
+    stats->processed  = __atomic_load_n(&ring->processed, __ATOMIC_RELAXED);
+    stats->batches    = __atomic_load_n(&ring->batches, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,130 @@
+#ifndef _PACKET_RING_H_
+#define _PACKET_RING_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+/** @file
+ *  Lock-free single producer, single consumer packet ring. It decouples
+ *  a capture thread (producer) from the analysis thread running the watch
+ *  functions (consumer), so that slow watchers do not stall capturing.
+ *
+ *  Frames are copied into fixed size slots. If the ring is full, the new
+ *  frame is dropped and counted. The consumer takes the frames in batches
+ *  and sleeps on a condition variable while the ring is empty.
+ */
+
+/** A slot of the ring. */
+struct packet_ring_slot {
+    /** Capture time of the frame (nanosecond resolution if the capture provides it). */
+    struct timespec timestamp;
+    /** Number of bytes in data. */
+    uint32_t length;
+    /** The frame (slot_size bytes available). */
+    uint8_t data[];
+};
+
+/** Ring statistics. */
+struct packet_ring_stats {
+    /** Number of slots. */
+    uint32_t capacity;
+    /** Frames currently waiting. */
+    uint32_t occupancy;
+    /** Highest occupancy seen. */
+    uint32_t high_water;
+    /** Frames offered by the producer. */
+    uint64_t received;
+    /** Frames dropped because the ring was full. */
+    uint64_t dropped;
+    /** Frames cut to the slot size. */
+    uint64_t truncated;
+    /** Frames handed to the consumer. */
+    uint64_t processed;
+    /** Batches handed to the consumer. */
+    uint64_t batches;
+};
+
+/** The ring. Producer and consumer indexes live on separate cache lines. */
+struct packet_ring {
+    uint32_t capacity;
+    uint32_t mask;
+    uint32_t slot_size;
+    size_t   stride;
+    uint8_t* slots;
+    /* producer side: */
+    uint64_t head __attribute__ ((aligned (64)));
+    uint64_t received;
+    uint64_t dropped;
+    uint64_t truncated;
+    uint32_t high_water;
+    /* consumer side: */
+    uint64_t tail __attribute__ ((aligned (64)));
+    uint64_t processed;
+    uint64_t batches;
+    /* consumer wakeup: */
+    int waiting __attribute__ ((aligned (64)));
+    int closed;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+};
+
+/** Allocates a ring.
+ *  @param capacity  Number of slots (rounded up to a power of two).
+ *  @param slot_size Maximum frame size, longer frames are truncated.
+ *  @return          The ring or NULL on error.
+ */
+struct packet_ring* packet_ring_create(uint32_t capacity, uint32_t slot_size);
+
+/** Releases a ring (the consumer must be stopped).
+ *  @param ring The ring.
+ */
+void packet_ring_free(struct packet_ring* ring);
+
+/** Producer: copies a frame into the ring.
+ *  @param ring      The ring.
+ *  @param timestamp Capture time.
+ *  @param data      The frame.
+ *  @param length    Length of the frame.
+ *  @return          0 on success, -1 if the ring was full (frame dropped).
+ */
+int packet_ring_push(struct packet_ring* ring, const struct timespec* timestamp,
+        const uint8_t* data, uint32_t length);
+
+/** Consumer: waits until frames are available.
+ *  @param ring The ring.
+ *  @param max  Maximum batch size.
+ *  @return     Number of frames available (at most max), 0 if the ring was
+ *              closed and is empty.
+ */
+uint32_t packet_ring_wait(struct packet_ring* ring, uint32_t max);
+
+/** Consumer: returns the n-th available frame (0 is the oldest).
+ *  @param ring The ring.
+ *  @param n    Index below the value returned by packet_ring_wait().
+ *  @return     The slot.
+ */
+struct packet_ring_slot* packet_ring_peek(struct packet_ring* ring, uint32_t n);
+
+/** Consumer: gives back the oldest count frames to the producer.
+ *  @param ring  The ring.
+ *  @param count Number of frames processed.
+ */
+void packet_ring_release(struct packet_ring* ring, uint32_t count);
+
+/** Wakes up the consumer, which returns once the ring is drained.
+ *  @param ring The ring.
+ */
+void packet_ring_close(struct packet_ring* ring);
+
+/** Reads the ring statistics (from any thread).
+ *  @param ring  The ring.
+ *  @param stats Will hold the statistics.
+ */
+void packet_ring_get_stats(struct packet_ring* ring, struct packet_ring_stats* stats);
+
+#endif
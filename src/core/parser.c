@@ -179,6 +179,8 @@ int parser_neighbors_store()
 	xmlCreateIntSubset(doc, BAD_CAST "neighbors", NULL, BAD_CAST "neighbor_list.dtd");
 
 	fprintf(stderr, "[parser] Writing cache...\n");
+	/* the timers of the neighbors seen since the last merge: */
+	lastseen_merge();
 
 	if (probe_list_save_neighbors(root_element)==-1) 
 	{
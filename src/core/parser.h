@@ -22,6 +22,7 @@
 #include "../membounds.h"
 #include "ndpmon_defs.h"
 
+#include "lastseen.h"
 #include "neighbors.h"
 #include "probes.h"
 #include "routers.h"
@@ -2,8 +2,32 @@
 
 static struct probe_list* probes;
 
+/* serializes the changes of the list, entries are looked up without it: */
 pthread_mutex_t probes_lock = PTHREAD_MUTEX_INITIALIZER;
 
+/* Gets the list entry holding a probe (the probe must be an entry of the list). */
+static struct probe_list* probe_list_entry(const struct probe* probe)
+{
+	return (struct probe_list*) ((char*) probe - offsetof(struct probe_list, entry));
+}
+
+/* Looks up a probe by name. Entries are only appended (with release
+ * semantics) and never removed while running, so no lock is needed. */
+static struct probe_list* probe_list_find(const char* probe_name)
+{
+	struct probe_list* tmp_probes = __atomic_load_n(&probes, __ATOMIC_ACQUIRE);
+
+	while (tmp_probes!=NULL) 
+	{
+		if (strncmp(probe_name, tmp_probes->entry.name, PROBE_NAME_SIZE)==0) 
+		{
+			break;
+		}
+		tmp_probes = __atomic_load_n(&tmp_probes->next, __ATOMIC_ACQUIRE);
+	}
+	return tmp_probes;
+}
+
 #ifdef _COUNTERMEASURES_
 int probe_cm_enabled(const char* probe_name)
 {
@@ -143,6 +167,10 @@ int probe_load_config(xmlNodePtr element, char* name, enum probe_type* type,
 			return 0;
 		}
 	} 
+	else if (type_prop!=NULL && STRCMP(type_prop, "vlan")==0) 
+	{
+		*type = PROBE_TYPE_VLAN;
+	} 
 	else 
 	{
 		fprintf(stderr, "[probes] ERROR: unknown interface type %s", (char*) type_prop);
@@ -168,7 +196,7 @@ int probe_load_config(xmlNodePtr element, char* name, enum probe_type* type,
 #endif
 		if (STRCMP(probe_child->name, "routers")==0) 
 		{
-			if (*type== PROBE_TYPE_INTERFACE && router_list_parse(probe_child, routers)==-1) 
+			if (*type!=PROBE_TYPE_REMOTE && router_list_parse(probe_child, routers)==-1) 
 			{
 				return -1;
 			}
@@ -256,28 +284,43 @@ int probe_load_neighbors(xmlNodePtr element, struct probe* probe,
 	return 0;
 }
 
+struct probe* probe_handle_lock(struct probe* probe)
+{
+	pthread_rwlock_wrlock(&probe_list_entry(probe)->lock);
+	return probe;
+}
+
+const struct probe* probe_handle_rdlock(struct probe* probe)
+{
+	pthread_rwlock_rdlock(&probe_list_entry(probe)->lock);
+	return probe;
+}
+
+void probe_handle_unlock(struct probe* probe)
+{
+	pthread_rwlock_unlock(&probe_list_entry(probe)->lock);
+}
+
 struct probe* probe_lock(const char* probe_name)
 {
-	struct probe_list* tmp_probes;
+	struct probe_list* tmp_probes = probe_list_find(probe_name);
 
-	pthread_mutex_lock(&probes_lock);
-	tmp_probes = probes;
-	while (tmp_probes!=NULL) 
+	if (tmp_probes==NULL) 
 	{
-		if (strncmp(probe_name, tmp_probes->entry.name, PROBE_NAME_SIZE)==0) 
-		{
-			break;
-		}
-		tmp_probes = tmp_probes->next;
+		return NULL;
 	}
-	if (tmp_probes!=NULL) 
+	return probe_handle_lock(&tmp_probes->entry);
+}
+
+const struct probe* probe_rdlock(const char* probe_name)
+{
+	struct probe_list* tmp_probes = probe_list_find(probe_name);
+
+	if (tmp_probes==NULL) 
 	{
-		pthread_mutex_lock(&tmp_probes->lock);
-		pthread_mutex_unlock(&probes_lock);
-		return &tmp_probes->entry;
+		return NULL;
 	}
-	pthread_mutex_unlock(&probes_lock);
-	return NULL;
+	return probe_handle_rdlock(&tmp_probes->entry);
 }
 
 #ifdef _COUNTERMEASURES_
@@ -317,12 +360,14 @@ int probe_list_add(char* const name, enum probe_type type,
 	new->entry.extinfo = extinfo;
 	new->entry.neighbors = neighbors;
 	new->entry.routers = routers;
-	pthread_mutex_init(&new->lock, NULL);
+	pthread_rwlock_init(&new->lock, NULL);
 	new->next = NULL;
+	/* the entry is published to lookups without the list lock (see
+	 * probe_list_find()) once it is initialized: */
 	if (probes==NULL) 
 	{
 		/* if the list is empty, the entry will be the new list: */
-		probes = new;
+		__atomic_store_n(&probes, new, __ATOMIC_RELEASE);
 	} 
 	else 
 	{
@@ -332,7 +377,7 @@ int probe_list_add(char* const name, enum probe_type type,
 		{
 			tmp_probes = tmp_probes->next;
 		}
-		tmp_probes->next = new;
+		__atomic_store_n(&tmp_probes->next, new, __ATOMIC_RELEASE);
 	}
 	return 0;
 }
@@ -386,6 +431,16 @@ int probe_list_load_config(xmlNodePtr element)
 			struct extinfo_list* extinfo = NULL;
 			router_list_t* routers = NULL;
 
+			if (vlan_template_is(probe_element))
+			{
+				/* templates are used for the VLANs of a trunk: */
+				if (vlan_template_add(probe_element)==-1)
+				{
+					return -1;
+				}
+				probe_element = probe_element->next;
+				continue;
+			}
 #ifdef _COUNTERMEASURES_
 			if (probe_load_config(probe_element, name, &type, &extinfo, &routers, 0, &cm_enabled) == 1 )
 #else
@@ -425,6 +480,11 @@ int probe_list_load_neighbors(xmlNodePtr root_element)
 
 			probe = (struct probe*) probe_list_get((char*) probe_name);
 			if (probe==NULL) 
+			{
+				/* VLANs of a trunk are added when they are seen: */
+				probe = vlan_probe_load((char*) probe_name);
+			}
+			if (probe==NULL) 
 			{
 				fprintf(stderr, "[parser] ERROR: XML neighbor cache is refering to unknown probe name %s.\n", (char*) probe_name);
 				return -1;
@@ -491,10 +551,12 @@ int probe_list_save_config(xmlNodePtr element)
 		xmlNodePtr probe_element;
 
 		probe_element = xmlNewChild(element, NULL, BAD_CAST "probe", NULL);
+		pthread_rwlock_rdlock(&tmp_probes->lock);
 		probe_save_config(probe_element, &tmp_probes->entry);
+		pthread_rwlock_unlock(&tmp_probes->lock);
 		tmp_probes = tmp_probes->next;
 	}
-	return 0;
+	return vlan_template_save(element);
 }
 
 int probe_list_save_neighbors(xmlNodePtr element)
@@ -506,7 +568,10 @@ int probe_list_save_neighbors(xmlNodePtr element)
 		xmlNodePtr probe_element;
 
 		probe_element = xmlNewChild(element, NULL, BAD_CAST "probe", NULL);
+		/* a reader, the watchers reading the probe are not held up: */
+		pthread_rwlock_rdlock(&tmp_probes->lock);
 		probe_save_neighbors(probe_element, &tmp_probes->entry);
+		pthread_rwlock_unlock(&tmp_probes->lock);
 		/* Here write the discovery stats down if the module is activated
 		   need to addthe discovery path to the file in the probes structure def
 		   need to add the module in the configure
@@ -523,7 +588,7 @@ void probe_list_send_down_event()
 
 	while (tmp_probes!=NULL) 
 	{
-		if (tmp_probes->entry.type == PROBE_TYPE_INTERFACE) 
+		if (tmp_probes->entry.type == PROBE_TYPE_INTERFACE || tmp_probes->entry.type == PROBE_TYPE_VLAN) 
 		{
 			fprintf(stderr, "Send down event...\n");
 			probe_updown(PROBE_UPDOWN_STATE_DOWN, &tmp_probes->entry);
@@ -575,6 +640,10 @@ int probe_save_config(xmlNodePtr element, const struct probe* probe)
 	{
 		xmlNewProp(element, BAD_CAST "type", BAD_CAST "interface");
 	} 
+	else if (probe->type == PROBE_TYPE_VLAN) 
+	{
+		xmlNewProp(element, BAD_CAST "type", BAD_CAST "vlan");
+	} 
 	else 
 	{
 		xmlNewProp(element, BAD_CAST "type", BAD_CAST "remote");
@@ -627,9 +696,9 @@ int probe_set_addresses(struct probe* probe)
 	struct ifaddrs* if_addresses;
 	time_t current = time(NULL);
 
-	if (probe->type==PROBE_TYPE_REMOTE) 
+	if (probe->type!=PROBE_TYPE_INTERFACE) 
 	{
-		/* nothing to do: */
+		/* nothing to do (VLANs are seen through their trunk): */
 		return 0;
 	}
 
@@ -666,23 +735,12 @@ int probe_set_addresses(struct probe* probe)
 
 void probe_unlock(const char* probe_name)
 {
-	struct probe_list* tmp_probes;
+	struct probe_list* tmp_probes = probe_list_find(probe_name);
 
-	pthread_mutex_lock(&probes_lock);
-	tmp_probes = probes;
-	while (tmp_probes!=NULL) 
-	{
-		if (strncmp(probe_name, tmp_probes->entry.name, PROBE_NAME_SIZE)==0) 
-		{
-			break;
-		}
-		tmp_probes = tmp_probes->next;
-	}
 	if (tmp_probes!=NULL) 
 	{
-		pthread_mutex_unlock(&tmp_probes->lock);
+		probe_handle_unlock(&tmp_probes->entry);
 	}
-	pthread_mutex_unlock(&probes_lock);
 }
 
 void probe_updown(enum probe_updown_state state, struct probe* probe)
@@ -702,6 +760,12 @@ void probe_updown(enum probe_updown_state state, struct probe* probe)
 		strlcpy(event->probe_updown.probe.name, probe->name, PROBE_NAME_SIZE);
 	}
 
+	/* the statistics of a stopped probe are those of its last collection: */
+	if (capture_stats_last(probe, &event->probe_updown.capture_stats)==0)
+	{
+		event->probe_updown.has_capture_stats = 1;
+	}
+
 	/* decide which address will be used as a key for updates: */
 	event->probe_updown.state = state;
 	event_queue(EVENT_TYPE_PROBE_UPDOWN, event);
@@ -742,6 +806,11 @@ int probe_updown_save(xmlNodePtr element,
 		xmlNewChild(element, NULL, BAD_CAST "state", BAD_CAST "down");
 		xmlNewProp(probe_element, BAD_CAST "name", BAD_CAST probe_updown->probe.name);
 	}
+	if (probe_updown->has_capture_stats)
+	{
+		capture_stats_save(xmlNewChild(element, NULL, BAD_CAST "capture_stats", NULL),
+				&probe_updown->capture_stats);
+	}
 
 	return 0;
 }
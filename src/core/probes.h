@@ -6,6 +6,7 @@
  */
 
 #include <pthread.h>
+#include <stddef.h>
 #include <ifaddrs.h>
 #include <linux/if_packet.h>
 
@@ -17,13 +18,16 @@
 #include "extinfo.h"
 #include "neighbors.h"
 #include "routers.h"
+#include "capture.h"
+#include "vlan.h"
 
 /** A list of probes. The <B>entry</B> field is a nested structure only to prevent
  * publishing the <B>next</B> field to plugins or watchers.
  */
 struct probe_list {
-    /** Lock to control read/write access to this probe's state information. */
-    pthread_mutex_t lock;
+    /** Lock to control read/write access to this probe's state information,
+        shared by the readers and exclusive for changes. */
+    pthread_rwlock_t lock;
     /** The probe's state information. */
     struct probe entry;
     /** The next list entry. */
@@ -47,12 +51,39 @@ int probe_cm_enabled(const char* probe_name);
  */
 void probe_copy(struct probe *destination, const struct probe *source);
 
+/** Locks a probe of the list directly, without looking it up. Used by
+ *  the watchers for the probe of capture_info, which is an entry of the
+ *  list and stays valid while NDPMon is running. The lock is exclusive,
+ *  hold it only while changing the probe's state.
+ *  @param probe The probe to be locked (an entry of the probe list,
+ *               <B>not</B> a copy).
+ *  @return      The locked probe.
+ */
+struct probe* probe_handle_lock(struct probe* probe);
+/** Locks a probe of the list for reading only, like probe_handle_lock().
+ *  Any number of readers hold the lock at the same time, including the
+ *  saving of the neighbor cache.
+ *  @param probe The probe to be locked (an entry of the probe list).
+ *  @return      The locked probe, read only.
+ */
+const struct probe* probe_handle_rdlock(struct probe* probe);
+/** Unlocks a probe locked by probe_handle_lock() or probe_handle_rdlock().
+ *  @param probe The probe to be unlocked.
+ */
+void probe_handle_unlock(struct probe* probe);
 /** Locks a given probe to have save read/write access and blocks
- *  if probe is already locked.
+ *  if probe is already locked. The probe is looked up by name, use
+ *  probe_handle_lock() if the probe is at hand.
  *  @param probe The probe to be locked.
  *  @return      The locked probe or NULL on error.
  */
 struct probe* probe_lock(const char* probe_name);
+/** Locks a given probe for reading only, see probe_handle_rdlock().
+ *  Unlock it with probe_unlock().
+ *  @param probe The probe to be locked.
+ *  @return      The locked probe or NULL on error.
+ */
+const struct probe* probe_rdlock(const char* probe_name);
 
 #ifdef _COUNTERMEASURES_
 /** Adds a new probe list entry to the global list of probes.
@@ -105,7 +136,8 @@ int probe_list_load_config(xmlNodePtr element);
  */
 int probe_list_load_neighbors(xmlNodePtr element);
 
-/** Locks the list of probes to have save read/write access.
+/** Locks the list of probes to have save read/write access. Needed to
+ *  change the list or walk it, not to lock a single probe.
  *  @return The locked probe list.
  */
 struct probe_list** probe_list_lock();
@@ -0,0 +1,297 @@
+#include "resolver.h"
+
+/** State of a cached address. */
+enum resolver_state {
+    RESOLVER_STATE_PENDING,
+    RESOLVER_STATE_RESOLVED,
+    RESOLVER_STATE_FAILED
+};
+
+/** A cached lookup, chained in a hash bucket and (while pending) in the work queue. */
+struct resolver_entry {
+    struct in6_addr address;
+    enum resolver_state state;
+    char hostname[HOST_NAME_SIZE];
+    time_t expires;
+    struct resolver_entry* next;
+    struct resolver_entry* next_queued;
+};
+
+struct resolver_settings resolver_settings = {
+    2,    /* workers */
+    500,  /* deadline (ms) */
+    3600, /* positive_ttl (s) */
+    300   /* negative_ttl (s) */
+};
+
+static int resolver_getnameinfo(const struct in6_addr* address, char* hostname, size_t size);
+
+static resolver_lookup_t resolver_lookup_function = resolver_getnameinfo;
+
+static struct resolver_entry* resolver_cache[RESOLVER_CACHE_BUCKETS];
+static int resolver_cache_count = 0;
+static struct resolver_entry* resolver_queue_head = NULL;
+static struct resolver_entry* resolver_queue_tail = NULL;
+
+static pthread_t resolver_threads[RESOLVER_WORKERS_MAX];
+static int resolver_thread_count = 0;
+static int resolver_running = 0;
+
+static pthread_mutex_t resolver_lock = PTHREAD_MUTEX_INITIALIZER;
+/* signalled when a lookup is queued: */
+static pthread_cond_t resolver_work_cond = PTHREAD_COND_INITIALIZER;
+/* signalled when a lookup is finished: */
+static pthread_cond_t resolver_done_cond = PTHREAD_COND_INITIALIZER;
+
+static int resolver_getnameinfo(const struct in6_addr* address, char* hostname, size_t size) {
+    struct sockaddr_in6 sa;
+
+    memset(&sa, 0, sizeof(struct sockaddr_in6));
+    sa.sin6_family = AF_INET6;
+    memcpy(&sa.sin6_addr, address, sizeof(struct in6_addr));
+    return getnameinfo((struct sockaddr*)&sa, sizeof(struct sockaddr_in6),
+            hostname, size, NULL, 0, NI_NAMEREQD);
+}
+
+static unsigned int resolver_hash(const struct in6_addr* address) {
+    unsigned int hash = 2166136261u;
+    int i;
+
+    for (i=0; i<16; i++) {
+        hash = (hash ^ address->s6_addr[i]) * 16777619u;
+    }
+    return hash % RESOLVER_CACHE_BUCKETS;
+}
+
+static struct resolver_entry* resolver_cache_get(const struct in6_addr* address) {
+    struct resolver_entry* entry = resolver_cache[resolver_hash(address)];
+
+    while (entry!=NULL) {
+        if (memcmp(&entry->address, address, sizeof(struct in6_addr))==0) {
+            return entry;
+        }
+        entry = entry->next;
+    }
+    return NULL;
+}
+
+/* Removes finished entries from a bucket, either all or only the expired ones.
+ * Pending entries are referenced by the work queue and are never removed. */
+static void resolver_bucket_purge(int bucket, time_t now, int all) {
+    struct resolver_entry** link = &resolver_cache[bucket];
+
+    while (*link!=NULL) {
+        struct resolver_entry* entry = *link;
+        if (entry->state!=RESOLVER_STATE_PENDING && (all || entry->expires<=now)) {
+            *link = entry->next;
+            free(entry);
+            resolver_cache_count--;
+        } else {
+            link = &entry->next;
+        }
+    }
+}
+
+/* Adds a pending entry for the address and queues it for the workers.
+ * Returns NULL if the cache is full of lookups that are still running. */
+static struct resolver_entry* resolver_cache_add(const struct in6_addr* address, time_t now) {
+    struct resolver_entry* new;
+    unsigned int bucket = resolver_hash(address);
+
+    if (resolver_cache_count>=RESOLVER_CACHE_SIZE) {
+        int i;
+        for (i=0; i<RESOLVER_CACHE_BUCKETS; i++) {
+            resolver_bucket_purge(i, now, 0);
+        }
+        if (resolver_cache_count>=RESOLVER_CACHE_SIZE) {
+            /* still full of valid entries, sacrifice this bucket: */
+            resolver_bucket_purge(bucket, now, 1);
+        }
+        if (resolver_cache_count>=RESOLVER_CACHE_SIZE) {
+            return NULL;
+        }
+    }
+    if ((new=malloc(sizeof(struct resolver_entry)))==NULL) {
+        perror("[resolver] malloc failed");
+        return NULL;
+    }
+    memset(new, 0, sizeof(struct resolver_entry));
+    memcpy(&new->address, address, sizeof(struct in6_addr));
+    new->state = RESOLVER_STATE_PENDING;
+    new->next = resolver_cache[bucket];
+    resolver_cache[bucket] = new;
+    resolver_cache_count++;
+
+    if (resolver_queue_tail==NULL) {
+        resolver_queue_head = new;
+    } else {
+        resolver_queue_tail->next_queued = new;
+    }
+    resolver_queue_tail = new;
+    pthread_cond_signal(&resolver_work_cond);
+    return new;
+}
+
+static void* resolver_worker_run(void* unused) {
+    pthread_mutex_lock(&resolver_lock);
+    while (resolver_running) {
+        struct resolver_entry* entry;
+        struct in6_addr address;
+        char hostname[HOST_NAME_SIZE];
+        int error;
+
+        if (resolver_queue_head==NULL) {
+            pthread_cond_wait(&resolver_work_cond, &resolver_lock);
+            continue;
+        }
+        entry = resolver_queue_head;
+        resolver_queue_head = entry->next_queued;
+        if (resolver_queue_head==NULL) {
+            resolver_queue_tail = NULL;
+        }
+        entry->next_queued = NULL;
+        memcpy(&address, &entry->address, sizeof(struct in6_addr));
+
+        /* the query itself runs unlocked: */
+        pthread_mutex_unlock(&resolver_lock);
+        error = resolver_lookup_function(&address, hostname, HOST_NAME_SIZE);
+        if (error!=0) {
+            if (DEBUG) {
+                char address_str[INET6_ADDRSTRLEN];
+                inet_ntop(AF_INET6, &address, address_str, INET6_ADDRSTRLEN);
+                fprintf(stderr, "[resolver] looking up %s failed: %s\n",
+                        address_str, gai_strerror(error));
+            }
+            snprintf(hostname, HOST_NAME_SIZE, "<%s>", gai_strerror(error));
+        }
+        pthread_mutex_lock(&resolver_lock);
+
+        /* pending entries are never evicted, the pointer is still valid: */
+        strlcpy(entry->hostname, hostname, HOST_NAME_SIZE);
+        if (error==0) {
+            entry->state   = RESOLVER_STATE_RESOLVED;
+            entry->expires = time(NULL) + resolver_settings.positive_ttl;
+        } else {
+            entry->state   = RESOLVER_STATE_FAILED;
+            entry->expires = time(NULL) + resolver_settings.negative_ttl;
+        }
+        pthread_cond_broadcast(&resolver_done_cond);
+    }
+    pthread_mutex_unlock(&resolver_lock);
+    return NULL;
+}
+
+void resolver_set_lookup(resolver_lookup_t lookup) {
+    resolver_lookup_function = (lookup!=NULL) ? lookup : resolver_getnameinfo;
+}
+
+int resolver_start() {
+    int workers = resolver_settings.workers;
+
+    if (workers<1) {
+        workers = 1;
+    } else if (workers>RESOLVER_WORKERS_MAX) {
+        workers = RESOLVER_WORKERS_MAX;
+    }
+    pthread_mutex_lock(&resolver_lock);
+    resolver_running = 1;
+    pthread_mutex_unlock(&resolver_lock);
+    for (resolver_thread_count=0; resolver_thread_count<workers; resolver_thread_count++) {
+        if (pthread_create(&resolver_threads[resolver_thread_count], NULL, resolver_worker_run, NULL)!=0) {
+            perror("[resolver] pthread_create failed");
+            resolver_stop();
+            return -1;
+        }
+    }
+    if (DEBUG) {
+        fprintf(stderr, "[resolver] %i workers started.\n", resolver_thread_count);
+    }
+    return 0;
+}
+
+void resolver_stop() {
+    int i;
+
+    pthread_mutex_lock(&resolver_lock);
+    resolver_running = 0;
+    pthread_cond_broadcast(&resolver_work_cond);
+    pthread_mutex_unlock(&resolver_lock);
+    for (i=0; i<resolver_thread_count; i++) {
+        pthread_join(resolver_threads[i], NULL);
+    }
+    resolver_thread_count = 0;
+
+    /* workers are gone, release everything (pending entries included): */
+    for (i=0; i<RESOLVER_CACHE_BUCKETS; i++) {
+        while (resolver_cache[i]!=NULL) {
+            struct resolver_entry* entry = resolver_cache[i];
+            resolver_cache[i] = entry->next;
+            free(entry);
+        }
+    }
+    resolver_cache_count = 0;
+    resolver_queue_head = NULL;
+    resolver_queue_tail = NULL;
+}
+
+int resolver_lookup(const struct in6_addr* const address, char* hostname) {
+    struct resolver_entry* entry;
+    struct timespec deadline;
+    time_t now;
+    int ret = 1;
+
+    if (IN6_IS_ADDR_UNSPECIFIED(address)) {
+        strlcpy(hostname, "n/a", HOST_NAME_SIZE);
+        return -1;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec  += resolver_settings.deadline / 1000;
+    deadline.tv_nsec += (long)(resolver_settings.deadline % 1000) * 1000000L;
+    if (deadline.tv_nsec>=1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&resolver_lock);
+    if (!resolver_running) {
+        /* no workers, resolve inline: */
+        int error;
+
+        pthread_mutex_unlock(&resolver_lock);
+        error = resolver_lookup_function(address, hostname, HOST_NAME_SIZE);
+        if (error!=0) {
+            snprintf(hostname, HOST_NAME_SIZE, "<%s>", gai_strerror(error));
+            return -1;
+        }
+        return 0;
+    }
+    now = time(NULL);
+    entry = resolver_cache_get(address);
+    if (entry!=NULL && entry->state!=RESOLVER_STATE_PENDING && entry->expires<=now) {
+        /* expired, query again: */
+        resolver_bucket_purge(resolver_hash(address), now, 0);
+        entry = NULL;
+    }
+    if (entry==NULL) {
+        resolver_cache_add(address, now);
+    }
+    /* a lookup for this address may already be running, in any case wait
+     * for the result (looked up again after each wakeup since finished
+     * entries may be evicted meanwhile): */
+    while ((entry=resolver_cache_get(address))!=NULL && entry->state==RESOLVER_STATE_PENDING) {
+        if (pthread_cond_timedwait(&resolver_done_cond, &resolver_lock, &deadline)==ETIMEDOUT) {
+            entry = resolver_cache_get(address);
+            break;
+        }
+    }
+    if (entry==NULL || entry->state==RESOLVER_STATE_PENDING) {
+        strlcpy(hostname, RESOLVER_PENDING, HOST_NAME_SIZE);
+        ret = 1;
+    } else {
+        strlcpy(hostname, entry->hostname, HOST_NAME_SIZE);
+        ret = (entry->state==RESOLVER_STATE_RESOLVED) ? 0 : -1;
+    }
+    pthread_mutex_unlock(&resolver_lock);
+    return ret;
+}
@@ -0,0 +1,87 @@
+#ifndef _RESOLVER_H_
+#define _RESOLVER_H_ 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+
+#include "../membounds.h"
+#include "ndpmon_defs.h"
+
+/** @file
+ *  Asynchronous reverse host lookups with a TTL cache.
+ *
+ *  Alert handlers run on the event queue thread, so a slow DNS server
+ *  must not hold them up. Lookups are handed to a small pool of worker
+ *  threads, the results are cached (failures too, for a shorter time) and
+ *  the caller only waits until a deadline. Concurrent requests for the
+ *  same address share a single query.
+ */
+
+/** Maximum number of resolver worker threads. */
+#define RESOLVER_WORKERS_MAX 16
+/** Number of hash buckets in the lookup cache. */
+#define RESOLVER_CACHE_BUCKETS 256
+/** Maximum number of cached addresses (pending lookups included). */
+#define RESOLVER_CACHE_SIZE 4096
+/** Hostname reported while the lookup for an address is still running. */
+#define RESOLVER_PENDING "pending"
+
+/** Performs the actual (blocking) reverse lookup of an address.
+ *  @param address  The address to be resolved.
+ *  @param hostname Buffer to hold the hostname.
+ *  @param size     Size of the hostname buffer.
+ *  @return         0 on success, a getnameinfo() error code otherwise.
+ */
+typedef int (*resolver_lookup_t)(const struct in6_addr* address, char* hostname, size_t size);
+
+/** Resolver configuration, set from the use_reverse_hostlookups element. */
+struct resolver_settings {
+    /** Number of worker threads. */
+    int workers;
+    /** Milliseconds a caller waits for a lookup before "pending" is returned. */
+    int deadline;
+    /** Seconds a resolved hostname is kept in the cache. */
+    int positive_ttl;
+    /** Seconds a failed lookup is kept in the cache. */
+    int negative_ttl;
+};
+
+extern struct resolver_settings resolver_settings;
+
+/** Replaces the function used by the workers to resolve addresses.
+ *  The default uses getnameinfo(). Must be called before resolver_start(),
+ *  e.g. to run against a local stand-in resolver.
+ *  @param lookup The lookup function, NULL restores the default.
+ */
+void resolver_set_lookup(resolver_lookup_t lookup);
+
+/** Starts the worker threads.
+ *  @return 0 on success, -1 otherwise.
+ */
+int resolver_start();
+
+/** Stops the worker threads and releases the cache.
+ *  Lookups already in progress are waited for.
+ */
+void resolver_stop();
+
+/** Resolves an address to a hostname, waiting at most for the configured
+ *  deadline. If the resolver is not started, the lookup is done inline.
+ *  @param address  The address to be resolved.
+ *  @param hostname Buffer to hold the hostname, must be of HOST_NAME_SIZE.
+ *                  On failure it holds "<reason>", on timeout "pending".
+ *  @return         0 on success, 1 if the lookup is still pending,
+ *                  -1 if the lookup failed.
+ */
+int resolver_lookup(const struct in6_addr* const address, char* hostname);
+
+#endif
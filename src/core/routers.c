@@ -1,5 +1,158 @@
 #include "routers.h"
 
+/* INDEX */
+/* Slots of a new index, the indexes grow when half full. */
+#define ROUTER_INDEX_INITIAL 8
+
+/* FNV-1a, continues the hash of the previous parts. */
+static uint64_t router_hash(uint64_t hash, const void *data, size_t length)
+{
+	const uint8_t *bytes = (const uint8_t *)data;
+	size_t i;
+
+	for (i=0; i<length; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+#define ROUTER_HASH_INIT 14695981039346656037ULL
+
+static uint64_t router_hash_mac(const struct ether_addr *eth)
+{
+	return router_hash(ROUTER_HASH_INIT, eth, sizeof(struct ether_addr));
+}
+
+static uint64_t router_hash_router(const struct in6_addr *lla, const struct ether_addr *eth)
+{
+	return router_hash(router_hash_mac(eth), lla, sizeof(struct in6_addr));
+}
+
+/* Prefixes and routes. */
+static uint64_t router_hash_prefix(const struct in6_addr *prefix, int mask)
+{
+	uint8_t mask_byte = (uint8_t)mask;
+
+	return router_hash(router_hash(ROUTER_HASH_INIT, prefix, sizeof(struct in6_addr)), &mask_byte, 1);
+}
+
+static uint64_t router_hash_nameserver(const struct in6_addr *addr, uint32_t lifetime)
+{
+	return router_hash(router_hash(ROUTER_HASH_INIT, addr, sizeof(struct in6_addr)), &lifetime, sizeof(uint32_t));
+}
+
+static uint64_t router_hash_domain(const char *domain, uint32_t lifetime)
+{
+	return router_hash(router_hash(ROUTER_HASH_INIT, domain, strnlen(domain, MAX_DOMAINLEN)), &lifetime, sizeof(uint32_t));
+}
+
+/* Allocates an empty index, the index is left unused on failure. */
+static void router_index_init(struct router_index *index)
+{
+	memset(index, 0, sizeof(struct router_index));
+	index->hashes = (uint64_t *)calloc(ROUTER_INDEX_INITIAL, sizeof(uint64_t));
+	index->slots = (void **)calloc(ROUTER_INDEX_INITIAL, sizeof(void *));
+	if (index->hashes == NULL || index->slots == NULL)
+	{
+		perror("[routers] calloc failed");
+		free(index->hashes);
+		free(index->slots);
+		memset(index, 0, sizeof(struct router_index));
+		return;
+	}
+	index->capacity = ROUTER_INDEX_INITIAL;
+}
+
+static void router_index_free(struct router_index *index)
+{
+	free(index->hashes);
+	free(index->slots);
+	memset(index, 0, sizeof(struct router_index));
+}
+
+/* Empties an index and keeps its slots for the entries added next. An index
+ * dropped by a failed growth is allocated again. */
+static void router_index_clear(struct router_index *index)
+{
+	if (index->slots == NULL)
+	{
+		router_index_init(index);
+		return;
+	}
+	memset(index->hashes, 0, index->capacity*sizeof(uint64_t));
+	memset(index->slots, 0, index->capacity*sizeof(void *));
+	index->count = 0;
+}
+
+/* Puts an entry in the first free slot after its hash, there must be one. */
+static void router_index_place(struct router_index *index, uint64_t hash, void *entry)
+{
+	uint32_t i = (uint32_t)hash & (index->capacity-1);
+
+	while (index->slots[i] != NULL)
+		i = (i+1) & (index->capacity-1);
+	index->hashes[i] = hash;
+	index->slots[i] = entry;
+	index->count++;
+}
+
+/* Adds an entry that is not indexed yet. If the index cannot grow it is
+ * dropped, the list is then scanned by the lookups. */
+static void router_index_insert(struct router_index *index, uint64_t hash, void *entry)
+{
+	struct router_index grown;
+	uint32_t i;
+
+	if (index->slots == NULL)
+		return;
+
+	if (2*(index->count+1) > index->capacity)
+	{
+		grown.capacity = 2*index->capacity;
+		grown.count = 0;
+		grown.hashes = (uint64_t *)calloc(grown.capacity, sizeof(uint64_t));
+		grown.slots = (void **)calloc(grown.capacity, sizeof(void *));
+		if (grown.hashes == NULL || grown.slots == NULL)
+		{
+			perror("[routers] calloc failed");
+			free(grown.hashes);
+			free(grown.slots);
+			router_index_free(index);
+			return;
+		}
+		for (i=0; i<index->capacity; i++)
+		{
+			if (index->slots[i] != NULL)
+				router_index_place(&grown, index->hashes[i], index->slots[i]);
+		}
+		router_index_free(index);
+		*index = grown;
+	}
+	router_index_place(index, hash, entry);
+}
+
+/* Returns the entries with a given hash one after the other, *probed (0 on
+ * the first call) counts the slots looked at. Returns NULL after the last. */
+static void *router_index_next(const struct router_index *index, uint64_t hash, uint32_t *probed)
+{
+	uint32_t i;
+
+	while (*probed < index->capacity)
+	{
+		i = ((uint32_t)hash + *probed) & (index->capacity-1);
+		(*probed)++;
+		if (index->slots[i] == NULL)
+			return NULL;
+		if (index->hashes[i] == hash)
+			return index->slots[i];
+	}
+	return NULL;
+}
+/* INDEX */
+
+
+
 /* HELPERS */
 int is_router_lla_in(router_list_t *list, struct in6_addr lla)
 {
@@ -17,29 +170,60 @@ int is_router_lla_in(router_list_t *list, struct in6_addr lla)
 }
 
 int is_router_mac_in(router_list_t *list, struct ether_addr eth)
+{
+	return router_find_by_mac(list, &eth) != NULL;
+}
+
+router_list_t * router_find(router_list_t *list, const struct in6_addr *lla, const struct ether_addr *eth)
 {
 	router_list_t *tmp = list;
+	uint32_t probed = 0;
+	uint64_t hash;
+
+	if (list != NULL && list->router_index.slots != NULL)
+	{
+		hash = router_hash_router(lla, eth);
+		while ((tmp=(router_list_t *)router_index_next(&list->router_index, hash, &probed)) != NULL)
+		{
+			if(!MEMCMP(eth,&(tmp->mac), sizeof(struct ether_addr)) && IN6_ARE_ADDR_EQUAL(lla,&(tmp->lla)))
+				return tmp;
+		}
+		return NULL;
+	}
 
 	while(tmp != NULL)
 	{
-		if(!MEMCMP(&eth,&(tmp->mac), sizeof(struct ether_addr)))
-			return 1;
+		if(!MEMCMP(eth,&(tmp->mac), sizeof(struct ether_addr)))
+			if(IN6_ARE_ADDR_EQUAL(lla,&(tmp->lla)))
+				return tmp;
 
 		tmp = tmp->next;
 	}
 
-	return 0;
+	return NULL;
 }
 
-router_list_t * router_get(router_list_t *list, struct in6_addr lla, struct ether_addr eth)
+router_list_t * router_find_by_mac(router_list_t *list, const struct ether_addr *eth)
 {
 	router_list_t *tmp = list;
+	uint32_t probed = 0;
+	uint64_t hash;
 
-	while(tmp != NULL)
+	if (list != NULL && list->mac_index.slots != NULL)
 	{
-		if(!MEMCMP(&eth,&(tmp->mac), sizeof(struct ether_addr)))
-			if(IN6_ARE_ADDR_EQUAL(&lla,&(tmp->lla)))
+		hash = router_hash_mac(eth);
+		while ((tmp=(router_list_t *)router_index_next(&list->mac_index, hash, &probed)) != NULL)
+		{
+			if(!MEMCMP(eth,&(tmp->mac), sizeof(struct ether_addr)))
 				return tmp;
+		}
+		return NULL;
+	}
+
+	while(tmp != NULL)
+	{
+		if(!MEMCMP(eth,&(tmp->mac), sizeof(struct ether_addr)))
+			return tmp;
 
 		tmp = tmp->next;
 	}
@@ -47,9 +231,14 @@ router_list_t * router_get(router_list_t *list, struct in6_addr lla, struct ethe
 	return NULL;
 }
 
+router_list_t * router_get(router_list_t *list, struct in6_addr lla, struct ether_addr eth)
+{
+	return router_find(list, &lla, &eth);
+}
+
 int router_has_router(router_list_t *list, struct in6_addr lla, struct ether_addr eth) 
 {
-	if (router_get(list, lla, eth)==NULL) 
+	if (router_find(list, &lla, &eth)==NULL) 
 	{
 		/* Not found */
 		return 0;
@@ -64,10 +253,11 @@ int router_add(router_list_t **list, const struct ether_addr* eth, const struct
 	uint32_t mtu, int p_volatile)
 {
 	router_list_t *tmp = *list,*new=NULL;
+	int mac_known;
 
-	if(router_has_router(*list,*lla,*eth))
+	if(router_find(*list,lla,eth) != NULL)
 	{
-		fprintf(stderr,"Router already in list\n");
+		LOGGING(LOGGING_CACHE, LOGGING_LEVEL_DEBUG, "Router already in list\n");
 		return 0;
 	}
 
@@ -91,16 +281,35 @@ int router_add(router_list_t **list, const struct ether_addr* eth, const struct
 	new->nameservers = NULL;
 	new->domains = NULL;
 	new->routes = NULL;
+	new->ra_verified = NULL;
+	new->ra_verified_length = 0;
+	new->ra_verified_fingerprint = 0;
+	router_index_init(&new->prefix_index);
+	router_index_init(&new->route_index);
+	router_index_init(&new->nameserver_index);
+	router_index_init(&new->domain_index);
+	memset(&new->router_index, 0, sizeof(struct router_index));
+	memset(&new->mac_index, 0, sizeof(struct router_index));
 	new->next = NULL;
 
 	if(*list != NULL)
 	{
+		mac_known = router_find_by_mac(*list, eth) != NULL;
 		while(tmp->next != NULL)
 			tmp=tmp->next;
 		tmp->next=new;
 	}
 	else
+	{
+		/* the first entry holds the indexes of the list: */
+		mac_known = 0;
+		router_index_init(&new->router_index);
+		router_index_init(&new->mac_index);
 		*list = new;
+	}
+	router_index_insert(&(*list)->router_index, router_hash_router(lla, eth), new);
+	if (!mac_known)
+		router_index_insert(&(*list)->mac_index, router_hash_mac(eth), new);
 
 	return 1;
 }
@@ -112,8 +321,12 @@ int router_add(router_list_t **list, const struct ether_addr* eth, const struct
 int router_add_prefix(router_list_t *list, struct in6_addr lla, struct ether_addr eth, struct in6_addr prefix, int mask, 
 	uint8_t flags_reserved, uint32_t valid_lifetime, uint32_t preferred_lifetime)
 {
-	router_list_t *tmp = list;
+	router_list_t *tmp = NULL;
 	prefix_t *new, *ptmp = NULL;
+	int indexed;
+
+	tmp = router_find(list, &lla, &eth);
+	if (tmp==NULL) return 0;
 
 	if( (new=(prefix_t *)malloc(sizeof(prefix_t))) == NULL)
 	{
@@ -128,8 +341,8 @@ int router_add_prefix(router_list_t *list, struct in6_addr lla, struct ether_add
 	new->param_preferred_time = preferred_lifetime;
 	new->next=NULL;
 
-	tmp = router_get(list,  lla, eth);
-	if (tmp==NULL) return 0;
+	/* the index refers to the first of equal prefixes: */
+	indexed = router_find_prefix(tmp, &prefix, mask) != NULL;
 
 	ptmp = tmp->prefixes;
 	if(ptmp == NULL) {
@@ -140,20 +353,31 @@ int router_add_prefix(router_list_t *list, struct in6_addr lla, struct ether_add
 		}
 		ptmp->next=new;
 	}
+	if (!indexed)
+		router_index_insert(&tmp->prefix_index, router_hash_prefix(&prefix, mask), new);
 	return 1;
 }
 
-prefix_t* router_get_prefix(router_list_t *list, struct in6_addr lla, struct ether_addr eth, struct in6_addr prefix, int mask)
+prefix_t* router_find_prefix(router_list_t *router, const struct in6_addr *prefix, int mask)
 {
-	router_list_t* router = router_get(list, lla, eth);
 	prefix_t *ptmp;
+	uint32_t probed = 0;
 
 	if (router==NULL) {
 		return NULL;
 	}
+	if (router->prefix_index.slots != NULL) {
+		uint64_t hash = router_hash_prefix(prefix, mask);
+		while ((ptmp=(prefix_t *)router_index_next(&router->prefix_index, hash, &probed)) != NULL) {
+			if( (ptmp->mask == mask) && (IN6_ARE_ADDR_EQUAL(prefix,&(ptmp->prefix))) ) {
+				return ptmp;
+			}
+		}
+		return NULL;
+	}
 	ptmp = router->prefixes;
 	while(ptmp != NULL) {
-		if( (ptmp->mask == mask) && (IN6_ARE_ADDR_EQUAL(&prefix,&(ptmp->prefix))) ) {
+		if( (ptmp->mask == mask) && (IN6_ARE_ADDR_EQUAL(prefix,&(ptmp->prefix))) ) {
 			return ptmp;
 		}
 		ptmp = ptmp->next;
@@ -161,6 +385,11 @@ prefix_t* router_get_prefix(router_list_t *list, struct in6_addr lla, struct eth
 	return NULL;
 }
 
+prefix_t* router_get_prefix(router_list_t *list, struct in6_addr lla, struct ether_addr eth, struct in6_addr prefix, int mask)
+{
+	return router_find_prefix(router_find(list, &lla, &eth), &prefix, mask);
+}
+
 int router_has_prefix(router_list_t *list, struct in6_addr lla, struct ether_addr eth, struct in6_addr prefix, int mask) 
 {
         if (router_get_prefix(list, lla, eth, prefix, mask)==NULL) 
@@ -176,15 +405,17 @@ int router_has_prefix(router_list_t *list, struct in6_addr lla, struct ether_add
 /* RFC6106 - RDNSS */
 int router_add_nameserver(router_list_t *list, struct ether_addr eth, struct in6_addr addr, uint32_t lifetime)
 {
-	router_list_t *tmp = list;
-	rdnss_t *new = NULL;
+	router_list_t *tmp = router_find_by_mac(list, &eth);
+	rdnss_t *new = NULL, *ntmp = NULL;
 
 	/* Already in list ? */
-	if( router_has_nameserver(list, eth, addr, lifetime) )
+	if( router_find_nameserver(tmp, &addr, lifetime) != NULL )
 	{
-		fprintf(stderr,"[router_add_nameserver] Nameserver already in list\n");
+		LOGGING(LOGGING_CACHE, LOGGING_LEVEL_DEBUG, "[router_add_nameserver] Nameserver already in list\n");
 		return 0;
 	}
+	if( tmp == NULL )
+		return 0;
 	
 	/* Add a new one */
 	if( (new=(rdnss_t *)malloc(sizeof(rdnss_t))) == NULL)
@@ -196,96 +427,113 @@ int router_add_nameserver(router_list_t *list, struct ether_addr eth, struct in6
 	new->lifetime = lifetime;
 	new->next = NULL;
 
-	/* find the router and append the nameserver */
-	while(tmp != NULL)
+	/* append the nameserver to the router */
+	ntmp = tmp->nameservers;
+	if(ntmp == NULL)
 	{
-		if(!MEMCMP(&eth,&(tmp->mac), sizeof(struct ether_addr)))
-		{
-				rdnss_t *ntmp = tmp->nameservers;
-				if(ntmp == NULL)
-				{
-					/* First element */
-					tmp->nameservers = new;
-				}
-				else
-				{
-					/* Got to the end and append it */
-					while(ntmp->next != NULL)
-						ntmp = ntmp->next;
-					ntmp->next = new;
-				}
-				return 1;
-		}
-		else
-			tmp = tmp->next;
+		/* First element */
+		tmp->nameservers = new;
 	}
-	
-	return 0;
+	else
+	{
+		/* Got to the end and append it */
+		while(ntmp->next != NULL)
+			ntmp = ntmp->next;
+		ntmp->next = new;
+	}
+	router_index_insert(&tmp->nameserver_index, router_hash_nameserver(&addr, lifetime), new);
+	return 1;
 }
 
-int router_has_nameserver(router_list_t *list, struct ether_addr eth, struct in6_addr addr, uint32_t lifetime)
+rdnss_t* router_find_nameserver(router_list_t *router, const struct in6_addr *addr, uint32_t lifetime)
 {
-	router_list_t *tmp = list;
-	/* Find the router */
-	while(tmp != NULL)
+	rdnss_t *ntmp;
+	uint32_t probed = 0;
+
+	if (router == NULL)
+		return NULL;
+
+	if (router->nameserver_index.slots != NULL)
 	{
-		if(!MEMCMP(&eth,&(tmp->mac), sizeof(struct ether_addr)))
+		uint64_t hash = router_hash_nameserver(addr, lifetime);
+		while ((ntmp=(rdnss_t *)router_index_next(&router->nameserver_index, hash, &probed)) != NULL)
 		{
-				rdnss_t *ntmp = tmp->nameservers;
-				/* check in nameservers list if it is present or not */
-				while(ntmp != NULL)
-				{
-					if( (IN6_ARE_ADDR_EQUAL(&addr,&(ntmp->address))) && (ntmp->lifetime == lifetime) )
-						return 1;
-
-					ntmp = ntmp->next;
-				}
-				return 0;
+			if( (IN6_ARE_ADDR_EQUAL(addr,&(ntmp->address))) && (ntmp->lifetime == lifetime) )
+				return ntmp;
 		}
-		tmp = tmp->next;
+		return NULL;
 	}
-	return 0;
+
+	/* check in nameservers list if it is present or not */
+	ntmp = router->nameservers;
+	while(ntmp != NULL)
+	{
+		if( (IN6_ARE_ADDR_EQUAL(addr,&(ntmp->address))) && (ntmp->lifetime == lifetime) )
+			return ntmp;
+
+		ntmp = ntmp->next;
+	}
+	return NULL;
+}
+
+int router_has_nameserver(router_list_t *list, struct ether_addr eth, struct in6_addr addr, uint32_t lifetime)
+{
+	return router_find_nameserver(router_find_by_mac(list, &eth), &addr, lifetime) != NULL;
 }
 /* RFC6106 - RDNSS */
 
 
 
 /* RFC6106 - DNSSL */
-int router_has_domain(router_list_t *list, struct ether_addr eth, const char *domain, uint32_t lifetime)
+dnssl_t* router_find_domain(router_list_t *router, const char *domain, uint32_t lifetime)
 {
-	router_list_t *tmp = list;
-	/* Find the router */
-	while(tmp != NULL)
+	dnssl_t *dtmp;
+	uint32_t probed = 0;
+
+	if (router == NULL)
+		return NULL;
+
+	if (router->domain_index.slots != NULL)
 	{
-		if(!MEMCMP(&eth,&(tmp->mac), sizeof(struct ether_addr)))
+		uint64_t hash = router_hash_domain(domain, lifetime);
+		while ((dtmp=(dnssl_t *)router_index_next(&router->domain_index, hash, &probed)) != NULL)
 		{
-				dnssl_t *dtmp = tmp->domains;
-				/* check in domains list if it is present or not */
-				while(dtmp != NULL)
-				{
-					if( !STRNCMP(domain, dtmp->domain, MAX_DOMAINLEN) && (dtmp->lifetime == lifetime) )
-						return 1;
-
-					dtmp = dtmp->next;
-				}
-				return 0;
+			if( !STRNCMP(domain, dtmp->domain, MAX_DOMAINLEN) && (dtmp->lifetime == lifetime) )
+				return dtmp;
 		}
-		tmp = tmp->next;
+		return NULL;
 	}
-	return 0;
+
+	/* check in domains list if it is present or not */
+	dtmp = router->domains;
+	while(dtmp != NULL)
+	{
+		if( !STRNCMP(domain, dtmp->domain, MAX_DOMAINLEN) && (dtmp->lifetime == lifetime) )
+			return dtmp;
+
+		dtmp = dtmp->next;
+	}
+	return NULL;
+}
+
+int router_has_domain(router_list_t *list, struct ether_addr eth, const char *domain, uint32_t lifetime)
+{
+	return router_find_domain(router_find_by_mac(list, &eth), domain, lifetime) != NULL;
 }
 
 int router_add_domain(router_list_t *list, struct ether_addr eth, const char *domain, uint32_t lifetime)
 {
-	router_list_t *tmp = list;
-	dnssl_t *new = NULL;
+	router_list_t *tmp = router_find_by_mac(list, &eth);
+	dnssl_t *new = NULL, *dtmp = NULL;
 
 	/* Already in list ? */
-	if( router_has_domain(list, eth, domain, lifetime) )
+	if( router_find_domain(tmp, domain, lifetime) != NULL )
 	{
-		fprintf(stderr,"[router_add_domain] Domain already in list\n");
+		LOGGING(LOGGING_CACHE, LOGGING_LEVEL_DEBUG, "[router_add_domain] Domain already in list\n");
 		return 0;
 	}
+	if( tmp == NULL )
+		return 0;
 	
 	/* Add a new one */
 	if( (new=(dnssl_t *)malloc(sizeof(dnssl_t))) == NULL)
@@ -298,31 +546,23 @@ int router_add_domain(router_list_t *list, struct ether_addr eth, const char *do
 	new->lifetime = lifetime;
 	new->next = NULL;
 
-	/* find the router and append the domain */
-	while(tmp != NULL)
+	/* append the domain to the router */
+	dtmp = tmp->domains;
+	if(dtmp == NULL)
 	{
-		if(!MEMCMP(&eth,&(tmp->mac), sizeof(struct ether_addr)))
-		{
-				dnssl_t *dtmp = tmp->domains;
-				if(dtmp == NULL)
-				{
-					/* First element */
-					tmp->domains = new;
-				}
-				else
-				{
-					/* Got to the end and append it */
-					while(dtmp->next != NULL)
-						dtmp = dtmp->next;
-					dtmp->next = new;
-				}
-				return 1;
-		}
-		else
-			tmp = tmp->next;
+		/* First element */
+		tmp->domains = new;
 	}
-	
-	return 0;
+	else
+	{
+		/* Got to the end and append it */
+		while(dtmp->next != NULL)
+			dtmp = dtmp->next;
+		dtmp->next = new;
+	}
+	/* hashed as stored, a longer domain is truncated: */
+	router_index_insert(&tmp->domain_index, router_hash_domain(new->domain, lifetime), new);
+	return 1;
 }
 /* RFC6106 - DNSSL */
 
@@ -331,8 +571,13 @@ int router_add_domain(router_list_t *list, struct ether_addr eth, const char *do
 /* RFC4191 - Route Info */
 int router_add_route(router_list_t *list, struct in6_addr lla, struct ether_addr eth, struct in6_addr prefix, int mask, uint8_t pref_reserved, uint32_t lifetime)
 {
-	router_list_t *tmp = list;
+	router_list_t *tmp = NULL;
 	route_info_t *new_route, *rtmp = NULL;
+	int indexed;
+
+	tmp = router_find(list, &lla, &eth);
+	if (tmp==NULL) 
+		return 0;
 
 	if( (new_route=(route_info_t *)malloc(sizeof(route_info_t))) == NULL)
 	{
@@ -346,9 +591,8 @@ int router_add_route(router_list_t *list, struct in6_addr lla, struct ether_addr
 	new_route->lifetime            = lifetime;
 	new_route->next=NULL;
 
-	tmp = router_get(list,  lla, eth);
-	if (tmp==NULL) 
-		return 0;
+	/* the index refers to the first of equal routes: */
+	indexed = router_find_route(tmp, &prefix, mask) != NULL;
 
 	rtmp = tmp->routes;
 	if(rtmp == NULL) 
@@ -363,6 +607,8 @@ int router_add_route(router_list_t *list, struct in6_addr lla, struct ether_addr
 		}
 		rtmp->next=new_route;
 	}
+	if (!indexed)
+		router_index_insert(&tmp->route_index, router_hash_prefix(&prefix, mask), new_route);
 
 	return 1;
 }
@@ -377,20 +623,33 @@ int router_has_route(router_list_t *list, struct in6_addr lla, struct ether_addr
 	return 1;
 }
 
-route_info_t* router_get_route(router_list_t *list, struct in6_addr lla, struct ether_addr eth, struct in6_addr prefix, int mask)
+route_info_t* router_find_route(router_list_t *router, const struct in6_addr *prefix, int mask)
 {
-	router_list_t* router = router_get(list, lla, eth);
 	route_info_t *rtmp;
+	uint32_t probed = 0;
 
 	if (router==NULL) 
 	{
 		return NULL;
 	}
 
+	if (router->route_index.slots != NULL)
+	{
+		uint64_t hash = router_hash_prefix(prefix, mask);
+		while ((rtmp=(route_info_t *)router_index_next(&router->route_index, hash, &probed)) != NULL)
+		{
+			if( (rtmp->mask == mask) && (IN6_ARE_ADDR_EQUAL(prefix,&(rtmp->prefix))) ) 
+			{
+				return rtmp;
+			}
+		}
+		return NULL;
+	}
+
 	rtmp = router->routes;
 	while(rtmp != NULL) 
 	{
-		if( (rtmp->mask == mask) && (IN6_ARE_ADDR_EQUAL(&prefix,&(rtmp->prefix))) ) 
+		if( (rtmp->mask == mask) && (IN6_ARE_ADDR_EQUAL(prefix,&(rtmp->prefix))) ) 
 		{
 			return rtmp;
 		}
@@ -400,6 +659,11 @@ route_info_t* router_get_route(router_list_t *list, struct in6_addr lla, struct
 	return NULL;
 }
 
+route_info_t* router_get_route(router_list_t *list, struct in6_addr lla, struct ether_addr eth, struct in6_addr prefix, int mask)
+{
+	return router_find_route(router_find(list, &lla, &eth), &prefix, mask);
+}
+
 /* RFC4191 - Route Info */
 
 
@@ -413,7 +677,7 @@ int router_add_address(router_list_t *list, struct ether_addr eth, struct in6_ad
 	
 	if(router_has_address(list,eth,addr))
 	{
-		fprintf(stderr,"Address already in list\n");
+		LOGGING(LOGGING_CACHE, LOGGING_LEVEL_DEBUG, "Address already in list\n");
 		return 0;
 	}
 	
@@ -427,46 +691,40 @@ int router_add_address(router_list_t *list, struct ether_addr eth, struct in6_ad
 	new->address = addr;
 	new->next=NULL;
 
-	while(tmp != NULL)
+	tmp = router_find_by_mac(list, &eth);
+	if(tmp != NULL)
 	{
-		if(!MEMCMP(&eth,&(tmp->mac), sizeof(struct ether_addr)))
+		address_t *atmp = tmp->addresses;
+		if(atmp == NULL)
+			tmp->addresses = new;
+		else
 		{
-				address_t *atmp = tmp->addresses;
-				if(atmp == NULL)
-					tmp->addresses = new;
-				else
-				{
-					while(atmp->next != NULL)
-						atmp=atmp->next;
-					atmp->next=new;
-				}
-				return 1;
+			while(atmp->next != NULL)
+				atmp=atmp->next;
+			atmp->next=new;
 		}
-		else
-			tmp = tmp->next;
+		return 1;
 	}
 	
+	free(new);
 	return 0;
 }
 
 int router_has_address(router_list_t *list, struct ether_addr eth, struct in6_addr addr)
 {
-	router_list_t *tmp = list;
-	while(tmp != NULL)
+	router_list_t *tmp = router_find_by_mac(list, &eth);
+	address_t *atmp;
+
+	if(tmp == NULL)
+		return 0;
+
+	atmp = tmp->addresses;
+	while(atmp != NULL)
 	{
-		if(!MEMCMP(&eth,&(tmp->mac), sizeof(struct ether_addr)))
-		{
-				address_t *atmp = tmp->addresses;
-				while(atmp != NULL)
-				{
-					if( IN6_ARE_ADDR_EQUAL(&addr,&(atmp->address)) )
-						return 1;
+		if( IN6_ARE_ADDR_EQUAL(&addr,&(atmp->address)) )
+			return 1;
 
-					atmp = atmp->next;
-				}
-				return 0;
-		}
-		tmp = tmp->next;
+		atmp = atmp->next;
 	}
 	return 0;
 }
@@ -475,6 +733,36 @@ int router_has_address(router_list_t *list, struct ether_addr eth, struct in6_ad
 
 
 /* UTILS */
+int router_ra_is_verified(const router_list_t *router, const uint8_t *canonical, size_t length, uint64_t fingerprint)
+{
+	return router->ra_verified != NULL
+		&& router->ra_verified_fingerprint == fingerprint
+		&& router->ra_verified_length == length
+		&& memcmp(router->ra_verified, canonical, length) == 0;
+}
+
+void router_ra_set_verified(router_list_t *router, const uint8_t *canonical, size_t length, uint64_t fingerprint)
+{
+	uint8_t *copy;
+
+	if (router->ra_verified_length != length)
+	{
+		if( (copy=(uint8_t *)realloc(router->ra_verified, length)) == NULL)
+		{
+			/* keep checking every RA of the router: */
+			perror("realloc");
+			free(router->ra_verified);
+			router->ra_verified = NULL;
+			router->ra_verified_length = 0;
+			return;
+		}
+		router->ra_verified = copy;
+	}
+	memcpy(router->ra_verified, canonical, length);
+	router->ra_verified_length = length;
+	router->ra_verified_fingerprint = fingerprint;
+}
+
 int nb_router(router_list_t *routers)
 {
 	int n = 0;
@@ -516,6 +804,16 @@ void router_copy(router_list_t* destination, router_list_t* source)
 	destination->param_retrans_timer = source->param_retrans_timer;
 	destination->param_router_lifetime = source->param_router_lifetime;
 	destination->params_volatile = source->params_volatile;
+	destination->ra_verified = NULL;
+	destination->ra_verified_length = 0;
+	destination->ra_verified_fingerprint = 0;
+	/* the copies are not indexed, their lists are scanned: */
+	memset(&destination->prefix_index, 0, sizeof(struct router_index));
+	memset(&destination->route_index, 0, sizeof(struct router_index));
+	memset(&destination->nameserver_index, 0, sizeof(struct router_index));
+	memset(&destination->domain_index, 0, sizeof(struct router_index));
+	memset(&destination->router_index, 0, sizeof(struct router_index));
+	memset(&destination->mac_index, 0, sizeof(struct router_index));
 	destination->next = NULL;
 
 	/* copy addresses: */
@@ -806,6 +1104,8 @@ int clean_router_prefixes(router_list_t **list, struct ether_addr eth)
 				free(ptodel);
 			}
 
+			tmp->prefixes = NULL;
+			router_index_clear(&tmp->prefix_index);
 			return 1;
 		}
 
@@ -832,6 +1132,8 @@ int clean_router_routes(router_list_t **list, struct ether_addr eth)
 				free(rtodel);
 			}
 
+			tmp->routes = NULL;
+			router_index_clear(&tmp->route_index);
 			return 1;
 		}
 
@@ -858,6 +1160,8 @@ int clean_router_rdnss(router_list_t **list, struct ether_addr eth)
 				free(ntodel);
 			}
 
+			tmp->nameservers = NULL;
+			router_index_clear(&tmp->nameserver_index);
 			return 1;
 		}
 
@@ -884,6 +1188,8 @@ int clean_router_dnssl(router_list_t **list, struct ether_addr eth)
 				free(dtodel);
 			}
 
+			tmp->domains = NULL;
+			router_index_clear(&tmp->domain_index);
 			return 1;
 		}
 
@@ -910,6 +1216,7 @@ int clean_router_addresses(router_list_t **list, struct ether_addr eth)
 				free(atodel);
 			}
 
+			tmp->addresses = NULL;
 			return 1;
 		}
 
@@ -936,6 +1243,13 @@ int clean_routers(router_list_t **list)
 		clean_router_rdnss(&tmp,tmp->mac);
 		clean_router_dnssl(&tmp,tmp->mac);
 		clean_router_routes(&tmp,tmp->mac);
+		free(tmp->ra_verified);
+		router_index_free(&tmp->prefix_index);
+		router_index_free(&tmp->route_index);
+		router_index_free(&tmp->nameserver_index);
+		router_index_free(&tmp->domain_index);
+		router_index_free(&tmp->router_index);
+		router_index_free(&tmp->mac_index);
 		tmp = tmp->next;
 		free(rtodel);
 	}
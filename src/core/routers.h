@@ -24,8 +24,64 @@
 #include "../ndpmon_netheaders.h"
 
 #include "cache_types.h"
+#include "logging.h"
 #include "print_packet_info.h"
 
+/* The lists of routers and of their prefixes, routes, nameservers and
+   domains are indexed by hash sets (see struct router_index), which the
+   functions below maintain. Entries must thus be added with these
+   functions. Lists that are not indexed, e.g. the copies of router_copy(),
+   are scanned. The by value functions (router_get(), router_has_*() ...)
+   are kept as wrappers of the router_find*() ones.
+*/
+
+/** Looks a router up by link local and ETHERNET address.
+    @param list The list of routers.
+    @param lla  The link local address.
+    @param eth  The ETHERNET address.
+    @return     The router, NULL if not found.
+*/
+router_list_t * router_find(router_list_t *list, const struct in6_addr *lla, const struct ether_addr *eth);
+
+/** Looks the first router with a given ETHERNET address up.
+    @param list The list of routers.
+    @param eth  The ETHERNET address.
+    @return     The router, NULL if not found.
+*/
+router_list_t * router_find_by_mac(router_list_t *list, const struct ether_addr *eth);
+
+/** Looks a prefix of a router up.
+    @param router The router, may be NULL.
+    @param prefix The prefix.
+    @param mask   The prefix length.
+    @return       The first matching prefix, NULL if not found.
+*/
+prefix_t* router_find_prefix(router_list_t *router, const struct in6_addr *prefix, int mask);
+
+/** Looks a route of a router up.
+    @param router The router, may be NULL.
+    @param prefix The prefix of the route.
+    @param mask   The prefix length.
+    @return       The first matching route, NULL if not found.
+*/
+route_info_t* router_find_route(router_list_t *router, const struct in6_addr *prefix, int mask);
+
+/** Looks a nameserver of a router up.
+    @param router   The router, may be NULL.
+    @param addr     The address of the nameserver.
+    @param lifetime The lifetime advertised.
+    @return         The nameserver, NULL if not found.
+*/
+rdnss_t* router_find_nameserver(router_list_t *router, const struct in6_addr *addr, uint32_t lifetime);
+
+/** Looks a search domain of a router up.
+    @param router   The router, may be NULL.
+    @param domain   The domain.
+    @param lifetime The lifetime advertised.
+    @return         The domain, NULL if not found.
+*/
+dnssl_t* router_find_domain(router_list_t *router, const char *domain, uint32_t lifetime);
+
 router_list_t * router_get(router_list_t *list, struct in6_addr lla, struct ether_addr eth);
 
 int is_router_lla_in(router_list_t *list, struct in6_addr lla);
@@ -66,6 +122,23 @@ int router_has_route(router_list_t *list, struct in6_addr lla, struct ether_addr
 route_info_t* router_get_route(router_list_t *list, struct in6_addr lla, struct ether_addr eth, struct in6_addr prefix, int mask);
 
 
+/** Tells if a RA is the last one of a router that passed all checks.
+    @param router      The router.
+    @param canonical   Canonical form of the RA (see watch_ra()).
+    @param length      Length of the canonical form.
+    @param fingerprint Fingerprint of the canonical form.
+    @return            1 if the RA was verified, 0 otherwise.
+*/
+int router_ra_is_verified(const router_list_t *router, const uint8_t *canonical, size_t length, uint64_t fingerprint);
+
+/** Remembers the last RA of a router that passed all checks.
+    @param router      The router.
+    @param canonical   Canonical form of the RA (see watch_ra()).
+    @param length      Length of the canonical form.
+    @param fingerprint Fingerprint of the canonical form.
+*/
+void router_ra_set_verified(router_list_t *router, const uint8_t *canonical, size_t length, uint64_t fingerprint);
+
 int nb_router(router_list_t *routers);
 void print_routers(router_list_t *list);
 
@@ -220,10 +220,18 @@ int settings_parse(xmlNodePtr element) {
             syslog (LOG_NOTICE, "NDPMon started by user %d", getuid ());
         } else if (STRCMP(setting->name, "use_reverse_hostlookups")==0) {
             char* value = (char*)XML_GET_CONTENT(setting->children);
+
             if (value==NULL || strcmp("1", value)!=0)
                 use_reverse_hostlookups=0;
             else
                 use_reverse_hostlookups=1;
+            /* optional resolver tuning: */
+            if (settings_get_int(setting, "workers", &resolver_settings.workers, 1, RESOLVER_WORKERS_MAX)==-1
+                    || settings_get_int(setting, "deadline", &resolver_settings.deadline, 0, 60000)==-1
+                    || settings_get_int(setting, "positive_ttl", &resolver_settings.positive_ttl, 0, 604800)==-1
+                    || settings_get_int(setting, "negative_ttl", &resolver_settings.negative_ttl, 0, 604800)==-1) {
+                return -1;
+            }
         }
         setting = setting->next;
     }
@@ -268,7 +276,9 @@ void settings_print() {
         fprintf(stderr, "    no ignor autoconf\n");
     fprintf(stderr, "    syslog facility %s\n", syslog_facility);
     if (use_reverse_hostlookups==1)
-        fprintf(stderr, "    use reverse hostlookups\n");
+        fprintf(stderr, "    use reverse hostlookups (%i workers, deadline %i ms, ttl %i/%i s)\n",
+                resolver_settings.workers, resolver_settings.deadline,
+                resolver_settings.positive_ttl, resolver_settings.negative_ttl);
     else
         fprintf(stderr, "    no use reverse hostlookups\n");
     fprintf(stderr, "}\n");
@@ -280,6 +290,7 @@ void settings_print() {
 int settings_store(xmlNodePtr settings_element) {
     xmlNodePtr actions_high_element=NULL;
     xmlNodePtr actions_low_element=NULL;
+    xmlNodePtr reverse_hostlookups_element=NULL;
     struct extinfo_list** extinfo;
     
     /* store actions high priority: */
@@ -296,7 +307,11 @@ int settings_store(xmlNodePtr settings_element) {
     xmlNewChild(settings_element, NULL, BAD_CAST "admin_mail",   BAD_CAST admin_mail);
     xmlNewChild(settings_element, NULL, BAD_CAST "ignor_autoconf",  (ignor_autoconf==1) ? BAD_CAST "1" : BAD_CAST "0" );
     xmlNewChild(settings_element, NULL, BAD_CAST "syslog_facility", BAD_CAST syslog_facility);
-    xmlNewChild(settings_element, NULL, BAD_CAST "use_reverse_hostlookups", (use_reverse_hostlookups==1) ? BAD_CAST "1" : BAD_CAST "0" );
+    reverse_hostlookups_element = xmlNewChild(settings_element, NULL, BAD_CAST "use_reverse_hostlookups", (use_reverse_hostlookups==1) ? BAD_CAST "1" : BAD_CAST "0" );
+    settings_set_int(reverse_hostlookups_element, "workers", resolver_settings.workers);
+    settings_set_int(reverse_hostlookups_element, "deadline", resolver_settings.deadline);
+    settings_set_int(reverse_hostlookups_element, "positive_ttl", resolver_settings.positive_ttl);
+    settings_set_int(reverse_hostlookups_element, "negative_ttl", resolver_settings.negative_ttl);
     /* store plugin global settings: */
     extinfo = settings_extinfo_lock();
     extinfo_list_save(settings_element, *extinfo);
@@ -312,3 +327,36 @@ struct extinfo_list** settings_extinfo_lock() {
 void settings_extinfo_unlock() {
     pthread_mutex_unlock(&settings_extinfo_mutex);
 }
+
+void settings_data_free(void** data) {
+    free(*data);
+    *data = NULL;
+}
+
+int settings_get_int(xmlNodePtr element, const char* name, int* value, int min, int max) {
+    xmlChar* property = xmlGetProp(element, BAD_CAST name);
+    char* end;
+    long number;
+
+    if (property==NULL) {
+        return 0;
+    }
+    errno = 0;
+    number = strtol((char*)property, &end, 10);
+    if (errno!=0 || end==(char*)property || *end!='\0' || number<min || number>max) {
+        fprintf(stderr, "[settings] ERROR: %s: %s must be an integer between %i and %i.\n",
+                (char*)element->name, name, min, max);
+        xmlFree(property);
+        return -1;
+    }
+    xmlFree(property);
+    *value = (int)number;
+    return 0;
+}
+
+void settings_set_int(xmlNodePtr element, const char* name, int value) {
+    char number[16];
+
+    snprintf(number, sizeof(number), "%i", value);
+    xmlNewProp(element, BAD_CAST name, BAD_CAST number);
+}
@@ -2,9 +2,12 @@
 #define _SETTINGS_H_
 
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <syslog.h>
 #include <string.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <pthread.h>
 
@@ -14,9 +17,16 @@
 #include "ndpmon_defs.h"
 
 #include "extinfo.h"
+#include "resolver.h"
 
 
 
+/** Converts a syslog facility name (e.g. "LOG_LOCAL1") to its value.
+ *  @param value    The facility name.
+ *  @param facility Will hold the facility, -1 if the name is unknown.
+ */
+void str_to_facility(char* value, int* facility);
+
 void settings_action_selector_print(struct action_selector* actions);
 
 void settings_print();
@@ -29,4 +39,29 @@ struct extinfo_list** settings_extinfo_lock();
 
 void settings_extinfo_unlock();
 
+/** Frees the settings of an extinfo type that hold no references, to be
+ *  registered as the free function with extinfo_type_list_add().
+ *  @param data The settings, set to NULL.
+ */
+void settings_data_free(void** data);
+
+/** Reads an integer attribute of a settings element.
+ *  @param element The settings element.
+ *  @param name    The attribute.
+ *  @param value   Holds the default and is left untouched if the attribute
+ *                 is not present.
+ *  @param min     The least value allowed.
+ *  @param max     The greatest value allowed.
+ *  @return        0 on success, -1 with an error printed if the attribute
+ *                 is not an integer within [min, max].
+ */
+int settings_get_int(xmlNodePtr element, const char* name, int* value, int min, int max);
+
+/** Writes an integer attribute of a settings element.
+ *  @param element The settings element.
+ *  @param name    The attribute.
+ *  @param value   Its value.
+ */
+void settings_set_int(xmlNodePtr element, const char* name, int value);
+
 #endif
@@ -0,0 +1,167 @@
+#include "stats.h"
+
+/* the alert reasons, an entry is written once before the count is raised: */
+static char stats_reasons[PROBE_STATS_REASONS_MAX][ALERT_REASON_SIZE];
+static int stats_reasons_count = 0;
+static pthread_mutex_t stats_reasons_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stats_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t stats_thread;
+static int stats_running = 0;
+static int stats_started = 0;
+
+void stats_packet(struct probe* probe, uint8_t icmp6_type, int length) {
+    __atomic_fetch_add(&probe->stats.packets[icmp6_type], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&probe->stats.bytes, (uint64_t)length, __ATOMIC_RELAXED);
+}
+
+/* Looks up the index of a reason in the first count entries. */
+static int stats_reason_find(const char* reason, int count) {
+    int i;
+
+    for (i=0; i<count; i++) {
+        if (strncmp(stats_reasons[i], reason, ALERT_REASON_SIZE)==0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Returns the index of a reason, adds it to the table if it is new. */
+static int stats_reason_index(const char* reason) {
+    int count = __atomic_load_n(&stats_reasons_count, __ATOMIC_ACQUIRE);
+    int index;
+
+    if ((index=stats_reason_find(reason, count))!=-1) {
+        return index;
+    }
+    pthread_mutex_lock(&stats_reasons_lock);
+    count = stats_reasons_count;
+    if ((index=stats_reason_find(reason, count))==-1) {
+        if (count<PROBE_STATS_REASONS_MAX-1) {
+            strlcpy(stats_reasons[count], reason, ALERT_REASON_SIZE);
+            index = count;
+        } else {
+            /* the last entry collects all further reasons: */
+            strlcpy(stats_reasons[PROBE_STATS_REASONS_MAX-1], "other", ALERT_REASON_SIZE);
+            index = PROBE_STATS_REASONS_MAX-1;
+        }
+        __atomic_store_n(&stats_reasons_count, index+1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&stats_reasons_lock);
+    return index;
+}
+
+void stats_alert(const struct probe* probe, const char* reason) {
+    /* the counters are the only members of a probe written through a const pointer: */
+    struct probe_stats* stats = (struct probe_stats*) &probe->stats;
+
+    __atomic_fetch_add(&stats->alerts[stats_reason_index(reason)], 1, __ATOMIC_RELAXED);
+}
+
+int stats_reason_count() {
+    return __atomic_load_n(&stats_reasons_count, __ATOMIC_ACQUIRE);
+}
+
+const char* stats_reason_name(int index) {
+    return stats_reasons[index];
+}
+
+void stats_probe_get(const struct probe* probe, struct probe_stats* stats) {
+    int i;
+
+    for (i=0; i<256; i++) {
+        stats->packets[i] = __atomic_load_n(&probe->stats.packets[i], __ATOMIC_RELAXED);
+    }
+    stats->bytes = __atomic_load_n(&probe->stats.bytes, __ATOMIC_RELAXED);
+    for (i=0; i<PROBE_STATS_REASONS_MAX; i++) {
+        stats->alerts[i] = __atomic_load_n(&probe->stats.alerts[i], __ATOMIC_RELAXED);
+    }
+    stats->neighbors = __atomic_load_n(&probe->stats.neighbors, __ATOMIC_RELAXED);
+    stats->addresses = __atomic_load_n(&probe->stats.addresses, __ATOMIC_RELAXED);
+    stats->routers   = __atomic_load_n(&probe->stats.routers, __ATOMIC_RELAXED);
+    stats->refreshed = __atomic_load_n(&probe->stats.refreshed, __ATOMIC_RELAXED);
+}
+
+void stats_probe_refresh(struct probe* probe) {
+    neighbor_list_t* tmp_neighbors = probe->neighbors;
+    uint64_t addresses = 0;
+
+    while (tmp_neighbors!=NULL) {
+        address_t* tmp_addresses = tmp_neighbors->addresses;
+
+        while (tmp_addresses!=NULL) {
+            addresses++;
+            tmp_addresses = tmp_addresses->next;
+        }
+        tmp_neighbors = tmp_neighbors->next;
+    }
+    __atomic_store_n(&probe->stats.neighbors, (uint64_t)nb_neighbor(probe->neighbors), __ATOMIC_RELAXED);
+    __atomic_store_n(&probe->stats.addresses, addresses, __ATOMIC_RELAXED);
+    __atomic_store_n(&probe->stats.routers, (uint64_t)nb_router(probe->routers), __ATOMIC_RELAXED);
+    __atomic_store_n(&probe->stats.refreshed, time(NULL), __ATOMIC_RELAXED);
+}
+
+/* Refreshes the cache sizes of all probes. */
+static void stats_refresh_all() {
+    struct probe_list** locked_probes;
+    struct probe_list* tmp_probes;
+
+    /* critical section: */
+    locked_probes = probe_list_lock();
+    /* copy the probe list (entries are never removed while running) */
+    tmp_probes = *locked_probes;
+    probe_list_unlock();
+    /* end critical section. */
+
+    while (tmp_probes!=NULL) {
+        /* a reader, the counters are atomic: */
+        probe_handle_rdlock(&tmp_probes->entry);
+        stats_probe_refresh(&tmp_probes->entry);
+        probe_handle_unlock(&tmp_probes->entry);
+        tmp_probes = tmp_probes->next;
+    }
+}
+
+static void* stats_run(void* unused) {
+    struct timespec wakeup;
+
+    pthread_mutex_lock(&stats_lock);
+    while (stats_running) {
+        pthread_mutex_unlock(&stats_lock);
+        stats_refresh_all();
+        pthread_mutex_lock(&stats_lock);
+        clock_gettime(CLOCK_REALTIME, &wakeup);
+        wakeup.tv_sec += STATS_REFRESH_INTERVAL;
+        /* wait out the interval unless stopped: */
+        while (stats_running
+                && pthread_cond_timedwait(&stats_cond, &stats_lock, &wakeup)!=ETIMEDOUT) {
+        }
+    }
+    pthread_mutex_unlock(&stats_lock);
+    return NULL;
+}
+
+int stats_start() {
+    stats_running = 1;
+    if (pthread_create(&stats_thread, NULL, stats_run, NULL)!=0) {
+        perror("[stats] pthread_create failed");
+        stats_running = 0;
+        return -1;
+    }
+    stats_started = 1;
+    return 0;
+}
+
+void stats_stop() {
+    if (!stats_started) {
+        return;
+    }
+    pthread_mutex_lock(&stats_lock);
+    stats_running = 0;
+    pthread_cond_signal(&stats_cond);
+    pthread_mutex_unlock(&stats_lock);
+    pthread_join(stats_thread, NULL);
+    stats_started = 0;
+}
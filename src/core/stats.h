@@ -0,0 +1,79 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "../membounds.h"
+#include "ndpmon_defs.h"
+
+#include "cache_types.h"
+#include "events.h"
+#include "probes.h"
+
+/** @file
+ *  Runtime counters of the probes.
+ *
+ *  The analysis threads count the frames by ICMPv6 type and the alerts by
+ *  reason with relaxed atomic additions to the counters of their probe
+ *  (struct probe_stats), readers take them with atomic loads. Neither
+ *  side takes the probe lock. The sizes of the neighbor caches and router
+ *  lists are counted by a thread of this module every STATS_REFRESH_INTERVAL
+ *  seconds, which holds the lock of one probe at a time.
+ *
+ *  Alert reasons are free text: each new reason gets the next index of a
+ *  global table, the same for all probes.
+ */
+
+/** Seconds between two refreshes of the cache sizes. */
+#define STATS_REFRESH_INTERVAL 5
+
+/** Counts a frame analyzed on a probe.
+ *  @param probe      The probe (a virtual probe for a VLAN).
+ *  @param icmp6_type ICMPv6 type of the frame, 0 if it is no ICMPv6 message.
+ *  @param length     Length of the frame.
+ */
+void stats_packet(struct probe* probe, uint8_t icmp6_type, int length);
+
+/** Counts an alert raised on a probe.
+ *  @param probe  The probe.
+ *  @param reason The reason of the alert.
+ */
+void stats_alert(const struct probe* probe, const char* reason);
+
+/** Returns the number of alert reasons seen so far.
+ *  @return The number of reasons, at most PROBE_STATS_REASONS_MAX.
+ */
+int stats_reason_count();
+
+/** Returns an alert reason.
+ *  @param index Index of the reason, below stats_reason_count().
+ *  @return      The reason, the last one stands for all further reasons.
+ */
+const char* stats_reason_name(int index);
+
+/** Takes a snapshot of the counters of a probe without locking it.
+ *  @param probe The probe.
+ *  @param stats Will hold the counters.
+ */
+void stats_probe_get(const struct probe* probe, struct probe_stats* stats);
+
+/** Counts the neighbors, their addresses and the routers of a probe.
+ *  @param probe The probe, must be locked (for reading at least).
+ */
+void stats_probe_refresh(struct probe* probe);
+
+/** Starts the thread refreshing the cache sizes of the probes.
+ *  @return 0 on success, -1 otherwise.
+ */
+int stats_start();
+
+/** Stops the refresh thread. */
+void stats_stop();
+
+#endif
@@ -0,0 +1,47 @@
+#include "text_buffer.h"
+
+int text_buffer_init(struct text_buffer* buffer, size_t size) {
+    memset(buffer, 0, sizeof(struct text_buffer));
+    if ((buffer->data=malloc(size))==NULL) {
+        perror("[text_buffer] malloc failed");
+        return -1;
+    }
+    buffer->data[0] = '\0';
+    buffer->size = size;
+    return 0;
+}
+
+void text_buffer_printf(struct text_buffer* buffer, const char* format, ...) {
+    va_list args;
+    int needed;
+
+    while (!buffer->failed) {
+        va_start(args, format);
+        needed = vsnprintf(buffer->data+buffer->length, buffer->size-buffer->length, format, args);
+        va_end(args);
+        if (needed<0) {
+            buffer->failed = 1;
+        } else if (buffer->length+needed<buffer->size) {
+            buffer->length += needed;
+            return;
+        } else {
+            size_t size = buffer->size*2;
+            char* data;
+
+            if (size<buffer->length+needed+1) {
+                size = buffer->length+needed+1;
+            }
+            if ((data=realloc(buffer->data, size))==NULL) {
+                buffer->failed = 1;
+            } else {
+                buffer->data = data;
+                buffer->size = size;
+            }
+        }
+    }
+}
+
+void text_buffer_free(struct text_buffer* buffer) {
+    free(buffer->data);
+    memset(buffer, 0, sizeof(struct text_buffer));
+}
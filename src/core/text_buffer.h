@@ -0,0 +1,45 @@
+#ifndef _TEXT_BUFFER_H_
+#define _TEXT_BUFFER_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+/** @file
+ *  A growing text buffer the control socket and the metrics exporter
+ *  build their responses in. When memory runs out the buffer is marked
+ *  failed and further output is dropped, the caller answers with an error.
+ */
+
+/** A growing text buffer. */
+struct text_buffer {
+    char* data;
+    /** Number of bytes written, without the terminating NUL. */
+    size_t length;
+    /** Number of bytes allocated. */
+    size_t size;
+    /** Set if memory ran out. */
+    int failed;
+};
+
+/** Allocates an empty buffer.
+ *  @param buffer The buffer.
+ *  @param size   The initial size in bytes.
+ *  @return       0 on success, -1 on error.
+ */
+int text_buffer_init(struct text_buffer* buffer, size_t size);
+
+/** Appends formatted text to a buffer, growing it as needed.
+ *  @param buffer The buffer, left unchanged once it failed.
+ *  @param format The printf() format.
+ */
+void text_buffer_printf(struct text_buffer* buffer, const char* format, ...)
+        __attribute__ ((format (printf, 2, 3)));
+
+/** Releases the memory of a buffer.
+ *  @param buffer The buffer.
+ */
+void text_buffer_free(struct text_buffer* buffer);
+
+#endif
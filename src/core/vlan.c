@@ -0,0 +1,419 @@
+#include "vlan.h"
+
+/** A QinQ virtual probe of a trunk. */
+struct vlan_qinq_entry {
+    /** Outer VLAN ID << 12 | inner VLAN ID. */
+    uint32_t key;
+    struct probe* probe;
+    struct vlan_qinq_entry* next;
+};
+
+/** The virtual probes of a trunk. The tables are read without locking,
+ *  entries are only added (under vlan_lock) and never removed. */
+struct vlan_trunk {
+    const struct probe* trunk;
+    /** Set if the probe is configured as trunk. */
+    int enabled;
+    /** Maximum number of virtual probes. */
+    int probes_max;
+    /** Number of virtual probes in the tables. */
+    int probe_count;
+    /** Set once the frames of a VLAN were dropped for the limit. */
+    int limit_reported;
+    /** Virtual probes of single tagged VLANs by VLAN ID. */
+    struct probe* single[VLAN_ID_COUNT];
+    /** Virtual probes of double tagged VLANs. */
+    struct vlan_qinq_entry* qinq[VLAN_QINQ_BUCKETS];
+    struct vlan_trunk* next;
+};
+
+/** A template probe element of the configuration. */
+struct vlan_template {
+    /** Name of the trunk probe. */
+    char trunk_name[PROBE_NAME_SIZE];
+    xmlNodePtr element;
+    struct vlan_template* next;
+};
+
+static struct vlan_trunk* vlan_trunks = NULL;
+static struct vlan_template* vlan_templates = NULL;
+/* serializes the creation of trunk tables and virtual probes: */
+static pthread_mutex_t vlan_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int vlan_parse(const uint8_t* frame, int length, uint16_t* vids) {
+    int offset = 2*ETH_ALEN;
+    int tags = 0;
+
+    while (offset+2<=length) {
+        uint16_t type = (frame[offset]<<8) | frame[offset+1];
+
+        if (type!=ETHERTYPE_VLAN && type!=VLAN_ETHERTYPE_8021AD && type!=VLAN_ETHERTYPE_QINQ) {
+            break;
+        }
+        if (tags==VLAN_TAGS_MAX || offset+VLAN_TAG_SIZE+2>length) {
+            return -1;
+        }
+        vids[tags++] = ((frame[offset+2]<<8) | frame[offset+3]) & 0x0fff;
+        offset += VLAN_TAG_SIZE;
+    }
+    return tags;
+}
+
+uint8_t* vlan_strip(uint8_t* frame, int tags) {
+    memmove(frame + tags*VLAN_TAG_SIZE, frame, 2*ETH_ALEN);
+    return frame + tags*VLAN_TAG_SIZE;
+}
+
+void vlan_probe_name(char* name, const char* trunk_name, const uint16_t* vids, int tags) {
+    if (tags==1) {
+        snprintf(name, PROBE_NAME_SIZE, "%s.%u", trunk_name, vids[0]);
+    } else {
+        snprintf(name, PROBE_NAME_SIZE, "%s.%u.%u", trunk_name, vids[0], vids[1]);
+    }
+}
+
+static struct vlan_template* vlan_template_get(const char* trunk_name) {
+    struct vlan_template* template = vlan_templates;
+
+    while (template!=NULL) {
+        if (strncmp(template->trunk_name, trunk_name, PROBE_NAME_SIZE)==0) {
+            return template;
+        }
+        template = template->next;
+    }
+    return NULL;
+}
+
+/* Adds a virtual probe to the probe list (which must be locked), configured
+ * from the template of the trunk if there is one. */
+static struct probe* vlan_probe_add(const char* name, const char* trunk_name) {
+    struct vlan_template* template = vlan_template_get(trunk_name);
+    char probe_name[PROBE_NAME_SIZE];
+    enum probe_type type = PROBE_TYPE_VLAN;
+    struct extinfo_list* extinfo = NULL;
+    router_list_t* routers = NULL;
+#ifdef _COUNTERMEASURES_
+    int cm_enabled = 0;
+#endif
+
+    strlcpy(probe_name, name, PROBE_NAME_SIZE);
+    if (template!=NULL) {
+        /* the template is loaded as if it was configured for the VLAN: */
+        xmlNodePtr element = xmlCopyNode(template->element, 1);
+        int ret;
+
+        if (element==NULL) {
+            fprintf(stderr, "[vlan] ERROR: copying the template of %s failed.\n", trunk_name);
+            return NULL;
+        }
+        xmlSetProp(element, BAD_CAST "name", BAD_CAST probe_name);
+#ifdef _COUNTERMEASURES_
+        ret = probe_load_config(element, probe_name, &type, &extinfo, &routers, 0, &cm_enabled);
+#else
+        ret = probe_load_config(element, probe_name, &type, &extinfo, &routers, 0);
+#endif
+        xmlFreeNode(element);
+        if (ret==-1) {
+            extinfo_list_free(&extinfo);
+            clean_routers(&routers);
+            return NULL;
+        }
+    }
+#ifdef _COUNTERMEASURES_
+    if (probe_list_add(probe_name, PROBE_TYPE_VLAN, extinfo, NULL, routers, cm_enabled)==-1) {
+#else
+    if (probe_list_add(probe_name, PROBE_TYPE_VLAN, extinfo, NULL, routers)==-1) {
+#endif
+        extinfo_list_free(&extinfo);
+        clean_routers(&routers);
+        return NULL;
+    }
+    return (struct probe*) probe_list_get(probe_name);
+}
+
+/* Gets the VLAN table of a probe, creates it on first use. */
+static struct vlan_trunk* vlan_trunk_get(const struct probe* trunk) {
+    struct vlan_trunk* entry = __atomic_load_n(&vlan_trunks, __ATOMIC_ACQUIRE);
+    struct capture_settings settings;
+
+    while (entry!=NULL) {
+        if (entry->trunk==trunk) {
+            return entry;
+        }
+        entry = entry->next;
+    }
+    pthread_mutex_lock(&vlan_lock);
+    for (entry=vlan_trunks; entry!=NULL; entry=entry->next) {
+        if (entry->trunk==trunk) {
+            break;
+        }
+    }
+    if (entry==NULL) {
+        if ((entry=malloc(sizeof(struct vlan_trunk)))==NULL) {
+            perror("[vlan] malloc failed");
+            pthread_mutex_unlock(&vlan_lock);
+            return NULL;
+        }
+        memset(entry, 0, sizeof(struct vlan_trunk));
+        capture_settings_get(trunk, &settings);
+        entry->trunk      = trunk;
+        entry->enabled    = settings.trunk;
+        entry->probes_max = settings.vlan_probes_max;
+        entry->next       = vlan_trunks;
+        __atomic_store_n(&vlan_trunks, entry, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&vlan_lock);
+    return entry;
+}
+
+static struct probe* vlan_trunk_lookup(struct vlan_trunk* vlan_trunk, const uint16_t* vids, int tags) {
+    struct vlan_qinq_entry* entry;
+    uint32_t key;
+
+    if (tags==1) {
+        return __atomic_load_n(&vlan_trunk->single[vids[0]], __ATOMIC_ACQUIRE);
+    }
+    key = ((uint32_t)vids[0]<<12) | vids[1];
+    entry = __atomic_load_n(&vlan_trunk->qinq[key % VLAN_QINQ_BUCKETS], __ATOMIC_ACQUIRE);
+    while (entry!=NULL) {
+        if (entry->key==key) {
+            return entry->probe;
+        }
+        entry = entry->next;
+    }
+    return NULL;
+}
+
+/* Adds a virtual probe to the tables of a trunk (vlan_lock must be held). */
+static int vlan_trunk_insert(struct vlan_trunk* vlan_trunk, const uint16_t* vids, int tags, struct probe* probe) {
+    struct vlan_qinq_entry* entry;
+    uint32_t key;
+
+    if (tags==1) {
+        __atomic_store_n(&vlan_trunk->single[vids[0]], probe, __ATOMIC_RELEASE);
+    } else {
+        if ((entry=malloc(sizeof(struct vlan_qinq_entry)))==NULL) {
+            perror("[vlan] malloc failed");
+            return -1;
+        }
+        key = ((uint32_t)vids[0]<<12) | vids[1];
+        entry->key   = key;
+        entry->probe = probe;
+        entry->next  = vlan_trunk->qinq[key % VLAN_QINQ_BUCKETS];
+        __atomic_store_n(&vlan_trunk->qinq[key % VLAN_QINQ_BUCKETS], entry, __ATOMIC_RELEASE);
+    }
+    vlan_trunk->probe_count++;
+    return 0;
+}
+
+/* Looks up the virtual probe in the probe list, creates it if it is not
+ * configured and adds it to the tables of the trunk (vlan_lock must be held). */
+static struct probe* vlan_probe_attach(struct vlan_trunk* vlan_trunk, struct probe* trunk,
+        const uint16_t* vids, int tags) {
+    char name[PROBE_NAME_SIZE];
+    struct probe* probe;
+    int created = 0;
+
+    if (vlan_trunk->probe_count>=vlan_trunk->probes_max) {
+        if (!vlan_trunk->limit_reported) {
+            fprintf(stderr, "[vlan] %s: %i virtual probes, frames of further VLANs are ignored.\n",
+                    trunk->name, vlan_trunk->probe_count);
+            vlan_trunk->limit_reported = 1;
+        }
+        return NULL;
+    }
+    vlan_probe_name(name, trunk->name, vids, tags);
+    /* critical section: */
+    probe_list_lock();
+    probe = (struct probe*) probe_list_get(name);
+    if (probe==NULL) {
+        probe = vlan_probe_add(name, trunk->name);
+        created = 1;
+    }
+    probe_list_unlock();
+    /* end critical section. */
+    if (probe==NULL) {
+        return NULL;
+    }
+    if (probe->type!=PROBE_TYPE_VLAN) {
+        fprintf(stderr, "[vlan] ERROR: probe %s exists and is not of type vlan.\n", name);
+        return NULL;
+    }
+    /* the frames of the VLAN are seen through the trunk: */
+    memcpy(&probe->ethernet_address, &trunk->ethernet_address, sizeof(struct ether_addr));
+    if (vlan_trunk_insert(vlan_trunk, vids, tags, probe)==-1) {
+        return NULL;
+    }
+    fprintf(stderr, "[vlan] %s: %s virtual probe %s.\n", trunk->name,
+            created ? "created" : "attached", name);
+    probe_updown(PROBE_UPDOWN_STATE_UP, probe);
+    return probe;
+}
+
+struct probe* vlan_probe_get(struct probe* trunk, const uint16_t* vids, int tags) {
+    struct vlan_trunk* vlan_trunk = vlan_trunk_get(trunk);
+    struct probe* probe;
+
+    if (vlan_trunk==NULL) {
+        return NULL;
+    }
+    /* priority tagged frames belong to the trunk: */
+    if (!vlan_trunk->enabled || (tags==1 && vids[0]==0)) {
+        return trunk;
+    }
+    if ((probe=vlan_trunk_lookup(vlan_trunk, vids, tags))!=NULL) {
+        return probe;
+    }
+    pthread_mutex_lock(&vlan_lock);
+    /* another worker may have attached it meanwhile: */
+    if ((probe=vlan_trunk_lookup(vlan_trunk, vids, tags))==NULL) {
+        probe = vlan_probe_attach(vlan_trunk, trunk, vids, tags);
+    }
+    pthread_mutex_unlock(&vlan_lock);
+    return probe;
+}
+
+/* Gets the VLAN IDs from the name of a virtual probe of a trunk.
+ * Returns the number of VLAN IDs, -1 if the name does not belong to the trunk. */
+static int vlan_probe_name_parse(const char* name, const char* trunk_name, uint16_t* vids) {
+    size_t length = strnlen(trunk_name, PROBE_NAME_SIZE);
+    const char* probe_name = name;
+    char canonical[PROBE_NAME_SIZE];
+    char* end;
+    unsigned long id;
+    int tags = 0;
+
+    if (strncmp(name, trunk_name, length)!=0 || name[length]!='.') {
+        return -1;
+    }
+    name += length;
+    while (*name=='.' && tags<VLAN_TAGS_MAX) {
+        id = strtoul(name+1, &end, 10);
+        if (end==name+1 || id>=VLAN_ID_COUNT) {
+            return -1;
+        }
+        vids[tags++] = (uint16_t) id;
+        name = end;
+    }
+    if (*name!='\0') {
+        return -1;
+    }
+    /* only names as built by vlan_probe_name(), e.g. no leading zeros: */
+    vlan_probe_name(canonical, trunk_name, vids, tags);
+    if (strncmp(canonical, probe_name, PROBE_NAME_SIZE)!=0) {
+        return -1;
+    }
+    return tags;
+}
+
+struct probe* vlan_probe_load(const char* name) {
+    struct probe_list** locked_probes;
+    struct probe_list* tmp_probes;
+    struct probe* probe = NULL;
+    uint16_t vids[VLAN_TAGS_MAX];
+
+    /* critical section: */
+    locked_probes = probe_list_lock();
+    tmp_probes = *locked_probes;
+    while (tmp_probes!=NULL && probe==NULL) {
+        if (tmp_probes->entry.type==PROBE_TYPE_INTERFACE
+                && vlan_probe_name_parse(name, tmp_probes->entry.name, vids)>0) {
+            struct capture_settings settings;
+
+            capture_settings_get(&tmp_probes->entry, &settings);
+            if (settings.trunk) {
+                probe = vlan_probe_add(name, tmp_probes->entry.name);
+            }
+        }
+        tmp_probes = tmp_probes->next;
+    }
+    probe_list_unlock();
+    /* end critical section. */
+    return probe;
+}
+
+int vlan_template_is(xmlNodePtr element) {
+    xmlChar* name_prop = xmlGetProp(element, BAD_CAST "name");
+    xmlChar* type_prop = xmlGetProp(element, BAD_CAST "type");
+    size_t suffix = strlen(VLAN_TEMPLATE_SUFFIX);
+    int ret = 0;
+
+    if (name_prop!=NULL && type_prop!=NULL && STRCMP(type_prop, "vlan")==0) {
+        size_t length = strlen((char*)name_prop);
+        ret = (length>suffix && strcmp((char*)name_prop+length-suffix, VLAN_TEMPLATE_SUFFIX)==0);
+    }
+    xmlFree(name_prop);
+    xmlFree(type_prop);
+    return ret;
+}
+
+int vlan_template_add(xmlNodePtr element) {
+    struct vlan_template* new;
+    xmlChar* name_prop = xmlGetProp(element, BAD_CAST "name");
+
+    if (name_prop==NULL) {
+        return -1;
+    }
+    if ((new=malloc(sizeof(struct vlan_template)))==NULL) {
+        perror("[vlan] malloc failed");
+        xmlFree(name_prop);
+        return -1;
+    }
+    memset(new, 0, sizeof(struct vlan_template));
+    strlcpy(new->trunk_name, (char*)name_prop, PROBE_NAME_SIZE);
+    new->trunk_name[strlen(new->trunk_name)-strlen(VLAN_TEMPLATE_SUFFIX)] = '\0';
+    xmlFree(name_prop);
+    if (vlan_template_get(new->trunk_name)!=NULL) {
+        fprintf(stderr, "[vlan] ERROR: more than one template for %s.\n", new->trunk_name);
+        free(new);
+        return -1;
+    }
+    if ((new->element=xmlCopyNode(element, 1))==NULL) {
+        fprintf(stderr, "[vlan] ERROR: copying the template of %s failed.\n", new->trunk_name);
+        free(new);
+        return -1;
+    }
+    new->next = vlan_templates;
+    vlan_templates = new;
+    return 0;
+}
+
+int vlan_template_save(xmlNodePtr element) {
+    struct vlan_template* template = vlan_templates;
+
+    while (template!=NULL) {
+        xmlNodePtr copy = xmlCopyNode(template->element, 1);
+
+        if (copy==NULL || xmlAddChild(element, copy)==NULL) {
+            xmlFreeNode(copy);
+            return -1;
+        }
+        template = template->next;
+    }
+    return 0;
+}
+
+void vlan_free() {
+    int i;
+
+    pthread_mutex_lock(&vlan_lock);
+    while (vlan_templates!=NULL) {
+        struct vlan_template* template = vlan_templates;
+        vlan_templates = template->next;
+        xmlFreeNode(template->element);
+        free(template);
+    }
+    while (vlan_trunks!=NULL) {
+        struct vlan_trunk* trunk = vlan_trunks;
+        vlan_trunks = trunk->next;
+        for (i=0; i<VLAN_QINQ_BUCKETS; i++) {
+            while (trunk->qinq[i]!=NULL) {
+                struct vlan_qinq_entry* entry = trunk->qinq[i];
+                trunk->qinq[i] = entry->next;
+                free(entry);
+            }
+        }
+        free(trunk);
+    }
+    pthread_mutex_unlock(&vlan_lock);
+}
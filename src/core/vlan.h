@@ -0,0 +1,116 @@
+#ifndef _VLAN_H_
+#define _VLAN_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <libxml/tree.h>
+
+#include "../membounds.h"
+#include "ndpmon_defs.h"
+#include "../ndpmon_netheaders.h"
+
+#include "cache_types.h"
+#include "probes.h"
+
+/** @file
+ *  Demultiplexing of a VLAN trunk into virtual probes.
+ *
+ *  A probe with trunk="1" in its capture element captures the tagged
+ *  frames of all VLANs of an interface. The frames of each VLAN (802.1Q,
+ *  or an 802.1ad outer tag with an 802.1Q inner tag) are analyzed as if
+ *  they were captured on a probe of type vlan named after the trunk and
+ *  the VLAN IDs, e.g. "eth0.100" or "eth0.100.200", with its own neighbor
+ *  and router state.
+ *
+ *  Virtual probes may be configured like any other probe. For the other
+ *  VLANs they are created on demand from the template of the trunk, a
+ *  probe element of type vlan named "<trunk>.*", for instance
+ *  \verbatim <probe name="eth0.*" type="vlan"><routers/></probe> \endverbatim
+ *  or without configuration if there is no template.
+ */
+
+/** Maximum number of VLAN tags of a frame (outer and inner tag). */
+#define VLAN_TAGS_MAX 2
+/** Ethertype of an 802.1ad service tag (outer tag). */
+#define VLAN_ETHERTYPE_8021AD 0x88a8
+/** Ethertype of an outer tag used by pre-standard QinQ equipment. */
+#define VLAN_ETHERTYPE_QINQ 0x9100
+/** Size of a VLAN tag. */
+#define VLAN_TAG_SIZE 4
+/** Number of VLAN IDs. */
+#define VLAN_ID_COUNT 4096
+/** Number of hash buckets for the QinQ virtual probes of a trunk. */
+#define VLAN_QINQ_BUCKETS 1024
+/** Default maximum number of virtual probes created for a trunk. */
+#define VLAN_PROBES_MAX_DEFAULT 1024
+/** Suffix of the name of a template. */
+#define VLAN_TEMPLATE_SUFFIX ".*"
+
+/** Parses the VLAN tags of a frame.
+ *  @param frame  The frame, starting with the ethernet header.
+ *  @param length Length of the frame.
+ *  @param vids   Will hold the VLAN IDs, outer tag first (VLAN_TAGS_MAX).
+ *  @return       The number of tags (0 if the frame is untagged), -1 if
+ *                the frame is truncated or has more than VLAN_TAGS_MAX tags.
+ */
+int vlan_parse(const uint8_t* frame, int length, uint16_t* vids);
+
+/** Removes the VLAN tags from a frame by moving the ethernet addresses
+ *  over them.
+ *  @param frame The frame.
+ *  @param tags  The number of tags returned by vlan_parse().
+ *  @return      The start of the untagged frame (frame + tags*VLAN_TAG_SIZE).
+ */
+uint8_t* vlan_strip(uint8_t* frame, int tags);
+
+/** Builds the name of the virtual probe of a VLAN.
+ *  @param name       Buffer of PROBE_NAME_SIZE.
+ *  @param trunk_name Name of the trunk probe.
+ *  @param vids       The VLAN IDs, outer tag first.
+ *  @param tags       The number of VLAN IDs.
+ */
+void vlan_probe_name(char* name, const char* trunk_name, const uint16_t* vids, int tags);
+
+/** Gets the virtual probe of a VLAN of a trunk, creates it if needed.
+ *  @param trunk The probe the frame was captured on.
+ *  @param vids  The VLAN IDs, outer tag first.
+ *  @param tags  The number of VLAN IDs.
+ *  @return      The virtual probe, the probe itself if it is no trunk or
+ *               for priority tagged frames (VLAN ID 0), NULL if the
+ *               maximum number of virtual probes is reached.
+ */
+struct probe* vlan_probe_get(struct probe* trunk, const uint16_t* vids, int tags);
+
+/** Creates the virtual probe of a neighbor cache entry (for VLANs that
+ *  were created on demand by a previous run).
+ *  @param name The name of the virtual probe.
+ *  @return     The new probe, NULL if the name does not belong to a trunk.
+ */
+struct probe* vlan_probe_load(const char* name);
+
+/** Checks if a probe element of the configuration is a template.
+ *  @param element The probe element.
+ *  @return        1 if it is a template, 0 otherwise.
+ */
+int vlan_template_is(xmlNodePtr element);
+
+/** Keeps a copy of a template.
+ *  @param element The probe element of the template.
+ *  @return        0 on success, -1 on error.
+ */
+int vlan_template_add(xmlNodePtr element);
+
+/** Saves the templates to the probes element of the configuration.
+ *  @param element The probes element.
+ *  @return        0 on success, -1 on error.
+ */
+int vlan_template_save(xmlNodePtr element);
+
+/** Releases the templates and the VLAN tables of the trunks. */
+void vlan_free();
+
+#endif
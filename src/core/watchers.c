@@ -2,6 +2,13 @@
 
 struct watcher_list* watchers=NULL;
 
+const unsigned int watchers_latency_bounds[WATCHERS_LATENCY_BUCKETS-1] = {
+    1, 5, 10, 50, 100, 500, 1000, 5000, 10000
+};
+
+/* set while the latencies of the watch functions are measured: */
+static int watchers_timed = 0;
+
 extern int DEBUG;
 
 int watchers_add(char* name, watcher_type watcher, uint8_t icmp6_type_match, uint16_t watch_flags_match) 
@@ -21,6 +28,8 @@ int watchers_add(char* name, watcher_type watcher, uint8_t icmp6_type_match, uin
     new_watcher->watcher = watcher;
     new_watcher->icmp6_type_match = icmp6_type_match;
     new_watcher->watch_flags_match = watch_flags_match;
+    memset(new_watcher->latency, 0, sizeof(new_watcher->latency));
+    new_watcher->latency_sum = 0;
     new_watcher->next = NULL; /* terminate list*/
     /* this must be inserted in a weird way to have a FIFO list: */
     /* if the list is empty: */
@@ -38,6 +47,26 @@ int watchers_add(char* name, watcher_type watcher, uint8_t icmp6_type_match, uin
     return 0;
 }
 
+/* Calls a watcher and counts its duration in the latency histogram. */
+static int watchers_call_timed(struct watcher_list* watcher, struct capture_info* const capture_info)
+{
+    struct timespec start, end;
+    uint64_t duration;
+    int bucket = 0;
+    int result;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    result = watcher->watcher(capture_info);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    duration = (uint64_t)(end.tv_sec-start.tv_sec)*1000000000 + end.tv_nsec - start.tv_nsec;
+    while (bucket<WATCHERS_LATENCY_BUCKETS-1 && duration>(uint64_t)watchers_latency_bounds[bucket]*1000) {
+        bucket++;
+    }
+    __atomic_fetch_add(&watcher->latency[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&watcher->latency_sum, duration, __ATOMIC_RELAXED);
+    return result;
+}
+
 int watchers_call(struct capture_info* const capture_info) 
 {
     struct watcher_list* tmp_watcher=watchers;
@@ -55,18 +84,30 @@ int watchers_call(struct capture_info* const capture_info)
         }
 
         /* if there are any watch flags given and they are not set for the packet, skip this watcher: */
-        if (tmp_watcher->watch_flags_match!=0 && !(watchers_flags_isset(capture_info->watch_flags, tmp_watcher->watch_flags_match))) 
+        if (tmp_watcher->watch_flags_match!=0 && !(watchers_flags_isset(capture_info->watch_flags, tmp_watcher->watch_flags_match & ~WATCH_FLAG_STATELESS))) 
 	{
             tmp_watcher = tmp_watcher->next;
             continue;
         }
 
+        /* a verified binding is only checked by the stateless watchers: */
+        if (watchers_flags_isset(capture_info->watch_flags, WATCH_FLAG_KNOWN_BINDING)
+                && !watchers_flags_isset(tmp_watcher->watch_flags_match, WATCH_FLAG_STATELESS))
+        {
+            tmp_watcher = tmp_watcher->next;
+            continue;
+        }
+
         if (DEBUG) 
 	{
             fprintf(stderr, "[watchers] calling watcher \"%s\".\n", tmp_watcher->name);
         }
 
-        watchers_result = tmp_watcher->watcher(capture_info);
+        if (__atomic_load_n(&watchers_timed, __ATOMIC_RELAXED)) {
+            watchers_result = watchers_call_timed(tmp_watcher, capture_info);
+        } else {
+            watchers_result = tmp_watcher->watcher(capture_info);
+        }
         if (watchers_result > packet_result) 
 	{
             /* only worse news cause update: */
@@ -86,6 +127,16 @@ int watchers_call(struct capture_info* const capture_info)
     return packet_result;
 }
 
+void watchers_timing(int enabled)
+{
+    __atomic_store_n(&watchers_timed, enabled, __ATOMIC_RELAXED);
+}
+
+const struct watcher_list* watchers_get()
+{
+    return watchers;
+}
+
 int  watchers_flags_isset(const uint16_t flags, const uint16_t flags_to_check) 
 {
     
@@ -175,6 +226,9 @@ void watchers_print()
         if (watchers_flags_isset(tmp_watcher->watch_flags_match, WATCH_FLAG_IS_LEGITIMATE_ROUTER)) {
             fprintf(stderr, "IS_LEGITIMATE_ROUTER ");
         }
+        if (watchers_flags_isset(tmp_watcher->watch_flags_match, WATCH_FLAG_STATELESS)) {
+            fprintf(stderr, "STATELESS ");
+        }
         fprintf(stderr, "]\n");
         tmp_watcher = tmp_watcher->next;
     }
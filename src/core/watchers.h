@@ -8,12 +8,18 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
 
 #include "../ndpmon_netheaders.h"
 
 /** Size of the human readable name of a watch function (may be equivalent to the C source code name). */
 #define WATCHER_NAME_SIZE  25
 
+/** Number of buckets of the watcher latency histograms, the last one
+    counts the calls slower than all bounds (see watchers_latency_bounds). */
+#define WATCHERS_LATENCY_BUCKETS 10
+
 /** Watch flag: Call further watch functions for the current packet. */
 #define WATCH_FLAG_CONTINUE_CHECKING      0x8000
 /** Watch flag: The current packet is an IPv6 packet. */
@@ -30,6 +36,12 @@
 #define WATCH_FLAG_IS_LEGITIMATE_ROUTER   0x0200
 /** Watch flag: Stop all watch function calls if the previous returned 2 i.e. something wrong has been detected e.g. dad dos */
 #define WATCH_FLAG_STOP_ON_ERROR          0x0100
+/** The source and content of the current NDP message are a verified binding (see bindings.h),
+    only the watchers registered with WATCH_FLAG_STATELESS are called. */
+#define WATCH_FLAG_KNOWN_BINDING          0x0080
+/** Registration flag, not set for packets: The watcher is called for verified bindings too, as it
+    only checks the packet itself or follows state the binding cache does not cover. */
+#define WATCH_FLAG_STATELESS              0x0040
 
 struct probe;
 
@@ -38,7 +50,9 @@ struct capture_info {
     /** Probe on which this packet has been captured. The probe should
         be locked if its data structures are accessed, only the <B>name</B>
         field can be accessed savely because it does never change after
-        startup.
+        startup. It is the entry of the probe list, lock it with
+        probe_handle_rdlock() to read it or probe_handle_lock() to change
+        it, rather than by its name.
      */
     struct probe* probe;
     /** Pre-allocated buffer for building an alert message. */
@@ -57,8 +71,16 @@ struct capture_info {
     const uint8_t* packet_data;
     /** Length of the packet. */
     int packet_length;
+    /** Capture time of the packet. */
+    const struct timeval* timestamp;
     /** Watch flags for the current packet that define its protocol type and further information. */
     uint16_t watch_flags;
+    /** Set by watch_known_binding() if the binding of the packet may be verified. */
+    int binding_candidate;
+    /** Generation of the probe's bindings when the packet was looked up. */
+    uint64_t binding_generation;
+    /** Alerts raised by the analyzing thread when the packet was looked up. */
+    unsigned long binding_alerts;
 };
 
 
@@ -82,6 +104,14 @@ struct watcher_list {
         The watcher is only called if all specified flags are set for the packet.
     */
     uint16_t     watch_flags_match;
+    /** Calls by duration, counted only if timing is enabled (see watchers_timing()).
+        Updated with relaxed atomic additions, bucket i counts the calls that
+        took up to watchers_latency_bounds[i] microseconds and more than the
+        previous bound.
+    */
+    uint64_t     latency[WATCHERS_LATENCY_BUCKETS];
+    /** Total duration of the timed calls in nanoseconds. */
+    uint64_t     latency_sum;
     /** Pointer to the next watcher_list entry.*/
     struct watcher_list* next;
 };
@@ -105,6 +135,20 @@ int  watchers_add(char* name, watcher_type watcher, uint8_t icmp6_type_match, ui
 */
 int watchers_call(struct capture_info* const capture_info);
 
+/** Upper bounds of the latency buckets in microseconds (all but the last bucket). */
+extern const unsigned int watchers_latency_bounds[WATCHERS_LATENCY_BUCKETS-1];
+
+/** Enables or disables timing the watch functions. Timing costs two clock
+    reads per call, it is only enabled while the latencies are exported.
+    @param enabled 1 to enable timing, 0 to disable it.
+*/
+void watchers_timing(int enabled);
+
+/** Returns the list of watch functions, which does not change after startup.
+    @return The first entry of the watcher_list.
+*/
+const struct watcher_list* watchers_get();
+
 int  watchers_flags_isset(const uint16_t flags, const uint16_t flags_to_check);
 
 void watchers_flags_set(uint16_t *flags, const uint16_t flags_to_set);
@@ -20,17 +20,40 @@ int extensions_register_handlers()
 #ifdef _WEBINTERFACE_
 	event_handler_add("webinterface",     wi_export_handler);
 #endif
+
+#ifdef _SYSLOG_NATIVE_
+	event_handler_add("syslog_native",    syslog_native_event_handler);
+#endif
+
+#ifdef _EVENT_RING_
+	event_handler_add("event_ring",       event_ring_event_handler);
+#endif
 	return 0;
 }
 
 int extensions_register_types() 
 {
-	if (extinfo_type_list_add("last_dad_address", last_dad_address_free, NULL, NULL, NULL)!=0) return -1;
+	if (extinfo_type_list_add("capture", settings_data_free, capture_settings_print, capture_settings_load, capture_settings_save)==-1) return -1;
+	if (extinfo_type_list_add("logging", settings_data_free, logging_settings_print, logging_settings_load, logging_settings_save)==-1) return -1;
+	if (extinfo_type_list_add("control", settings_data_free, control_settings_print, control_settings_load, control_settings_save)==-1) return -1;
+	if (extinfo_type_list_add("metrics", settings_data_free, metrics_settings_print, metrics_settings_load, metrics_settings_save)==-1) return -1;
+	if (extinfo_type_list_add("evidence", settings_data_free, evidence_settings_print, evidence_settings_load, evidence_settings_save)==-1) return -1;
+	if (extinfo_type_list_add("lastseen", settings_data_free, lastseen_settings_print, lastseen_settings_load, lastseen_settings_save)==-1) return -1;
+	if (extinfo_type_list_add("capture_loop", settings_data_free, event_loop_settings_print, event_loop_settings_load, event_loop_settings_save)==-1) return -1;
 #ifdef _RULES_
-	if (extinfo_type_list_add("rules", rule_list_free, rule_list_print, rule_list_load, rule_list_save)!=0) return -1;
+	if ((rule_list_slot=extinfo_type_list_add("rules", rule_list_free, rule_list_print, rule_list_load, rule_list_save))==-1) return -1;
 #endif
 #ifdef _SOAP_
-	if (extinfo_type_list_add("soap", soap_settings_free, soap_settings_print, soap_settings_load, soap_settings_save)!=0) return -1;
+	if (extinfo_type_list_add("soap", soap_settings_free, soap_settings_print, soap_settings_load, soap_settings_save)==-1) return -1;
+#endif
+#ifdef _SYSLOG_NATIVE_
+	if (extinfo_type_list_add("syslog_native", syslog_native_settings_free, syslog_native_settings_print, syslog_native_settings_load, syslog_native_settings_save)==-1) return -1;
+#endif
+#ifdef _CAPTURE_USE_LNFQ_
+	if (extinfo_type_list_add("nfqueue", settings_data_free, capture_lnfq_settings_print, capture_lnfq_settings_load, capture_lnfq_settings_save)==-1) return -1;
+#endif
+#ifdef _EVENT_RING_
+	if (extinfo_type_list_add("event_ring", event_ring_settings_free, event_ring_settings_print, event_ring_settings_load, event_ring_settings_save)==-1) return -1;
 #endif
 	return 0;
 }
@@ -45,13 +68,15 @@ int extensions_register_watchers()
 	if (watchers_add("watch_prepare_inet6",    &watch_prepare_inet6,    0, WATCH_FLAG_CONTINUE_CHECKING | WATCH_FLAG_IS_IP6)!=0) return -1;
 	if (watchers_add("watch_prepare_icmp6",    &watch_prepare_icmp6,    0, WATCH_FLAG_CONTINUE_CHECKING | WATCH_FLAG_IS_ICMP6)!=0) return -1;
 	if (watchers_add("watch_prepare_nd",       &watch_prepare_nd,       0, WATCH_FLAG_CONTINUE_CHECKING | WATCH_FLAG_IS_NDP)!=0) return -1;
+	/* Known-host fast path, only the STATELESS watchers are called for verified bindings: */
+	if (watchers_add("watch_known_binding",    &watch_known_binding,    0, WATCH_FLAG_CONTINUE_CHECKING | WATCH_FLAG_IS_NDP)!=0) return -1;
 
 	/* General checks, only for ND packets: */
-	if (watchers_add("watch_eth_mismatch",  &watch_eth_mismatch,  0,      WATCH_FLAG_CONTINUE_CHECKING | WATCH_FLAG_IS_NDP)!=0) return -1;
-	if (watchers_add("watch_eth_broadcast", &watch_eth_broadcast, 0,      WATCH_FLAG_CONTINUE_CHECKING | WATCH_FLAG_IS_NDP)!=0) return -1;
-	if (watchers_add("watch_ip_broadcast", &watch_ip_broadcast,   0,      WATCH_FLAG_CONTINUE_CHECKING | WATCH_FLAG_IS_NDP)!=0) return -1;
+	if (watchers_add("watch_eth_mismatch",  &watch_eth_mismatch,  0,      WATCH_FLAG_CONTINUE_CHECKING | WATCH_FLAG_IS_NDP | WATCH_FLAG_STATELESS)!=0) return -1;
+	if (watchers_add("watch_eth_broadcast", &watch_eth_broadcast, 0,      WATCH_FLAG_CONTINUE_CHECKING | WATCH_FLAG_IS_NDP | WATCH_FLAG_STATELESS)!=0) return -1;
+	if (watchers_add("watch_ip_broadcast", &watch_ip_broadcast,   0,      WATCH_FLAG_CONTINUE_CHECKING | WATCH_FLAG_IS_NDP | WATCH_FLAG_STATELESS)!=0) return -1;
 	if (watchers_add("watch_bogon", &watch_bogon,                 0,      WATCH_FLAG_CONTINUE_CHECKING | WATCH_FLAG_IS_NDP)!=0) return -1;
-	if (watchers_add("watch_hop_limit", &watch_hop_limit,         0,      WATCH_FLAG_CONTINUE_CHECKING | WATCH_FLAG_IS_NDP)!=0) return -1;
+	if (watchers_add("watch_hop_limit", &watch_hop_limit,         0,      WATCH_FLAG_CONTINUE_CHECKING | WATCH_FLAG_IS_NDP | WATCH_FLAG_STATELESS)!=0) return -1;
 
 	/* Router Solicitation checks: */
 	if (watchers_add("new_station", &new_station,   ND_ROUTER_SOLICIT,    WATCH_FLAG_CONTINUE_CHECKING | WATCH_FLAG_IP6_SRC_SPECIFIED)!=0) return -1;
@@ -66,10 +91,10 @@ int extensions_register_watchers()
 
 	/* Neighbor Solicitation checks: */
 	if (watchers_add("new_station", &new_station,   ND_NEIGHBOR_SOLICIT,  WATCH_FLAG_CONTINUE_CHECKING | WATCH_FLAG_IP6_SRC_SPECIFIED)!=0) return -1;
-	if (watchers_add("watch_dad", &watch_dad,       ND_NEIGHBOR_SOLICIT,  WATCH_FLAG_CONTINUE_CHECKING)!=0) return -1;
+	if (watchers_add("watch_dad", &watch_dad,       ND_NEIGHBOR_SOLICIT,  WATCH_FLAG_CONTINUE_CHECKING | WATCH_FLAG_STATELESS)!=0) return -1;
 
 	/* Neighbor Advertisement checks: */
-	if (watchers_add("watch_dad_dos", &watch_dad_dos, ND_NEIGHBOR_ADVERT, WATCH_FLAG_STOP_ON_ERROR | WATCH_FLAG_CONTINUE_CHECKING)!=0) return -1;
+	if (watchers_add("watch_dad_dos", &watch_dad_dos, ND_NEIGHBOR_ADVERT, WATCH_FLAG_STOP_ON_ERROR | WATCH_FLAG_CONTINUE_CHECKING | WATCH_FLAG_STATELESS)!=0) return -1;
 	if (watchers_add("watch_na_target", &watch_na_target, ND_NEIGHBOR_ADVERT, WATCH_FLAG_STOP_ON_ERROR | WATCH_FLAG_CONTINUE_CHECKING)!=0) return -1;
 	if (watchers_add("new_station", &new_station,     ND_NEIGHBOR_ADVERT, WATCH_FLAG_CONTINUE_CHECKING)!=0) return -1;
 	if (watchers_add("watch_R_flag", &watch_R_flag,   ND_NEIGHBOR_ADVERT, WATCH_FLAG_CONTINUE_CHECKING)!=0) return -1;
@@ -79,10 +104,10 @@ int extensions_register_watchers()
 
 #ifdef _COUNTERMEASURES_
 	/* if (watchers_add("watch_ndpmon_present", &watch_ndpmon_present, ND_NDPMON_PRESENT, WATCH_FLAG_CONTINUE_CHECKING |  WATCH_FLAG_IS_NDP_MESSAGE)!=0) return -1; */
-	if (watchers_add("watch_ndpmon_present", &watch_ndpmon_present, ND_NDPMON_PRESENT, WATCH_FLAG_CONTINUE_CHECKING |  WATCH_FLAG_IS_NDP)!=0) return -1;
+	if (watchers_add("watch_ndpmon_present", &watch_ndpmon_present, ND_NDPMON_PRESENT, WATCH_FLAG_CONTINUE_CHECKING |  WATCH_FLAG_IS_NDP | WATCH_FLAG_STATELESS)!=0) return -1;
 #endif
 #ifdef _RULES_
-	if (watchers_add("rule_match_all",       &rule_match_all, 0,          WATCH_FLAG_IS_NDP)!=0) return -1;
+	if (watchers_add("rule_match_all",       &rule_match_all, 0,          WATCH_FLAG_IS_NDP | WATCH_FLAG_STATELESS)!=0) return -1;
 #endif
 
 	/* Print list:*/
@@ -108,6 +133,14 @@ void extensions_setup(char * interface)
 #ifdef _SOAP_
 	soap_up();
 #endif
+
+#ifdef _SYSLOG_NATIVE_
+	syslog_native_up();
+#endif
+
+#ifdef _EVENT_RING_
+	event_ring_up();
+#endif
 }
 
 void extensions_teardown() 
@@ -119,4 +152,12 @@ void extensions_teardown()
 #ifdef _SOAP_
 	soap_down();
 #endif
+
+#ifdef _SYSLOG_NATIVE_
+	syslog_native_down();
+#endif
+
+#ifdef _EVENT_RING_
+	event_ring_down();
+#endif
 }
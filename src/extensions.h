@@ -27,6 +27,26 @@
 #include "./plugins/soap/soap.h"
 #endif
 
+#ifdef _SYSLOG_NATIVE_
+#include "./plugins/syslog_native/syslog_native.h"
+#endif
+
+#ifdef _EVENT_RING_
+#include "./plugins/event_ring/event_ring.h"
+#endif
+
+#ifdef _CAPTURE_USE_LNFQ_
+#include "./capture/capture_lnfq.h"
+#endif
+
+#include "./core/bindings.h"
+#include "./core/control.h"
+#include "./core/evidence.h"
+#include "./core/lastseen.h"
+#include "./core/logging.h"
+#include "./core/metrics.h"
+#include "./core/event_loop.h"
+
 /** @file
  *  Provides extension points needed to integrate custom watch functions
  *  or plugins. These well defined points should be used to register extension
@@ -25,6 +25,13 @@
                                                   monitoring*.c/watch*() */
 #define RA_PARAM_MISMATCHED_SIZE 30
 #define RA_PARAM_MISMATCHED_LIST_SIZE 150
+#define RA_FINGERPRINT_SIZE 1500          /* -> monitoring_ra.c/watch_ra(), canonical form of a RA */
+#define RA_FINGERPRINT_OPTIONS_MAX 32     /* -> monitoring_ra.c/watch_ra(), options of a RA in canonical form */
+#define RA_OPTIONS_PREFIX_MAX 16          /* -> monitoring_ra.h/struct ra_options, prefix information options of a RA */
+#define RA_OPTIONS_MTU_MAX 4              /* -> monitoring_ra.h/struct ra_options, MTU options of a RA */
+#define RA_OPTIONS_NAMESERVER_MAX 32      /* -> monitoring_ra.h/struct ra_options, RDNSS addresses of a RA */
+#define RA_OPTIONS_DOMAIN_MAX 32          /* -> monitoring_ra.h/struct ra_options, DNSSL domains of a RA */
+#define RA_OPTIONS_ROUTE_MAX 32           /* -> monitoring_ra.h/struct ra_options, route information options of a RA */
 
 #define TIME_STR_SIZE 32
 #define INT_STR_SIZE 33
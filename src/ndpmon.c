@@ -74,13 +74,19 @@ void usage()
 }
 
 
-void handler(int n)
+void* handler(void* args)
 {
+	sigset_t* signals = (sigset_t*) args;
+	int signal_number;
+
+	/* the signals are blocked in all threads, this thread takes them: */
+	while (sigwait(signals, &signal_number)!=0)
+		;
 	fprintf(stderr, "\nInterrupted ;) \n");
 
-	/* cleanup: */
-	teardown();
-	exit(0);
+	/* capture_up_all() returns in the main thread, which cleans up: */
+	capture_stop_all();
+	return NULL;
 }
 
 
@@ -109,6 +115,12 @@ void setup(char *interface)
 		fprintf(stderr, "Error parsing configuration.\n"); exit(1);
 	}
 
+	/* diagnostic messages are written by a logger thread from now on */
+	if (logging_start()!=0)
+	{
+		fprintf(stderr, "Error starting the logging.\n"); exit(1);
+	}
+
 	/* loading the neighbor cache for each interface */
 	if (parser_neighbors_parse()==-1) 
 	{
@@ -121,6 +133,42 @@ void setup(char *interface)
 		probe_list_print();
 	}
 
+	/* reverse lookups for the alert messages are done by worker threads */
+	if (use_reverse_hostlookups==1 && resolver_start()!=0)
+	{
+		fprintf(stderr,"Error starting reverse host lookups.\n"); exit(1);
+	}
+
+	/* capture statistics are collected by a thread of their own */
+	if (capture_monitor_start()!=0)
+	{
+		fprintf(stderr,"Error starting the capture statistics.\n"); exit(1);
+	}
+
+	/* runtime counters are served over the control socket */
+	if (stats_start()!=0 || control_start()!=0)
+	{
+		fprintf(stderr,"Error starting the control socket.\n"); exit(1);
+	}
+
+	/* and scraped from the metrics exporter */
+	if (metrics_start()!=0)
+	{
+		fprintf(stderr,"Error starting the metrics exporter.\n"); exit(1);
+	}
+
+	/* the frames around an alert are kept as evidence */
+	if (evidence_start()!=0)
+	{
+		fprintf(stderr,"Error starting the evidence capture.\n"); exit(1);
+	}
+
+	/* the lastseen timers of the neighbors are merged periodically */
+	if (lastseen_start()!=0)
+	{
+		fprintf(stderr,"Error starting the lastseen merge.\n"); exit(1);
+	}
+
 	/* enable alerts if not in learning phase */
 	alert_set_active(!learning);
 
@@ -183,7 +231,15 @@ void teardown()
 	syslog(LOG_NOTICE, "NDPMon stopped.");
 	closelog();
 
+	metrics_stop();
+	control_stop();
+	stats_stop();
+	capture_monitor_stop();
 	capture_down_all();
+	evidence_stop();
+	lastseen_stop();
+	bindings_free();
+	dad_free();
 	probe_list_send_down_event();
 	event_queue(EVENT_TYPE_EXIT, NULL);
 	
@@ -192,6 +248,8 @@ void teardown()
 		fprintf(stderr, "Waiting for event queue to finish...\n");
 	}
 	pthread_join(event_queue_thread, NULL);
+	resolver_stop();
+	logging_stop();
 
 	extensions_teardown();
 
@@ -202,6 +260,8 @@ void teardown()
 	parser_neighbors_store();
 
 	/* free data structures */
+	capture_monitor_free();
+	vlan_free();
 	probe_list_free();
 	event_handler_list_free();
 	extinfo_type_list_free();
@@ -212,6 +272,8 @@ void teardown()
 int main(int argc,char **argv)
 { 
 	char *interface; /* name of the interface/device to use */ 
+	sigset_t signals; /* the signals terminating the daemon */
+	pthread_t signal_thread;
 
 	int op = 0;
 
@@ -259,6 +321,7 @@ int main(int argc,char **argv)
 
 			case 'v':
 				DEBUG = 1;
+				logging_set_level(LOGGING_LEVEL_DEBUG);
 				fprintf(stderr,"NDPMon starts in DEBUG mode.\n");
 				break;
 
@@ -272,9 +335,12 @@ int main(int argc,char **argv)
 		}
 	}
 
-	signal(SIGINT,handler);
-	signal(SIGQUIT,handler);
-	signal(SIGTERM,handler);
+	/* blocked before any thread is started, so that they all inherit the mask: */
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGQUIT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, NULL);
 
 	if (DEBUG) 
 	{
@@ -284,6 +350,13 @@ int main(int argc,char **argv)
 	main_thread = pthread_self();
 
 	setup(interface);
+	if (pthread_create(&signal_thread, NULL, handler, &signals)!=0)
+	{
+		perror("pthread_create");
+		exit(1);
+	}
+	/* not joined, it still waits if the capture ended on its own: */
+	pthread_detach(signal_thread);
 	capture_up_all();
 
 	teardown();
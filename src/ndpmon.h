@@ -46,12 +46,18 @@ Olivier Festor, Scientific Leader of the MADYNEs Project, 20 August 2006
 
 #include "./core/alerts.h"
 #include "./core/capture.h"
+#include "./core/control.h"
+#include "./core/evidence.h"
+#include "./core/logging.h"
+#include "./core/metrics.h"
 #include "./core/events.h"
 #include "./core/neighbors.h"
 #include "./core/parser.h"
 #include "./core/print_packet_info.h"
+#include "./core/resolver.h"
 #include "./core/routers.h"
 #include "./core/settings.h"
+#include "./core/stats.h"
 #include "./core/watchers.h"
 
 #if defined (_CAPTURE_USE_PCAP_) || defined (_CAPTURE_USE_LNFQ_)
@@ -72,14 +78,17 @@ Olivier Festor, Scientific Leader of the MADYNEs Project, 20 August 2006
 void setup();
 
 /** This function stops packet capturing, cancels the event queue thread and
- *  releases resources used by the program. It is called by the signal handler handler().
+ *  releases resources used by the program. It is called once by the main
+ *  thread when capture_up_all() returns.
  */
 void teardown();
 
-/** NDPMon signal handler to terminate the daemon.
- *  @param n Signal number.
+/** Thread waiting for the signals terminating the daemon, which are
+ *  blocked in all threads. Stops the capture on the first one, the main
+ *  thread then tears down. Nothing is done in signal context.
+ *  @param args The signals (sigset_t) to wait for.
  */
-void handler(int n);
+void* handler(void* args);
 
 /** Displays a help message and exits.*/
 void usage();
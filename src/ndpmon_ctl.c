@@ -0,0 +1,101 @@
+/* ndpmon-ctl: queries the control socket of a running NDPMon. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "./core/control_protocol.h"
+
+static void usage() {
+    fprintf(stderr,
+            "Usage: ndpmon-ctl [-s socket_path] command [probe]\n"
+            "    -s  path of the control socket (default " CONTROL_PATH ")\n"
+            "Commands:\n"
+            "    probes             list the probes\n"
+            "    stats [probe]      packet, alert and cache counters\n"
+            "    neighbors probe    neighbor cache of a probe\n"
+            "    routers probe      router list of a probe\n");
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    struct sockaddr_un address;
+    const char* path = CONTROL_PATH;
+    char request[CONTROL_REQUEST_SIZE];
+    char chunk[4096];
+    char* response = NULL;
+    char* records;
+    size_t length = 0;
+    ssize_t received;
+    int fd;
+    int op;
+
+    while ((op=getopt(argc, argv, "s:h"))!=-1) {
+        switch (op) {
+            case 's':
+                path = optarg;
+                break;
+            default:
+                usage();
+        }
+    }
+    if (optind>=argc || argc-optind>2) {
+        usage();
+    }
+    if (snprintf(request, sizeof(request), "%s%s%s\n", argv[optind],
+            (argc-optind==2) ? " " : "", (argc-optind==2) ? argv[optind+1] : "")>=(int)sizeof(request)) {
+        fprintf(stderr, "ndpmon-ctl: request too long.\n");
+        return 1;
+    }
+
+    memset(&address, 0, sizeof(struct sockaddr_un));
+    address.sun_family = AF_UNIX;
+    if (strlen(path)>=sizeof(address.sun_path)) {
+        fprintf(stderr, "ndpmon-ctl: socket path too long.\n");
+        return 1;
+    }
+    strcpy(address.sun_path, path);
+    if ((fd=socket(AF_UNIX, SOCK_STREAM, 0))==-1) {
+        perror("ndpmon-ctl: socket");
+        return 1;
+    }
+    if (connect(fd, (struct sockaddr*)&address, sizeof(struct sockaddr_un))==-1) {
+        fprintf(stderr, "ndpmon-ctl: connecting to %s: ", path);
+        perror(NULL);
+        return 1;
+    }
+    if (write(fd, request, strlen(request))!=(ssize_t)strlen(request)) {
+        perror("ndpmon-ctl: write");
+        return 1;
+    }
+
+    /* read the whole response, it ends when NDPMon closes the connection: */
+    while ((received=read(fd, chunk, sizeof(chunk)))>0) {
+        if ((response=realloc(response, length+received+1))==NULL) {
+            perror("ndpmon-ctl: realloc");
+            return 1;
+        }
+        memcpy(response+length, chunk, received);
+        length += received;
+    }
+    close(fd);
+    if (received<0) {
+        perror("ndpmon-ctl: read");
+        return 1;
+    }
+    if (response==NULL || (records=memchr(response, '\n', length))==NULL) {
+        fprintf(stderr, "ndpmon-ctl: no response.\n");
+        return 1;
+    }
+    records++;
+    if (strncmp(response, CONTROL_RESPONSE_ERROR, strlen(CONTROL_RESPONSE_ERROR))==0) {
+        fprintf(stderr, "ndpmon-ctl: %.*s", (int)(records-response), response);
+        return 1;
+    }
+    fwrite(records, 1, length-(records-response), stdout);
+    free(response);
+    return 0;
+}
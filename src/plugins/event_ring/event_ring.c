@@ -0,0 +1,182 @@
+#include "event_ring.h"
+
+static pthread_mutex_t event_ring_settings_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct event_ring_settings* event_ring_settings = NULL;
+
+/* only used by the event queue thread after event_ring_up(): */
+static struct event_ring_header* event_ring = NULL;
+static struct event_ring_slot* event_ring_slots = NULL;
+static size_t event_ring_size = 0;
+
+static void event_ring_fill_alert(struct event_ring_alert* record, const struct alert_info* alert) {
+    record->time     = alert->time;
+    record->priority = alert->priority;
+    memcpy(record->ethernet_address1, &alert->ethernet_address1, 6);
+    memcpy(record->ethernet_address2, &alert->ethernet_address2, 6);
+    memcpy(record->ipv6_address, &alert->ipv6_address, 16);
+    strlcpy(record->probe_name, alert->probe_name, EVENT_RING_PROBE_SIZE);
+    strlcpy(record->reason, alert->reason, EVENT_RING_REASON_SIZE);
+    strlcpy(record->message, alert->message, EVENT_RING_MESSAGE_SIZE);
+}
+
+static void event_ring_fill_neighbor_update(struct event_ring_neighbor_update* record,
+        const struct neighbor_update_info* update) {
+    const neighbor_list_t* neighbor = &update->neighbor;
+    const address_t* address = neighbor->addresses;
+
+    record->timer    = neighbor->timer;
+    record->key_type = update->key_type;
+    record->trouble  = neighbor->trouble;
+    memcpy(record->mac, &neighbor->mac, 6);
+    memcpy(record->first_mac_seen, &neighbor->first_mac_seen, 6);
+    memcpy(record->previous_mac, &neighbor->previous_mac, 6);
+    memcpy(record->lla, &neighbor->lla, 16);
+    record->address_count = 0;
+    while (address!=NULL) {
+        if (record->address_count<EVENT_RING_ADDRESSES) {
+            memcpy(record->addresses[record->address_count], &address->address, 16);
+        }
+        record->address_count++;
+        address = address->next;
+    }
+    strlcpy(record->probe_name, update->probe_name, EVENT_RING_PROBE_SIZE);
+}
+
+void event_ring_event_handler(const struct event_info* event) {
+    struct event_ring_slot* slot;
+    uint64_t seq;
+
+    if (event_ring==NULL
+            || (event->type!=EVENT_TYPE_ALERT && event->type!=EVENT_TYPE_NEIGHBOR_UPDATE)) {
+        return;
+    }
+    seq  = event_ring->write_seq + 1;
+    slot = (struct event_ring_slot*)((char*)event_ring_slots + ((seq-1) % event_ring->slot_count) * event_ring->slot_size);
+
+    /* mark the slot as being written before touching the record: */
+    __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memset(&slot->data, 0, sizeof(slot->data));
+    if (event->type==EVENT_TYPE_ALERT) {
+        slot->type = EVENT_RING_TYPE_ALERT;
+        event_ring_fill_alert(&slot->data.alert, &event->data->alert);
+    } else {
+        slot->type = EVENT_RING_TYPE_NEIGHBOR_UPDATE;
+        event_ring_fill_neighbor_update(&slot->data.neighbor_update, &event->data->neighbor_update);
+    }
+    /* publish: */
+    __atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+    __atomic_store_n(&event_ring->write_seq, seq, __ATOMIC_RELEASE);
+}
+
+void event_ring_settings_free(void** data) {
+    /* no referenced structures, just free it */
+    pthread_mutex_lock(&event_ring_settings_lock);
+    if (event_ring_settings==*data) {
+        event_ring_settings = NULL;
+    }
+    pthread_mutex_unlock(&event_ring_settings_lock);
+    free(*data);
+    *data = NULL;
+}
+
+int event_ring_settings_load(xmlNodePtr element, void** data) {
+    struct event_ring_settings* settings;
+    xmlChar* path  = xmlGetProp(element, BAD_CAST "path");
+    xmlChar* slots = xmlGetProp(element, BAD_CAST "slots");
+
+    if ((settings=malloc(sizeof(struct event_ring_settings)))==NULL) {
+        perror("[event_ring] malloc failed.\n");
+        exit(1);
+    }
+    memset(settings, 0, sizeof(struct event_ring_settings));
+    strlcpy(settings->path, (path!=NULL) ? (char*)path : EVENT_RING_PATH, PATH_SIZE);
+    settings->slots = (slots!=NULL) ? (unsigned int)atoi((char*)slots) : EVENT_RING_SLOTS;
+    xmlFree(path);
+    xmlFree(slots);
+    if (settings->slots<2 || settings->slots>(1u<<20)) {
+        fprintf(stderr, "[event_ring] ERROR: settings: slots must be between 2 and %u.\n", 1u<<20);
+        free(settings);
+        return -1;
+    }
+    *data = settings;
+    pthread_mutex_lock(&event_ring_settings_lock);
+    event_ring_settings = settings;
+    pthread_mutex_unlock(&event_ring_settings_lock);
+    return 0;
+}
+
+void event_ring_settings_print(void* data) {
+    struct event_ring_settings* settings = (struct event_ring_settings*) data;
+
+    fprintf(stderr, "[event_ring] plugin configuration {\n");
+    fprintf(stderr, "    path %s\n", settings->path);
+    fprintf(stderr, "    slots %u\n", settings->slots);
+    fprintf(stderr, "}\n");
+}
+
+int event_ring_settings_save(xmlNodePtr element, void* data) {
+    struct event_ring_settings* settings = (struct event_ring_settings*) data;
+    char slots_str[16];
+
+    xmlNewProp(element, BAD_CAST "path", BAD_CAST settings->path);
+    snprintf(slots_str, sizeof(slots_str), "%u", settings->slots);
+    xmlNewProp(element, BAD_CAST "slots", BAD_CAST slots_str);
+    return 0;
+}
+
+void event_ring_up() {
+    struct event_ring_header* ring;
+    int fd;
+
+    pthread_mutex_lock(&event_ring_settings_lock);
+    if (event_ring_settings==NULL) {
+        pthread_mutex_unlock(&event_ring_settings_lock);
+        return;
+    }
+    event_ring_size = sizeof(struct event_ring_header)
+        + (size_t)event_ring_settings->slots * sizeof(struct event_ring_slot);
+
+    /* Readers still mapping a previous ring keep the old file, they notice
+     * the restart from the changed inode. */
+    unlink(event_ring_settings->path);
+    if ((fd=open(event_ring_settings->path, O_RDWR | O_CREAT | O_EXCL, 0644))==-1) {
+        perror("[event_ring] open");
+        pthread_mutex_unlock(&event_ring_settings_lock);
+        return;
+    }
+    if (ftruncate(fd, event_ring_size)==-1) {
+        perror("[event_ring] ftruncate");
+        close(fd);
+        pthread_mutex_unlock(&event_ring_settings_lock);
+        return;
+    }
+    ring = mmap(NULL, event_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring==MAP_FAILED) {
+        perror("[event_ring] mmap");
+        pthread_mutex_unlock(&event_ring_settings_lock);
+        return;
+    }
+    ring->version    = EVENT_RING_VERSION;
+    ring->slot_size  = sizeof(struct event_ring_slot);
+    ring->slot_count = event_ring_settings->slots;
+    ring->write_seq  = 0;
+    ring->started    = time(NULL);
+    __atomic_store_n(&ring->magic, EVENT_RING_MAGIC, __ATOMIC_RELEASE);
+
+    event_ring_slots = (struct event_ring_slot*)(ring+1);
+    event_ring = ring;
+    fprintf(stderr, "[event_ring] publishing events to %s (%u slots).\n",
+            event_ring_settings->path, event_ring_settings->slots);
+    pthread_mutex_unlock(&event_ring_settings_lock);
+}
+
+void event_ring_down() {
+    if (event_ring==NULL) {
+        return;
+    }
+    munmap(event_ring, event_ring_size);
+    event_ring = NULL;
+    event_ring_slots = NULL;
+}
@@ -0,0 +1,86 @@
+#ifndef _EVENT_RING_H_
+#define _EVENT_RING_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <libxml/tree.h>
+
+#include "../../membounds.h"
+#include "ndpmon_defs.h"
+
+#include "../../core/events.h"
+#include "../../core/extinfo.h"
+
+#include "event_ring_types.h"
+
+/** @file
+ *  Event ring plugin: publishes alerts and neighbor updates to a memory
+ *  mapped file (by default under /dev/shm), so that local collectors can
+ *  follow them without going through the XML files or pipe programs.
+ *
+ *  The ring has a single producer, the event queue thread, which never
+ *  waits for readers: the oldest records are overwritten. See
+ *  event_ring_types.h for the layout and event_ring_reader.h for the
+ *  reader side.
+ *
+ *  Configured by an event_ring element in the settings, for instance
+ *  \verbatim <event_ring path="/dev/shm/ndpmon.events" slots="4096"/> \endverbatim
+ */
+
+/** Default path of the ring. */
+#define EVENT_RING_PATH "/dev/shm/ndpmon.events"
+/** Default number of slots. */
+#define EVENT_RING_SLOTS 4096
+
+/** Settings for the event ring plugin. */
+struct event_ring_settings {
+    /** Path of the ring file. */
+    char path[PATH_SIZE];
+    /** Number of slots. */
+    unsigned int slots;
+};
+
+/** Publishes alert and neighbor update events to the ring.
+ *  @param event The event.
+ */
+void event_ring_event_handler(const struct event_info* event);
+
+/** Frees the plugin settings.
+ *  @param data The settings (call by reference).
+ */
+void event_ring_settings_free(void** data);
+
+/** Loads the plugin settings from an XML element.
+ *  @param element The event_ring element.
+ *  @param data    Will hold the settings (call by reference).
+ *  @return        0 on success, -1 on error.
+ */
+int event_ring_settings_load(xmlNodePtr element, void** data);
+
+/** Prints the plugin settings.
+ *  @param data The settings.
+ */
+void event_ring_settings_print(void* data);
+
+/** Saves the plugin settings to an XML element.
+ *  @param element The element to add the attributes to.
+ *  @param data    The settings.
+ *  @return        Always 0.
+ */
+int event_ring_settings_save(xmlNodePtr element, void* data);
+
+/** Creates and maps the ring file (if the plugin is configured). */
+void event_ring_up();
+
+/** Unmaps the ring. The file is left in place for readers. */
+void event_ring_down();
+
+#endif
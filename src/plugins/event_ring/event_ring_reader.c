@@ -0,0 +1,130 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "event_ring_reader.h"
+
+static const struct event_ring_slot* event_ring_reader_slot(const struct event_ring_reader* reader, uint64_t seq) {
+    const struct event_ring_header* header = reader->header;
+
+    return (const struct event_ring_slot*)((const char*)(header+1)
+            + ((seq-1) % header->slot_count) * header->slot_size);
+}
+
+int event_ring_reader_open(struct event_ring_reader* reader, const char* path, int from_start) {
+    struct stat st;
+    const struct event_ring_header* header;
+    uint64_t write_seq;
+    int fd;
+
+    memset(reader, 0, sizeof(struct event_ring_reader));
+    if ((fd=open(path, O_RDONLY))==-1) {
+        return -1;
+    }
+    if (fstat(fd, &st)==-1) {
+        close(fd);
+        return -1;
+    }
+    if ((size_t)st.st_size<sizeof(struct event_ring_header)) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    header = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (header==MAP_FAILED) {
+        return -1;
+    }
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE)!=EVENT_RING_MAGIC
+            || header->version!=EVENT_RING_VERSION
+            || header->slot_size<sizeof(struct event_ring_slot)
+            || header->slot_count==0
+            || (size_t)st.st_size<sizeof(struct event_ring_header) + (size_t)header->slot_count*header->slot_size) {
+        munmap((void*)header, st.st_size);
+        errno = EINVAL;
+        return -1;
+    }
+    reader->header = header;
+    reader->size   = st.st_size;
+    reader->inode  = st.st_ino;
+
+    write_seq = __atomic_load_n(&header->write_seq, __ATOMIC_ACQUIRE);
+    if (!from_start) {
+        reader->next_seq = write_seq + 1;
+    } else if (write_seq>header->slot_count) {
+        reader->next_seq = write_seq - header->slot_count + 1;
+    } else {
+        reader->next_seq = 1;
+    }
+    return 0;
+}
+
+void event_ring_reader_close(struct event_ring_reader* reader) {
+    if (reader->header!=NULL) {
+        munmap((void*)reader->header, reader->size);
+        reader->header = NULL;
+    }
+}
+
+int event_ring_reader_replaced(const struct event_ring_reader* reader, const char* path) {
+    struct stat st;
+
+    if (stat(path, &st)==-1) {
+        return 0;
+    }
+    return (st.st_ino!=reader->inode);
+}
+
+const struct event_ring_slot* event_ring_reader_peek(struct event_ring_reader* reader) {
+    const struct event_ring_header* header = reader->header;
+    uint64_t write_seq = __atomic_load_n(&header->write_seq, __ATOMIC_ACQUIRE);
+
+    while (reader->next_seq<=write_seq) {
+        const struct event_ring_slot* slot;
+
+        if (write_seq - reader->next_seq >= header->slot_count) {
+            /* overrun: skip to the oldest record still in the ring */
+            uint64_t oldest = write_seq - header->slot_count + 1;
+            reader->lost += oldest - reader->next_seq;
+            reader->next_seq = oldest;
+        }
+        slot = event_ring_reader_slot(reader, reader->next_seq);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE)==reader->next_seq) {
+            return slot;
+        }
+        /* overwritten (or being overwritten) since write_seq was read: */
+        reader->lost++;
+        reader->next_seq++;
+        write_seq = __atomic_load_n(&header->write_seq, __ATOMIC_ACQUIRE);
+    }
+    return NULL;
+}
+
+int event_ring_reader_release(struct event_ring_reader* reader, const struct event_ring_slot* slot) {
+    uint64_t seq;
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+    if (seq!=reader->next_seq) {
+        reader->lost++;
+        reader->next_seq++;
+        return -1;
+    }
+    reader->next_seq++;
+    return 0;
+}
+
+int event_ring_reader_next(struct event_ring_reader* reader, struct event_ring_slot* record) {
+    const struct event_ring_slot* slot;
+
+    while ((slot=event_ring_reader_peek(reader))!=NULL) {
+        memcpy(record, slot, sizeof(struct event_ring_slot));
+        if (event_ring_reader_release(reader, slot)==0) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+#ifndef _EVENT_RING_READER_H_
+#define _EVENT_RING_READER_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "event_ring_types.h"
+
+/** @file
+ *  Reader library for the NDPMon event ring. Readers map the ring read
+ *  only and never slow down the producer: if a reader falls behind by more
+ *  than the ring size, the skipped records are counted as lost.
+ *
+ *  Zero copy use:
+ *  \verbatim
+    const struct event_ring_slot* slot;
+    while ((slot=event_ring_reader_peek(&reader))!=NULL) {
+        ... use slot ...
+        if (event_ring_reader_release(&reader, slot)!=0) {
+            ... slot was overwritten meanwhile, discard what was read ...
+        }
+    }
+    \endverbatim
+ */
+
+/** Reader state. */
+struct event_ring_reader {
+    /** The mapped ring. */
+    const struct event_ring_header* header;
+    /** Size of the mapping. */
+    size_t size;
+    /** Inode of the mapped file (changes if NDPMon is restarted). */
+    ino_t inode;
+    /** Number of the next record to read. */
+    uint64_t next_seq;
+    /** Number of records that were overwritten before they could be read. */
+    uint64_t lost;
+};
+
+/** Maps a ring.
+ *  @param reader     The reader to initialize.
+ *  @param path       Path of the ring file.
+ *  @param from_start 1 to start with the oldest record still in the ring,
+ *                    0 to only read records published from now on.
+ *  @return           0 on success, -1 otherwise (errno is set).
+ */
+int event_ring_reader_open(struct event_ring_reader* reader, const char* path, int from_start);
+
+/** Unmaps the ring.
+ *  @param reader The reader.
+ */
+void event_ring_reader_close(struct event_ring_reader* reader);
+
+/** Checks whether the file at path is still the ring that is mapped.
+ *  @param reader The reader.
+ *  @param path   Path of the ring file.
+ *  @return       1 if the ring was replaced (producer restarted), 0 otherwise.
+ */
+int event_ring_reader_replaced(const struct event_ring_reader* reader, const char* path);
+
+/** Returns the next record in place, without copying it. The record may be
+ *  overwritten at any time, its use must be confirmed with
+ *  event_ring_reader_release().
+ *  @param reader The reader.
+ *  @return       The slot or NULL if there is no new record.
+ */
+const struct event_ring_slot* event_ring_reader_peek(struct event_ring_reader* reader);
+
+/** Finishes reading a slot returned by event_ring_reader_peek() and moves
+ *  to the next record.
+ *  @param reader The reader.
+ *  @param slot   The slot.
+ *  @return       0 if the slot was valid while it was used, -1 if it was
+ *                overwritten (it is counted as lost).
+ */
+int event_ring_reader_release(struct event_ring_reader* reader, const struct event_ring_slot* slot);
+
+/** Copies the next record.
+ *  @param reader The reader.
+ *  @param record Buffer for the record.
+ *  @return       1 if a record was copied, 0 if there is no new record.
+ */
+int event_ring_reader_next(struct event_ring_reader* reader, struct event_ring_slot* record);
+
+#endif
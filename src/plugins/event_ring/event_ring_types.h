@@ -0,0 +1,101 @@
+#ifndef _EVENT_RING_TYPES_H_
+#define _EVENT_RING_TYPES_H_
+
+#include <stdint.h>
+
+/** @file
+ *  Layout of the shared memory event ring. This header is shared by the
+ *  producer (NDPMon) and the readers, it does not depend on other NDPMon
+ *  headers.
+ *
+ *  The file starts with an event_ring_header followed by slot_count slots
+ *  of slot_size bytes. Record n (counting from 1) is written to slot
+ *  (n-1) % slot_count. The producer never waits for readers: old records
+ *  are overwritten, a reader notices this from the sequence numbers.
+ *
+ *  Writing a slot: seq is set to 0, the record is written, seq is set to
+ *  the record number and finally write_seq is set to the record number.
+ *  A reader copies (or uses) the slot between two reads of seq and must
+ *  discard it if seq was not the expected number both times.
+ */
+
+/** Magic number at the start of the file ("NDPR"). */
+#define EVENT_RING_MAGIC   0x4e445052
+/** Layout version. */
+#define EVENT_RING_VERSION 1
+
+/** Maximum size of a probe name (as PROBE_NAME_SIZE). */
+#define EVENT_RING_PROBE_SIZE   100
+/** Maximum size of an alert reason (as ALERT_REASON_SIZE). */
+#define EVENT_RING_REASON_SIZE  100
+/** Maximum size of an alert message (as ALERT_MESSAGE_SIZE). */
+#define EVENT_RING_MESSAGE_SIZE 256
+/** Maximum number of neighbor addresses published. */
+#define EVENT_RING_ADDRESSES    8
+
+/** Record types. */
+enum event_ring_type {
+    EVENT_RING_TYPE_ALERT = 1,
+    EVENT_RING_TYPE_NEIGHBOR_UPDATE = 2
+};
+
+/** Ring header, at offset 0. */
+struct event_ring_header {
+    /** EVENT_RING_MAGIC, written last when the ring is set up. */
+    uint32_t magic;
+    /** EVENT_RING_VERSION. */
+    uint32_t version;
+    /** Size of a slot in bytes. */
+    uint32_t slot_size;
+    /** Number of slots. */
+    uint32_t slot_count;
+    /** Number of the last record published (0 if none). */
+    uint64_t write_seq;
+    /** Time the producer started. */
+    int64_t started;
+    uint64_t reserved[4];
+};
+
+/** An alert. */
+struct event_ring_alert {
+    int64_t time;
+    int32_t priority;
+    uint8_t ethernet_address1[6];
+    uint8_t ethernet_address2[6];
+    uint8_t ipv6_address[16];
+    char probe_name[EVENT_RING_PROBE_SIZE];
+    char reason[EVENT_RING_REASON_SIZE];
+    char message[EVENT_RING_MESSAGE_SIZE];
+};
+
+/** A neighbor update. */
+struct event_ring_neighbor_update {
+    int64_t timer;
+    /** enum neighbor_update_key_type of the update. */
+    int32_t key_type;
+    int32_t trouble;
+    uint8_t mac[6];
+    uint8_t first_mac_seen[6];
+    uint8_t previous_mac[6];
+    uint8_t reserved[2];
+    uint8_t lla[16];
+    /** Number of addresses of the neighbor (may exceed EVENT_RING_ADDRESSES). */
+    uint32_t address_count;
+    uint8_t addresses[EVENT_RING_ADDRESSES][16];
+    char probe_name[EVENT_RING_PROBE_SIZE];
+};
+
+/** A slot of the ring. */
+struct event_ring_slot {
+    /** Record number, 0 while the slot is written. */
+    uint64_t seq;
+    /** enum event_ring_type */
+    uint32_t type;
+    uint32_t reserved;
+    union {
+        struct event_ring_alert alert;
+        struct event_ring_neighbor_update neighbor_update;
+    } data;
+};
+
+#endif
@@ -0,0 +1,136 @@
+/* ndpmon-events: prints the records of the NDPMon event ring. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "event_ring_reader.h"
+
+#define NDPMON_EVENTS_DEFAULT_PATH "/dev/shm/ndpmon.events"
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int n) {
+    running = 0;
+}
+
+static void usage() {
+    fprintf(stderr,
+            "Usage: ndpmon-events [-p ring_path] [-a] [-f] [-i interval_ms]\n"
+            "    -p  path of the event ring (default " NDPMON_EVENTS_DEFAULT_PATH ")\n"
+            "    -a  print all records still in the ring, not only new ones\n"
+            "    -f  follow the ring until interrupted\n"
+            "    -i  polling interval when following (default 100 ms)\n");
+    exit(1);
+}
+
+static void mac_ntoa(const uint8_t* mac, char* buffer) {
+    snprintf(buffer, 18, "%x:%x:%x:%x:%x:%x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+static void print_record(const struct event_ring_slot* record) {
+    char mac1[18], mac2[18], ipv6[INET6_ADDRSTRLEN];
+
+    if (record->type==EVENT_RING_TYPE_ALERT) {
+        const struct event_ring_alert* alert = &record->data.alert;
+
+        mac_ntoa(alert->ethernet_address1, mac1);
+        mac_ntoa(alert->ethernet_address2, mac2);
+        inet_ntop(AF_INET6, alert->ipv6_address, ipv6, INET6_ADDRSTRLEN);
+        printf("%llu alert time=%lld probe=%s priority=%i reason=\"%s\" mac1=%s mac2=%s ipv6=%s message=\"%s\"\n",
+                (unsigned long long)record->seq, (long long)alert->time, alert->probe_name,
+                alert->priority, alert->reason, mac1, mac2, ipv6, alert->message);
+    } else if (record->type==EVENT_RING_TYPE_NEIGHBOR_UPDATE) {
+        const struct event_ring_neighbor_update* update = &record->data.neighbor_update;
+        uint32_t i;
+
+        mac_ntoa(update->mac, mac1);
+        inet_ntop(AF_INET6, update->lla, ipv6, INET6_ADDRSTRLEN);
+        printf("%llu neighbor_update probe=%s mac=%s lla=%s timer=%lld addresses=",
+                (unsigned long long)record->seq, update->probe_name, mac1, ipv6,
+                (long long)update->timer);
+        for (i=0; i<update->address_count && i<EVENT_RING_ADDRESSES; i++) {
+            inet_ntop(AF_INET6, update->addresses[i], ipv6, INET6_ADDRSTRLEN);
+            printf("%s%s", (i>0) ? "," : "", ipv6);
+        }
+        if (update->address_count>EVENT_RING_ADDRESSES) {
+            printf(",...(%u)", update->address_count);
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    struct event_ring_reader reader;
+    struct event_ring_slot record;
+    const char* path = NDPMON_EVENTS_DEFAULT_PATH;
+    int from_start = 0, follow = 0, interval = 100;
+    uint64_t lost = 0;
+    int op;
+
+    while ((op=getopt(argc, argv, "p:afi:h"))!=-1) {
+        switch (op) {
+            case 'p':
+                path = optarg;
+                break;
+            case 'a':
+                from_start = 1;
+                break;
+            case 'f':
+                follow = 1;
+                break;
+            case 'i':
+                interval = atoi(optarg);
+                if (interval<1)
+                    usage();
+                break;
+            default:
+                usage();
+                break;
+        }
+    }
+    if (event_ring_reader_open(&reader, path, from_start)==-1) {
+        perror(path);
+        return 1;
+    }
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+
+    while (running) {
+        struct timespec pause;
+
+        while (event_ring_reader_next(&reader, &record)) {
+            print_record(&record);
+        }
+        if (reader.lost!=lost) {
+            fprintf(stderr, "[ndpmon-events] %llu records lost (reader too slow).\n",
+                    (unsigned long long)(reader.lost-lost));
+            lost = reader.lost;
+        }
+        fflush(stdout);
+        if (!follow) {
+            break;
+        }
+        if (event_ring_reader_replaced(&reader, path)) {
+            /* NDPMon was restarted, read the new ring from its start: */
+            event_ring_reader_close(&reader);
+            if (event_ring_reader_open(&reader, path, 1)==-1) {
+                perror(path);
+                return 1;
+            }
+            lost = 0;
+            continue;
+        }
+        pause.tv_sec  = interval / 1000;
+        pause.tv_nsec = (long)(interval % 1000) * 1000000L;
+        nanosleep(&pause, NULL);
+    }
+    event_ring_reader_close(&reader);
+    return 0;
+}
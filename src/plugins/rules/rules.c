@@ -1,5 +1,7 @@
 #include "rules.h"
 
+int rule_list_slot = -1;
+
 static char rule_field_translations[RULE_FIELDS_COUNT][RULE_FIELD_SIZE];
 static int  rule_field_translations_initialized = 0;
 
@@ -124,6 +126,7 @@ int rule_list_add(struct rule_list** rules, char* description, struct rule_match
     strlcpy(new_rule->description, description, RULE_DESCRIPTION_SIZE);
     new_rule->matches = matches;
     new_rule->exports = exports;
+    new_rule->compiled = NULL;
     new_rule->next = NULL; /* keep the list terminated */
     
     if (*rules==NULL) {
@@ -141,6 +144,10 @@ int rule_list_add(struct rule_list** rules, char* description, struct rule_match
 
 void rule_list_free(void** data) {
     struct rule_list* rules = *data;
+
+    if (rules!=NULL) {
+        rule_set_free(rules->compiled);
+    }
     while (rules!=NULL) {
         struct rule_list* current=rules;
         rules=(rules)->next;
@@ -212,6 +219,12 @@ int rule_list_load (xmlNodePtr element, void** data) {
         }
         rule = rule->next;
     }
+    if (rules!=NULL && (rules->compiled=rule_set_compile(rules))==NULL) {
+        fprintf(stderr, "[rules] ERROR: Could not compile the rules.\n");
+        *data = rules;
+        rule_list_free(data);
+        return -1;
+    }
     *data = rules;
     return 0;
 }
@@ -1,127 +1,25 @@
 #include "rules_matches.h"
 
-int rule_match_and(const struct rule_match_list* const match,
-        const unsigned int value, const unsigned int flag) {
+/* fields of the Neighbor Discovery options: */
+#define RULE_FIELDS_OPTIONS (RULE_FIELD_BIT(RULE_FIELD_ND_OPT_MTU_MTU+1) \
+        - RULE_FIELD_BIT(RULE_FIELD_ND_OPT_SOURCELINKLAYER))
 
-    if (match->kind == RULE_MATCH) {
-        return (value & flag)==flag;
-    }
-    return !((value & flag)==flag);
-}
-
-int rule_match_all(struct capture_info* const capture_info) {
-    const struct ether_header* ethernet_header = capture_info->ethernet_header;
-    const struct ip6_hdr* ip6_header           = capture_info->ip6_header;
-    const struct icmp6_hdr* icmp6_header       = capture_info->icmp6_header;
-    const struct nd_option_list* option_list   = capture_info->option_list;
-    struct rule_list* tmp_rule = NULL;
-    struct probe* probe_locked;
-
-    /* critical section: */
-    probe_locked = probe_lock(capture_info->probe->name);
-    tmp_rule = extinfo_list_get_data(probe_locked->extinfo, "rules");
-    probe_unlock(capture_info->probe->name);
-    /* end of critical section. */
-
-    while (tmp_rule != NULL) {
-        struct rule_match_list* match = tmp_rule->matches;
-        int matches_all = 1;
-        while (match != NULL && matches_all == 1) {
-            switch (match->field) {
-                case RULE_FIELD_ETHERNET_SOURCE:
-                case RULE_FIELD_ETHERNET_DESTINATION:
-                    matches_all = rule_match_ethernet(match, ethernet_header);
-                    break;
-                case RULE_FIELD_INET6_SOURCE:
-                case RULE_FIELD_INET6_DESTINATION:
-                case RULE_FIELD_INET6_PAYLOAD:
-                case RULE_FIELD_INET6_NEXTHEADER:
-                case RULE_FIELD_INET6_HOPLIMIT:
-                    matches_all = rule_match_inet6(match, ip6_header);
-                    break;
-                default:
-                    if (match->field < RULE_FIELDS_COUNT) {
-                        matches_all = rule_match_icmp6(match, icmp6_header,
-                                option_list);
-                    } else {
-                        fprintf(
-                                stderr,
-                                "[rules] ERROR: Unknown field type \"%u\" for matching rule \"%s\".\n",
-                                match->field, tmp_rule->description);
-                    }
-            }
-            match = match->next;
-        }
-        if (matches_all == 1) {
-            if (DEBUG) {
-                fprintf(stderr, "[rules] Matched rule %s\n",
-                        tmp_rule->description);
-            }
-            alert_raise(1, capture_info->probe, "user defined rule matched", tmp_rule->description, (struct ether_addr*) capture_info->ethernet_header->ether_shost, NULL, &capture_info->ip6_header->ip6_src, NULL);
-        }
-        tmp_rule = tmp_rule->next;
-    }
-    return 0;
-}
-
-int rule_match_ether_addr(const struct rule_match_list* const match,
-        const struct ether_addr* const ethernet_source) {
+/* Bucket of the packets of an ICMPv6 type. */
+static int rule_bucket_of_type(const uint8_t icmp6_type) {
 
-    if (match->kind == RULE_MATCH) {
-        return (memcmp(&(match->value.ethernet_address), ethernet_source,
-                sizeof(struct ether_addr)) == 0);
+    if (icmp6_type>=ND_ROUTER_SOLICIT && icmp6_type<=ND_REDIRECT) {
+        return icmp6_type - ND_ROUTER_SOLICIT;
     }
-    return (memcmp(&(match->value.ethernet_address), ethernet_source,
-            sizeof(struct ether_addr)) != 0);
+    return RULE_BUCKET_OTHER;
 }
 
-int rule_match_ethernet(const struct rule_match_list* const match,
-        const struct ether_header* const ethernet_header) {
+/* Bucket of the message a field belongs to, -1 for fields of all packets. */
+static int rule_field_bucket(const rule_field_t field) {
 
-    switch (match->field) {
-        case RULE_FIELD_ETHERNET_SOURCE:
-            return rule_match_ether_addr(match,
-                    (struct ether_addr*) ethernet_header->ether_shost);
-        case RULE_FIELD_ETHERNET_DESTINATION:
-            return rule_match_ether_addr(match,
-                    (struct ether_addr*) ethernet_header->ether_dhost);
-    }
-    return 0;
-}
-
-int rule_match_icmp6(const struct rule_match_list* const match,
-        const struct icmp6_hdr* const icmp6_header, const struct nd_option_list* option_list) {
-
-    switch (match->field) {
-        case RULE_FIELD_ICMP6_TYPE:
-            return rule_match_uint8(match, icmp6_header->icmp6_type);
-        case RULE_FIELD_ICMP6_CODE:
-            return rule_match_uint8(match, icmp6_header->icmp6_code);
+    switch (field) {
         case RULE_FIELD_ND_RS:
-            if (match->kind == RULE_MATCH) {
-                return (icmp6_header->icmp6_type == ND_ROUTER_SOLICIT);
-            }
-            return (icmp6_header->icmp6_type == ND_ROUTER_SOLICIT);
+            return rule_bucket_of_type(ND_ROUTER_SOLICIT);
         case RULE_FIELD_ND_RA:
-            if (match->kind == RULE_MATCH) {
-                return (icmp6_header->icmp6_type == ND_ROUTER_ADVERT);
-            }
-            return (icmp6_header->icmp6_type == ND_ROUTER_ADVERT);
-        case RULE_FIELD_ND_NS:
-            if (match->kind == RULE_MATCH) {
-                return (icmp6_header->icmp6_type == ND_NEIGHBOR_SOLICIT);
-            }
-            return (icmp6_header->icmp6_type == ND_NEIGHBOR_SOLICIT);
-        case RULE_FIELD_ND_NA:
-            if (match->kind == RULE_MATCH) {
-                return (icmp6_header->icmp6_type == ND_NEIGHBOR_ADVERT);
-            }
-            return (icmp6_header->icmp6_type == ND_NEIGHBOR_ADVERT);
-        case RULE_FIELD_ND_RD:
-            if (match->kind == RULE_MATCH) {
-                            return (icmp6_header->icmp6_type == ND_REDIRECT);
-                        }
-                        return (icmp6_header->icmp6_type == ND_REDIRECT);
         case RULE_FIELD_ND_RA_CURHOPLIMIT:
         case RULE_FIELD_ND_RA_FLAG_MANAGED:
         case RULE_FIELD_ND_RA_FLAG_OTHER:
@@ -129,281 +27,573 @@ int rule_match_icmp6(const struct rule_match_list* const match,
         case RULE_FIELD_ND_RA_LIFETIME:
         case RULE_FIELD_ND_RA_REACHABLETIMER:
         case RULE_FIELD_ND_RA_RETRANSTIMER:
-            if (icmp6_header->icmp6_type==ND_ROUTER_ADVERT) {
-                return rule_match_nd_router_advert(match, (struct nd_router_advert*)icmp6_header);
-            }
-            fprintf(stderr, "[rules] WARNING: Tried to match a router advertisement "
-                    "field on a packet that is no router advertisement.\n");
-            return 0;
+            return rule_bucket_of_type(ND_ROUTER_ADVERT);
+        case RULE_FIELD_ND_NS:
         case RULE_FIELD_ND_NS_TARGETADDRESS:
-            if (icmp6_header->icmp6_type==ND_NEIGHBOR_SOLICIT) {
-                            return rule_match_in6_addr(
-                        match,
-                        &((struct nd_neighbor_solicit*) icmp6_header)->nd_ns_target);
-            }
-            fprintf(stderr, "[rules] WARNING: Tried to match a neighbor advertisement "
-                "field on a packet that is no neighbor advertisement.\n");
-            return 0;
+            return rule_bucket_of_type(ND_NEIGHBOR_SOLICIT);
+        case RULE_FIELD_ND_NA:
         case RULE_FIELD_ND_NA_FLAG_ROUTER:
         case RULE_FIELD_ND_NA_FLAG_SOLICITED:
         case RULE_FIELD_ND_NA_FLAG_OVERRIDE:
         case RULE_FIELD_ND_NA_TARGETADDRESS:
-            if (icmp6_header->icmp6_type==ND_NEIGHBOR_ADVERT) {
-                return rule_match_nd_neighbor_advert(match, (struct nd_neighbor_advert*)icmp6_header);
-            }
-            fprintf(stderr, "[rules] WARNING: Tried to match a neighbor advertisement "
-                    "field on a packet that is no neighbor advertisement.\n");
-            return 0;
+            return rule_bucket_of_type(ND_NEIGHBOR_ADVERT);
+        case RULE_FIELD_ND_RD:
         case RULE_FIELD_ND_RD_TARGETADDRESS:
         case RULE_FIELD_ND_RD_DESTINATIONADDRESS:
-            if (icmp6_header->icmp6_type==ND_REDIRECT) {
-                return rule_match_nd_redirect(match, (struct nd_redirect*)icmp6_header);
-            }
-            fprintf(stderr, "[rules] WARNING: Tried to match a redirect "
-                    "field on a packet that is no redirect message.\n");
-            return 0;
-        default:
-            return rule_match_nd_opt(match, option_list);
+            return rule_bucket_of_type(ND_REDIRECT);
     }
-    return 0;
+    return -1;
 }
 
-int rule_match_in6_addr(const struct rule_match_list* const match,
-        const struct in6_addr* const inet6_address) {
-    uint8_t address1_prefixed[sizeof(struct in6_addr)];
-    uint8_t address2_prefixed[sizeof(struct in6_addr)];
-    uint8_t prefix_mask[sizeof(struct in6_addr)];
-    uint8_t address_index;
-    /* preparation for the prefix initialization */
-    uint8_t bits_to_zero = 128 - match->value.inet6.prefix;
-    uint8_t bytes_to_zero = bits_to_zero / 8;
-    uint8_t remaining_bits = bits_to_zero % 8;
-    uint8_t* prefix_mask_ptr = (uint8_t*) &prefix_mask;
-
-    /* setting prefix mask to all 1: */
-    memset(prefix_mask_ptr, UINT8_MAX, sizeof(struct in6_addr));
-
-    /* setting unused bits of prefix mask to zero */
-    memset(prefix_mask_ptr + 16 - bytes_to_zero, 0, bytes_to_zero);
-    if (remaining_bits > 0) {
-        prefix_mask_ptr[15 - bytes_to_zero] = (prefix_mask_ptr[15
-                - bytes_to_zero] >> (remaining_bits)) << (remaining_bits);
-    }
-    /* for each byte do a bitwise and of prefix mask with the rule's addr:*/
-    for (address_index = 0; address_index < sizeof(struct in6_addr); address_index++) {
-        address1_prefixed[address_index]
-                = (((uint8_t*) &(match->value.inet6.address))[address_index])
-                        & prefix_mask[address_index];
-        address2_prefixed[address_index]
-                = (((uint8_t*) inet6_address)[address_index])
-                        & prefix_mask[address_index];
-    }
-    /* switch according to match type: */
-    if (match->kind == RULE_MATCH) {
-        return (memcmp(address1_prefixed, address2_prefixed,
-                sizeof(struct in6_addr)) == 0);
-    }
-    return (memcmp(address1_prefixed, address2_prefixed,
-            sizeof(struct in6_addr)) != 0);
-}
+static uint8_t rule_field_value_kind(const rule_field_t field) {
 
-int rule_match_inet6(const struct rule_match_list* const match,
-        const struct ip6_hdr* const inet6_header) {
-    switch (match->field) {
+    switch (field) {
+        case RULE_FIELD_ETHERNET_SOURCE:
+        case RULE_FIELD_ETHERNET_DESTINATION:
+        case RULE_FIELD_ND_OPT_SOURCELINKLAYER_ADDRESS:
+        case RULE_FIELD_ND_OPT_TARGETLINKLAYER_ADDRESS:
+            return RULE_VALUE_ETHERNET;
         case RULE_FIELD_INET6_SOURCE:
-            return rule_match_in6_addr(match, &inet6_header->ip6_src);
         case RULE_FIELD_INET6_DESTINATION:
-            return rule_match_in6_addr(match, &inet6_header->ip6_dst);
-        case RULE_FIELD_INET6_PAYLOAD:
-            return rule_match_uint16(match, inet6_header->ip6_ctlun.ip6_un1.ip6_un1_plen);
-        case RULE_FIELD_INET6_NEXTHEADER:
-            return rule_match_uint8(match, inet6_header->ip6_ctlun.ip6_un1.ip6_un1_nxt);
-        case RULE_FIELD_INET6_HOPLIMIT:
-            return rule_match_uint8(match, inet6_header->ip6_ctlun.ip6_un1.ip6_un1_hlim);
+        case RULE_FIELD_ND_NS_TARGETADDRESS:
+        case RULE_FIELD_ND_NA_TARGETADDRESS:
+        case RULE_FIELD_ND_RD_TARGETADDRESS:
+        case RULE_FIELD_ND_RD_DESTINATIONADDRESS:
+        case RULE_FIELD_ND_OPT_PREFIXINFO_PREFIX:
+            return RULE_VALUE_INET6;
     }
-    fprintf(stderr, "[rules] ERROR: Unknown field %i in match_inet6.\n", match->field);
-    return 0;
+    return RULE_VALUE_NUMBER;
 }
 
-int rule_match_nd_neighbor_advert(const struct rule_match_list* const match,
-        const struct nd_neighbor_advert* const neighbor_advert) {
+static size_t rule_field_address_size(const rule_field_t field) {
 
-    switch (match->field) {
-        case RULE_FIELD_ND_NA_FLAG_ROUTER:
-            return rule_match_and(match, neighbor_advert->nd_na_flags_reserved, ND_NA_FLAG_ROUTER);
-        case RULE_FIELD_ND_NA_FLAG_SOLICITED:
-            return rule_match_and(match, neighbor_advert->nd_na_flags_reserved, ND_NA_FLAG_SOLICITED);
-        case RULE_FIELD_ND_NA_FLAG_OVERRIDE:
-            return rule_match_and(match, neighbor_advert->nd_na_flags_reserved, ND_NA_FLAG_OVERRIDE);
-        case RULE_FIELD_ND_NA_TARGETADDRESS:
-            return rule_match_in6_addr(match, &neighbor_advert->nd_na_target);
+    if (rule_field_value_kind(field)==RULE_VALUE_ETHERNET) {
+        return sizeof(struct ether_addr);
     }
-    fprintf(stderr, "[rules] ERROR: Unknown field %i in match_nd_neighbor_advert.\n", match->field);
-    return 0;
+    return sizeof(struct in6_addr);
 }
 
-int rule_match_nd_opt(const struct rule_match_list* const match,
-        const struct nd_option_list* option_list) {
+/* Value of a number field of a match (1 for flags and options). */
+static uint32_t rule_match_number(const struct rule_match_list* const match) {
+
     switch (match->field) {
-        case RULE_FIELD_ND_OPT_SOURCELINKLAYER:
-            return rule_match_nd_opt_type(match, option_list, ND_OPT_SOURCE_LINKADDR);
-        case RULE_FIELD_ND_OPT_TARGETLINKLAYER:
-            return rule_match_nd_opt_type(match, option_list, ND_OPT_TARGET_LINKADDR);
-        case RULE_FIELD_ND_OPT_PREFIXINFO:
-            return rule_match_nd_opt_type(match, option_list, ND_OPT_PREFIX_INFORMATION);
-        case RULE_FIELD_ND_OPT_MTU:
-            return rule_match_nd_opt_type(match, option_list, ND_OPT_MTU);
-        case RULE_FIELD_ND_OPT_SOURCELINKLAYER_ADDRESS:
-            while (option_list!=NULL) {
-                    if (option_list->option_data.option_header.nd_opt_type==ND_OPT_SOURCE_LINKADDR) {
-                        return rule_match_ether_addr(match, &option_list->option_data.linklayer.ethernet_address);
-                    }
-                    option_list = option_list->next;
-                }
-            /* option not found: */
-            if (match->kind==RULE_MATCH) {
-                return 0;
-            }
-            return 1;
-        case RULE_FIELD_ND_OPT_TARGETLINKLAYER_ADDRESS:
-            while (option_list!=NULL) {
-                    if (option_list->option_data.option_header.nd_opt_type==ND_OPT_TARGET_LINKADDR) {
-                        return rule_match_ether_addr(match, &option_list->option_data.linklayer.ethernet_address);
-                    }
-                    option_list = option_list->next;
-                }
-            /* option not found: */
-            if (match->kind==RULE_MATCH) {
-                return 0;
-            }
-            return 1;
-        case RULE_FIELD_ND_OPT_PREFIXINFO_FLAG_ONLINK:
-        case RULE_FIELD_ND_OPT_PREFIXINFO_FLAG_AUTOCONF:
+        case RULE_FIELD_INET6_NEXTHEADER:
+        case RULE_FIELD_INET6_HOPLIMIT:
+        case RULE_FIELD_ICMP6_TYPE:
+        case RULE_FIELD_ICMP6_CODE:
+        case RULE_FIELD_ND_RA_CURHOPLIMIT:
+            return match->value.uint8;
+        case RULE_FIELD_INET6_PAYLOAD:
+        case RULE_FIELD_ND_RA_LIFETIME:
+            return match->value.uint16;
+        case RULE_FIELD_ND_RA_REACHABLETIMER:
+        case RULE_FIELD_ND_RA_RETRANSTIMER:
         case RULE_FIELD_ND_OPT_PREFIXINFO_VALIDLIFETIME:
         case RULE_FIELD_ND_OPT_PREFIXINFO_PREFERREDLIFETIME:
-        case RULE_FIELD_ND_OPT_PREFIXINFO_PREFIX:
-            return rule_match_nd_opt_prefix(match, option_list);
         case RULE_FIELD_ND_OPT_MTU_MTU:
-            while (option_list!=NULL) {
-                    if (option_list->option_data.option_header.nd_opt_type==ND_OPT_TARGET_LINKADDR) {
-                        return rule_match_uint32(match, option_list->option_data.mtu.nd_opt_mtu_mtu);
-                    }
-                    option_list = option_list->next;
-                }
-            /* option not found: */
-            if (match->kind==RULE_MATCH) {
-                return 0;
-            }
-            return 1;
+            return match->value.uint32;
+    }
+    return 1;
+}
+
+static void rule_predicate_compile(const struct rule_match_list* const match,
+        struct rule_predicate* const predicate) {
+    const uint8_t* address = (const uint8_t*)&match->value.inet6.address;
+    int prefix = match->value.inet6.prefix>128 ? 128 : match->value.inet6.prefix;
+    int i;
 
+    memset(predicate, 0, sizeof(struct rule_predicate));
+    predicate->field = match->field;
+    predicate->kind = match->kind;
+    predicate->value_kind = rule_field_value_kind(match->field);
+    switch (predicate->value_kind) {
+        case RULE_VALUE_NUMBER:
+            predicate->number = rule_match_number(match);
+            break;
+        case RULE_VALUE_ETHERNET:
+            memcpy(predicate->address, &match->value.ethernet_address, sizeof(struct ether_addr));
+            break;
+        case RULE_VALUE_INET6:
+            for (i=0; i<(int)sizeof(struct in6_addr); i++, prefix-=8) {
+                predicate->mask[i] = prefix>=8 ? 0xff : (prefix<=0 ? 0 : (uint8_t)(0xff<<(8-prefix)));
+                predicate->address[i] = address[i] & predicate->mask[i];
+            }
+            break;
     }
-    fprintf(stderr, "[rules] ERROR: Unknown field %i in match_nd_opt.\n", match->field);
-    return 0;
+}
 
+/* Tells if a predicate is an exact address match that may serve as key. */
+static int rule_predicate_is_key(const struct rule_predicate* const predicate) {
+
+    return predicate->kind==RULE_MATCH
+            && (predicate->value_kind==RULE_VALUE_ETHERNET
+            || (predicate->value_kind==RULE_VALUE_INET6 && predicate->mask[15]==0xff));
 }
 
-int rule_match_nd_opt_prefix(const struct rule_match_list* const match,
-        const struct nd_option_list* option_list) {
-    while (option_list!=NULL) {
-        if (option_list->option_data.option_header.nd_opt_type==ND_OPT_PREFIX_INFORMATION) {
-            const struct nd_opt_prefix_info* prefix_info=&option_list->option_data.prefix_info;
-            switch (match->field) {
-                case RULE_FIELD_ND_OPT_PREFIXINFO_FLAG_ONLINK:
-                                    return rule_match_and(match, prefix_info->nd_opt_pi_flags_reserved, ND_OPT_PI_FLAG_ONLINK);
-                case RULE_FIELD_ND_OPT_PREFIXINFO_FLAG_AUTOCONF:
-                    return rule_match_and(match, prefix_info->nd_opt_pi_flags_reserved, ND_OPT_PI_FLAG_AUTO);
-                case RULE_FIELD_ND_OPT_PREFIXINFO_VALIDLIFETIME:
-                    return rule_match_uint32(match, prefix_info->nd_opt_pi_valid_time);
-                case RULE_FIELD_ND_OPT_PREFIXINFO_PREFERREDLIFETIME:
-                    return rule_match_uint32(match, prefix_info->nd_opt_pi_preferred_time);
-                case RULE_FIELD_ND_OPT_PREFIXINFO_PREFIX:
-                    return rule_match_in6_addr(match, &prefix_info->nd_opt_pi_prefix);
-            }
-            fprintf(stderr, "[rules] ERROR: Unknown field %i in match_nd_opt_prefix.\n", match->field);
-            return 0;
+static int rule_predicate_match(const struct rule_predicate* const predicate,
+        const struct rule_fields* const fields) {
+    const uint8_t* address = fields->address[predicate->field];
+    int equal = 0;
+    int i;
+
+    /* a missing field (an option not present) does not equal the value: */
+    if ((fields->present & RULE_FIELD_BIT(predicate->field))!=0) {
+        switch (predicate->value_kind) {
+            case RULE_VALUE_NUMBER:
+                equal = fields->number[predicate->field]==predicate->number;
+                break;
+            case RULE_VALUE_ETHERNET:
+                equal = memcmp(address, predicate->address, sizeof(struct ether_addr))==0;
+                break;
+            case RULE_VALUE_INET6:
+                equal = 1;
+                for (i=0; i<(int)sizeof(struct in6_addr) && equal; i++) {
+                    equal = (address[i] & predicate->mask[i])==predicate->address[i];
+                }
+                break;
         }
-        option_list = option_list->next;
     }
-    /* option not found: */
-    if (match->kind==RULE_MATCH) {
-        return 0;
+    if (predicate->kind==RULE_MATCH) {
+        return equal;
     }
-    return 1;
+    return !equal;
 }
 
-int rule_match_nd_opt_type(const struct rule_match_list* const match,
-        const struct nd_option_list* option_list, uint8_t opt_type) {
-    while (option_list!=NULL) {
-        if (option_list->option_data.option_header.nd_opt_type==opt_type) {
-            /* given option found: */
-            if (match->kind==RULE_MATCH) {
-                return 1;
-            }
-            return 0;
+/* FNV-1a of a key. */
+static uint64_t rule_key_hash(const rule_field_t field, const uint8_t* const address) {
+    const size_t size = rule_field_address_size(field);
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i;
+
+    hash ^= field;
+    hash *= 1099511628211ULL;
+    for (i=0; i<size; i++) {
+        hash ^= address[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* Gets the slot of a key in the hash table of a bucket, which is unused if
+ * the key is not in the table.
+ */
+static struct rule_key* rule_key_slot(const struct rule_bucket* const bucket,
+        const rule_field_t field, const uint8_t* const address) {
+    const size_t size = rule_field_address_size(field);
+    uint32_t index = (uint32_t)rule_key_hash(field, address) & (bucket->key_capacity-1);
+
+    while (bucket->keys[index].used
+            && (bucket->keys[index].field!=field
+            || memcmp(bucket->keys[index].address, address, size)!=0)) {
+        index = (index+1) & (bucket->key_capacity-1);
+    }
+    return &bucket->keys[index];
+}
+
+static void rule_compile(struct rule_set* const set, struct rule_compiled* const compiled,
+        const struct rule_list* const rule, uint32_t* const predicates_count) {
+    struct rule_predicate* const predicates = &set->predicates[*predicates_count];
+    const struct rule_match_list* match;
+    struct rule_predicate predicate;
+    uint32_t i, j;
+    int bucket;
+
+    compiled->rule = rule;
+    compiled->first = *predicates_count;
+    compiled->buckets = (1<<RULE_BUCKETS)-1;
+    for (match=rule->matches; match!=NULL; match=match->next) {
+        if (match->field >= RULE_FIELDS_COUNT) {
+            fprintf(stderr,
+                    "[rules] ERROR: Unknown field type \"%u\" for matching rule \"%s\".\n",
+                    match->field, rule->description);
+            continue;
+        }
+        bucket = rule_field_bucket(match->field);
+        switch (match->field) {
+            case RULE_FIELD_ND_RS:
+            case RULE_FIELD_ND_RA:
+            case RULE_FIELD_ND_NS:
+            case RULE_FIELD_ND_NA:
+            case RULE_FIELD_ND_RD:
+                /* these only check the message type, whatever the match kind: */
+                compiled->buckets &= 1<<bucket;
+                continue;
+            case RULE_FIELD_ICMP6_TYPE:
+                bucket = rule_bucket_of_type(match->value.uint8);
+                if (bucket!=RULE_BUCKET_OTHER) {
+                    if (match->kind==RULE_MATCH) {
+                        compiled->buckets &= 1<<bucket;
+                    } else {
+                        compiled->buckets &= ~(1<<bucket);
+                    }
+                    continue;
+                }
+                /* the other bucket holds several types, compare it there: */
+                if (match->kind==RULE_MATCH) {
+                    compiled->buckets &= 1<<RULE_BUCKET_OTHER;
+                }
+                break;
+            default:
+                /* a field of a message type only matches that type: */
+                if (bucket!=-1) {
+                    compiled->buckets &= 1<<bucket;
+                }
         }
-        option_list = option_list->next;
+        rule_predicate_compile(match, &predicates[compiled->count]);
+        compiled->count++;
     }
-    /* given option was not found: */
-    if (match->kind == RULE_MATCH) {
-        return 0;
+    /* the first exact address match is the key: */
+    for (i=0; i<compiled->count; i++) {
+        if (rule_predicate_is_key(&predicates[i])) {
+            compiled->key = predicates[i];
+            compiled->has_key = 1;
+            memmove(&predicates[i], &predicates[i+1], (compiled->count-i-1)*sizeof(struct rule_predicate));
+            compiled->count--;
+            break;
+        }
     }
-    return 1;
+    /* cheapest predicates first, the order of the rule is kept otherwise: */
+    for (i=1; i<compiled->count; i++) {
+        predicate = predicates[i];
+        for (j=i; j>0 && predicates[j-1].value_kind>predicate.value_kind; j--) {
+            predicates[j] = predicates[j-1];
+        }
+        predicates[j] = predicate;
+    }
+    *predicates_count += compiled->count;
 }
 
-int rule_match_nd_redirect(const struct rule_match_list* const match,
-        const struct nd_redirect* const redirect) {
-    switch (match->field) {
-        case RULE_FIELD_ND_RD_TARGETADDRESS:
-            return rule_match_in6_addr(match, &redirect->nd_rd_target);
-        case RULE_FIELD_ND_RD_DESTINATIONADDRESS:
-            return rule_match_in6_addr(match, &redirect->nd_rd_dst);
+static int rule_bucket_compile(struct rule_set* const set, const int index) {
+    struct rule_bucket* const bucket = &set->buckets[index];
+    const struct rule_compiled* rule;
+    struct rule_key* key;
+    uint32_t keyed_count = 0;
+    uint32_t first = 0;
+    uint32_t i, j;
+
+    for (i=0; i<set->count; i++) {
+        rule = &set->rules[i];
+        if ((rule->buckets & (1<<index))==0) {
+            continue;
+        }
+        for (j=0; j<rule->count; j++) {
+            bucket->fields |= RULE_FIELD_BIT(set->predicates[rule->first+j].field);
+        }
+        if (rule->has_key) {
+            bucket->fields |= RULE_FIELD_BIT(rule->key.field);
+            bucket->key_fields |= RULE_FIELD_BIT(rule->key.field);
+            keyed_count++;
+        } else {
+            bucket->scan_count++;
+        }
+    }
+    if (bucket->scan_count>0
+            && (bucket->scan=malloc(bucket->scan_count*sizeof(uint32_t)))==NULL) {
+        perror("[rules] malloc");
+        return -1;
+    }
+    if (keyed_count>0) {
+        /* keep the hash table at most half full: */
+        bucket->key_capacity = 8;
+        while (bucket->key_capacity < 2*keyed_count) {
+            bucket->key_capacity <<= 1;
+        }
+        if ((bucket->keys=calloc(bucket->key_capacity, sizeof(struct rule_key)))==NULL
+                || (bucket->keyed=malloc(keyed_count*sizeof(uint32_t)))==NULL) {
+            perror("[rules] malloc");
+            return -1;
+        }
+    }
+    /* list the rules without key and count the rules of each key: */
+    bucket->scan_count = 0;
+    for (i=0; i<set->count; i++) {
+        rule = &set->rules[i];
+        if ((rule->buckets & (1<<index))==0) {
+            continue;
+        }
+        if (!rule->has_key) {
+            bucket->scan[bucket->scan_count++] = i;
+            continue;
+        }
+        key = rule_key_slot(bucket, rule->key.field, rule->key.address);
+        if (!key->used) {
+            key->used = 1;
+            key->field = rule->key.field;
+            memcpy(key->address, rule->key.address, sizeof(key->address));
+        }
+        key->count++;
+    }
+    /* then group the rules of each key: */
+    for (i=0; i<bucket->key_capacity; i++) {
+        if (bucket->keys[i].used) {
+            bucket->keys[i].first = first;
+            first += bucket->keys[i].count;
+            bucket->keys[i].count = 0;
+        }
+    }
+    for (i=0; i<set->count; i++) {
+        rule = &set->rules[i];
+        if ((rule->buckets & (1<<index))!=0 && rule->has_key) {
+            key = rule_key_slot(bucket, rule->key.field, rule->key.address);
+            bucket->keyed[key->first + key->count++] = i;
+        }
     }
-    fprintf(stderr, "[rules] ERROR: Unknown field %i in match_nd_redirect.\n", match->field);
     return 0;
 }
 
-int rule_match_nd_router_advert(const struct rule_match_list* const match,
-        const struct nd_router_advert* const router_advert) {
+struct rule_set* rule_set_compile(const struct rule_list* rules) {
+    const struct rule_list* tmp_rules;
+    const struct rule_match_list* match;
+    struct rule_set* set;
+    uint32_t matches_count = 0;
+    uint32_t i;
 
-    switch (match->field) {
-        case RULE_FIELD_ND_RA_CURHOPLIMIT:
-            return rule_match_uint8(match, router_advert->nd_ra_curhoplimit);
-        case RULE_FIELD_ND_RA_FLAG_MANAGED:
-            return rule_match_and(match, router_advert->nd_ra_flags_reserved, ND_RA_FLAG_MANAGED);
-        case RULE_FIELD_ND_RA_FLAG_OTHER:
-            return rule_match_and(match, router_advert->nd_ra_flags_reserved, ND_RA_FLAG_OTHER);
-        case RULE_FIELD_ND_RA_FLAG_HOMEAGENT:
-            return rule_match_and(match, router_advert->nd_ra_flags_reserved, ND_RA_FLAG_HOME_AGENT);
-        case RULE_FIELD_ND_RA_LIFETIME:
-            return rule_match_uint16(match, router_advert->nd_ra_router_lifetime);
-        case RULE_FIELD_ND_RA_REACHABLETIMER:
-            return rule_match_uint32(match, router_advert->nd_ra_reachable);
-        case RULE_FIELD_ND_RA_RETRANSTIMER:
-            return rule_match_uint32(match, router_advert->nd_ra_retransmit);
+    if ((set=calloc(1, sizeof(struct rule_set)))==NULL) {
+        perror("[rules] calloc");
+        return NULL;
     }
-    fprintf(stderr, "[rules] ERROR: Unknown field %i in match_nd_router_advert.\n", match->field);
-    return 0;
+    for (tmp_rules=rules; tmp_rules!=NULL; tmp_rules=tmp_rules->next) {
+        set->count++;
+        for (match=tmp_rules->matches; match!=NULL; match=match->next) {
+            matches_count++;
+        }
+    }
+    if ((set->count>0 && (set->rules=calloc(set->count, sizeof(struct rule_compiled)))==NULL)
+            || (matches_count>0 && (set->predicates=calloc(matches_count, sizeof(struct rule_predicate)))==NULL)) {
+        perror("[rules] calloc");
+        rule_set_free(set);
+        return NULL;
+    }
+    matches_count = 0;
+    for (tmp_rules=rules, i=0; tmp_rules!=NULL; tmp_rules=tmp_rules->next, i++) {
+        rule_compile(set, &set->rules[i], tmp_rules, &matches_count);
+    }
+    for (i=0; i<RULE_BUCKETS; i++) {
+        if (rule_bucket_compile(set, i)==-1) {
+            rule_set_free(set);
+            return NULL;
+        }
+    }
+    return set;
+}
+
+void rule_set_free(struct rule_set* set) {
+    int i;
+
+    if (set==NULL) {
+        return;
+    }
+    for (i=0; i<RULE_BUCKETS; i++) {
+        free(set->buckets[i].scan);
+        free(set->buckets[i].keyed);
+        free(set->buckets[i].keys);
+    }
+    free(set->rules);
+    free(set->predicates);
+    free(set);
 }
 
-int rule_match_uint8(const struct rule_match_list* const match, const uint8_t uint8) {
-    if (match->kind == RULE_MATCH) {
-        return match->value.uint8 == uint8;
+static void rule_fields_number(struct rule_fields* const fields,
+        const rule_field_t field, const uint32_t number) {
+    fields->present |= RULE_FIELD_BIT(field);
+    fields->number[field] = number;
+}
+
+static void rule_fields_address(struct rule_fields* const fields,
+        const rule_field_t field, const void* const address) {
+    fields->present |= RULE_FIELD_BIT(field);
+    fields->address[field] = address;
+}
+
+/* Extracts the fields of a packet, the options only if needed. */
+static void rule_fields_extract(const struct capture_info* const capture_info,
+        const uint64_t needed, struct rule_fields* const fields) {
+    const struct ether_header* ethernet_header = capture_info->ethernet_header;
+    const struct ip6_hdr* ip6_header           = capture_info->ip6_header;
+    const struct icmp6_hdr* icmp6_header       = capture_info->icmp6_header;
+    const struct nd_option_list* option        = capture_info->option_list;
+
+    fields->present = 0;
+    rule_fields_address(fields, RULE_FIELD_ETHERNET_SOURCE, ethernet_header->ether_shost);
+    rule_fields_address(fields, RULE_FIELD_ETHERNET_DESTINATION, ethernet_header->ether_dhost);
+    rule_fields_address(fields, RULE_FIELD_INET6_SOURCE, &ip6_header->ip6_src);
+    rule_fields_address(fields, RULE_FIELD_INET6_DESTINATION, &ip6_header->ip6_dst);
+    rule_fields_number(fields, RULE_FIELD_INET6_PAYLOAD, ntohs(ip6_header->ip6_ctlun.ip6_un1.ip6_un1_plen));
+    rule_fields_number(fields, RULE_FIELD_INET6_NEXTHEADER, ip6_header->ip6_ctlun.ip6_un1.ip6_un1_nxt);
+    rule_fields_number(fields, RULE_FIELD_INET6_HOPLIMIT, ip6_header->ip6_ctlun.ip6_un1.ip6_un1_hlim);
+    rule_fields_number(fields, RULE_FIELD_ICMP6_TYPE, icmp6_header->icmp6_type);
+    rule_fields_number(fields, RULE_FIELD_ICMP6_CODE, icmp6_header->icmp6_code);
+    switch (icmp6_header->icmp6_type) {
+        case ND_ROUTER_ADVERT: {
+            const struct nd_router_advert* router_advert = (const struct nd_router_advert*)icmp6_header;
+
+            rule_fields_number(fields, RULE_FIELD_ND_RA_CURHOPLIMIT, router_advert->nd_ra_curhoplimit);
+            rule_fields_number(fields, RULE_FIELD_ND_RA_FLAG_MANAGED,
+                    (router_advert->nd_ra_flags_reserved & ND_RA_FLAG_MANAGED)==ND_RA_FLAG_MANAGED);
+            rule_fields_number(fields, RULE_FIELD_ND_RA_FLAG_OTHER,
+                    (router_advert->nd_ra_flags_reserved & ND_RA_FLAG_OTHER)==ND_RA_FLAG_OTHER);
+            rule_fields_number(fields, RULE_FIELD_ND_RA_FLAG_HOMEAGENT,
+                    (router_advert->nd_ra_flags_reserved & ND_RA_FLAG_HOME_AGENT)==ND_RA_FLAG_HOME_AGENT);
+            rule_fields_number(fields, RULE_FIELD_ND_RA_LIFETIME, ntohs(router_advert->nd_ra_router_lifetime));
+            rule_fields_number(fields, RULE_FIELD_ND_RA_REACHABLETIMER, ntohl(router_advert->nd_ra_reachable));
+            rule_fields_number(fields, RULE_FIELD_ND_RA_RETRANSTIMER, ntohl(router_advert->nd_ra_retransmit));
+            break;
+        }
+        case ND_NEIGHBOR_SOLICIT:
+            rule_fields_address(fields, RULE_FIELD_ND_NS_TARGETADDRESS,
+                    &((const struct nd_neighbor_solicit*)icmp6_header)->nd_ns_target);
+            break;
+        case ND_NEIGHBOR_ADVERT: {
+            const struct nd_neighbor_advert* neighbor_advert = (const struct nd_neighbor_advert*)icmp6_header;
+
+            rule_fields_number(fields, RULE_FIELD_ND_NA_FLAG_ROUTER,
+                    (neighbor_advert->nd_na_flags_reserved & ND_NA_FLAG_ROUTER)==ND_NA_FLAG_ROUTER);
+            rule_fields_number(fields, RULE_FIELD_ND_NA_FLAG_SOLICITED,
+                    (neighbor_advert->nd_na_flags_reserved & ND_NA_FLAG_SOLICITED)==ND_NA_FLAG_SOLICITED);
+            rule_fields_number(fields, RULE_FIELD_ND_NA_FLAG_OVERRIDE,
+                    (neighbor_advert->nd_na_flags_reserved & ND_NA_FLAG_OVERRIDE)==ND_NA_FLAG_OVERRIDE);
+            rule_fields_address(fields, RULE_FIELD_ND_NA_TARGETADDRESS, &neighbor_advert->nd_na_target);
+            break;
+        }
+        case ND_REDIRECT:
+            rule_fields_address(fields, RULE_FIELD_ND_RD_TARGETADDRESS,
+                    &((const struct nd_redirect*)icmp6_header)->nd_rd_target);
+            rule_fields_address(fields, RULE_FIELD_ND_RD_DESTINATIONADDRESS,
+                    &((const struct nd_redirect*)icmp6_header)->nd_rd_dst);
+            break;
+    }
+    if ((needed & RULE_FIELDS_OPTIONS)==0) {
+        return;
+    }
+    /* the fields of an option are those of its first occurence: */
+    for (; option!=NULL; option=option->next) {
+        switch (option->nd_option_type) {
+            case ND_OPT_SOURCE_LINKADDR:
+                if ((fields->present & RULE_FIELD_BIT(RULE_FIELD_ND_OPT_SOURCELINKLAYER))==0) {
+                    rule_fields_number(fields, RULE_FIELD_ND_OPT_SOURCELINKLAYER, 1);
+                    rule_fields_address(fields, RULE_FIELD_ND_OPT_SOURCELINKLAYER_ADDRESS,
+                            &option->option_data.linklayer.ethernet_address);
+                }
+                break;
+            case ND_OPT_TARGET_LINKADDR:
+                if ((fields->present & RULE_FIELD_BIT(RULE_FIELD_ND_OPT_TARGETLINKLAYER))==0) {
+                    rule_fields_number(fields, RULE_FIELD_ND_OPT_TARGETLINKLAYER, 1);
+                    rule_fields_address(fields, RULE_FIELD_ND_OPT_TARGETLINKLAYER_ADDRESS,
+                            &option->option_data.linklayer.ethernet_address);
+                }
+                break;
+            case ND_OPT_PREFIX_INFORMATION:
+                if ((fields->present & RULE_FIELD_BIT(RULE_FIELD_ND_OPT_PREFIXINFO))==0) {
+                    const struct nd_opt_prefix_info* prefix_info = &option->option_data.prefix_info;
+
+                    rule_fields_number(fields, RULE_FIELD_ND_OPT_PREFIXINFO, 1);
+                    rule_fields_number(fields, RULE_FIELD_ND_OPT_PREFIXINFO_FLAG_ONLINK,
+                            (prefix_info->nd_opt_pi_flags_reserved & ND_OPT_PI_FLAG_ONLINK)==ND_OPT_PI_FLAG_ONLINK);
+                    rule_fields_number(fields, RULE_FIELD_ND_OPT_PREFIXINFO_FLAG_AUTOCONF,
+                            (prefix_info->nd_opt_pi_flags_reserved & ND_OPT_PI_FLAG_AUTO)==ND_OPT_PI_FLAG_AUTO);
+                    rule_fields_number(fields, RULE_FIELD_ND_OPT_PREFIXINFO_VALIDLIFETIME,
+                            ntohl(prefix_info->nd_opt_pi_valid_time));
+                    rule_fields_number(fields, RULE_FIELD_ND_OPT_PREFIXINFO_PREFERREDLIFETIME,
+                            ntohl(prefix_info->nd_opt_pi_preferred_time));
+                    rule_fields_address(fields, RULE_FIELD_ND_OPT_PREFIXINFO_PREFIX,
+                            &prefix_info->nd_opt_pi_prefix);
+                }
+                break;
+            case ND_OPT_MTU:
+                if ((fields->present & RULE_FIELD_BIT(RULE_FIELD_ND_OPT_MTU))==0) {
+                    rule_fields_number(fields, RULE_FIELD_ND_OPT_MTU, 1);
+                    rule_fields_number(fields, RULE_FIELD_ND_OPT_MTU_MTU,
+                            ntohl(option->option_data.mtu.nd_opt_mtu_mtu));
+                }
+                break;
+        }
     }
-    return match->value.uint8 != uint8;
 }
 
-int rule_match_uint16(const struct rule_match_list* const match, const uint16_t uint16) {
-    /* beaware of network byte order: */
-    if (match->kind == RULE_MATCH) {
-        return match->value.uint16 == ntohs(uint16);
+static int rule_compiled_match(const struct rule_set* const set,
+        const struct rule_compiled* const rule, const struct rule_fields* const fields) {
+    uint32_t i;
+
+    for (i=0; i<rule->count; i++) {
+        if (!rule_predicate_match(&set->predicates[rule->first+i], fields)) {
+            return 0;
+        }
     }
-    return match->value.uint16 != ntohs(uint16);
+    return 1;
 }
 
-int rule_match_uint32(const struct rule_match_list* const match, const uint32_t uint32) {
-    /* beaware of network byte order: */
-        if (match->kind == RULE_MATCH) {
-            return match->value.uint32 == ntohl(uint32);
+int rule_match_all(struct capture_info* const capture_info) {
+    const struct rule_list* rules;
+    const struct rule_set* set;
+    const struct rule_bucket* bucket;
+    const struct probe* probe_locked;
+    struct rule_fields fields;
+    /* the rules without key and the rules of each key found, in rule order: */
+    const uint32_t* lists[RULE_FIELDS_COUNT+1];
+    uint32_t lists_left[RULE_FIELDS_COUNT+1];
+    unsigned int lists_count = 0;
+    uint64_t key_fields;
+    rule_field_t field;
+
+    /* critical section: */
+    probe_locked = probe_handle_rdlock(capture_info->probe);
+    rules = extinfo_list_get(probe_locked->extinfo, rule_list_slot);
+    probe_handle_unlock(capture_info->probe);
+    /* end of critical section. */
+
+    if (rules==NULL || rules->compiled==NULL) {
+        return 0;
+    }
+    set = rules->compiled;
+    bucket = &set->buckets[rule_bucket_of_type(capture_info->icmp6_header->icmp6_type)];
+    if (bucket->scan_count==0 && bucket->keys==NULL) {
+        return 0;
+    }
+    rule_fields_extract(capture_info, bucket->fields, &fields);
+    if (bucket->scan_count>0) {
+        lists[lists_count] = bucket->scan;
+        lists_left[lists_count] = bucket->scan_count;
+        lists_count++;
+    }
+    key_fields = bucket->key_fields & fields.present;
+    for (field=0; key_fields!=0; field++, key_fields>>=1) {
+        const struct rule_key* key;
+
+        if ((key_fields & 1)==0) {
+            continue;
+        }
+        key = rule_key_slot(bucket, field, fields.address[field]);
+        if (key->used) {
+            lists[lists_count] = &bucket->keyed[key->first];
+            lists_left[lists_count] = key->count;
+            lists_count++;
+        }
+    }
+    /* merge the lists to raise the alerts in the order of the rules: */
+    while (lists_count>0) {
+        const struct rule_compiled* rule;
+        unsigned int next = 0;
+        unsigned int i;
+
+        for (i=1; i<lists_count; i++) {
+            if (*lists[i] < *lists[next]) {
+                next = i;
+            }
+        }
+        rule = &set->rules[*lists[next]];
+        lists[next]++;
+        if (--lists_left[next]==0) {
+            lists_count--;
+            lists[next] = lists[lists_count];
+            lists_left[next] = lists_left[lists_count];
         }
-        return match->value.uint32 != ntohl(uint32);
+        if (rule_compiled_match(set, rule, &fields)) {
+            if (DEBUG) {
+                fprintf(stderr, "[rules] Matched rule %s\n",
+                        rule->rule->description);
+            }
+            alert_raise(1, capture_info->probe, "user defined rule matched", (char*)rule->rule->description, (struct ether_addr*) capture_info->ethernet_header->ether_shost, NULL, &capture_info->ip6_header->ip6_src, NULL);
+        }
+    }
+    return 0;
 }
@@ -13,17 +13,29 @@
 #include "rules_types.h"
 
 extern struct rule_list* rules;
+/** Slot of the extinfo type "rules", set when it is registered. */
+extern int rule_list_slot;
 
 extern int DEBUG;
 
-/** Matches a given value against a specific flag using bitwise AND with respect
- *  to the match kind (match or no_match).
- *  @param match The match used to determine the match kind.
- *  @param value The packet value to be checked.
- *  @param flag  The flag to be checked.
+/** Compiles a rule list for matching.
+ *
+ *  Each rule is put in the buckets of the ICMPv6 types it may match, as
+ *  told by its nd.* and icmp6.type matches and by the fields of a message
+ *  type it matches. Its other matches become predicates on the field
+ *  vector of the packets, the cheapest first. An exact ethernet or IPv6
+ *  address match (no prefix) is taken as the key of the rule, the rules of
+ *  a bucket with a key are found by a hash lookup of the fields of the
+ *  packet.
+ *  @param rules The rule list.
+ *  @return      The compiled rules, NULL on error.
  */
-int rule_match_and(const struct rule_match_list* const match,
-        const unsigned int value, const unsigned int flag);
+struct rule_set* rule_set_compile(const struct rule_list* rules);
+
+/** Frees compiled rules.
+ *  @param set The compiled rules, may be NULL.
+ */
+void rule_set_free(struct rule_set* set);
 
 /** Checks all rules if they match a given packet.
  *  @param capture_info    The capture_info structure containing all
@@ -33,117 +45,4 @@ int rule_match_and(const struct rule_match_list* const match,
  */
 int rule_match_all(struct capture_info* const capture_info);
 
-/** Checks if the given ethernet address matches that of the match.
- *  @param match            The match holding the match kind and the value of
- *                          this match to check against.
- *  @param ethernet_address The ethernet address of the packet.
- *  @return                 1 if the packet matches, 0 otherwise.
- */
-int rule_match_ether_addr(const struct rule_match_list* const match, const struct ether_addr* const ethernet_address);
-
-/** Checks a given match against an ethernet header.
- *  @param match           The match.
- *  @param ethernet_header The ethernet header of the packet.
- *  @return                1 if the packet matches, 0 otherwise.
- */
-int rule_match_ethernet(const struct rule_match_list* const match, const struct ether_header* const ethernet_header);
-
-/** Checks a given match against an ICMPv6 header.
- *  @param match         The match.
- *  @param icmp6_header  The ICMPv6 header of the packet.
- *  @param packet_length The total length of the packet.
- *  @return              1 if the packet matches, 0 otherwise.
- */
-int rule_match_icmp6(const struct rule_match_list* const match,
-        const struct icmp6_hdr* const icmp6_header, const struct nd_option_list* option_list);
-
-/** Checks a given IPv6 address against that of the match.
- *  @param match         The match.
- *  @param inet6_address The IPv6 address of the packet.
- *  @return              1 if the packet matches, 0 otherwise.
- */
-int rule_match_in6_addr(const struct rule_match_list* const match, const struct in6_addr* const inet6_address);
-
-/** Checks a given match against an IPv6 header.
- *  @param match      The match.
- *  @param ip6_header The IPv6 header of the packet.
- *  @return           1 if the packet matches, 0 otherwise.
- */
-int rule_match_inet6(const struct rule_match_list* const match, const struct ip6_hdr* const ip6_header);
-
-/** Checks a given match against a ND neighbor advertisement.
- *  @param match         The match.
- *  @param router_advert The neighbor advertisement.
- *  @return              1 if the packet matches, 0 otherwise.
- */
-int rule_match_nd_neighbor_advert(const struct rule_match_list* const match,
-        const struct nd_neighbor_advert* const neighbor_advert);
-
-/** Checks a given match against an option list.
- *  @param match         The match.
- *  @param option_list   The option list.
- *  @return              1 if the packet matches, 0 otherwise.
- */
-int rule_match_nd_opt(const struct rule_match_list* const match,
-        const struct nd_option_list* option_list);
-
-/** Checks a given match against an option list that may contain a
- *  prefix information option.
- *  @param match         The match.
- *  @param option_list   The option list.
- *  @return              1 if the packet matches, 0 otherwise.
- */
-int rule_match_nd_opt_prefix(const struct rule_match_list* const match,
-        const struct nd_option_list* option_list);
-
-/** Checks for a given match and a ND option type if the option is contained
- *  in the list of options of the current captured packet.
- *  @param match         The match.
- *  @param option_list   Option list.
- *  @param opt_type      Option type to check for.
- *  @return              1 if the packet matches, 0 otherwise.
- */
-int rule_match_nd_opt_type(const struct rule_match_list* const match,
-        const struct nd_option_list* option_list, uint8_t opt_type);
-
-/** Checks a given match against a ND redirect message.
- *  @param match         The match.
- *  @param redirect      The redirect message.
- *  @return              1 if the packet matches, 0 otherwise.
- */
-int rule_match_nd_redirect(const struct rule_match_list* const match,
-        const struct nd_redirect* const redirect);
-
-/** Checks a given match against a ND router advertisement.
- *  @param match         The match.
- *  @param router_advert The router advertisement.
- *  @return              1 if the packet matches, 0 otherwise.
- */
-int rule_match_nd_router_advert(const struct rule_match_list* const match,
-        const struct nd_router_advert* const router_advert);
-
-/** Checks a given match against an 8bit unsigned integer with respect to
- *  the match kind (match or no_match).
- *  @param match The match.
- *  @param uint8 The number.
- *  @return      1 if the packet matches, 0 otherwise.
- */
-int rule_match_uint8(const struct rule_match_list* const match, const uint8_t uint8);
-
-/** Checks a given match against an 16bit unsigned integer with respect to
- *  the match kind (match or no_match) taking care of network byte order.
- *  @param match  The match.
- *  @param uint16 The number.
- *  @return       1 if the packet matches, 0 otherwise.
- */
-int rule_match_uint16(const struct rule_match_list* const match, const uint16_t uint16);
-
-/** Checks a given match against an 32bit unsigned integer with respect to
- *  the match kind (match or no_match) taking care of network byte order.
- *  @param match  The match.
- *  @param uint32 The number.
- *  @return       1 if the packet matches, 0 otherwise.
- */
-int rule_match_uint32(const struct rule_match_list* const match, const uint32_t uint32);
-
 #endif
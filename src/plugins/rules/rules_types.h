@@ -72,6 +72,8 @@
 #define RULE_MATCH         200
 #define RULE_NO_MATCH      201
 
+struct rule_set;
+
 /** Holds a list of rules.
 */
 struct rule_list {
@@ -85,6 +87,10 @@ struct rule_list {
         be included in an alert triggered by this rule.
     */
     struct rule_export_list* exports;
+    /** The rules compiled for matching by rule_set_compile(), only set in
+        the first entry of a list loaded by rule_list_load().
+    */
+    struct rule_set* compiled;
     /** Pointer to the next rule list entry.
     */
     struct rule_list* next;
@@ -141,4 +147,105 @@ struct rule_match_list {
     struct rule_match_list* next;
 };
 
+/** Number of buckets of a compiled rule list: one for each Neighbor
+ *  Discovery message (RS, RA, NS, NA, redirect) and one for the other
+ *  ICMPv6 messages.
+ */
+#define RULE_BUCKETS      6
+#define RULE_BUCKET_OTHER 5
+
+/* kinds of values of the compiled matches, from the cheapest to compare: */
+#define RULE_VALUE_NUMBER   0
+#define RULE_VALUE_ETHERNET 1
+#define RULE_VALUE_INET6    2
+
+/** Bit of a field in a field mask. */
+#define RULE_FIELD_BIT(field) (UINT64_C(1)<<(field))
+
+/** A match compiled for matching the field vector of a packet.
+ */
+struct rule_predicate {
+    /** The field of the packet. */
+    rule_field_t field;
+    /** RULE_MATCH or RULE_NO_MATCH. */
+    rule_match_kind_t kind;
+    /** RULE_VALUE_NUMBER, RULE_VALUE_ETHERNET or RULE_VALUE_INET6. */
+    uint8_t value_kind;
+    /** Number in host byte order, 1 for flags and options. */
+    uint32_t number;
+    /** Ethernet address (first 6 bytes) or IPv6 address with the bits past
+     *  the prefix cleared.
+     */
+    uint8_t address[sizeof(struct in6_addr)];
+    /** Prefix mask of an IPv6 address. */
+    uint8_t mask[sizeof(struct in6_addr)];
+};
+
+/** A compiled rule. */
+struct rule_compiled {
+    /** The rule as loaded. */
+    const struct rule_list* rule;
+    /** First of the predicates of the rule in the rule set, the cheapest first. */
+    uint32_t first;
+    /** Number of predicates. */
+    uint32_t count;
+    /** Bit b is set if the rule may match the packets of bucket b. */
+    uint8_t buckets;
+    /** 1 if the rule has an exact ethernet or IPv6 address match, which is
+     *  looked up in the keys of the buckets rather than in the predicates.
+     */
+    int has_key;
+    /** That match. */
+    struct rule_predicate key;
+};
+
+/** An exact address match shared by rules of a bucket. */
+struct rule_key {
+    /** 1 if this slot of the hash table is used. */
+    uint8_t used;
+    rule_field_t field;
+    uint8_t address[sizeof(struct in6_addr)];
+    /** First rule with this key in the keyed array of the bucket. */
+    uint32_t first;
+    /** Number of rules with this key. */
+    uint32_t count;
+};
+
+/** The rules that may match the packets of an ICMPv6 type. */
+struct rule_bucket {
+    /** Fields of the packets the rules need. */
+    uint64_t fields;
+    /** Fields of the keys. */
+    uint64_t key_fields;
+    /** Rules without key, in rule order. */
+    uint32_t* scan;
+    uint32_t scan_count;
+    /** Rules with a key, grouped by key and in rule order for each key. */
+    uint32_t* keyed;
+    /** Hash table of the keys (open addressing), NULL if there are none. */
+    struct rule_key* keys;
+    /** Size of the hash table, a power of two. */
+    uint32_t key_capacity;
+};
+
+/** A rule list compiled by rule_set_compile(). */
+struct rule_set {
+    /** The rules, in the order of the list. */
+    struct rule_compiled* rules;
+    uint32_t count;
+    /** The predicates of all rules. */
+    struct rule_predicate* predicates;
+    struct rule_bucket buckets[RULE_BUCKETS];
+};
+
+/** The fields of a packet, extracted once for all rules. */
+struct rule_fields {
+    /** Bit of a field set if the packet has the field. */
+    uint64_t present;
+    /** Number fields in host byte order, 1 for flags set and options. */
+    uint32_t number[RULE_FIELDS_COUNT];
+    /** Ethernet and IPv6 address fields, within the packet. */
+    const uint8_t* address[RULE_FIELDS_COUNT];
+};
+
 #endif
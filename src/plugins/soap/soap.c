@@ -285,7 +285,7 @@ herror_t soap_listen_alert(SoapCtx *request, SoapCtx *result) {
     char request_probe_name[PROBE_NAME_SIZE];
     char search_probe_name[PROBE_NAME_SIZE];
     int request_priority=0;
-    struct probe* locked_probe;
+    const struct probe* locked_probe;
 
     /* initialize values: */
     memset(&request_ethernet_address1, 0, sizeof(struct ether_addr));
@@ -341,7 +341,7 @@ herror_t soap_listen_alert(SoapCtx *request, SoapCtx *result) {
     snprintf(search_probe_name, PROBE_NAME_SIZE-1, "%s/%s", (char*)method_src, request_probe_name);
     xmlFree(method_src);
     /* critical section: */
-    locked_probe = probe_lock(search_probe_name);
+    locked_probe = probe_rdlock(search_probe_name);
     if (locked_probe==NULL) {
         /* nothing locked. */
         fprintf(stderr, "[soap] WARNING: recieved alert: Referenced probe \"%s\" not found.\n", search_probe_name);
@@ -493,6 +493,7 @@ herror_t soap_listen_neighbor_update(SoapCtx *request, SoapCtx *result) {
              neighbor_update(search_probe_name, NULL, NULL, &request_neighbor);
              break;
      }
+     bindings_invalidate(locked_probe);
      probe_unlock(search_probe_name);
      /* end critical section. */
      return H_OK;
@@ -579,6 +580,7 @@ herror_t soap_listen_probe_updown(SoapCtx *request, SoapCtx *result) {
         locked_probe->routers = request_probe_routers;
         locked_probe->extinfo = request_probe_extinfo;
         probe_load_neighbors(request_probe_element, locked_probe, 1);
+        bindings_invalidate(locked_probe);
         if (DEBUG) {
                 fprintf(stderr, "[soap] Loading request probe information done.\n");
         }
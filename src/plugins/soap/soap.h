@@ -11,6 +11,7 @@
 #include <nanohttp/nanohttp-ssl.h>
 
 #include "../../core/alerts.h"
+#include "../../core/bindings.h"
 #include "../../core/neighbors.h"
 #include "../../core/parser.h"
 #include "../../core/probes.h"
@@ -0,0 +1,504 @@
+#include "syslog_native.h"
+
+/** A formatted record waiting in the queue. */
+struct syslog_native_record {
+    size_t length;
+    char data[SYSLOG_NATIVE_RECORD_SIZE];
+};
+
+static pthread_mutex_t syslog_native_settings_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct syslog_native_settings* syslog_native_settings = NULL;
+
+/* bounded record queue, filled by the event queue thread: */
+static pthread_mutex_t syslog_native_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  syslog_native_queue_cond = PTHREAD_COND_INITIALIZER;
+static struct syslog_native_record* syslog_native_queue = NULL;
+static int syslog_native_queue_head  = 0;
+static int syslog_native_queue_count = 0;
+static unsigned long syslog_native_dropped = 0;
+static int syslog_native_running = 0;
+
+/* sender thread state: */
+static pthread_t syslog_native_thread;
+static int syslog_native_socket = -1;
+/* TCP output not yet written (a record must never be cut): */
+static char* syslog_native_stream = NULL;
+static size_t syslog_native_stream_length = 0;
+static size_t syslog_native_stream_offset = 0;
+
+int syslog_native_active() {
+    int active;
+
+    pthread_mutex_lock(&syslog_native_settings_lock);
+    active = (syslog_native_settings!=NULL);
+    pthread_mutex_unlock(&syslog_native_settings_lock);
+    return active;
+}
+
+/* Copies value as SD-PARAM value, escaping '"', '\' and ']' (RFC 5424 6.3.3). */
+static size_t syslog_native_sd_escape(char* buffer, size_t size, const char* value) {
+    size_t length = 0;
+
+    while (*value!='\0' && length+2<size) {
+        if (*value=='"' || *value=='\\' || *value==']') {
+            buffer[length++] = '\\';
+        }
+        buffer[length++] = *value++;
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+size_t syslog_native_format(const struct syslog_native_settings* settings,
+        const struct alert_info* alert, char* record) {
+    char timestamp[32];
+    char mac1[ETH_ADDRSTRLEN];
+    char mac2[ETH_ADDRSTRLEN];
+    char ipv6[INET6_ADDRSTRLEN];
+    char probe[PROBE_NAME_SIZE*2];
+    char reason[ALERT_REASON_SIZE*2];
+    struct tm tm;
+    int severity = (alert->priority==2) ? LOG_WARNING : LOG_NOTICE;
+    int length;
+
+    gmtime_r(&alert->time, &tm);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    ether_ntoa_r(&alert->ethernet_address1, mac1);
+    ether_ntoa_r(&alert->ethernet_address2, mac2);
+    inet_ntop(AF_INET6, &alert->ipv6_address, ipv6, INET6_ADDRSTRLEN);
+    syslog_native_sd_escape(probe, sizeof(probe), alert->probe_name);
+    syslog_native_sd_escape(reason, sizeof(reason), alert->reason);
+
+    /* <PRI>VERSION TIMESTAMP HOSTNAME APP-NAME PROCID MSGID [SD] MSG */
+    length = snprintf(record, SYSLOG_NATIVE_RECORD_SIZE,
+            "<%i>1 %s %s %s %i alert [" SYSLOG_NATIVE_SD_ID
+            " probe=\"%s\" reason=\"%s\" mac1=\"%s\" mac2=\"%s\" ipv6=\"%s\" priority=\"%i\"] %s",
+            settings->facility | severity, timestamp,
+            settings->hostname, settings->app_name, (int)getpid(),
+            probe, reason, mac1, mac2, ipv6, alert->priority, alert->message);
+    if (length<0) {
+        return 0;
+    }
+    if (length>=SYSLOG_NATIVE_RECORD_SIZE) {
+        length = SYSLOG_NATIVE_RECORD_SIZE-1;
+    }
+    return (size_t)length;
+}
+
+void syslog_native_event_handler(const struct event_info* event) {
+    const struct alert_info* alert;
+    struct syslog_native_record* slot;
+
+    if (event->type!=EVENT_TYPE_ALERT) {
+        return;
+    }
+    alert = &event->data->alert;
+    /* same priority selection as the standard syslog handler: */
+    if ((alert->priority==2 && action_high_pri.syslog!=1)
+            || (alert->priority==1 && action_low_pri.syslog!=1)) {
+        return;
+    }
+    pthread_mutex_lock(&syslog_native_queue_lock);
+    if (syslog_native_queue==NULL) {
+        pthread_mutex_unlock(&syslog_native_queue_lock);
+        return;
+    }
+    if (syslog_native_queue_count>=syslog_native_settings->queue_size) {
+        syslog_native_dropped++;
+        pthread_mutex_unlock(&syslog_native_queue_lock);
+        return;
+    }
+    /* the slot is free and not touched by the sender until it is counted: */
+    slot = &syslog_native_queue[(syslog_native_queue_head+syslog_native_queue_count) % syslog_native_settings->queue_size];
+    pthread_mutex_unlock(&syslog_native_queue_lock);
+
+    slot->length = syslog_native_format(syslog_native_settings, alert, slot->data);
+
+    pthread_mutex_lock(&syslog_native_queue_lock);
+    syslog_native_queue_count++;
+    if (syslog_native_queue_count>=syslog_native_settings->batch) {
+        pthread_cond_signal(&syslog_native_queue_cond);
+    }
+    pthread_mutex_unlock(&syslog_native_queue_lock);
+}
+
+static int syslog_native_connect(const struct syslog_native_settings* settings) {
+    int sock = -1;
+
+    if (settings->transport==SYSLOG_NATIVE_UNIX) {
+        struct sockaddr_un address;
+
+        memset(&address, 0, sizeof(struct sockaddr_un));
+        address.sun_family = AF_UNIX;
+        strlcpy(address.sun_path, settings->host, sizeof(address.sun_path));
+        if ((sock=socket(AF_UNIX, SOCK_DGRAM, 0))==-1) {
+            perror("[syslog_native] socket");
+            return -1;
+        }
+        if (connect(sock, (struct sockaddr*)&address, sizeof(struct sockaddr_un))==-1) {
+            perror("[syslog_native] connect");
+            close(sock);
+            return -1;
+        }
+    } else {
+        struct addrinfo hints;
+        struct addrinfo* result;
+        struct addrinfo* ai;
+        int error;
+
+        memset(&hints, 0, sizeof(struct addrinfo));
+        hints.ai_family   = AF_UNSPEC;
+        hints.ai_socktype = (settings->transport==SYSLOG_NATIVE_TCP) ? SOCK_STREAM : SOCK_DGRAM;
+        if ((error=getaddrinfo(settings->host, settings->port, &hints, &result))!=0) {
+            fprintf(stderr, "[syslog_native] %s: %s\n", settings->host, gai_strerror(error));
+            return -1;
+        }
+        for (ai=result; ai!=NULL; ai=ai->ai_next) {
+            if ((sock=socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol))==-1) {
+                continue;
+            }
+            /* connecting may block, but only the sender thread: */
+            if (connect(sock, ai->ai_addr, ai->ai_addrlen)==0) {
+                break;
+            }
+            close(sock);
+            sock = -1;
+        }
+        freeaddrinfo(result);
+        if (sock==-1) {
+            fprintf(stderr, "[syslog_native] could not connect to %s.\n", settings->target);
+            return -1;
+        }
+    }
+    /* writes must never block: */
+    if (fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK)==-1) {
+        perror("[syslog_native] fcntl");
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/* Moves up to count queued records (starting at first) into the TCP stream
+ * buffer, using octet counting framing. Returns the number of records taken. */
+static int syslog_native_stream_fill(int first, int count) {
+    int i;
+
+    for (i=0; i<count; i++) {
+        const struct syslog_native_record* record = &syslog_native_queue[(first+i) % syslog_native_settings->queue_size];
+        int length = snprintf(syslog_native_stream+syslog_native_stream_length,
+                SYSLOG_NATIVE_BATCH_MAX*(SYSLOG_NATIVE_RECORD_SIZE+8)-syslog_native_stream_length,
+                "%u %.*s", (unsigned int)record->length, (int)record->length, record->data);
+        syslog_native_stream_length += length;
+    }
+    return count;
+}
+
+/* Writes count records starting at first. Returns the number of records that
+ * may be released (sent or dropped on a hard error), -1 to retry later. */
+static int syslog_native_send(int first, int count) {
+    if (syslog_native_settings->transport==SYSLOG_NATIVE_TCP) {
+        ssize_t written;
+        int taken = 0;
+
+        if (syslog_native_stream_offset==syslog_native_stream_length) {
+            syslog_native_stream_length = 0;
+            syslog_native_stream_offset = 0;
+            taken = syslog_native_stream_fill(first, count);
+        }
+        written = send(syslog_native_socket,
+                syslog_native_stream+syslog_native_stream_offset,
+                syslog_native_stream_length-syslog_native_stream_offset,
+                MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (written>0) {
+            syslog_native_stream_offset += written;
+        } else if (written==-1 && errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR) {
+            /* the rest of the stream is lost with the connection: */
+            perror("[syslog_native] send");
+            close(syslog_native_socket);
+            syslog_native_socket = -1;
+            syslog_native_stream_length = 0;
+            syslog_native_stream_offset = 0;
+        } else if (taken==0) {
+            /* collector does not read, nothing moved: */
+            return -1;
+        }
+        return taken;
+    } else {
+#ifdef _LINUX_
+        struct mmsghdr messages[SYSLOG_NATIVE_BATCH_MAX];
+        struct iovec iov[SYSLOG_NATIVE_BATCH_MAX];
+        int i, sent;
+
+        memset(messages, 0, sizeof(messages));
+        for (i=0; i<count; i++) {
+            struct syslog_native_record* record = &syslog_native_queue[(first+i) % syslog_native_settings->queue_size];
+            iov[i].iov_base = record->data;
+            iov[i].iov_len  = record->length;
+            messages[i].msg_hdr.msg_iov    = &iov[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        sent = sendmmsg(syslog_native_socket, messages, count, MSG_DONTWAIT | MSG_NOSIGNAL);
+#else
+        int i, sent = 0;
+
+        for (i=0; i<count; i++) {
+            struct syslog_native_record* record = &syslog_native_queue[(first+i) % syslog_native_settings->queue_size];
+            if (send(syslog_native_socket, record->data, record->length, MSG_DONTWAIT | MSG_NOSIGNAL)==-1) {
+                if (sent==0) {
+                    sent = -1;
+                }
+                break;
+            }
+            sent++;
+        }
+#endif
+        if (sent>=0) {
+            return sent;
+        }
+        if (errno==EAGAIN || errno==EWOULDBLOCK || errno==ENOBUFS || errno==EINTR) {
+            return -1;
+        }
+        /* collector gone or record rejected, drop the batch: */
+        perror("[syslog_native] send");
+        close(syslog_native_socket);
+        syslog_native_socket = -1;
+        return count;
+    }
+}
+
+static void* syslog_native_run(void* unused) {
+    pthread_mutex_lock(&syslog_native_queue_lock);
+    while (1) {
+        int first, count, released;
+        struct timespec deadline;
+
+        if (syslog_native_running && syslog_native_queue_count<syslog_native_settings->batch) {
+            /* wait for a full batch or until the flush interval is over: */
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec  += syslog_native_settings->flush_interval / 1000;
+            deadline.tv_nsec += (long)(syslog_native_settings->flush_interval % 1000) * 1000000L;
+            if (deadline.tv_nsec>=1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&syslog_native_queue_cond, &syslog_native_queue_lock, &deadline);
+        }
+        if (syslog_native_queue_count==0 && syslog_native_stream_offset==syslog_native_stream_length) {
+            if (!syslog_native_running) {
+                break;
+            }
+            continue;
+        }
+        first = syslog_native_queue_head;
+        count = syslog_native_queue_count;
+        if (count>syslog_native_settings->batch) {
+            count = syslog_native_settings->batch;
+        }
+        pthread_mutex_unlock(&syslog_native_queue_lock);
+
+        if (syslog_native_socket==-1) {
+            syslog_native_socket = syslog_native_connect(syslog_native_settings);
+        }
+        released = (syslog_native_socket==-1) ? -1 : syslog_native_send(first, count);
+
+        pthread_mutex_lock(&syslog_native_queue_lock);
+        if (released>0) {
+            syslog_native_queue_head = (syslog_native_queue_head+released) % syslog_native_settings->queue_size;
+            syslog_native_queue_count -= released;
+        } else if (released==-1 && !syslog_native_running) {
+            /* shutting down and the collector does not take anything: */
+            syslog_native_dropped += syslog_native_queue_count;
+            syslog_native_queue_count = 0;
+            syslog_native_stream_offset = syslog_native_stream_length;
+        } else if (released==-1) {
+            /* retry after the next interval instead of spinning: */
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += 1;
+            pthread_cond_timedwait(&syslog_native_queue_cond, &syslog_native_queue_lock, &deadline);
+        }
+    }
+    pthread_mutex_unlock(&syslog_native_queue_lock);
+    return NULL;
+}
+
+void syslog_native_settings_free(void** data) {
+    /* no referenced structures, just free it */
+    pthread_mutex_lock(&syslog_native_settings_lock);
+    if (syslog_native_settings==*data) {
+        syslog_native_settings = NULL;
+    }
+    pthread_mutex_unlock(&syslog_native_settings_lock);
+    free(*data);
+    *data = NULL;
+}
+
+/* Reads a string attribute, keeping the default if it is not present. */
+static void syslog_native_get_str(xmlNodePtr element, const char* name, char* value, size_t size) {
+    xmlChar* property = xmlGetProp(element, BAD_CAST name);
+
+    if (property!=NULL) {
+        strlcpy(value, (char*)property, size);
+        xmlFree(property);
+    }
+}
+
+int syslog_native_settings_load(xmlNodePtr element, void** data) {
+    struct syslog_native_settings* settings;
+    char* scheme_end;
+    char* port;
+
+    if ((settings=malloc(sizeof(struct syslog_native_settings)))==NULL) {
+        perror("[syslog_native] malloc failed.\n");
+        exit(1);
+    }
+    memset(settings, 0, sizeof(struct syslog_native_settings));
+    /* defaults: */
+    strlcpy(settings->target, "unix:/dev/log", SYSLOG_NATIVE_STR_SIZE);
+    if (gethostname(settings->hostname, SYSLOG_NATIVE_STR_SIZE)!=0 || settings->hostname[0]=='\0') {
+        strlcpy(settings->hostname, "-", SYSLOG_NATIVE_STR_SIZE);
+    }
+    strlcpy(settings->app_name, "NDPMon", SYSLOG_NATIVE_STR_SIZE);
+    strlcpy(settings->facility_name, syslog_facility, SYSLOG_FACILITY_SIZE);
+    settings->batch          = 32;
+    settings->queue_size     = 1024;
+    settings->flush_interval = 200;
+
+    syslog_native_get_str(element, "target",   settings->target,        SYSLOG_NATIVE_STR_SIZE);
+    syslog_native_get_str(element, "hostname", settings->hostname,      SYSLOG_NATIVE_STR_SIZE);
+    syslog_native_get_str(element, "app_name", settings->app_name,      SYSLOG_NATIVE_STR_SIZE);
+    syslog_native_get_str(element, "facility", settings->facility_name, SYSLOG_FACILITY_SIZE);
+    if (settings_get_int(element, "batch",          &settings->batch,          1, SYSLOG_NATIVE_BATCH_MAX)==-1
+            || settings_get_int(element, "queue",          &settings->queue_size,     1, 65536)==-1
+            || settings_get_int(element, "flush_interval", &settings->flush_interval, 1, 60000)==-1) {
+        free(settings);
+        return -1;
+    }
+
+    str_to_facility(settings->facility_name, &settings->facility);
+    if (settings->facility==-1) {
+        fprintf(stderr, "[syslog_native] ERROR: settings: unknown facility %s.\n", settings->facility_name);
+        free(settings);
+        return -1;
+    }
+
+    /* target is unix:PATH, udp:HOST:PORT or tcp:HOST:PORT ([HOST] for IPv6 literals): */
+    if ((scheme_end=strchr(settings->target, ':'))==NULL) {
+        fprintf(stderr, "[syslog_native] ERROR: settings: bad target %s.\n", settings->target);
+        free(settings);
+        return -1;
+    }
+    if (strncmp(settings->target, "unix:", 5)==0) {
+        settings->transport = SYSLOG_NATIVE_UNIX;
+        strlcpy(settings->host, scheme_end+1, SYSLOG_NATIVE_STR_SIZE);
+    } else {
+        if (strncmp(settings->target, "udp:", 4)==0) {
+            settings->transport = SYSLOG_NATIVE_UDP;
+        } else if (strncmp(settings->target, "tcp:", 4)==0) {
+            settings->transport = SYSLOG_NATIVE_TCP;
+        } else {
+            fprintf(stderr, "[syslog_native] ERROR: settings: unknown transport in %s.\n", settings->target);
+            free(settings);
+            return -1;
+        }
+        strlcpy(settings->host, scheme_end+1, SYSLOG_NATIVE_STR_SIZE);
+        strlcpy(settings->port, "514", sizeof(settings->port));
+        if (settings->host[0]=='[') {
+            char* bracket = strchr(settings->host, ']');
+            if (bracket==NULL) {
+                fprintf(stderr, "[syslog_native] ERROR: settings: bad target %s.\n", settings->target);
+                free(settings);
+                return -1;
+            }
+            port = (bracket[1]==':') ? bracket+2 : NULL;
+            *bracket = '\0';
+            memmove(settings->host, settings->host+1, strlen(settings->host));
+        } else {
+            port = strrchr(settings->host, ':');
+            if (port!=NULL) {
+                *port++ = '\0';
+            }
+        }
+        if (port!=NULL && *port!='\0') {
+            strlcpy(settings->port, port, sizeof(settings->port));
+        }
+    }
+
+    *data = settings;
+    pthread_mutex_lock(&syslog_native_settings_lock);
+    syslog_native_settings = settings;
+    pthread_mutex_unlock(&syslog_native_settings_lock);
+    return 0;
+}
+
+void syslog_native_settings_print(void* data) {
+    struct syslog_native_settings* settings = (struct syslog_native_settings*) data;
+
+    fprintf(stderr, "[syslog_native] plugin configuration {\n");
+    fprintf(stderr, "    target %s\n", settings->target);
+    fprintf(stderr, "    hostname %s\n", settings->hostname);
+    fprintf(stderr, "    app name %s\n", settings->app_name);
+    fprintf(stderr, "    facility %s\n", settings->facility_name);
+    fprintf(stderr, "    batch %i, queue %i, flush interval %i ms\n",
+            settings->batch, settings->queue_size, settings->flush_interval);
+    fprintf(stderr, "}\n");
+}
+
+int syslog_native_settings_save(xmlNodePtr element, void* data) {
+    struct syslog_native_settings* settings = (struct syslog_native_settings*) data;
+
+    xmlNewProp(element, BAD_CAST "target", BAD_CAST settings->target);
+    xmlNewProp(element, BAD_CAST "hostname", BAD_CAST settings->hostname);
+    xmlNewProp(element, BAD_CAST "app_name", BAD_CAST settings->app_name);
+    xmlNewProp(element, BAD_CAST "facility", BAD_CAST settings->facility_name);
+    settings_set_int(element, "batch", settings->batch);
+    settings_set_int(element, "queue", settings->queue_size);
+    settings_set_int(element, "flush_interval", settings->flush_interval);
+    return 0;
+}
+
+void syslog_native_up() {
+    if (!syslog_native_active()) {
+        return;
+    }
+    if ((syslog_native_queue=calloc(syslog_native_settings->queue_size, sizeof(struct syslog_native_record)))==NULL) {
+        perror("[syslog_native] malloc failed.\n");
+        exit(1);
+    }
+    if (syslog_native_settings->transport==SYSLOG_NATIVE_TCP
+            && (syslog_native_stream=malloc(SYSLOG_NATIVE_BATCH_MAX*(SYSLOG_NATIVE_RECORD_SIZE+8)))==NULL) {
+        perror("[syslog_native] malloc failed.\n");
+        exit(1);
+    }
+    syslog_native_running = 1;
+    if (pthread_create(&syslog_native_thread, NULL, syslog_native_run, NULL)!=0) {
+        perror("[syslog_native] pthread_create failed");
+        exit(1);
+    }
+    fprintf(stderr, "[syslog_native] sending alerts to %s.\n", syslog_native_settings->target);
+}
+
+void syslog_native_down() {
+    if (syslog_native_queue==NULL) {
+        return;
+    }
+    pthread_mutex_lock(&syslog_native_queue_lock);
+    syslog_native_running = 0;
+    pthread_cond_signal(&syslog_native_queue_cond);
+    pthread_mutex_unlock(&syslog_native_queue_lock);
+    pthread_join(syslog_native_thread, NULL);
+
+    if (syslog_native_dropped>0) {
+        fprintf(stderr, "[syslog_native] %lu records dropped.\n", syslog_native_dropped);
+    }
+    if (syslog_native_socket!=-1) {
+        close(syslog_native_socket);
+        syslog_native_socket = -1;
+    }
+    pthread_mutex_lock(&syslog_native_queue_lock);
+    free(syslog_native_queue);
+    syslog_native_queue = NULL;
+    pthread_mutex_unlock(&syslog_native_queue_lock);
+    free(syslog_native_stream);
+    syslog_native_stream = NULL;
+}
@@ -0,0 +1,141 @@
+#ifndef _SYSLOG_NATIVE_H_
+#define _SYSLOG_NATIVE_H_
+
+#ifdef _LINUX_
+/* sendmmsg() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <syslog.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netdb.h>
+
+#include <libxml/tree.h>
+
+#include "../../membounds.h"
+#include "ndpmon_defs.h"
+
+#include "../../core/events.h"
+#include "../../core/extinfo.h"
+#include "../../core/settings.h"
+
+/** @file
+ *  Native syslog plugin: sends alerts as RFC 5424 records with structured
+ *  data to a local unix socket or to a UDP/TCP collector.
+ *
+ *  Records are formatted on the event queue thread and put into a bounded
+ *  queue. A sender thread writes them in batches over a non-blocking
+ *  socket (one sendmmsg() per batch for datagram targets, octet counted
+ *  framing as in RFC 6587 for TCP). If the queue is full, new records
+ *  are dropped and counted.
+ *
+ *  Configured by a syslog_native element in the settings, for instance
+ *  \verbatim <syslog_native target="udp:[2001:db8::514]:514" batch="32"/> \endverbatim
+ */
+
+/** Maximum length of the target, hostname and app name settings. */
+#define SYSLOG_NATIVE_STR_SIZE 256
+/** Maximum size of a formatted record. */
+#define SYSLOG_NATIVE_RECORD_SIZE 2048
+/** Maximum number of records sent at once. */
+#define SYSLOG_NATIVE_BATCH_MAX 64
+/** The structured data ID (enterprise number reserved for documentation, RFC 5612). */
+#define SYSLOG_NATIVE_SD_ID "ndpmon@32473"
+
+/** Transport used to reach the collector. */
+enum syslog_native_transport {
+    SYSLOG_NATIVE_UNIX,
+    SYSLOG_NATIVE_UDP,
+    SYSLOG_NATIVE_TCP
+};
+
+/** Settings for the native syslog plugin. */
+struct syslog_native_settings {
+    /** The target as given in the configuration. */
+    char target[SYSLOG_NATIVE_STR_SIZE];
+    /** The transport parsed from the target. */
+    enum syslog_native_transport transport;
+    /** Socket path (unix) or host name (udp/tcp). */
+    char host[SYSLOG_NATIVE_STR_SIZE];
+    /** Port (udp/tcp). */
+    char port[16];
+    /** HOSTNAME field of the records. */
+    char hostname[SYSLOG_NATIVE_STR_SIZE];
+    /** APP-NAME field of the records. */
+    char app_name[SYSLOG_NATIVE_STR_SIZE];
+    /** Syslog facility name. */
+    char facility_name[SYSLOG_FACILITY_SIZE];
+    /** Syslog facility. */
+    int facility;
+    /** Maximum number of records per write. */
+    int batch;
+    /** Maximum number of queued records. */
+    int queue_size;
+    /** Milliseconds to wait for a batch to fill up. */
+    int flush_interval;
+};
+
+/** Checks if the plugin is configured, in that case the standard syslog
+ *  handler leaves alerts to this plugin.
+ *  @return 1 if configured, 0 otherwise.
+ */
+int syslog_native_active();
+
+/** Queues an alert for the collector. The records are sent for the
+ *  priorities that have syslog enabled in the actions settings.
+ *  @param event The event, only alerts are handled.
+ */
+void syslog_native_event_handler(const struct event_info* event);
+
+/** Formats an alert as RFC 5424 record.
+ *  @param settings The plugin settings.
+ *  @param alert    The alert.
+ *  @param record   Buffer of SYSLOG_NATIVE_RECORD_SIZE.
+ *  @return         The length of the record.
+ */
+size_t syslog_native_format(const struct syslog_native_settings* settings,
+        const struct alert_info* alert, char* record);
+
+/** Frees the plugin settings.
+ *  @param data The settings (call by reference).
+ */
+void syslog_native_settings_free(void** data);
+
+/** Loads the plugin settings from an XML element.
+ *  @param element The syslog_native element.
+ *  @param data    Will hold the settings (call by reference).
+ *  @return        0 on success, -1 on error.
+ */
+int syslog_native_settings_load(xmlNodePtr element, void** data);
+
+/** Prints the plugin settings.
+ *  @param data The settings.
+ */
+void syslog_native_settings_print(void* data);
+
+/** Saves the plugin settings to an XML element.
+ *  @param element The element to add the attributes to.
+ *  @param data    The settings.
+ *  @return        Always 0.
+ */
+int syslog_native_settings_save(xmlNodePtr element, void* data);
+
+/** Starts the sender thread (if the plugin is configured). */
+void syslog_native_up();
+
+/** Sends the remaining records and stops the sender thread. */
+void syslog_native_down();
+
+#endif
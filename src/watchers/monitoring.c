@@ -167,16 +167,13 @@ int watch_prepare_icmp6(struct capture_info* const capture_info)
 
 	capture_info->icmp6_type = capture_info->icmp6_header->icmp6_type;
 
-	if(DEBUG)
-	{
-		fprintf(stderr,"ND type: %d\n", capture_info->icmp6_header->icmp6_type);
-	}
+	LOGGING(LOGGING_WATCH, LOGGING_LEVEL_TRACE, "ND type: %d\n", capture_info->icmp6_header->icmp6_type);
 
 	switch (capture_info->icmp6_header->icmp6_type)
 	{
 		case ND_ROUTER_SOLICIT:
 			watchers_flags_set(watch_flags, WATCH_FLAG_IS_NDP);
-			fprintf(stderr,"----- ND_ROUTER_SOLICIT -----\n");
+			LOGGING(LOGGING_WATCH, LOGGING_LEVEL_TRACE, "----- ND_ROUTER_SOLICIT -----\n");
 			if(DEBUG)
 			{
 				rsptr = (struct nd_router_solicit*) capture_info->icmp6_header;
@@ -186,7 +183,7 @@ int watch_prepare_icmp6(struct capture_info* const capture_info)
 
 		case ND_ROUTER_ADVERT:
 			watchers_flags_set(watch_flags, WATCH_FLAG_IS_NDP);
-			fprintf(stderr,"----- ND_ROUTER_ADVERT -----\n");
+			LOGGING(LOGGING_WATCH, LOGGING_LEVEL_TRACE, "----- ND_ROUTER_ADVERT -----\n");
 			raptr = (struct nd_router_advert*) capture_info->icmp6_header;
 			if (DEBUG)
 			{
@@ -196,7 +193,7 @@ int watch_prepare_icmp6(struct capture_info* const capture_info)
 
 		case ND_NEIGHBOR_SOLICIT:
 			watchers_flags_set(watch_flags, WATCH_FLAG_IS_NDP);
-			fprintf(stderr,"----- ND_NEIGHBOR_SOLICIT -----\n");
+			LOGGING(LOGGING_WATCH, LOGGING_LEVEL_TRACE, "----- ND_NEIGHBOR_SOLICIT -----\n");
 			nsptr = (struct  nd_neighbor_solicit*)  capture_info->icmp6_header;
 			if (DEBUG)
 			{
@@ -206,7 +203,7 @@ int watch_prepare_icmp6(struct capture_info* const capture_info)
 
 		case ND_NEIGHBOR_ADVERT:
 			watchers_flags_set(watch_flags, WATCH_FLAG_IS_NDP);
-			fprintf(stderr,"----- ND_NEIGHBOR_ADVERT -----\n");
+			LOGGING(LOGGING_WATCH, LOGGING_LEVEL_TRACE, "----- ND_NEIGHBOR_ADVERT -----\n");
 			naptr = (struct nd_neighbor_advert*) capture_info->icmp6_header;
 			if (DEBUG)
 			{
@@ -216,9 +213,12 @@ int watch_prepare_icmp6(struct capture_info* const capture_info)
 
 		case ND_REDIRECT:
 			watchers_flags_set(watch_flags, WATCH_FLAG_IS_NDP);
-			fprintf(stderr,"----- ND_REDIRECT -----\n");
+			LOGGING(LOGGING_WATCH, LOGGING_LEVEL_TRACE, "----- ND_REDIRECT -----\n");
 			rdptr = (struct nd_redirect*)  capture_info->icmp6_header;
-			print_rd(*rdptr);
+			if (DEBUG)
+			{
+				print_rd(*rdptr);
+			}
 			break;
 
 #ifdef _COUNTERMEASURES_
@@ -226,28 +226,28 @@ int watch_prepare_icmp6(struct capture_info* const capture_info)
 			if (((struct nd_ndpmon_present*)capture_info->icmp6_header)->nd_np_code==ND_NP_CODE)
 			{
 				watchers_flags_set(watch_flags, WATCH_FLAG_IS_NDP);
-				fprintf(stderr,"----- ND_NDPMON_PRESENT -----\n");
+				LOGGING(LOGGING_WATCH, LOGGING_LEVEL_TRACE, "----- ND_NDPMON_PRESENT -----\n");
 			}
 			break;
 #endif
 
 		case 128:
 			watchers_flags_unset(watch_flags, WATCH_FLAG_CONTINUE_CHECKING);
-			printf ("Echo request: %d\n", capture_info->icmp6_header->icmp6_type);
+			LOGGING(LOGGING_WATCH, LOGGING_LEVEL_TRACE, "Echo request: %d\n", capture_info->icmp6_header->icmp6_type);
 			break;
 		case 129:
 			watchers_flags_unset(watch_flags, WATCH_FLAG_CONTINUE_CHECKING);
-			printf ("Echo reply: %d\n", capture_info->icmp6_header->icmp6_type);
+			LOGGING(LOGGING_WATCH, LOGGING_LEVEL_TRACE, "Echo reply: %d\n", capture_info->icmp6_header->icmp6_type);
 			break;
 
 		case 1:
 			watchers_flags_unset(watch_flags, WATCH_FLAG_CONTINUE_CHECKING);
-			printf ("Address Unreachable: %d\n", capture_info->icmp6_header->icmp6_type);
+			LOGGING(LOGGING_WATCH, LOGGING_LEVEL_TRACE, "Address Unreachable: %d\n", capture_info->icmp6_header->icmp6_type);
 			break;
 
 		default:
 			watchers_flags_unset(watch_flags, WATCH_FLAG_CONTINUE_CHECKING);
-			printf ("Unknown ICMPv6 type: %d\n", capture_info->icmp6_header->icmp6_type);
+			LOGGING(LOGGING_WATCH, LOGGING_LEVEL_TRACE, "Unknown ICMPv6 type: %d\n", capture_info->icmp6_header->icmp6_type);
 	}
 
 	return 0;
@@ -440,11 +440,11 @@ int watch_bogon(struct capture_info* const capture_info)
 	const struct in6_addr* ip_addr = &(capture_info->ip6_header->ip6_src);
 	char str_ip[INET6_ADDRSTRLEN];
 	router_list_t *tmp;
-	struct probe* locked_probe;
+	const struct probe* locked_probe;
 	int find = 0;
 
 	/* critical section: */
-	locked_probe = probe_lock(capture_info->probe->name);
+	locked_probe = probe_handle_rdlock(capture_info->probe);
 	tmp = locked_probe->routers;
 	inet_ntop(AF_INET6, ip_addr, str_ip, INET6_ADDRSTRLEN);
 
@@ -460,7 +460,7 @@ int watch_bogon(struct capture_info* const capture_info)
 		}
 		tmp = tmp->next;
 	}
-	probe_unlock(capture_info->probe->name);
+	probe_handle_unlock(capture_info->probe);
 	/* end critical section. */
 
 	if (!find && !IN6_IS_ADDR_UNSPECIFIED(ip_addr)&&!IN6_IS_ADDR_LINKLOCAL(ip_addr)&&!IN6_IS_ADDR_MULTICAST(ip_addr)&&!IN6_IS_ADDR_SITELOCAL(ip_addr))
@@ -497,6 +497,39 @@ int watch_hop_limit(struct capture_info* const capture_info)
 	return 0;
 }
 
+/* An alert of new_station(), raised once the probe is unlocked. */
+struct new_station_alert
+{
+	int priority;
+	char* reason;
+	char message[NOTIFY_BUFFER_SIZE];
+	struct ether_addr ethernet_address2;
+	int has_ethernet_address2;
+};
+
+/* Most alerts new_station() raises for a packet: */
+#define NEW_STATION_ALERTS_MAX 2
+
+static void new_station_alert_add(struct new_station_alert* alerts, int* alert_count, int priority,
+		char* reason, const char* message, const struct ether_addr* ethernet_address2)
+{
+	struct new_station_alert* alert;
+
+	if (*alert_count>=NEW_STATION_ALERTS_MAX)
+	{
+		return;
+	}
+	alert = &alerts[(*alert_count)++];
+	alert->priority = priority;
+	alert->reason   = reason;
+	strlcpy(alert->message, message, NOTIFY_BUFFER_SIZE);
+	alert->has_ethernet_address2 = (ethernet_address2!=NULL);
+	if (ethernet_address2!=NULL)
+	{
+		memcpy(&alert->ethernet_address2, ethernet_address2, sizeof(struct ether_addr));
+	}
+}
+
 int new_station(struct capture_info* const capture_info)
 {
 	neighbor_list_t** list;
@@ -509,6 +542,10 @@ int new_station(struct capture_info* const capture_info)
 	const struct ether_addr* ethernet_source = (struct ether_addr*) (capture_info->ethernet_header->ether_shost);
 	const struct in6_addr*   ipv6_source     = &(capture_info->ip6_header->ip6_src);
 	struct probe* locked_probe;
+	/* alerts are raised once the probe is unlocked: */
+	struct new_station_alert alerts[NEW_STATION_ALERTS_MAX];
+	int alert_count = 0;
+	int i;
 
 	/* first of all, check if it is IP multicast */
 	if (IN6_IS_ADDR_MULTICAST(ipv6_source))
@@ -516,13 +553,11 @@ int new_station(struct capture_info* const capture_info)
 		/* do not treat, it is malformed and alert is already raised */
 		return ret;
 	}
+	inet_ntop(AF_INET6, ipv6_source, str_ip, INET6_ADDRSTRLEN);
 
-	/* this whole function is a CRITICAL SECTION due to its poor coding style.
-	 * maybe it's a good idea to rewrite it sometime and use the locks more
-	 * optimized. but now I will not focus on this.
-	 * +thom
-	 */
-	locked_probe = probe_lock(capture_info->probe->name);
+	/* critical section, only the lookups and the changes of the neighbor
+	 * cache (the alerts are built in buffers and raised afterwards): */
+	locked_probe = probe_handle_lock(capture_info->probe);
 	/* retrieve neighbor list: */
 	list = &locked_probe->neighbors;
 
@@ -530,31 +565,9 @@ int new_station(struct capture_info* const capture_info)
 	found_mac = is_neighbor_by_mac(*list, ethernet_source);
 	found_lla = is_neighbor_by_lla(*list, ipv6_source);
 	found_ip  = is_neighbor_by_ip(*list,  ipv6_source);
-	inet_ntop(AF_INET6, ipv6_source, str_ip, INET6_ADDRSTRLEN);
-
-	if(DEBUG)
-	{
-		fprintf(stderr,"[monitoring] new_station?: found_mac: %d found_lla: %d found_ip: %d\n", found_mac, found_lla, found_ip);
-	}
-
-	if( !found_mac )
-	{
-		/* new ethernet address discovered: */
-#ifdef _MACRESOLUTION_
-		/* Verify that the MAC address is from a known vendor */
-		char vendor[MANUFACTURER_NAME_SIZE];
-		strlcpy(vendor, get_manufacturer(manuf, ethernet_source), MANUFACTURER_NAME_SIZE);
 
-		if( !strncmp(vendor, "unknown", MANUFACTURER_NAME_SIZE) )
-		{
-			/* the MAC address is not from a known vendor, may be a forged address */
-			snprintf (buffer, NOTIFY_BUFFER_SIZE, "unknown mac vendor %s %s", ether_ntoa(ethernet_source),str_ip);
-			alert_raise(1, capture_info->probe, "unknown mac vendor", buffer, ethernet_source, NULL, ipv6_source, NULL);
-			ret = 1;
-		}
-#endif
-		watchers_flags_set(&capture_info->watch_flags,WATCH_FLAG_NEW_ETHERNET_ADDRESS);
-	}
+	LOGGING(LOGGING_WATCH, LOGGING_LEVEL_TRACE,
+			"[monitoring] new_station?: found_mac: %d found_lla: %d found_ip: %d\n", found_mac, found_lla, found_ip);
 
 	if( (found_mac == 0) && (found_lla == 0) && (found_ip == 0) )
 	{
@@ -568,7 +581,7 @@ int new_station(struct capture_info* const capture_info)
 
 		snprintf(buffer, NOTIFY_BUFFER_SIZE, "new station %s %s", ether_ntoa(ethernet_source),str_ip);
 		neighbor_update(capture_info->probe->name, NULL, NULL, get_neighbor_by_mac(*list, ethernet_source));
-		alert_raise(1, capture_info->probe, "new station", buffer, ethernet_source,NULL, ipv6_source, NULL);
+		new_station_alert_add(alerts, &alert_count, 1, "new station", buffer, NULL);
 		ret = 1;
 	}
 
@@ -580,7 +593,7 @@ int new_station(struct capture_info* const capture_info)
 		reset_neighbor_timer(*list, ethernet_source, capture_info->probe);
 		snprintf (buffer, NOTIFY_BUFFER_SIZE, "new lla %s %s\n", ether_ntoa(ethernet_source),str_ip);
 		neighbor_update(capture_info->probe->name, ethernet_source, NULL, get_neighbor_by_mac(*list, ethernet_source));
-		alert_raise(1, capture_info->probe, "new lla", buffer, ethernet_source, NULL, ipv6_source, NULL);
+		new_station_alert_add(alerts, &alert_count, 1, "new lla", buffer, NULL);
 		ret = 1;
 	}
 
@@ -593,7 +606,7 @@ int new_station(struct capture_info* const capture_info)
 		reset_neighbor_timer(*list, ethernet_source, capture_info->probe);
 		snprintf (buffer, NOTIFY_BUFFER_SIZE, "new IP %s %s\n", ether_ntoa(ethernet_source),str_ip);
 		neighbor_update(capture_info->probe->name, ethernet_source, NULL, get_neighbor_by_mac(*list, ethernet_source));
-		alert_raise(1, capture_info->probe, "new IP", buffer, ethernet_source, NULL, ipv6_source, NULL);
+		new_station_alert_add(alerts, &alert_count, 1, "new IP", buffer, NULL);
 		ret = 1;
 	}
 
@@ -633,7 +646,7 @@ int new_station(struct capture_info* const capture_info)
 					snprintf (buffer, NOTIFY_BUFFER_SIZE, "changed ethernet address %s to %s %s", temp, ether_ntoa(ethernet_source),str_ip);
 					if(DEBUG)
 						fprintf (stderr, "changed ethernet address %s to %s %s\n", temp, ether_ntoa(ethernet_source),str_ip);
-					alert_raise(1, capture_info->probe, "changed ethernet address", buffer, ethernet_source, &(old_mac), ipv6_source, NULL);
+					new_station_alert_add(alerts, &alert_count, 1, "changed ethernet address", buffer, &(old_mac));
 
 					ret = 2;
 				}
@@ -656,22 +669,15 @@ int new_station(struct capture_info* const capture_info)
 					snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong couple MAC/LLA in icmp6 %s %s", eth_str, str_ip);
 					if(DEBUG)
 						fprintf (stderr, "wrong couple MAC/LLA in icmp6 %s %s\n", eth_str, str_ip);
-					alert_raise(2, capture_info->probe, "wrong couple MAC/LLA", buffer, ethernet_source, NULL, ipv6_source, NULL);
+					new_station_alert_add(alerts, &alert_count, 2, "wrong couple MAC/LLA", buffer, NULL);
 				}
 		}
 
 		if(clean_addresses)
 		{
-			/* reset timer for host */
-			reset_neighbor_timer(*list, ethernet_source, capture_info->probe);
-			fprintf (stderr, "Reset timer for %s %s\n", ether_ntoa(ethernet_source),str_ip);
-
-			/* if the IP exists, reset timer */
-			if( found_ip == 1 )
-			{
-				reset_neighbor_address_timer(*list, ethernet_source, ipv6_source);
-				fprintf (stderr, "Reset address timer for %s %s\n", ether_ntoa(ethernet_source),str_ip);
-			}
+			/* the timers of the host and of the IP if it exists are reset by the next merge: */
+			lastseen_mark(capture_info->probe, get_neighbor_by_mac(*list, ethernet_source), (found_ip == 1) ? ipv6_source : NULL);
+			LOGGING(LOGGING_CACHE, LOGGING_LEVEL_DEBUG, "Marked %s %s as seen\n", ether_ntoa(ethernet_source), str_ip);
 			neighbor_update(capture_info->probe->name, ethernet_source, NULL, get_neighbor_by_mac(*list, ethernet_source));
 		}
 #if 0
@@ -690,7 +696,7 @@ int new_station(struct capture_info* const capture_info)
 			snprintf (buffer, NOTIFY_BUFFER_SIZE, "spoofed addresses in icmp6 %s %s", eth_str, str_ip);
 			if(DEBUG)
 				fprintf (stderr, "spoofed addresses in icmp6 %s %s", eth_str, str_ip);
-			alert_raise(2, capture_info->probe, "spoofed addresses", buffer, ethernet_source, NULL, ipv6_source, NULL);
+			new_station_alert_add(alerts, &alert_count, 2, "spoofed addresses", buffer, NULL);
 
 		}
 #endif
@@ -725,14 +731,14 @@ int new_station(struct capture_info* const capture_info)
 				snprintf (buffer, NOTIFY_BUFFER_SIZE, "flip flop between %s and %s for %s", temp, ether_ntoa(ethernet_source), str_ip);
 				if(DEBUG)
 					fprintf (stderr, "flip flop between %s and %s for %s\n", temp, ether_ntoa(ethernet_source), str_ip);
-				alert_raise(2, capture_info->probe, "flip flop", buffer, ethernet_source, &old_mac, ipv6_source, NULL);
+				new_station_alert_add(alerts, &alert_count, 2, "flip flop", buffer, &old_mac);
 			}
 			else
 			{
 				sprintf (buffer, "reused old ethernet address %s instead of %s for %s", ether_ntoa(ethernet_source), temp, str_ip);
 				if(DEBUG)
 					fprintf (stderr, "reused old ethernet address %s instead of %s for %s\n", ether_ntoa(ethernet_source), temp, str_ip);
-				alert_raise(2, capture_info->probe, "reused old ethernet address", buffer, ethernet_source, &old_mac, ipv6_source, NULL);
+				new_station_alert_add(alerts, &alert_count, 2, "reused old ethernet address", buffer, &old_mac);
 			}
 			neighbor_update_mac(*list, &lla, ethernet_source);
 			neighbor_update(capture_info->probe->name, NULL, &lla, get_neighbor_by_lla(*list, &lla));
@@ -765,17 +771,45 @@ int new_station(struct capture_info* const capture_info)
 			snprintf (buffer, NOTIFY_BUFFER_SIZE, "changed ethernet address %s to %s %s", temp, ether_ntoa(ethernet_source),str_ip);
 			if(DEBUG)
 				fprintf (stderr, "changed ethernet address %s to %s %s\n", temp, ether_ntoa(ethernet_source),str_ip);
-			alert_raise(2, capture_info->probe, "changed ethernet address", buffer, ethernet_source, &(old_mac), ipv6_source, NULL);
+			new_station_alert_add(alerts, &alert_count, 2, "changed ethernet address", buffer, &(old_mac));
 			
 			ret = 2;
 		}
 	}
 
-	/* luckily you did the return in such a way that it does not leave
-	 * a zombie lock when I only put the unlock stuff here... at least I hope...
-	 * +thom
-	 */
-	probe_unlock(capture_info->probe->name);
-	/* end of critical function ;) */
+	/* every branch returning non zero changed the neighbor cache: */
+	if (ret!=0)
+	{
+		bindings_invalidate(locked_probe);
+	}
+	probe_handle_unlock(capture_info->probe);
+	/* end of critical section. */
+
+	if( !found_mac )
+	{
+		/* new ethernet address discovered: */
+#ifdef _MACRESOLUTION_
+		/* Verify that the MAC address is from a known vendor */
+		char vendor[MANUFACTURER_NAME_SIZE];
+		strlcpy(vendor, get_manufacturer(manuf, ethernet_source), MANUFACTURER_NAME_SIZE);
+
+		if( !strncmp(vendor, "unknown", MANUFACTURER_NAME_SIZE) )
+		{
+			/* the MAC address is not from a known vendor, may be a forged address */
+			snprintf (buffer, NOTIFY_BUFFER_SIZE, "unknown mac vendor %s %s", ether_ntoa(ethernet_source),str_ip);
+			alert_raise(1, capture_info->probe, "unknown mac vendor", buffer, ethernet_source, NULL, ipv6_source, NULL);
+			if (ret==0)
+			{
+				ret = 1;
+			}
+		}
+#endif
+		watchers_flags_set(&capture_info->watch_flags,WATCH_FLAG_NEW_ETHERNET_ADDRESS);
+	}
+	for (i=0; i<alert_count; i++)
+	{
+		alert_raise(alerts[i].priority, capture_info->probe, alerts[i].reason, alerts[i].message, ethernet_source,
+				alerts[i].has_ethernet_address2 ? &alerts[i].ethernet_address2 : NULL, ipv6_source, NULL);
+	}
 	return ret;
 }
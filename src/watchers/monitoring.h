@@ -64,7 +64,10 @@ Olivier Festor, Scientific Leader of the MADYNEs Project, 20 August 2006
 #include "ndpmon_defs.h"
 
 #include "../core/alerts.h"
+#include "../core/bindings.h"
 #include "../core/capture.h"
+#include "../core/lastseen.h"
+#include "../core/logging.h"
 #include "../core/print_packet_info.h"
 #include "../core/watchers.h"
 
@@ -39,14 +39,13 @@ Olivier Festor, Scientific Leader of the MADYNEs Project, 20 August 2006
 int watch_R_flag(struct capture_info* const capture_info) 
 {
 	struct nd_neighbor_advert* neighbor_advert = (struct nd_neighbor_advert*) capture_info->icmp6_header;
-	struct probe* locked_probe;
+	const struct probe* locked_probe;
 
 	/*Mask is used to select the R_FLAG from the NA*/
 	int R_FLAG = (neighbor_advert->nd_na_flags_reserved)&ND_NA_FLAG_ROUTER;
 	int ret = 0;
 
-	if(DEBUG)
-		fprintf(stderr, "NA flag router: %d\n", R_FLAG);
+	LOGGING(LOGGING_WATCH, LOGGING_LEVEL_TRACE, "NA flag router: %d\n", R_FLAG);
 
 	if (R_FLAG)
 	{
@@ -58,11 +57,11 @@ int watch_R_flag(struct capture_info* const capture_info)
 		int found_lla;
 
 		/* critical section: */
-		locked_probe = probe_lock(capture_info->probe->name);
+		locked_probe = probe_handle_rdlock(capture_info->probe);
 		found_mac = is_router_mac_in(locked_probe->routers, *src_eth);
 		found_lla = is_router_lla_in(locked_probe->routers, capture_info->ip6_header->ip6_src);
 		locked_probe = NULL;
-		probe_unlock(capture_info->probe->name);
+		probe_handle_unlock(capture_info->probe);
 		/* end critical section. */
 
 		mac_address= (char*)ether_ntoa((struct ether_addr*) (capture_info->ethernet_header->ether_shost));
@@ -85,12 +84,12 @@ int watch_R_flag(struct capture_info* const capture_info)
 			{
 				int found_ip = 0;
 				/* critical section: */
-				locked_probe = probe_lock(capture_info->probe->name);
+				locked_probe = probe_handle_rdlock(capture_info->probe);
 				if (router_has_address(locked_probe->routers, *src_eth, capture_info->ip6_header->ip6_src)) {
 					found_ip = 1;
 				}
 				locked_probe = NULL;
-				probe_unlock(capture_info->probe->name);
+				probe_handle_unlock(capture_info->probe);
 				/* end of critical section. */
 
 				if( !found_ip)
@@ -118,21 +117,17 @@ int watch_R_flag(struct capture_info* const capture_info)
   */
 int watch_dad_dos(struct capture_info* const capture_info) 
 {
-	const struct in6_addr* wanted_addr=NULL;
 	struct nd_neighbor_advert* neighbor_advert = (struct nd_neighbor_advert*) capture_info->icmp6_header;
 	int new_eth = watchers_flags_isset(capture_info->watch_flags, WATCH_FLAG_NEW_ETHERNET_ADDRESS);
-	struct probe* locked_probe;
+	const struct probe* locked_probe;
 
 	const struct ether_addr* ethernet_source = (struct ether_addr*) (capture_info->ethernet_header->ether_shost);
-	neighbor_list_t** list;
 	int found_mac;
 
 	/* critical section: */
-	locked_probe = probe_lock(capture_info->probe->name);
-	wanted_addr = extinfo_list_get_data(locked_probe->extinfo, "last_dad_address");
-	list = &locked_probe->neighbors;
-	found_mac = is_neighbor_by_mac(*list, ethernet_source);
-	probe_unlock(capture_info->probe->name);
+	locked_probe = probe_handle_rdlock(capture_info->probe);
+	found_mac = is_neighbor_by_mac(locked_probe->neighbors, ethernet_source);
+	probe_handle_unlock(capture_info->probe);
 	/* end of critical section. */
 
 	if( !found_mac )
@@ -141,9 +136,9 @@ int watch_dad_dos(struct capture_info* const capture_info)
 		new_eth = 1;
 	}
 
-	if(wanted_addr!=NULL && IN6_ARE_ADDR_EQUAL(&neighbor_advert->nd_na_target, wanted_addr))
+	if(dad_in_progress(capture_info->probe, &neighbor_advert->nd_na_target, capture_info->timestamp))
 	{
-		/* NA against the last NS for DAD :-/ */
+		/* NA against a NS for DAD :-/ */
 		/* Is this response true ? */
 		int find_mac = 0;
 		int dos = 0;
@@ -162,7 +157,7 @@ int watch_dad_dos(struct capture_info* const capture_info)
 
 			/*Is the mac addr in the neighbor list ?*/
 			/* critical section: */
-			locked_probe = probe_lock(capture_info->probe->name);
+			locked_probe = probe_handle_rdlock(capture_info->probe);
 			neighbor = get_neighbor_by_mac(locked_probe->neighbors, src_eth);
 			if (neighbor!=NULL) 
 			{
@@ -177,7 +172,7 @@ int watch_dad_dos(struct capture_info* const capture_info)
 			}
 			/* don't touch it further: */
 			neighbor = NULL;
-			probe_unlock(capture_info->probe->name);
+			probe_handle_unlock(capture_info->probe);
 			/* end of critical section. */
 
 			if(find_mac == 1) 
@@ -200,7 +195,7 @@ int watch_dad_dos(struct capture_info* const capture_info)
 		{
 			char ip_address[40];
 
-			fprintf(stderr,"[monitoring_na] New Ethernet DAD DoS\n");
+			LOGGING(LOGGING_WATCH, LOGGING_LEVEL_INFO, "[monitoring_na] New Ethernet DAD DoS\n");
 			ipv6_ntoa(ip_address, capture_info->ip6_header->ip6_src);
 			snprintf (capture_info->message, NOTIFY_BUFFER_SIZE, "dad dos %s %s", (char*)ether_ntoa((struct ether_addr*) (capture_info->ethernet_header->ether_shost)), ip_address);
 			alert_raise(
@@ -256,9 +251,8 @@ int watch_na_target(struct capture_info* const capture_info)
 	 * */
 	if( IN6_IS_ADDR_MULTICAST(target_address) )
 	{
-		fprintf(stderr,"[monitoring_na] NA multicast target\n");
-		if(DEBUG)
-			fprintf(stderr, "NA multicast target %s %s %s\n", ether_source_str, ipv6_source_str, target_address_str);
+		LOGGING(LOGGING_WATCH, LOGGING_LEVEL_INFO, "[monitoring_na] NA multicast target %s %s %s\n",
+				ether_source_str, ipv6_source_str, target_address_str);
 		snprintf (buffer, NOTIFY_BUFFER_SIZE, "NA multicast target %s %s %s", ether_source_str,ipv6_source_str, target_address_str);
 		alert_raise(2, capture_info->probe, "NA multicast target", buffer, ether_source, NULL, ipv6_source, NULL);
 
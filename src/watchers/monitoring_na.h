@@ -39,6 +39,8 @@ Olivier Festor, Scientific Leader of the MADYNEs Project, 20 August 2006
 #include "../ndpmon_netheaders.h"
 
 #include "../core/alerts.h"
+#include "../core/dad.h"
+#include "../core/logging.h"
 #include "../core/routers.h"
 #include "../core/watchers.h"
 
@@ -38,16 +38,13 @@ Olivier Festor, Scientific Leader of the MADYNEs Project, 20 August 2006
 #include "ndpmon_defs.h"
 #include "../ndpmon_netheaders.h"
 
-#include "../core/extinfo.h"
+#include "../core/dad.h"
+#include "../core/logging.h"
 #include "../core/probes.h"
 #include "../core/watchers.h"
 
-void last_dad_address_free(void** data);
-
 /*Note which addr is wanted by a dad message
   */
 int watch_dad(struct capture_info* const capture_info);
 
-struct in6_addr* get_last_dad_addr();
-
 #endif
@@ -33,238 +33,299 @@ Olivier Festor, Scientific Leader of the MADYNEs Project, 20 August 2006
 #include "monitoring_ra.h"
 #include "monitoring.h"
 
-int watch_ra(struct capture_info* const capture_info) 
+/* Orders two options of the canonical form, by length then content. */
+static int ra_option_compare(const struct nd_opt_hdr* option1, const struct nd_opt_hdr* option2)
 {
-	int ret = 0;
-	struct ether_addr *src_eth;
-	char  eth[ETH_ADDRSTRLEN], ip_address[IP6_STR_SIZE];
-	char * buffer                            = capture_info->message;
-	const struct nd_option_list* option_list = capture_info->option_list;
-	router_list_t** routers;
-	router_list_t* router;
-	struct probe* locked_probe;
+	if (option1->nd_opt_len != option2->nd_opt_len)
+	{
+		return (option1->nd_opt_len < option2->nd_opt_len) ? -1 : 1;
+	}
+	return memcmp(option1, option2, option1->nd_opt_len*8);
+}
 
-	src_eth = (struct ether_addr *) capture_info->ethernet_header->ether_shost;
-	ipv6_ntoa(ip_address, capture_info->ip6_header->ip6_src);
-	strlcpy(eth,ether_ntoa(src_eth), ETH_ADDRSTRLEN);
+/* Builds the canonical form of a RA: its parameters followed by its options
+ * in a fixed order, so that a router repeating a RA with its options reordered
+ * still gives the same form. Computes the FNV-1a fingerprint of the form.
+ * Returns -1 if the RA is malformed or too large to be kept.
+ */
+static int ra_fingerprint(const struct capture_info* capture_info, uint8_t* canonical, size_t* length, uint64_t* fingerprint)
+{
+	const uint8_t* end = capture_info->packet_data + capture_info->packet_length;
+	const uint8_t* pos = (const uint8_t*) capture_info->icmp6_header + sizeof(struct nd_router_advert);
+	const struct nd_opt_hdr* options[RA_FINGERPRINT_OPTIONS_MAX];
+	const struct nd_opt_hdr* option;
+	uint8_t* out;
+	int option_count = 0;
+	uint64_t hash = 14695981039346656037ULL;
+	size_t i;
+	int j;
+
+	if (pos > end)
+	{
+		return -1;
+	}
+	/* hop limit, flags, router lifetime, reachable and retransmission timers: */
+	*length = sizeof(struct nd_router_advert) - 4;
+	memcpy(canonical, (const uint8_t*) capture_info->icmp6_header + 4, *length);
 
-	/* whole function is critical section: */
-	locked_probe = probe_lock(capture_info->probe->name);
-	routers = &locked_probe->routers;
-	router = router_get(*routers, capture_info->ip6_header->ip6_src, *src_eth);
+	while (pos + 2 <= end && pos[0] != 0)
+	{
+		option = (const struct nd_opt_hdr*) pos;
+		if (option->nd_opt_len == 0 || pos + option->nd_opt_len*8 > end
+				|| option_count == RA_FINGERPRINT_OPTIONS_MAX
+				|| *length + option->nd_opt_len*8 > RA_FINGERPRINT_SIZE)
+		{
+			return -1;
+		}
+		/* insertion sort, RA have a handful of options: */
+		for (j=option_count; j>0 && ra_option_compare(options[j-1], option)>0; j--)
+		{
+			options[j] = options[j-1];
+		}
+		options[j] = option;
+		option_count++;
+		*length += option->nd_opt_len*8;
+		pos += option->nd_opt_len*8;
+	}
 
-	/* Learning phase, just populate the routers list */
-	if(learning) 
+	out = canonical + sizeof(struct nd_router_advert) - 4;
+	for (j=0; j<option_count; j++)
 	{
-		struct nd_opt_prefix_info* option_prefix = NULL;
-		struct nd_opt_mtu* option_mtu = NULL;
-		char prefix[INET6_ADDRSTRLEN];
-		struct nd_opt_rdnss *option_rdnss = NULL;
-		struct nd_opt_dnssl *option_dnssl = NULL;
-		struct nd_opt_route_info* option_route = NULL;
-		int nb = -1;
-		uint32_t lifetime =  0;
-		uint32_t nd_opt_len = 0;
-		uint8_t * pos = 0;
-		struct in6_addr *addr =  NULL;
-		char *search = NULL;
-		uint8_t route_pref_reserved = 0, route_prefix_len = 0;
-
-		prefix_t* router_prefix=NULL;
-		rdnss_t *rdnss = NULL;
-		rdnss_t *tmp_rdnss = NULL;
-		dnssl_t *dnssl = NULL;
-		dnssl_t *tmp_dnssl = NULL;
-
-		route_info_t *routes = NULL;
-		route_info_t *tmp_routes = NULL;
+		memcpy(out, options[j], options[j]->nd_opt_len*8);
+		out += options[j]->nd_opt_len*8;
+	}
+	for (i=0; i<*length; i++)
+	{
+		hash ^= canonical[i];
+		hash *= 1099511628211ULL;
+	}
+	*fingerprint = hash;
+	return 0;
+}
 
-		/* Retrieve the Router Advertisement to get the RA params. */
-		struct nd_router_advert *router_advert = (struct nd_router_advert*) (capture_info->icmp6_header);
+/* Decodes the options of a RA watch_ra() looks at in one pass. The options
+ * end with the packet or with an option of type 0, as in watch_prepare_nd().
+ * Returns -1 if an option is truncated or has a wrong length. The options
+ * of a kind that do not fit in struct ra_options are counted as truncated
+ * and not looked at, the RA itself is valid (a router learns it, but once
+ * learning is over it raises an alert).
+ */
+static int ra_options_decode(const struct capture_info* capture_info, struct ra_options* options)
+{
+	const uint8_t* end = capture_info->packet_data + capture_info->packet_length;
+	const uint8_t* pos = (const uint8_t*) capture_info->icmp6_header + sizeof(struct nd_router_advert);
+	const uint8_t* option_end;
+	const uint8_t* search;
+	size_t length, domain_length;
+	uint32_t lifetime;
+
+	options->prefix_count = 0;
+	options->mtu_count = 0;
+	options->nameserver_count = 0;
+	options->nameserver_empty_count = 0;
+	options->domain_count = 0;
+	options->domain_too_long_count = 0;
+	options->route_count = 0;
+	options->truncated_count = 0;
+
+	if (pos > end)
+	{
+		return -1;
+	}
+	while (pos + 2 <= end && pos[0] != 0)
+	{
+		length = pos[1]*8;
+		if (length == 0 || pos + length > end)
+		{
+			return -1;
+		}
+		option_end = pos + length;
 
-		/* We have to search the prefix and mtu option among the others RA options: */
-		while (option_list!=NULL) 
+		switch (pos[0])
 		{
-			struct nd_opt_hdr* optptr = (struct nd_opt_hdr*) &option_list->option_data;
-			switch (option_list->option_data.option_header.nd_opt_type) 
+			case ND_OPT_PREFIX_INFORMATION:
 			{
-				case ND_OPT_PREFIX_INFORMATION:
-					option_prefix = (struct nd_opt_prefix_info*) optptr;
-					ipv6pre_ntoa(prefix, option_prefix->nd_opt_pi_prefix);
-					break;
+				struct nd_opt_prefix_info option_prefix;
+				struct ra_prefix* prefix;
 
-				case ND_OPT_MTU:
-					option_mtu = (struct nd_opt_mtu*) optptr;
+				if (length != sizeof(struct nd_opt_prefix_info))
+				{
+					return -1;
+				}
+				if (options->prefix_count == RA_OPTIONS_PREFIX_MAX)
+				{
+					options->truncated_count++;
 					break;
+				}
+				memcpy(&option_prefix, pos, sizeof(struct nd_opt_prefix_info));
+				prefix = &options->prefixes[options->prefix_count++];
+				prefix->prefix         = option_prefix.nd_opt_pi_prefix;
+				prefix->mask           = option_prefix.nd_opt_pi_prefix_len;
+				prefix->flags_reserved = option_prefix.nd_opt_pi_flags_reserved;
+				prefix->valid_time     = ntohl(option_prefix.nd_opt_pi_valid_time);
+				prefix->preferred_time = ntohl(option_prefix.nd_opt_pi_preferred_time);
+				prefix->reserved2      = ntohl(option_prefix.nd_opt_pi_reserved2);
+				break;
+			}
 
-				case ND_OPT_RDNSS: /* RFC6106 RDNSS option */
-					option_rdnss = (struct nd_opt_rdnss *) optptr;
-					nb = (option_rdnss->nd_opt_rdnss_len -1)/2;
-					lifetime =  ntohl(option_rdnss->nd_opt_rdnss_lifetime);
-					pos = (uint8_t *)optptr;
+			case ND_OPT_MTU:
+			{
+				struct nd_opt_mtu option_mtu;
 
-					/* Look for all addresses declared */
-					for (addr = (struct in6_addr *) (pos+8); nb > 0; addr++, nb--)
-					{
-						/* add new entry in list */
-						rdnss_t *new;
-						if( (new = (rdnss_t *)malloc(sizeof(struct rdnss))) == NULL)
-						{
-							perror("malloc for new RDNSS");
-							break;
-						}
-
-						new->lifetime = lifetime;
-						memcpy( &new->address, addr, sizeof(struct in6_addr));
-						new->next = NULL;
-
-						tmp_rdnss = rdnss;
-						if(tmp_rdnss == NULL)
-							rdnss = new;
-						else
-						{
-							while( tmp_rdnss->next != NULL )
-								tmp_rdnss = tmp_rdnss->next;
-
-							tmp_rdnss->next = new;
-						}
-					}
+				if (length != sizeof(struct nd_opt_mtu))
+				{
+					return -1;
+				}
+				if (options->mtu_count == RA_OPTIONS_MTU_MAX)
+				{
+					options->truncated_count++;
 					break;
+				}
+				memcpy(&option_mtu, pos, sizeof(struct nd_opt_mtu));
+				options->mtus[options->mtu_count++] = ntohl(option_mtu.nd_opt_mtu_mtu);
+				break;
+			}
 
-				case ND_OPT_DNSSL: /* RFC6106 DNSSL option */
-					option_dnssl = (struct nd_opt_dnssl *) optptr;
-					lifetime =  ntohl(option_dnssl->nd_opt_dnssl_lifetime);
-					nd_opt_len = option_dnssl->nd_opt_dnssl_len;
-					pos = (uint8_t *)optptr;
-
-					/* Payload lenght in Bytes
-					 * Length of domains to search
-					 **/
-					nd_opt_len = (nd_opt_len - 1) * 8;
-
-					/* set pointer to domains at the first position */
-					search = (char *)(pos + 8);
-					while (nd_opt_len > 0)
+			case ND_OPT_RDNSS: /* RFC6106 RDNSS option */
+				/* the header is followed by the addresses: */
+				if ((length - 8) % sizeof(struct in6_addr) != 0)
+				{
+					return -1;
+				}
+				if (length == 8)
+				{
+					options->nameserver_empty_count++;
+				}
+				memcpy(&lifetime, pos + 4, sizeof(uint32_t));
+				for (search = pos + 8; search < option_end; search += sizeof(struct in6_addr))
+				{
+					if (options->nameserver_count == RA_OPTIONS_NAMESERVER_MAX)
 					{
-						char domain[MAX_DOMAINLEN+1];
-						uint32_t domain_len = 0;
-						int stop = 0;
-						dnssl_t *new = NULL;
-
-						memset(domain, 0, sizeof(domain));
-						/* look for a domain to search */
-						while(*search != '\0')
-						{
-							/* Make sure we do not have a domain larger than the max size */
-							if(domain_len>=MAX_DOMAINLEN)
-							{
-								/* Domain too long */
-								stop = 1;
-								break;
-							}
-
-							domain[domain_len] = *search;
-							domain_len++;
-							search++;
-							nd_opt_len--;
-						}
-
-						/* Make sure we do not have a domain larger than the max size */
-						if(domain_len>=MAX_DOMAINLEN)
-							stop = 1;
-
-						/* Domain name too long, stop with the option header */
-						if(stop)
-							break;
-
-						/* inc one last time for \0 */
-						domain[domain_len] = *search;
-						domain_len++;
-						search++;
-						nd_opt_len--;
-
-						/* do not treat padding */
-						if( !strncmp(domain, "", 1) )
-							continue;
-
-						/* Add new search domain */
-						if( (new = (dnssl_t *)malloc(sizeof(struct dnssl))) == NULL)
-						{
-							perror("malloc for new DNSSL");
-							break;
-						}
-						new->lifetime = lifetime;
-						strlcpy( new->domain, domain, MAX_DOMAINLEN+1);
-						new->next = NULL;
-
-						tmp_dnssl = dnssl;
-						if(tmp_dnssl == NULL)
-							dnssl = new;
-						else
-						{
-							while( tmp_dnssl->next != NULL )
-								tmp_dnssl = tmp_dnssl->next;
-
-							tmp_dnssl->next = new;
-						}
+						options->truncated_count++;
+						continue;
 					}
-					break;
-
-				case ND_OPT_ROUTE_INFORMATION: /* RFC4191 Route Information */
-					option_route = (struct nd_opt_route_info*) optptr;
-					route_pref_reserved   = option_route->nd_opt_ri_pref_reserved;
-					lifetime              = ntohl(option_route->nd_opt_ri_lifetime);
-					route_prefix_len      = option_route->nd_opt_ri_prefix_len;
-					/* option_route->nd_opt_ri_prefix) */
+					memcpy(&options->nameservers[options->nameserver_count].address, search, sizeof(struct in6_addr));
+					options->nameservers[options->nameserver_count].lifetime = ntohl(lifetime);
+					options->nameserver_count++;
+				}
+				break;
 
-					if(route_pref_reserved != 16)	/* should not be ignored */
+			case ND_OPT_DNSSL: /* RFC6106 DNSSL option */
+				/* the header is followed by NUL terminated domains and padding: */
+				memcpy(&lifetime, pos + 4, sizeof(uint32_t));
+				for (search = pos + 8; search < option_end; search += domain_length + 1)
+				{
+					domain_length = strnlen((const char*) search, option_end - search);
+					if (domain_length >= MAX_DOMAINLEN)
+					{
+						/* the end of the domain cannot be told, skip the rest of the option: */
+						options->domain_too_long_count++;
+						break;
+					}
+					if (search + domain_length == option_end)
 					{
-						route_info_t *new;
-						if( (new = (route_info_t *)malloc(sizeof(struct route_info))) == NULL)
-						{
-							perror("malloc for new Route Info");
-							break;
-						}
-						
-						memcpy( &new->prefix, &option_route->nd_opt_ri_prefix, sizeof(struct in6_addr));
-						new->mask = route_prefix_len;
-						new->lifetime = lifetime;
-						new->param_pref_reserved = route_pref_reserved;
-						new->next = NULL;
-
-						tmp_routes = routes;
-						if(tmp_routes == NULL)
-							routes = new;
-						else
-						{
-							while( tmp_routes->next != NULL )
-								tmp_routes = tmp_routes->next;
-
-							tmp_routes->next = new;
-						}
+						return -1;
 					}
+					/* do not treat padding */
+					if (domain_length == 0)
+					{
+						continue;
+					}
+					if (options->domain_count == RA_OPTIONS_DOMAIN_MAX)
+					{
+						options->truncated_count++;
+						continue;
+					}
+					memcpy(options->domains[options->domain_count].domain, search, domain_length);
+					options->domains[options->domain_count].domain[domain_length] = '\0';
+					options->domains[options->domain_count].lifetime = ntohl(lifetime);
+					options->domain_count++;
+				}
+				break;
 
-					break;
+			case ND_OPT_ROUTE_INFORMATION: /* RFC4191 Route Information */
+			{
+				struct ra_route* route;
 
-				default:
+				/* the prefix is 0, 8 or 16 bytes long and must hold the prefix length: */
+				if (length > sizeof(struct nd_opt_route_info) || pos[2] > 128
+						|| pos[2] > (length - 8)*8)
+				{
+					return -1;
+				}
+				if (options->route_count == RA_OPTIONS_ROUTE_MAX)
+				{
+					options->truncated_count++;
 					break;
-			}
-			/* If all supported options were found skip remaining options: 
-			 * Do not stop if option rdnss, dnssl or route info are not NULL
-			 * as we can have several ones
-			 **/
-			if (option_prefix!=NULL && option_mtu!=NULL) 
-			{
+				}
+				route = &options->routes[options->route_count++];
+				memset(&route->prefix, 0, sizeof(struct in6_addr));
+				memcpy(&route->prefix, pos + 8, length - 8);
+				route->mask          = pos[2];
+				route->pref_reserved = pos[3];
+				memcpy(&lifetime, pos + 4, sizeof(uint32_t));
+				route->lifetime      = ntohl(lifetime);
 				break;
 			}
-			/* Next option field*/
-			option_list = option_list->next;
+
+			default:
+				break;
 		}
+		pos = option_end;
+	}
+	return 0;
+}
+
+int watch_ra(struct capture_info* const capture_info) 
+{
+	int ret = 0;
+	struct ether_addr *src_eth;
+	char  eth[ETH_ADDRSTRLEN], ip_address[IP6_STR_SIZE];
+	char * buffer                            = capture_info->message;
+	router_list_t** routers;
+	router_list_t* router;
+	struct probe* locked_probe;
+	/* canonical form of the RA, a router repeating its last valid RA is not checked again: */
+	uint8_t ra_canonical[RA_FINGERPRINT_SIZE];
+	size_t ra_canonical_length = 0;
+	uint64_t ra_canonical_fingerprint = 0;
+	int ra_fingerprinted;
+	/* the options, decoded before locking the probe: */
+	struct ra_options options;
+	int options_decoded;
+	/* RetransTimer of a RA that passed the checks, taken for the DADs: */
+	uint32_t dad_retrans_timer = 0;
+	int i;
 
-		if (!option_prefix) 
+	src_eth = (struct ether_addr *) capture_info->ethernet_header->ether_shost;
+	ipv6_ntoa(ip_address, capture_info->ip6_header->ip6_src);
+	strlcpy(eth,ether_ntoa(src_eth), ETH_ADDRSTRLEN);
+	ra_fingerprinted = !learning
+		&& ra_fingerprint(capture_info, ra_canonical, &ra_canonical_length, &ra_canonical_fingerprint)==0;
+	options_decoded = ra_options_decode(capture_info, &options)==0;
+	if (options_decoded && options.truncated_count > 0)
+	{
+		LOGGING(LOGGING_WATCH, LOGGING_LEVEL_DEBUG, "[monitoring_ra] RA of %s %s has %d options more than are looked at, they are ignored\n",
+				eth, ip_address, options.truncated_count);
+	}
+
+	/* whole function is critical section: */
+	locked_probe = probe_handle_lock(capture_info->probe);
+	routers = &locked_probe->routers;
+	router = router_find(*routers, &capture_info->ip6_header->ip6_src, src_eth);
+
+	/* Learning phase, just populate the routers list */
+	if(learning) 
+	{
+		/* Retrieve the Router Advertisement to get the RA params. */
+		struct nd_router_advert *router_advert = (struct nd_router_advert*) (capture_info->icmp6_header);
+		prefix_t* router_prefix = NULL;
+		route_info_t* router_route = NULL;
+
+		if (!options_decoded || options.prefix_count == 0) 
 		{
-			/*if there is no prefix information:*/
-			probe_unlock(capture_info->probe->name);
+			/* malformed or without prefix information: */
+			probe_handle_unlock(capture_info->probe);
 			return 0;
 		}
 
@@ -277,42 +338,15 @@ int watch_ra(struct capture_info* const capture_info)
 					ntohs(router_advert->nd_ra_router_lifetime),
 					ntohl(router_advert->nd_ra_reachable),
 					ntohl(router_advert->nd_ra_retransmit),
-					option_mtu==NULL?0:ntohl(option_mtu->nd_opt_mtu_mtu),
+					options.mtu_count==0?0:options.mtus[0],
 					1 /* params are by default volatile (they may change).  */
 				  );
-			router_add_prefix(
-					*routers, capture_info->ip6_header->ip6_src, *src_eth,
-					option_prefix->nd_opt_pi_prefix,
-					option_prefix->nd_opt_pi_prefix_len,
-					option_prefix->nd_opt_pi_flags_reserved,
-					ntohl(option_prefix->nd_opt_pi_valid_time),
-					ntohl(option_prefix->nd_opt_pi_preferred_time)
-					);
-
-			/* Add RDNSS info */
-			tmp_rdnss = rdnss;
-			while(tmp_rdnss != NULL)
+			router = router_find(*routers, &capture_info->ip6_header->ip6_src, src_eth);
+			if (router == NULL)
 			{
-				router_add_nameserver(*routers, *src_eth, tmp_rdnss->address, tmp_rdnss->lifetime);
-				tmp_rdnss = tmp_rdnss->next;
+				probe_handle_unlock(capture_info->probe);
+				return 0;
 			}
-
-			/* Add DNSSL info */
-			tmp_dnssl = dnssl;
-			while(tmp_dnssl != NULL)
-			{
-				router_add_domain(*routers, *src_eth, tmp_dnssl->domain, tmp_dnssl->lifetime);
-				tmp_dnssl = tmp_dnssl->next;
-			}
-
-			/* Add Route Info */
-			tmp_routes = routes;
-			while(tmp_routes != NULL)
-			{
-				router_add_route(*routers, capture_info->ip6_header->ip6_src, *src_eth, tmp_routes->prefix, tmp_routes->mask, tmp_routes->param_pref_reserved, tmp_routes->lifetime);
-				tmp_routes = tmp_routes->next;
-			}
-
 		}
 		else /* router already learned */
 		{
@@ -323,56 +357,73 @@ int watch_ra(struct capture_info* const capture_info)
 			router->param_reachable_timer = ntohl(router_advert->nd_ra_reachable);
 			router->param_retrans_timer   = ntohl(router_advert->nd_ra_retransmit);
 
-			if (option_mtu!=NULL) 
+			if (options.mtu_count > 0) 
 			{
-				router->param_mtu = ntohl(option_mtu->nd_opt_mtu_mtu);
+				router->param_mtu = options.mtus[0];
 			}
+		}
 
-			router_prefix = router_get_prefix(*routers, capture_info->ip6_header->ip6_src, *src_eth, option_prefix->nd_opt_pi_prefix, option_prefix->nd_opt_pi_prefix_len);
+		for (i=0; i<options.prefix_count; i++)
+		{
+			const struct ra_prefix* prefix = &options.prefixes[i];
+
+			router_prefix = router_find_prefix(router, &prefix->prefix, prefix->mask);
 			if( router_prefix == NULL ) 
 			{
 				/* If there is a new prefix advertised add it to the list of prefixes.*/
 				router_add_prefix(
 						*routers, capture_info->ip6_header->ip6_src, *src_eth,
-						option_prefix->nd_opt_pi_prefix,
-						option_prefix->nd_opt_pi_prefix_len,
-						option_prefix->nd_opt_pi_flags_reserved,
-						ntohl(option_prefix->nd_opt_pi_valid_time),
-						ntohl(option_prefix->nd_opt_pi_preferred_time)
+						prefix->prefix, prefix->mask, prefix->flags_reserved,
+						prefix->valid_time, prefix->preferred_time
 						);
 			} 
 			else 
 			{
 				/* If the prefix is already in the list update values: */
-				router_prefix->param_valid_time     = ntohl(option_prefix->nd_opt_pi_valid_time);
-				router_prefix->param_preferred_time = ntohl(option_prefix->nd_opt_pi_preferred_time);
+				router_prefix->param_valid_time     = prefix->valid_time;
+				router_prefix->param_preferred_time = prefix->preferred_time;
 			}
+		}
+
+		/* Add RDNSS info */
+		for (i=0; i<options.nameserver_count; i++)
+		{
+			router_add_nameserver(*routers, *src_eth, options.nameservers[i].address, options.nameservers[i].lifetime);
+		}
+
+		/* Add DNSSL info */
+		for (i=0; i<options.domain_count; i++)
+		{
+			router_add_domain(*routers, *src_eth, options.domains[i].domain, options.domains[i].lifetime);
+		}
 
-			/* Add RDNSS info */
-			tmp_rdnss = rdnss;
-			while(tmp_rdnss != NULL)
+		/* Add Route Info */
+		for (i=0; i<options.route_count; i++)
+		{
+			const struct ra_route* route = &options.routes[i];
+
+			/* should be ignored: */
+			if (route->pref_reserved == ND_OPT_RI_PREF_IGNOR)
 			{
-				router_add_nameserver(*routers, *src_eth, tmp_rdnss->address, tmp_rdnss->lifetime);
-				tmp_rdnss = tmp_rdnss->next;
+				continue;
 			}
-
-			/* Add DNSSL info */
-			tmp_dnssl = dnssl;
-			while(tmp_dnssl != NULL)
+			router_route = router_find_route(router, &route->prefix, route->mask);
+			if (router_route == NULL)
 			{
-				router_add_domain(*routers, *src_eth, tmp_dnssl->domain, tmp_dnssl->lifetime);
-				tmp_dnssl = tmp_dnssl->next;
+				router_add_route(*routers, capture_info->ip6_header->ip6_src, *src_eth, route->prefix, route->mask, route->pref_reserved, route->lifetime);
 			}
-
-			/* Add Route Info */
-			tmp_routes = routes;
-			while(tmp_routes != NULL)
+			else
 			{
-				router_add_route(*routers, capture_info->ip6_header->ip6_src, *src_eth, tmp_routes->prefix, tmp_routes->mask, tmp_routes->param_pref_reserved, tmp_routes->lifetime);
-				tmp_routes = tmp_routes->next;
+				/* If the route is already in the list update values: */
+				router_route->lifetime            = route->lifetime;
+				router_route->param_pref_reserved = route->pref_reserved;
 			}
 		}
-		probe_unlock(capture_info->probe->name);
+		dad_retrans_timer = router->param_retrans_timer;
+		bindings_invalidate(locked_probe);
+		probe_handle_unlock(capture_info->probe);
+		/* the hosts of the link take the RetransTimer of the learned router for their DAD: */
+		dad_retrans_timer_set(capture_info->probe, dad_retrans_timer);
 print_routers(*routers);
 		return 0;
 	}
@@ -423,10 +474,19 @@ print_routers(*routers);
 		}
 #endif
 	}
+	/* The router is valid and repeats its last RA that passed all checks */
+	else if (ra_fingerprinted
+		&& router_ra_is_verified(router, ra_canonical, ra_canonical_length, ra_canonical_fingerprint))
+	{
+		LOGGING(LOGGING_WATCH, LOGGING_LEVEL_TRACE, "[monitoring_ra] RA of %s %s verified already\n", eth, ip_address);
+		dad_retrans_timer = ntohl(((struct nd_router_advert*) capture_info->icmp6_header)->nd_ra_retransmit);
+	}
 	/* The router is valid, check options */
 	else
 	{
 		const struct ether_header* ethernet_header = capture_info->ethernet_header;
+		/* alerts raised before the checks: */
+		unsigned long alerts = alert_raised_count();
 		struct nd_router_advert *ra = (struct nd_router_advert *) capture_info->icmp6_header;
 		unsigned int managed_flag, other_flag;
 		char prefix[INET6_ADDRSTRLEN];
@@ -540,403 +600,284 @@ print_routers(*routers);
 		/******************************
 		 * Check RA options 
 		 ******************************/
-		/*We have to search the prefix and other options among the others RA options*/
-		while(option_list!=NULL) 
+		if (!options_decoded)
 		{
-			struct nd_opt_hdr* optptr = (struct nd_opt_hdr* ) &option_list->option_data;
-			if(optptr->nd_opt_type ==  ND_OPT_PREFIX_INFORMATION) 
+			snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA options: malformed options");
+			alert_raise(2, capture_info->probe, "wrong RA options", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
+			ret = 2;
+			options.prefix_count = 0;
+			options.mtu_count = 0;
+			options.nameserver_count = 0;
+			options.nameserver_empty_count = 0;
+			options.domain_count = 0;
+			options.domain_too_long_count = 0;
+			options.route_count = 0;
+			options.truncated_count = 0;
+		}
+		else if (options.truncated_count > 0)
+		{
+			/* the options not looked at may hide a rogue one behind padding: */
+			snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA options: too many options (%d not checked)", options.truncated_count);
+			alert_raise(2, capture_info->probe, "wrong RA options", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
+			ret = 2;
+		}
+
+		/* Prefix information options */
+		for (i=0; i<options.prefix_count; i++)
+		{
+			const struct ra_prefix* option_prefix = &options.prefixes[i];
+			/* ADDED param spoofing detection: */
+			prefix_t* router_prefix=NULL;
+			/* END ADDED */
+
+			ipv6pre_ntoa(prefix, option_prefix->prefix);
+			
+			/* Check prefix */
+			router_prefix = router_find_prefix(router, &option_prefix->prefix, option_prefix->mask);
+			if (router_prefix==NULL) /* prefix not found*/
 			{
-				struct nd_opt_prefix_info* option_prefix = (struct nd_opt_prefix_info*) optptr;
-				uint8_t prefix_flags_reserved;
-				uint32_t prefix_valid_time, prefix_preferred_time, prefix_reserved2;
-				/* ADDED param spoofing detection: */
-				prefix_t* router_prefix=NULL;
-				/* END ADDED */
-
-				prefix_flags_reserved = option_prefix->nd_opt_pi_flags_reserved;
-				prefix_reserved2      = ntohl(option_prefix->nd_opt_pi_reserved2);
-				prefix_valid_time     = ntohl(option_prefix->nd_opt_pi_valid_time);
-				prefix_preferred_time = ntohl(option_prefix->nd_opt_pi_preferred_time);
-				ipv6pre_ntoa(prefix, option_prefix->nd_opt_pi_prefix);
-				
-				/* Check prefix */
-				router_prefix = router_get_prefix(*routers, capture_info->ip6_header->ip6_src, *src_eth, option_prefix->nd_opt_pi_prefix, option_prefix->nd_opt_pi_prefix_len);
-				if (router_prefix==NULL) /* prefix not found*/
-				{
-					char ip_address[IP6_STR_SIZE];
-					ipv6_ntoa(ip_address, capture_info->ip6_header->ip6_src);
-					snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong prefix %s %s %s", prefix,(char*)ether_ntoa((struct ether_addr*) (ethernet_header->ether_shost)), ip_address);
-					alert_raise(2, capture_info->probe, "wrong prefix", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
-					ret = 2;
+				snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong prefix %s %s %s", prefix,(char*)ether_ntoa((struct ether_addr*) (ethernet_header->ether_shost)), ip_address);
+				alert_raise(2, capture_info->probe, "wrong prefix", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
+				ret = 2;
 #ifdef _COUNTERMEASURES_
-					/* We only propagate a counter measure if the probe is  a local one */
-					if( (locked_probe->type == PROBE_TYPE_INTERFACE) && (locked_probe->cm_enabled == 1) )
-					{
-						/* we need to pass the interface on which 
-						 * the countermeasure must be propagated as a parameter 
-						 * i.e. the probe name */
-						cm_kill_wrong_prefix(router, &capture_info->ip6_header->ip6_src, &option_prefix->nd_opt_pi_prefix, option_prefix->nd_opt_pi_prefix_len, locked_probe->name);
-					}
-#endif
-				}
-				
-				/* check the lifetimes  - RFC2462 */
-				/* valid should always be > to preferred - RFC2462 */
-				if (prefix_preferred_time > prefix_valid_time)
+				/* We only propagate a counter measure if the probe is  a local one */
+				if( (locked_probe->type == PROBE_TYPE_INTERFACE) && (locked_probe->cm_enabled == 1) )
 				{
-					char ip_address[IP6_STR_SIZE];
-					ipv6_ntoa(ip_address, capture_info->ip6_header->ip6_src);
-					snprintf (buffer, NOTIFY_BUFFER_SIZE, "RA preferred lifetime %d longer than valid lifetime %d",prefix_valid_time, prefix_preferred_time );
-					alert_raise(2, capture_info->probe, "wrong RA prefix option lifetimes", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
-					ret = 2;
+					/* we need to pass the interface on which 
+					 * the countermeasure must be propagated as a parameter 
+					 * i.e. the probe name */
+					cm_kill_wrong_prefix(router, &capture_info->ip6_header->ip6_src, &option_prefix->prefix, option_prefix->mask, locked_probe->name);
 				}
-				
-				/* valid lifetime should always be more than 2 hours - RFC2462 */
-				if (prefix_valid_time < 7200)
-				{
-					char ip_address[IP6_STR_SIZE];
-					ipv6_ntoa(ip_address, capture_info->ip6_header->ip6_src);
-					snprintf (buffer, NOTIFY_BUFFER_SIZE, "RA prefix option valid lifetime %d < 2 hours", prefix_valid_time );
-					alert_raise(2, capture_info->probe, "RA prefix option valid lifetime too short", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
-					ret = 2;
-				}
-				
-				/* param spoofing detection in prefix option */
-				if (router_prefix != NULL && router->params_volatile==0) 
-				{
-					/* reset previous flag value */
-					param_mismatch = 0;
-
-					/* Checking value against those learned. prefix params cannot be zero. all are checked. */
-					memset(param_mismatched_list, 0, RA_PARAM_MISMATCHED_LIST_SIZE);
-
-					if (prefix_flags_reserved != router_prefix->param_flags_reserved) 
-					{
-						memset(param_mismatched, 0, RA_PARAM_MISMATCHED_SIZE);
-						snprintf(param_mismatched, RA_PARAM_MISMATCHED_SIZE, "flags=%u;", prefix_flags_reserved);
-						strlcat(param_mismatched_list,param_mismatched,RA_PARAM_MISMATCHED_SIZE);
-						param_mismatch++;
-					}
-					if (prefix_reserved2 != 0) 
-					{
-						memset(param_mismatched, 0, RA_PARAM_MISMATCHED_SIZE);
-						snprintf(param_mismatched, RA_PARAM_MISMATCHED_SIZE, "reserved2=%u;", prefix_reserved2);
-						strlcat(param_mismatched_list,param_mismatched,RA_PARAM_MISMATCHED_SIZE);
-						param_mismatch++;
-					}
-					if (prefix_valid_time != router_prefix->param_valid_time) 
-					{
-						memset(param_mismatched, 0, RA_PARAM_MISMATCHED_SIZE);
-						snprintf (param_mismatched, RA_PARAM_MISMATCHED_SIZE, "valid_time=%u;", prefix_valid_time);
-						strlcat(param_mismatched_list,param_mismatched,RA_PARAM_MISMATCHED_SIZE);
-						param_mismatch++;
-					}
-					if (prefix_preferred_time != router_prefix->param_preferred_time) 
-					{
-						memset(param_mismatched, 0, RA_PARAM_MISMATCHED_SIZE);
-						snprintf (param_mismatched, RA_PARAM_MISMATCHED_SIZE, "preferred_time=%u;", prefix_preferred_time);
-						strlcat(param_mismatched_list,param_mismatched,RA_PARAM_MISMATCHED_SIZE);
-						param_mismatch++;
-					}
-					if (param_mismatch>0) 
-					{
-						snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA prefix option params: %s", param_mismatched_list);
-						alert_raise(2, capture_info->probe, "wrong RA prefix option params", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
-#ifdef _COUNTERMEASURES_
-						param_spoofing_detected = 1;
 #endif
-					}	
-				}
-				/* END ADDED */
 			}
 			
-			/* Verify that the Source Link Option matches the Ethernet source addr of the packet
-			   REMOVED this because this is already done by watch_eth_mismatch.
-			   */
-#if 0
-			else if(optptr->nd_opt_type ==  ND_OPT_SOURCE_LINKADDR)
+			/* check the lifetimes  - RFC2462 */
+			/* valid should always be > to preferred - RFC2462 */
+			if (option_prefix->preferred_time > option_prefix->valid_time)
 			{
-				uint8_t *mac;
-				mac = (uint8_t *)(pos+2);
-
-				if( (mac[0]!=ethernet_header->ether_shost[0]) || (mac[1]!=ethernet_header->ether_shost[1]) || (mac[2]!=ethernet_header->ether_shost[2]) || (mac[3]!=ethernet_header->ether_shost[3]) || (mac[4]!=ethernet_header->ether_shost[4]) || (mac[5]!=ethernet_header->ether_shost[5]) )
-				{
-					char  eth_opt[ETH_ADDRSTRLEN];
-					struct ether_addr * adv_eth = NULL;
-
-					adv_eth = (struct ether_addr *) mac;
-					strlcpy(eth_opt,ether_ntoa(adv_eth), ETH_ADDRSTRLEN);
-					snprintf (buffer, NOTIFY_BUFFER_SIZE-1, "source link address %s different from ethernet source %s", eth_opt, eth );
-					alert_raise(2, "wrong source link address option", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
-					ret = 2;
-				}
+				snprintf (buffer, NOTIFY_BUFFER_SIZE, "RA preferred lifetime %d longer than valid lifetime %d",option_prefix->valid_time, option_prefix->preferred_time );
+				alert_raise(2, capture_info->probe, "wrong RA prefix option lifetimes", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
+				ret = 2;
 			}
-#endif
 			
-			/* Checking MTU option against the value learned. 
-			 * A value learned = 0 means option not learned, thus unspecified
-			 * if a value is set here and is different from the expected, raise an alert
-			 * this implies that if the option is set when not expected an alert is raised
-			 **/
-			else if(optptr->nd_opt_type ==  ND_OPT_MTU) 
+			/* valid lifetime should always be more than 2 hours - RFC2462 */
+			if (option_prefix->valid_time < 7200)
 			{
-				uint32_t mtu;
-				struct nd_opt_mtu *option_mtu = (struct nd_opt_mtu*) optptr;
-				mtu = ntohl(option_mtu->nd_opt_mtu_mtu);
-				
-				/* if (router != NULL && router->params_volatile==0 && router->param_mtu!=0 && mtu != router->param_mtu) */
-				if (router != NULL && router->params_volatile==0)
-					/* Alert if Adv MTU != learned MTU 
-					 * of if none expected (router->param_mtu == 0) and Adv MTU == zero 
-					 **/
-					if( (mtu != router->param_mtu) || (mtu == 0) )
-					{
-						snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA mtu option: mtu=%u", mtu);
-						alert_raise(2, capture_info->probe, "wrong RA mtu option", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
+				snprintf (buffer, NOTIFY_BUFFER_SIZE, "RA prefix option valid lifetime %d < 2 hours", option_prefix->valid_time );
+				alert_raise(2, capture_info->probe, "RA prefix option valid lifetime too short", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
+				ret = 2;
+			}
+			
+			/* param spoofing detection in prefix option */
+			if (router_prefix != NULL && router->params_volatile==0) 
+			{
+				/* reset previous flag value */
+				param_mismatch = 0;
+
+				/* Checking value against those learned. prefix params cannot be zero. all are checked. */
+				memset(param_mismatched_list, 0, RA_PARAM_MISMATCHED_LIST_SIZE);
+
+				if (option_prefix->flags_reserved != router_prefix->param_flags_reserved) 
+				{
+					memset(param_mismatched, 0, RA_PARAM_MISMATCHED_SIZE);
+					snprintf(param_mismatched, RA_PARAM_MISMATCHED_SIZE, "flags=%u;", option_prefix->flags_reserved);
+					strlcat(param_mismatched_list,param_mismatched,RA_PARAM_MISMATCHED_SIZE);
+					param_mismatch++;
+				}
+				if (option_prefix->reserved2 != 0) 
+				{
+					memset(param_mismatched, 0, RA_PARAM_MISMATCHED_SIZE);
+					snprintf(param_mismatched, RA_PARAM_MISMATCHED_SIZE, "reserved2=%u;", option_prefix->reserved2);
+					strlcat(param_mismatched_list,param_mismatched,RA_PARAM_MISMATCHED_SIZE);
+					param_mismatch++;
+				}
+				if (option_prefix->valid_time != router_prefix->param_valid_time) 
+				{
+					memset(param_mismatched, 0, RA_PARAM_MISMATCHED_SIZE);
+					snprintf (param_mismatched, RA_PARAM_MISMATCHED_SIZE, "valid_time=%u;", option_prefix->valid_time);
+					strlcat(param_mismatched_list,param_mismatched,RA_PARAM_MISMATCHED_SIZE);
+					param_mismatch++;
+				}
+				if (option_prefix->preferred_time != router_prefix->param_preferred_time) 
+				{
+					memset(param_mismatched, 0, RA_PARAM_MISMATCHED_SIZE);
+					snprintf (param_mismatched, RA_PARAM_MISMATCHED_SIZE, "preferred_time=%u;", option_prefix->preferred_time);
+					strlcat(param_mismatched_list,param_mismatched,RA_PARAM_MISMATCHED_SIZE);
+					param_mismatch++;
+				}
+				if (param_mismatch>0) 
+				{
+					snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA prefix option params: %s", param_mismatched_list);
+					alert_raise(2, capture_info->probe, "wrong RA prefix option params", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
 #ifdef _COUNTERMEASURES_
-						param_spoofing_detected=1;
+					param_spoofing_detected = 1;
 #endif
-					}
-				/* END ADDED*/				
+				}	
 			}
+			/* END ADDED */
+		}
 
+		/* The Source Link Option is checked against the Ethernet source addr
+		 * of the packet by watch_eth_mismatch.
+		 */
 
-			/* RFC6106 RDNSS option */
-			else if(optptr->nd_opt_type == ND_OPT_RDNSS)
-			{
-				/* Cast the option to the right header */
-				struct nd_opt_rdnss *option_rdnss = (struct nd_opt_rdnss *) optptr;
-				/* number of Ns advertised */
-				int nb_ns = (option_rdnss->nd_opt_rdnss_len -1)/2;
-				/* lifetime of these NS */
-				uint32_t lifetime =  ntohl(option_rdnss->nd_opt_rdnss_lifetime);
-				/* pointer to the first Ns addr */
-				uint8_t * pos = (uint8_t *)optptr;
-				 /* struct in6_addr *addr = (struct in6_addr *) (pos + 8); */
-				struct in6_addr *addr =  NULL;
-
-#if 0
-fprintf(stderr, "Recursive DNS nameServer option with %d NS and lifetime %u!!!\n", nb_ns, lifetime );
-#endif
-				if(nb_ns<=0)
+		/* Checking MTU option against the value learned. 
+		 * A value learned = 0 means option not learned, thus unspecified
+		 * if a value is set here and is different from the expected, raise an alert
+		 * this implies that if the option is set when not expected an alert is raised
+		 **/
+		for (i=0; i<options.mtu_count; i++)
+		{
+			uint32_t mtu = options.mtus[i];
+			
+			if (router->params_volatile==0)
+				/* Alert if Adv MTU != learned MTU 
+				 * of if none expected (router->param_mtu == 0) and Adv MTU == zero 
+				 **/
+				if( (mtu != router->param_mtu) || (mtu == 0) )
 				{
-					/* option set but no nameserver is given */
-					snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA RDNSS option: empty nameservers list");
-					alert_raise(2, capture_info->probe, "wrong RA RDNSS option", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
+					snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA mtu option: mtu=%u", mtu);
+					alert_raise(2, capture_info->probe, "wrong RA mtu option", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
 #ifdef _COUNTERMEASURES_
-					dns_option_error = 1;
+					param_spoofing_detected=1;
 #endif
-					ret = 2;
 				}
-				for (addr = (struct in6_addr *) (pos+8); nb_ns > 0; addr++, nb_ns --)
-				{
-					/* check that the router has the couple lifetime / NS in his nameservers list */
-					if( !router_has_nameserver(*routers, *src_eth, *addr, lifetime) )
-					{
-						char  ns_addr_str[IP6_STR_SIZE];
-						ipv6_ntoa(ns_addr_str, *addr);
-						snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA RDNSS option: %s %u", ns_addr_str, lifetime);
-						alert_raise(2, capture_info->probe, "wrong RA RDNSS option", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
+		}
 
+		/* RFC6106 RDNSS options */
+		for (i=0; i<options.nameserver_empty_count; i++)
+		{
+			/* option set but no nameserver is given */
+			snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA RDNSS option: empty nameservers list");
+			alert_raise(2, capture_info->probe, "wrong RA RDNSS option", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
 #ifdef _COUNTERMEASURES_
-						/* We only propagate a counter measure if the probe is  a local one */
-						if( (locked_probe->type == PROBE_TYPE_INTERFACE) && (locked_probe->cm_enabled == 1) )
-						{
-							cm_kill_wrong_nameserver(router, &capture_info->ip6_header->ip6_src, addr, locked_probe->name);
-						}
-
-						dns_option_error = 1;
+			dns_option_error = 1;
 #endif
-						ret = 2;
-					}
-				}
-
-			}
+			ret = 2;
+		}
+		for (i=0; i<options.nameserver_count; i++)
+		{
+			const struct ra_nameserver* nameserver = &options.nameservers[i];
 
-			/* RFC6106 DNSSL option */
-			else if(optptr->nd_opt_type == ND_OPT_DNSSL)
+			/* check that the router has the couple lifetime / NS in his nameservers list */
+			if( router_find_nameserver(router_find_by_mac(*routers, src_eth), &nameserver->address, nameserver->lifetime) == NULL )
 			{
-				/* Cast the option to the right header */
-				struct nd_opt_dnssl *option_dnssl = (struct nd_opt_dnssl *) optptr;
-				/* lifetime of these NS */
-				uint32_t lifetime =  ntohl(option_dnssl->nd_opt_dnssl_lifetime);
-				/* Length of the option in word of 8 Bytes */
-				uint32_t nd_opt_len = option_dnssl->nd_opt_dnssl_len;
-				/* Position in the domains list */
-				char *search = NULL;
-				/* pointer within the option */
-				uint8_t * pos = (uint8_t *)optptr;
-
-				/* Payload lenght in Bytes
-				 * Length of domains to search
-				 **/
-				nd_opt_len = (nd_opt_len - 1) * 8;
-
-#if 0
-fprintf(stderr, "DNS Search List option with lifetime %u of length %u !!!\n", lifetime, nd_opt_len );
-#endif
+				char  ns_addr_str[IP6_STR_SIZE];
+				ipv6_ntoa(ns_addr_str, nameserver->address);
+				snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA RDNSS option: %s %u", ns_addr_str, nameserver->lifetime);
+				alert_raise(2, capture_info->probe, "wrong RA RDNSS option", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
 
-				/* set pointer to domains at the first position */
-				search = (char *)(pos + 8);
-				while (nd_opt_len > 0)
+#ifdef _COUNTERMEASURES_
+				/* We only propagate a counter measure if the probe is  a local one */
+				if( (locked_probe->type == PROBE_TYPE_INTERFACE) && (locked_probe->cm_enabled == 1) )
 				{
-					char domain[MAX_DOMAINLEN+1];
-					uint32_t domain_len = 0;
-					int stop = 0;
+					cm_kill_wrong_nameserver(router, &capture_info->ip6_header->ip6_src, &nameserver->address, locked_probe->name);
+				}
 
-					memset(domain, 0, sizeof(domain));
-					/* look for a domain to search */
-					while(*search != '\0')
-					{
-						/* Make sure we do not have a domain larger than the max size */
-						if(domain_len>=MAX_DOMAINLEN)
-						{
-							/* Domain too long */
-							snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA DNSSL option: search domain too long");
-							alert_raise(2, capture_info->probe, "wrong RA DNSSL option", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
-#ifdef _COUNTERMEASURES_
-							dns_option_error = 1;
+				dns_option_error = 1;
 #endif
-							ret = 2;
-							stop = 1;
-						}
-
-
-						domain[domain_len] = *search;
-						domain_len++;
-						search++;
-						nd_opt_len--;
-					}
+				ret = 2;
+			}
+		}
 
-					/* Make sure we do not have a domain larger than the max size */
-					if(domain_len>=MAX_DOMAINLEN)
-					{
-						/* Domain too long */
-						snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA DNSSL option: search domain too long");
-						alert_raise(2, capture_info->probe, "wrong RA DNSSL option", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
+		/* RFC6106 DNSSL options */
+		for (i=0; i<options.domain_too_long_count; i++)
+		{
+			/* Domain too long */
+			snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA DNSSL option: search domain too long");
+			alert_raise(2, capture_info->probe, "wrong RA DNSSL option", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
 #ifdef _COUNTERMEASURES_
-						dns_option_error = 1;
+			dns_option_error = 1;
 #endif
-						ret = 2;
-						stop = 1;
-					}
+			ret = 2;
+		}
+		for (i=0; i<options.domain_count; i++)
+		{
+			const struct ra_domain* domain = &options.domains[i];
 
-					/* Domain name too long, stop with the option header */
-					if(stop)
-						break;
+			/* check that the router has the couple lifetime / domain in his search list */
+			if( router_find_domain(router_find_by_mac(*routers, src_eth), domain->domain, domain->lifetime) == NULL )
+			{
+				snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA DNSSL option: %s %u", domain->domain, domain->lifetime);
+				alert_raise(2, capture_info->probe, "wrong RA DNSSL option", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
 
-					/* inc one last time for \0 */
-					domain[domain_len] = *search;
-					domain_len++;
-					search++;
-					nd_opt_len--;
+#ifdef _COUNTERMEASURES_
+				/* We only propagate a counter measure if the probe is  a local one */
+				if( (locked_probe->type == PROBE_TYPE_INTERFACE) && (locked_probe->cm_enabled == 1) )
+				{
+					cm_kill_wrong_domain(router, &capture_info->ip6_header->ip6_src, domain->domain, locked_probe->name);
+				}
 
-					/* do not treat padding */
-					if( !strncmp(domain, "", 1) )
-						continue;
+				dns_option_error = 1;
+#endif
+				ret = 2;
+			}
+		}
 
+		/* RFC4191 Route Information options */
+		for (i=0; i<options.route_count; i++)
+		{
+			const struct ra_route* option_route = &options.routes[i];
+			route_info_t *rinfo = NULL;
 
-#if 0
-fprintf(stderr, "    ---> Search domain %s\n", domain);
-#endif
-					/* check that the router has the couple lifetime / domain in his search list */
-					if( !router_has_domain(*routers, *src_eth, domain, lifetime) )
-					{
-						snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA DNSSL option: %s %u", domain, lifetime);
-						alert_raise(2, capture_info->probe, "wrong RA DNSSL option", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
+			ipv6pre_ntoa(prefix, option_route->prefix);
 
+			/* Is the preference OK ? */
+			if(option_route->pref_reserved == ND_OPT_RI_PREF_IGNOR)
+			{
+				/* Should not happen */
+				snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA Route Info option: route preference ignor");
+				alert_raise(2, capture_info->probe, "wrong RA Route Info option", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
 #ifdef _COUNTERMEASURES_
-					/* We only propagate a counter measure if the probe is  a local one */
-					if( (locked_probe->type == PROBE_TYPE_INTERFACE) && (locked_probe->cm_enabled == 1) )
-					{
-						cm_kill_wrong_domain(router, &capture_info->ip6_header->ip6_src, domain, locked_probe->name);
-					}
-
-						dns_option_error = 1;
+				/* route_option_error = 1; */
 #endif
-						ret = 2;
-					}
+				ret = 2;
+			}
+
+			/* does this route exist ? */
+			if( (rinfo=router_find_route(router, &option_route->prefix, option_route->mask)) == NULL)
+			{
+				/* Wrong route */
+				snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA Route Info option %s/%u", prefix, option_route->mask);
+				alert_raise(2, capture_info->probe, "wrong RA Route Info option", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
+				ret = 2;
 
+#ifdef _COUNTERMEASURES_
+				route_option_error = 1;
+				/* We only propagate a counter measure if the probe is  a local one */
+				if( (locked_probe->type == PROBE_TYPE_INTERFACE) && (locked_probe->cm_enabled == 1) )
+				{
+					cm_kill_wrong_route(router, &capture_info->ip6_header->ip6_src, &option_route->prefix, option_route->mask, option_route->pref_reserved, locked_probe->name);
 				}
+#endif
 
 			}
-
-			/* RFC4191 Route Information */
-			else if(optptr->nd_opt_type ==  ND_OPT_ROUTE_INFORMATION) 
+			else
 			{
-				struct nd_opt_route_info* option_route = (struct nd_opt_route_info*) optptr;
-				uint8_t route_pref_reserved, route_prefix_len;
-				uint32_t lifetime;
-				route_info_t *rinfo = NULL;
-
-				route_pref_reserved   = option_route->nd_opt_ri_pref_reserved;
-				lifetime              = ntohl(option_route->nd_opt_ri_lifetime);
-				route_prefix_len      = option_route->nd_opt_ri_prefix_len;
-				ipv6pre_ntoa(prefix, option_route->nd_opt_ri_prefix);
-
-				/* Is the preference OK ? */
-				if(route_pref_reserved == ND_OPT_RI_PREF_IGNOR)
+				/* Lifetime and preference OK ? */
+				if(option_route->lifetime != rinfo->lifetime)
 				{
-					/* Should not happen */
-					snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA Route Info option: route preference ignor");
-					alert_raise(2, capture_info->probe, "wrong RA Route Info option", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
+					/* Wrong route */
+					snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA Route Info Lifetime %s/%u %u", prefix, option_route->mask, option_route->lifetime);
+					alert_raise(2, capture_info->probe, "wrong RA Route Info lifetime", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
 #ifdef _COUNTERMEASURES_
-					/* route_option_error = 1; */
+					route_option_error = 1;
 #endif
 					ret = 2;
 				}
 
-				/* does this route exist ? */
-				if( (rinfo=router_get_route(*routers, capture_info->ip6_header->ip6_src, *src_eth, option_route->nd_opt_ri_prefix, route_prefix_len)) == NULL)
+				if(option_route->pref_reserved != rinfo->param_pref_reserved)
 				{
 					/* Wrong route */
-					snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA Route Info option %s/%u", prefix, route_prefix_len);
-					alert_raise(2, capture_info->probe, "wrong RA Route Info option", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
-					ret = 2;
-
+					snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA Route Info preference %s/%u %u", prefix, option_route->mask, option_route->pref_reserved);
+					alert_raise(2, capture_info->probe, "wrong RA Route Info preference", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
 #ifdef _COUNTERMEASURES_
 					route_option_error = 1;
-					/* We only propagate a counter measure if the probe is  a local one */
-					if( (locked_probe->type == PROBE_TYPE_INTERFACE) && (locked_probe->cm_enabled == 1) )
-					{
-						cm_kill_wrong_route(router, &capture_info->ip6_header->ip6_src, &option_route->nd_opt_ri_prefix, route_prefix_len, route_pref_reserved, locked_probe->name);
-					}
 #endif
-
-				}
-				else
-				{
-					/* Lifetime and preference OK ? */
-					if(lifetime != rinfo->lifetime)
-					{
-						/* Wrong route */
-						snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA Route Info Lifetime %s/%u %u", prefix, route_prefix_len, lifetime);
-						alert_raise(2, capture_info->probe, "wrong RA Route Info lifetime", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
-#ifdef _COUNTERMEASURES_
-						route_option_error = 1;
-#endif
-						ret = 2;
-					}
-
-					if(route_pref_reserved != rinfo->param_pref_reserved)
-					{
-						/* Wrong route */
-						snprintf (buffer, NOTIFY_BUFFER_SIZE, "wrong RA Route Info preference %s/%u %u", prefix, route_prefix_len, route_pref_reserved);
-						alert_raise(2, capture_info->probe, "wrong RA Route Info preference", buffer, (struct ether_addr*) (ethernet_header->ether_shost), NULL, &capture_info->ip6_header->ip6_src, NULL);
-#ifdef _COUNTERMEASURES_
-						route_option_error = 1;
-#endif
-						ret = 2;
-					}
+					ret = 2;
 				}
-				
-				
 			}
-
-
-			/*Next option field*/
-			option_list = option_list->next;
-		} 
+		}
 		/******************************
 		 * end options
 		 ******************************/
@@ -969,9 +910,20 @@ fprintf(stderr, "    ---> Search domain %s\n", domain);
 		}
 #endif
 
+		/* the RA passed all checks, the next identical ones are accepted directly: */
+		if (ra_fingerprinted && ret==0 && alert_raised_count()==alerts)
+		{
+			router_ra_set_verified(router, ra_canonical, ra_canonical_length, ra_canonical_fingerprint);
+		}
+		if (ret==0 && alert_raised_count()==alerts)
+		{
+			dad_retrans_timer = ntohl(ra->nd_ra_retransmit);
+		}
 	} /* end valid router*/
 
-	probe_unlock(capture_info->probe->name);
+	probe_handle_unlock(capture_info->probe);
+	/* the hosts of the link take the RetransTimer of a valid RA for their DAD: */
+	dad_retrans_timer_set(capture_info->probe, dad_retrans_timer);
 
 	return ret;
 }
@@ -59,6 +59,8 @@ Olivier Festor, Scientific Leader of the MADYNEs Project, 20 August 2006
 #include "ndpmon_defs.h"
 
 #include "../core/alerts.h"
+#include "../core/bindings.h"
+#include "../core/dad.h"
 #include "../core/watchers.h"
 #include "../core/routers.h"
 
@@ -98,6 +100,63 @@ struct nd_opt_dnssl
 /* RFC6106 - END */
 #endif
 
+/** A prefix information option of a RA, in host byte order. */
+struct ra_prefix
+{
+	struct in6_addr prefix;
+	uint8_t mask;
+	uint8_t flags_reserved;
+	uint32_t valid_time;
+	uint32_t preferred_time;
+	uint32_t reserved2;
+};
+
+/** An address of a RDNSS option of a RA (RFC6106). */
+struct ra_nameserver
+{
+	struct in6_addr address;
+	uint32_t lifetime;
+};
+
+/** A domain of a DNSSL option of a RA (RFC6106), as the NUL terminated
+    string of the option (the labels are not decoded). */
+struct ra_domain
+{
+	char domain[MAX_DOMAINLEN+1];
+	uint32_t lifetime;
+};
+
+/** A route information option of a RA (RFC4191). */
+struct ra_route
+{
+	struct in6_addr prefix;
+	uint8_t mask;
+	uint8_t pref_reserved;
+	uint32_t lifetime;
+};
+
+/** The options of a RA watch_ra() looks at, decoded in one pass into
+    bounded arrays so that no allocation is needed. */
+struct ra_options
+{
+	struct ra_prefix prefixes[RA_OPTIONS_PREFIX_MAX];
+	int prefix_count;
+	uint32_t mtus[RA_OPTIONS_MTU_MAX];
+	int mtu_count;
+	struct ra_nameserver nameservers[RA_OPTIONS_NAMESERVER_MAX];
+	int nameserver_count;
+	/** RDNSS options without any address. */
+	int nameserver_empty_count;
+	struct ra_domain domains[RA_OPTIONS_DOMAIN_MAX];
+	int domain_count;
+	/** Domains longer than MAX_DOMAINLEN, the rest of their DNSSL option is skipped. */
+	int domain_too_long_count;
+	struct ra_route routes[RA_OPTIONS_ROUTE_MAX];
+	int route_count;
+	/** Options, addresses and domains that did not fit in the arrays and are not checked. */
+	int truncated_count;
+};
+
 int watch_ra(struct capture_info* const capture_info);
 
 #endif
@@ -44,7 +44,7 @@ int watch_rd_src(struct capture_info* const capture_info)
 	char ip_address[INET6_ADDRSTRLEN], ether_address[ETH_ADDRSTRLEN];
 	struct ether_addr *src_eth = (struct ether_addr *) ethernet_header->ether_shost;
 	int ret = 0;
-	struct probe* locked_probe;
+	const struct probe* locked_probe;
 	int found_router = 12345;
 
 	/* addresses to string */
@@ -52,10 +52,10 @@ int watch_rd_src(struct capture_info* const capture_info)
 	strlcpy( ether_address, ether_ntoa(src_eth), ETH_ADDRSTRLEN);
 
 	/* begin critical section: */
-	locked_probe = probe_lock(capture_info->probe->name);
-	found_router = router_has_router(locked_probe->routers, ip6_header->ip6_src, *src_eth);
+	locked_probe = probe_handle_rdlock(capture_info->probe);
+	found_router = router_find(locked_probe->routers, &ip6_header->ip6_src, src_eth) != NULL;
 	locked_probe = NULL;
-	probe_unlock(capture_info->probe->name);
+	probe_handle_unlock(capture_info->probe);
 	/* end critical section. */
 
 	if(!found_router)
@@ -64,11 +64,11 @@ int watch_rd_src(struct capture_info* const capture_info)
 		int found_lla;
 
 		/* begin critical section: */
-		locked_probe = probe_lock(capture_info->probe->name);
-		found_mac = is_router_mac_in(locked_probe->routers, *src_eth);
+		locked_probe = probe_handle_rdlock(capture_info->probe);
+		found_mac = router_find_by_mac(locked_probe->routers, src_eth) != NULL;
 		found_lla = is_router_lla_in(locked_probe->routers, ip6_header->ip6_src);
 		locked_probe = NULL;
-		probe_unlock(capture_info->probe->name);
+		probe_handle_unlock(capture_info->probe);
 		/* end critical section. */
 
 		if( found_mac && found_lla)
@@ -111,7 +111,7 @@ int watch_rd_src(struct capture_info* const capture_info)
 	if(routers != NULL)
 	{
 		mac_address= (char*)ether_ntoa((struct ether_addr*) (ethernet_header->ether_shost));
-		mac_ok = is_router_mac_in(routers, *src_eth);
+		mac_ok = router_find_by_mac(routers, src_eth) != NULL;
 	}
 	else
 		mac_ok=1;